@@ -52,6 +52,7 @@
 #include "common.h"
 #include "config/files.h"
 #include "config/preferences.h"
+#include "tools/stats.h"
 #include "xmpp/xmpp.h"
 #include "xmpp/muc.h"
 
@@ -231,6 +232,7 @@ static void
 _chat_log_chat(const char* const login, const char* const other, const char* const msg,
                chat_log_direction_t direction, GDateTime* timestamp, const char* const resourcepart)
 {
+    gint64 start = stats_start();
     char* other_name;
     GString* other_str = NULL;
 
@@ -306,6 +308,7 @@ _chat_log_chat(const char* const login, const char* const other, const char* con
 
     g_free(date_fmt);
     g_date_time_unref(timestamp);
+    stats_end(PROF_STATS_CHATLOG, start);
 }
 
 void
@@ -378,6 +381,7 @@ void
 _groupchat_log_chat(const gchar* const login, const gchar* const room, const gchar* const nick,
                     const gchar* const msg)
 {
+    gint64 start = stats_start();
     struct dated_chat_log* dated_log = g_hash_table_lookup(groupchat_logs, room);
 
     // no log for room
@@ -413,6 +417,7 @@ _groupchat_log_chat(const gchar* const login, const gchar* const room, const gch
 
     g_free(date_fmt);
     g_date_time_unref(dt_tmp);
+    stats_end(PROF_STATS_CHATLOG, start);
 }
 
 void
@@ -132,6 +132,9 @@ static char* _lastactivity_autocomplete(ProfWin* window, const char* const input
 static char* _intype_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _mood_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _strophe_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _stats_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _history_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _xmlconsole_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _adhoc_cmd_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _vcard_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 
@@ -280,6 +283,12 @@ static Autocomplete mood_type_ac;
 static Autocomplete strophe_ac;
 static Autocomplete strophe_sm_ac;
 static Autocomplete strophe_verbosity_ac;
+static Autocomplete stats_ac;
+static Autocomplete stats_dump_ac;
+static Autocomplete history_ac;
+static Autocomplete xmlconsole_ac;
+static Autocomplete xmlconsole_filter_ac;
+static Autocomplete xmlconsole_filter_kind_ac;
 static Autocomplete adhoc_cmd_ac;
 static Autocomplete lastactivity_ac;
 static Autocomplete vcard_ac;
@@ -666,6 +675,7 @@ cmd_ac_init(void)
     autocomplete_add(bookmark_ac, "remove");
     autocomplete_add(bookmark_ac, "join");
     autocomplete_add(bookmark_ac, "invites");
+    autocomplete_add(bookmark_ac, "joinlimit");
     autocomplete_add(bookmark_ac, "ignore");
 
     bookmark_property_ac = autocomplete_new();
@@ -983,6 +993,9 @@ cmd_ac_init(void)
     autocomplete_add(plugins_ac, "unload");
     autocomplete_add(plugins_ac, "reload");
     autocomplete_add(plugins_ac, "python_version");
+    autocomplete_add(plugins_ac, "queue");
+    autocomplete_add(plugins_ac, "stats");
+    autocomplete_add(plugins_ac, "budget");
 
     filepath_ac = autocomplete_new();
 
@@ -1115,6 +1128,32 @@ cmd_ac_init(void)
     autocomplete_add(strophe_verbosity_ac, "2");
     autocomplete_add(strophe_verbosity_ac, "3");
 
+    stats_ac = autocomplete_new();
+    autocomplete_add(stats_ac, "reset");
+    autocomplete_add(stats_ac, "dump");
+    stats_dump_ac = autocomplete_new();
+    autocomplete_add(stats_dump_ac, "off");
+
+    history_ac = autocomplete_new();
+    autocomplete_add(history_ac, "on");
+    autocomplete_add(history_ac, "off");
+    autocomplete_add(history_ac, "compact");
+    autocomplete_add(history_ac, "export");
+    autocomplete_add(history_ac, "import");
+
+    xmlconsole_ac = autocomplete_new();
+    autocomplete_add(xmlconsole_ac, "filter");
+    autocomplete_add(xmlconsole_ac, "capture");
+    xmlconsole_filter_ac = autocomplete_new();
+    autocomplete_add(xmlconsole_filter_ac, "element");
+    autocomplete_add(xmlconsole_filter_ac, "ns");
+    autocomplete_add(xmlconsole_filter_ac, "jid");
+    autocomplete_add(xmlconsole_filter_ac, "clear");
+    xmlconsole_filter_kind_ac = autocomplete_new();
+    autocomplete_add(xmlconsole_filter_kind_ac, "element");
+    autocomplete_add(xmlconsole_filter_kind_ac, "ns");
+    autocomplete_add(xmlconsole_filter_kind_ac, "jid");
+
     mood_ac = autocomplete_new();
     autocomplete_add(mood_ac, "set");
     autocomplete_add(mood_ac, "clear");
@@ -1615,6 +1654,12 @@ cmd_ac_reset(ProfWin* window)
     autocomplete_reset(strophe_verbosity_ac);
     autocomplete_reset(strophe_sm_ac);
     autocomplete_reset(strophe_ac);
+    autocomplete_reset(stats_ac);
+    autocomplete_reset(stats_dump_ac);
+    autocomplete_reset(history_ac);
+    autocomplete_reset(xmlconsole_ac);
+    autocomplete_reset(xmlconsole_filter_ac);
+    autocomplete_reset(xmlconsole_filter_kind_ac);
     autocomplete_reset(adhoc_cmd_ac);
 
     autocomplete_reset(vcard_ac);
@@ -1806,6 +1851,12 @@ cmd_ac_uninit(void)
     autocomplete_free(vcard_togglable_param_ac);
     autocomplete_free(vcard_toggle_ac);
     autocomplete_free(vcard_address_type_ac);
+    autocomplete_free(xmlconsole_ac);
+    autocomplete_free(xmlconsole_filter_ac);
+    autocomplete_free(xmlconsole_filter_kind_ac);
+    autocomplete_free(stats_ac);
+    autocomplete_free(stats_dump_ac);
+    autocomplete_free(history_ac);
 }
 
 static void
@@ -1936,7 +1987,7 @@ _cmd_ac_complete_params(ProfWin* window, const char* const input, gboolean previ
 
     // autocomplete boolean settings
     gchar* boolean_choices[] = { "/beep", "/states", "/outtype", "/flash", "/splash",
-                                 "/history", "/vercheck", "/privileges", "/wrap",
+                                 "/vercheck", "/privileges", "/wrap",
                                  "/carbons", "/os", "/slashguard", "/mam", "/silence" };
 
     for (int i = 0; i < ARRAY_SIZE(boolean_choices); i++) {
@@ -2078,6 +2129,9 @@ _cmd_ac_complete_params(ProfWin* window, const char* const input, gboolean previ
     g_hash_table_insert(ac_funcs, "/intype", _intype_autocomplete);
     g_hash_table_insert(ac_funcs, "/mood", _mood_autocomplete);
     g_hash_table_insert(ac_funcs, "/strophe", _strophe_autocomplete);
+    g_hash_table_insert(ac_funcs, "/stats", _stats_autocomplete);
+    g_hash_table_insert(ac_funcs, "/history", _history_autocomplete);
+    g_hash_table_insert(ac_funcs, "/xmlconsole", _xmlconsole_autocomplete);
     g_hash_table_insert(ac_funcs, "/cmd", _adhoc_cmd_autocomplete);
     g_hash_table_insert(ac_funcs, "/vcard", _vcard_autocomplete);
 
@@ -4426,6 +4480,50 @@ _strophe_autocomplete(ProfWin* window, const char* const input, gboolean previou
     return autocomplete_param_with_ac(input, "/strophe", strophe_ac, FALSE, previous);
 }
 
+static char*
+_stats_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    char* result = NULL;
+
+    result = autocomplete_param_with_ac(input, "/stats dump", stats_dump_ac, FALSE, previous);
+    if (result) {
+        return result;
+    }
+
+    return autocomplete_param_with_ac(input, "/stats", stats_ac, FALSE, previous);
+}
+
+static char*
+_history_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    if (strncmp(input, "/history export ", 16) == 0) {
+        return cmd_ac_complete_filepath(input, "/history export", previous);
+    }
+    if (strncmp(input, "/history import ", 16) == 0) {
+        return cmd_ac_complete_filepath(input, "/history import", previous);
+    }
+
+    return autocomplete_param_with_ac(input, "/history", history_ac, FALSE, previous);
+}
+
+static char*
+_xmlconsole_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    char* result = NULL;
+
+    result = autocomplete_param_with_ac(input, "/xmlconsole filter clear", xmlconsole_filter_kind_ac, FALSE, previous);
+    if (result) {
+        return result;
+    }
+
+    result = autocomplete_param_with_ac(input, "/xmlconsole filter", xmlconsole_filter_ac, FALSE, previous);
+    if (result) {
+        return result;
+    }
+
+    return autocomplete_param_with_ac(input, "/xmlconsole", xmlconsole_ac, FALSE, previous);
+}
+
 static char*
 _adhoc_cmd_autocomplete(ProfWin* window, const char* const input, gboolean previous)
 {
@@ -785,6 +785,7 @@ static const struct cmd_t command_defs[] = {
               "/bookmark remove [<room>]",
               "/bookmark join <room>",
               "/bookmark invites on|off",
+              "/bookmark joinlimit <number>",
               "/bookmark ignore",
               "/bookmark ignore add <jid>",
               "/bookmark ignore remove <jid>")
@@ -803,6 +804,7 @@ static const struct cmd_t command_defs[] = {
               { "autojoin on|off", "Whether to join the room automatically on login." },
               { "join <room>", "Join room using the properties associated with the bookmark." },
               { "invites on|off", "Whether or not to bookmark accepted room invites, defaults to 'on'." },
+              { "joinlimit <number>", "Maximum number of rooms joined at the same time on login, remaining rooms wait until earlier joins complete. The current room and rooms with unread messages are joined first. Use 0 to join all rooms at once, defaults to 5." },
               { "ignore add <barejid>", "Add a bookmark to the autojoin ignore list." },
               { "ignore remove <barejid>", "Remove a bookmark from the autojoin ignore list." })
       CMD_EXAMPLES(
@@ -1868,18 +1870,29 @@ static const struct cmd_t command_defs[] = {
     },
 
     { CMD_PREAMBLE("/history",
-                   parse_args, 1, 1, &cons_history_setting)
+                   parse_args, 1, 2, &cons_history_setting)
       CMD_MAINFUNC(cmd_history)
       CMD_TAGS(
               CMD_TAG_UI,
               CMD_TAG_CHAT)
       CMD_SYN(
-              "/history on|off")
+              "/history on|off",
+              "/history compact",
+              "/history export <file>",
+              "/history import <file>|<dir>")
       CMD_DESC(
               "Switch chat history on or off, /logging chat will automatically be enabled when this setting is on. "
-              "When history is enabled, previous messages are shown in chat windows.")
-      CMD_ARGS(
-              { "on|off", "Enable or disable showing chat history." })
+              "When history is enabled, previous messages are shown in chat windows. "
+              "Export and import run in the background and remember how far they got, running them again continues where they stopped.")
+      CMD_ARGS(
+              { "on|off", "Enable or disable showing chat history." },
+              { "compact", "Rebuild the chat log database of the current account to reclaim unused space and refresh its statistics." },
+              { "export <file>", "Write the chat log database of the current account to a file, one message per line. Exporting to the same file again only appends messages logged since." },
+              { "import <file>", "Add the messages of an export file or of a chat log written by /logging to the database. Messages already in the database are skipped." },
+              { "import <dir>", "Import all chat logs below a directory, e.g. the chatlogs directory of an account." })
+      CMD_EXAMPLES(
+              "/history export ~/history.txt",
+              "/history import ~/.local/share/profanity/chatlogs/me_at_server.org")
     },
 
     { CMD_PREAMBLE("/log",
@@ -2142,7 +2155,10 @@ static const struct cmd_t command_defs[] = {
               { "load", cmd_plugins_load },
               { "unload", cmd_plugins_unload },
               { "reload", cmd_plugins_reload },
-              { "python_version", cmd_plugins_python_version })
+              { "python_version", cmd_plugins_python_version },
+              { "queue", cmd_plugins_queue },
+              { "stats", cmd_plugins_stats },
+              { "budget", cmd_plugins_budget })
       CMD_MAINFUNC(cmd_plugins)
       CMD_SYN(
               "/plugins",
@@ -2152,7 +2168,11 @@ static const struct cmd_t command_defs[] = {
               "/plugins unload [<plugin>]",
               "/plugins load [<plugin>]",
               "/plugins reload [<plugin>]",
-              "/plugins python_version")
+              "/plugins python_version",
+              "/plugins queue <size>|off",
+              "/plugins stats [reset]",
+              "/plugins budget <ms>|off",
+              "/plugins budget autodisable on|off")
       CMD_DESC(
               "Manage plugins. Passing no arguments lists installed plugins and global plugins which are available for local installation. Global directory for Python plugins is " GLOBAL_PYTHON_PLUGINS_PATH " and for C Plugins is " GLOBAL_C_PLUGINS_PATH ".")
       CMD_ARGS(
@@ -2162,7 +2182,11 @@ static const struct cmd_t command_defs[] = {
               { "load [<plugin>]", "Load a plugin that already exists in the plugin directory, passing no argument loads all found plugins. It will be loaded upon next start too unless unloaded." },
               { "unload [<plugin>]", "Unload a loaded plugin, passing no argument will unload all plugins." },
               { "reload [<plugin>]", "Reload a plugin, passing no argument will reload all plugins." },
-              { "python_version", "Show the Python interpreter version." })
+              { "python_version", "Show the Python interpreter version." },
+              { "queue <size>|off", "Hooks which only observe, like the post_* hooks or presence and focus changes, are queued and run from the main loop so plugins don't hold up incoming messages. Keep at most <size> calls queued and drop the oldest ones beyond that, 'off' runs them right away. Default 500." },
+              { "stats [reset]", "Show how often each plugin hook was called and how long it took, per plugin." },
+              { "budget <ms>|off", "Time a single hook call may take. A plugin going over it several calls in a row is reported in the console. Default 100ms." },
+              { "budget autodisable on|off", "Unload plugins which keep going over the budget until the next start." })
       CMD_EXAMPLES(
               "/plugins install",
               "/plugins install /home/steveharris/Downloads/metal.py",
@@ -2170,7 +2194,10 @@ static const struct cmd_t command_defs[] = {
               "/plugins uninstall browser.py",
               "/plugins load browser.py",
               "/plugins unload say.py",
-              "/plugins reload wikipedia.py")
+              "/plugins reload wikipedia.py",
+              "/plugins queue 1000",
+              "/plugins stats",
+              "/plugins budget 50")
     },
 
     { CMD_PREAMBLE("/prefs",
@@ -2218,14 +2245,32 @@ static const struct cmd_t command_defs[] = {
     },
 
     { CMD_PREAMBLE("/xmlconsole",
-                   parse_args, 0, 0, NULL)
+                   parse_args, 0, 3, NULL)
       CMD_MAINFUNC(cmd_xmlconsole)
       CMD_TAGS(
               CMD_TAG_UI)
       CMD_SYN(
-              "/xmlconsole")
-      CMD_DESC(
-              "Open the XML console to view incoming and outgoing XMPP traffic.")
+              "/xmlconsole",
+              "/xmlconsole filter",
+              "/xmlconsole filter element|ns|jid <value>",
+              "/xmlconsole filter clear [element|ns|jid]",
+              "/xmlconsole capture <file>|off")
+      CMD_DESC(
+              "Open the XML console to view incoming and outgoing XMPP traffic. "
+              "The console keeps the most recent stanzas and only draws them while it is visible. "
+              "Filters decide which of them are shown, a stanza has to match all filters that are set.")
+      CMD_ARGS(
+              { "filter", "Show the current filters." },
+              { "filter element <name>", "Only show stanzas containing an element with this name." },
+              { "filter ns <namespace>", "Only show stanzas containing this namespace." },
+              { "filter jid <jid>", "Only show stanzas sent from or to this JID, a bare JID also matches its full JIDs." },
+              { "filter clear [element|ns|jid]", "Remove one or all filters." },
+              { "capture <file>", "Append every stanza, regardless of the filters, to a file while the console is open." },
+              { "capture off", "Stop writing to the capture file." })
+      CMD_EXAMPLES(
+              "/xmlconsole filter ns urn:xmpp:mam:2",
+              "/xmlconsole filter jid room@conference.example.org",
+              "/xmlconsole capture /tmp/xmpp.log")
     },
 
     { CMD_PREAMBLE("/script",
@@ -2695,6 +2740,31 @@ static const struct cmd_t command_defs[] = {
               "/strophe verbosity 3",
               "/strophe sm no-resend")
     },
+
+    { CMD_PREAMBLE("/stats",
+                   parse_args, 0, 2, NULL)
+      CMD_MAINFUNC(cmd_stats)
+      CMD_TAGS(
+              CMD_TAG_UI)
+      CMD_SYN(
+              "/stats",
+              "/stats reset",
+              "/stats dump",
+              "/stats dump <seconds>|off")
+      CMD_DESC(
+              "Show how much time Profanity spends handling stanzas, drawing, logging and running plugin hooks. "
+              "For each area the number of calls, the average, an upper bound of the median and 99th percentile and the maximum duration are shown. "
+              "Also shows how many chat states and presence updates were sent, and how many were dropped because a newer one replaced them before they went out. "
+              "The dump file is written to the data directory as 'stats'.")
+      CMD_ARGS(
+              { "reset", "Clear all counters." },
+              { "dump", "Append the current counters to the dump file." },
+              { "dump <seconds>", "Append the counters to the dump file periodically." },
+              { "dump off", "Stop writing the dump file periodically." })
+      CMD_EXAMPLES(
+              "/stats",
+              "/stats dump 300")
+    },
     // NEXT-COMMAND (search helper)
 };
 
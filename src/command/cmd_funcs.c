@@ -61,6 +61,7 @@
 #include "profanity.h"
 #include "log.h"
 #include "common.h"
+#include "database.h"
 #include "command/cmd_funcs.h"
 #include "command/cmd_defs.h"
 #include "command/cmd_ac.h"
@@ -79,6 +80,7 @@
 #include "tools/parser.h"
 #include "tools/bookmark_ignore.h"
 #include "tools/editor.h"
+#include "tools/stats.h"
 #include "plugins/plugins.h"
 #include "ui/ui.h"
 #include "ui/window_list.h"
@@ -202,8 +204,13 @@ cmd_process_input(ProfWin* window, char* inp)
 
         // handle command if input starts with a '/'
     } else if (inp[0] == '/') {
-        char* inp_cpy = strdup(inp);
-        char* command = strtok(inp_cpy, " ");
+        // the command is the first word, short ones are copied to the stack
+        char command_buf[64];
+        size_t command_len = strcspn(inp, " ");
+        char* command = command_len < sizeof(command_buf) ? command_buf : g_malloc(command_len + 1);
+        memcpy(command, inp, command_len);
+        command[command_len] = '\0';
+
         char* question_mark = strchr(command, '?');
         if (question_mark) {
             *question_mark = '\0';
@@ -215,7 +222,9 @@ cmd_process_input(ProfWin* window, char* inp)
         } else {
             result = _cmd_execute(window, command, inp);
         }
-        free(inp_cpy);
+        if (command != command_buf) {
+            g_free(command);
+        }
 
         // call a default handler if input didn't start with '/'
     } else {
@@ -449,6 +458,9 @@ cmd_connect(ProfWin* window, const char* const command, gchar** args)
     // connect with account
     ProfAccount* account = accounts_get_account(user);
     if (account) {
+        // the connect options and password below are only for this connection
+        account = account_unshare(account);
+
         // override account options with connect options
         if (altdomain != NULL)
             account_set_server(account, altdomain);
@@ -4741,6 +4753,32 @@ cmd_bookmark(ProfWin* window, const char* const command, gchar** args)
         return TRUE;
     }
 
+    if (strcmp(cmd, "joinlimit") == 0) {
+        if (args[1] == NULL) {
+            cons_bad_cmd_usage(command);
+            cons_alert(NULL);
+            return TRUE;
+        }
+
+        int limit = 0;
+        char* err_msg = NULL;
+        gboolean res = strtoi_range(args[1], &limit, 0, INT_MAX, &err_msg);
+        if (res) {
+            prefs_set_room_join_limit(limit);
+            if (limit == 0) {
+                cons_show("Rooms will be joined all at once on login.");
+            } else {
+                cons_show("At most %d rooms will be joined at a time on login.", limit);
+            }
+        } else {
+            cons_show(err_msg);
+            cons_bad_cmd_usage(command);
+            free(err_msg);
+        }
+        cons_alert(NULL);
+        return TRUE;
+    }
+
     if (strcmp(cmd, "list") == 0) {
         char* bookmark_jid = args[1];
         if (bookmark_jid == NULL) {
@@ -6778,17 +6816,78 @@ cmd_vercheck(ProfWin* window, const char* const command, gchar** args)
     }
 }
 
+static gboolean
+_xmlconsole_filter_kind_valid(const char* const kind)
+{
+    return g_strcmp0(kind, "element") == 0 || g_strcmp0(kind, "ns") == 0 || g_strcmp0(kind, "jid") == 0;
+}
+
 gboolean
 cmd_xmlconsole(ProfWin* window, const char* const command, gchar** args)
 {
     ProfXMLWin* xmlwin = wins_get_xmlconsole();
-    if (xmlwin) {
-        ui_focus_win((ProfWin*)xmlwin);
-    } else {
-        ProfWin* window = wins_new_xmlconsole();
-        ui_focus_win(window);
+
+    if (args[0] == NULL) {
+        if (xmlwin) {
+            ui_focus_win((ProfWin*)xmlwin);
+        } else {
+            ProfWin* window = wins_new_xmlconsole();
+            ui_focus_win(window);
+        }
+        return TRUE;
+    }
+
+    gboolean is_filter = g_strcmp0(args[0], "filter") == 0;
+    gboolean is_capture = g_strcmp0(args[0], "capture") == 0;
+    if (!is_filter && !is_capture) {
+        cons_bad_cmd_usage(command);
+        return TRUE;
+    }
+
+    if (!xmlwin) {
+        xmlwin = (ProfXMLWin*)wins_new_xmlconsole();
+    }
+
+    if (is_capture) {
+        if (args[1] == NULL) {
+            cons_bad_cmd_usage(command);
+        } else if (g_strcmp0(args[1], "off") == 0) {
+            xmlwin_capture_stop(xmlwin);
+            cons_show("XML console capture stopped.");
+        } else if (xmlwin_capture_start(xmlwin, args[1])) {
+            cons_show("XML console capturing to %s.", args[1]);
+        } else {
+            cons_show_error("Could not open %s for writing: %s", args[1], g_strerror(errno));
+        }
+        return TRUE;
+    }
+
+    if (args[1] == NULL) {
+        xmlwin_show_filters(xmlwin, window);
+        return TRUE;
     }
 
+    if (g_strcmp0(args[1], "clear") == 0) {
+        if (args[2] == NULL) {
+            xmlwin_set_filter(xmlwin, NULL, NULL);
+            cons_show("XML console filters removed.");
+        } else if (_xmlconsole_filter_kind_valid(args[2])) {
+            xmlwin_set_filter(xmlwin, args[2], NULL);
+            cons_show("XML console %s filter removed.", args[2]);
+        } else {
+            cons_bad_cmd_usage(command);
+        }
+        return TRUE;
+    }
+
+    if (args[2] == NULL || !_xmlconsole_filter_kind_valid(args[1])) {
+        cons_bad_cmd_usage(command);
+        return TRUE;
+    }
+
+    xmlwin_set_filter(xmlwin, args[1], args[2]);
+    cons_show("XML console only shows stanzas with %s %s.", args[1], args[2]);
+
     return TRUE;
 }
 
@@ -6946,6 +7045,64 @@ cmd_history(ProfWin* window, const char* const command, gchar** args)
         return FALSE;
     }
 
+    if (g_strcmp0(args[0], "compact") == 0) {
+        if (connection_get_status() != JABBER_CONNECTED) {
+            cons_show("You are not currently connected.");
+            return TRUE;
+        }
+        if (log_database_migrating()) {
+            cons_show("The chat log database is still being migrated, compact it once that has finished.");
+            return TRUE;
+        }
+
+        gint64 size_before = 0;
+        gint64 size_after = 0;
+        if (log_database_compact(&size_before, &size_after)) {
+            auto_gchar gchar* before = g_format_size(size_before);
+            auto_gchar gchar* after = g_format_size(size_after);
+            cons_show("Chat log database compacted from %s to %s.", before, after);
+        } else {
+            cons_show_error("Could not compact the chat log database.");
+        }
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[0], "export") == 0 || g_strcmp0(args[0], "import") == 0) {
+        gboolean export = g_strcmp0(args[0], "export") == 0;
+        if (args[1] == NULL) {
+            cons_bad_cmd_usage(command);
+            return TRUE;
+        }
+        if (connection_get_status() != JABBER_CONNECTED) {
+            cons_show("You are not currently connected.");
+            return TRUE;
+        }
+        if (log_database_migrating()) {
+            cons_show("The chat log database is still being migrated, try again once that has finished.");
+            return TRUE;
+        }
+        if (log_database_transferring()) {
+            cons_show("A history export or import is already running.");
+            return TRUE;
+        }
+
+        auto_gchar gchar* path = get_expanded_path(args[1]);
+        if (export) {
+            if (log_database_export(path)) {
+                cons_show("Exporting chat history to %s.", path);
+            } else {
+                cons_show_error("Could not export chat history to %s.", path);
+            }
+        } else {
+            if (log_database_import(path)) {
+                cons_show("Importing chat history from %s.", path);
+            } else {
+                cons_show_error("Could not import chat history from %s, expected a /history export file, a chat log or a directory of chat logs.", path);
+            }
+        }
+        return TRUE;
+    }
+
     _cmd_set_boolean_preference(args[0], command, "Chat history", PREF_HISTORY);
 
     // if set to on, set chlog (/logging chat on)
@@ -7240,6 +7397,114 @@ cmd_plugins_python_version(ProfWin* window, const char* const command, gchar** a
     return TRUE;
 }
 
+gboolean
+cmd_plugins_queue(ProfWin* window, const char* const command, gchar** args)
+{
+    if (args[1] == NULL) {
+        gint size = prefs_get_plugins_hook_queue();
+        if (size > 0) {
+            cons_show("Plugin hook queue size: %d", size);
+        } else {
+            cons_show("Plugin hooks are run right away.");
+        }
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[1], "off") == 0) {
+        prefs_set_plugins_hook_queue(0);
+        cons_show("Plugin hooks will be run right away.");
+        return TRUE;
+    }
+
+    int size = 0;
+    char* err_msg = NULL;
+    gboolean res = strtoi_range(args[1], &size, 1, INT_MAX, &err_msg);
+    if (!res) {
+        cons_show(err_msg);
+        free(err_msg);
+        return TRUE;
+    }
+
+    prefs_set_plugins_hook_queue(size);
+    cons_show("Plugin hook queue size set to %d.", size);
+
+    return TRUE;
+}
+
+gboolean
+cmd_plugins_stats(ProfWin* window, const char* const command, gchar** args)
+{
+    if (g_strcmp0(args[1], "reset") == 0) {
+        plugins_stats_reset();
+        cons_show("Plugin statistics reset.");
+        return TRUE;
+    } else if (args[1] != NULL) {
+        cons_bad_cmd_usage(command);
+        return TRUE;
+    }
+
+    GSList* lines = plugins_stats_report();
+    if (!lines) {
+        cons_show("No plugin hooks have been called.");
+        return TRUE;
+    }
+
+    cons_show("Plugin hook statistics:");
+    for (GSList* curr = lines; curr; curr = g_slist_next(curr)) {
+        cons_show("%s", (char*)curr->data);
+    }
+    g_slist_free_full(lines, g_free);
+
+    return TRUE;
+}
+
+gboolean
+cmd_plugins_budget(ProfWin* window, const char* const command, gchar** args)
+{
+    if (args[1] == NULL) {
+        gint budget = prefs_get_plugins_hook_budget();
+        if (budget > 0) {
+            cons_show("Plugin hook budget: %dms, autodisable %s.", budget, prefs_get_plugins_hook_autodisable() ? "on" : "off");
+        } else {
+            cons_show("Plugin hook budget is off.");
+        }
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[1], "autodisable") == 0) {
+        if (g_strcmp0(args[2], "on") == 0) {
+            prefs_set_plugins_hook_autodisable(TRUE);
+            cons_show("Plugins over budget will be unloaded.");
+        } else if (g_strcmp0(args[2], "off") == 0) {
+            prefs_set_plugins_hook_autodisable(FALSE);
+            cons_show("Plugins over budget will only be reported.");
+        } else {
+            cons_bad_cmd_usage(command);
+        }
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[1], "off") == 0) {
+        prefs_set_plugins_hook_budget(0);
+        cons_show("Plugin hook budget disabled.");
+        return TRUE;
+    }
+
+    int budget = 0;
+    char* err_msg = NULL;
+    gboolean res = strtoi_range(args[1], &budget, 1, INT_MAX, &err_msg);
+    if (!res) {
+        cons_show(err_msg);
+        free(err_msg);
+        return TRUE;
+    }
+
+    prefs_set_plugins_hook_budget(budget);
+    cons_show("Plugin hook budget set to %dms.", budget);
+
+    return TRUE;
+}
+
 gboolean
 cmd_plugins(ProfWin* window, const char* const command, gchar** args)
 {
@@ -8619,6 +8884,7 @@ cmd_omemo_gen(ProfWin* window, const char* const command, gchar** args)
     ui_update();
     ProfAccount* account = accounts_get_account(session_get_account_name());
     omemo_generate_crypto_materials(account);
+    account_free(account);
     cons_show("OMEMO crytographic materials generated. Your Device ID is %d.", omemo_device_id());
     return TRUE;
 #else
@@ -9411,8 +9677,7 @@ _url_aesgcm_method(ProfWin* window, const char* cmd_template, const char* url, c
         download->cmd_template = NULL;
     }
 
-    pthread_create(&(download->worker), NULL, &aesgcm_file_get, download);
-    aesgcm_download_add_download(download);
+    aesgcm_file_get(download);
 }
 #endif
 
@@ -9430,8 +9695,7 @@ _url_http_method(ProfWin* window, const char* cmd_template, const char* url, con
         download->cmd_template = NULL;
     }
 
-    pthread_create(&(download->worker), NULL, &http_file_get, download);
-    http_download_add_download(download);
+    http_file_get(download);
 }
 
 void
@@ -9886,6 +10150,60 @@ cmd_strophe(ProfWin* window, const char* const command, gchar** args)
     return FALSE;
 }
 
+gboolean
+cmd_stats(ProfWin* window, const char* const command, gchar** args)
+{
+    if (args[0] == NULL) {
+        GSList* lines = stats_report();
+        cons_show("");
+        for (GSList* curr = lines; curr; curr = g_slist_next(curr)) {
+            cons_show("%s", (char*)curr->data);
+        }
+        g_slist_free_full(lines, g_free);
+        cons_alert(NULL);
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[0], "reset") == 0) {
+        stats_reset();
+        cons_show("Statistics reset.");
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[0], "dump") == 0) {
+        if (args[1] == NULL) {
+            if (stats_dump()) {
+                cons_show("Statistics written to the dump file.");
+            } else {
+                cons_show_error("Could not write the statistics dump file.");
+            }
+            return TRUE;
+        }
+
+        if (g_strcmp0(args[1], "off") == 0) {
+            prefs_set_stats_dump_interval(0);
+            cons_show("Periodic statistics dump disabled.");
+            return TRUE;
+        }
+
+        int interval = 0;
+        char* err_msg = NULL;
+        gboolean res = strtoi_range(args[1], &interval, 1, INT_MAX, &err_msg);
+        if (res) {
+            prefs_set_stats_dump_interval(interval);
+            cons_show("Statistics will be written to the dump file every %d seconds.", interval);
+        } else {
+            cons_show(err_msg);
+            cons_bad_cmd_usage(command);
+            free(err_msg);
+        }
+        return TRUE;
+    }
+
+    cons_bad_cmd_usage(command);
+    return TRUE;
+}
+
 gboolean
 cmd_vcard(ProfWin* window, const char* const command, gchar** args)
 {
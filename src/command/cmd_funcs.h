@@ -175,6 +175,9 @@ gboolean cmd_plugins_load(ProfWin* window, const char* const command, gchar** ar
 gboolean cmd_plugins_unload(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_plugins_reload(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_plugins_python_version(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_plugins_queue(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_plugins_stats(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_plugins_budget(ProfWin* window, const char* const command, gchar** args);
 
 gboolean cmd_blocked(ProfWin* window, const char* const command, gchar** args);
 
@@ -258,6 +261,7 @@ gboolean cmd_silence(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_register(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_mood(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_strophe(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_stats(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_stamp(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_vcard(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_vcard_add(ProfWin* window, const char* const command, gchar** args);
@@ -60,6 +60,7 @@ account_new(gchar* name, gchar* jid, gchar* password, gchar* eval_password, gboo
 {
     ProfAccount* new_account = calloc(1, sizeof(ProfAccount));
 
+    new_account->refcnt = 1;
     new_account->name = name;
 
     if (jid) {
@@ -205,6 +206,55 @@ account_eval_password(ProfAccount* account)
     return TRUE;
 }
 
+ProfAccount*
+account_ref(ProfAccount* account)
+{
+    if (account) {
+        account->refcnt++;
+    }
+
+    return account;
+}
+
+static GList*
+_copy_list(GList* list)
+{
+    return g_list_copy_deep(list, (GCopyFunc)g_strdup, NULL);
+}
+
+/*
+ * Accounts are shared between callers and must not be changed in place.
+ * Returns an account the caller may modify, which is the given account
+ * if nobody else holds it, or a private copy otherwise. The reference to
+ * the given account is handed over either way.
+ */
+ProfAccount*
+account_unshare(ProfAccount* account)
+{
+    if (account == NULL || account->refcnt == 1) {
+        return account;
+    }
+
+    ProfAccount* copy = account_new(g_strdup(account->name), g_strdup(account->jid),
+                                    g_strdup(account->password), g_strdup(account->eval_password),
+                                    account->enabled, g_strdup(account->server), account->port,
+                                    g_strdup(account->resource), g_strdup(account->last_presence),
+                                    g_strdup(account->login_presence), account->priority_online,
+                                    account->priority_chat, account->priority_away, account->priority_xa,
+                                    account->priority_dnd, g_strdup(account->muc_service),
+                                    g_strdup(account->muc_nick), g_strdup(account->otr_policy),
+                                    _copy_list(account->otr_manual), _copy_list(account->otr_opportunistic),
+                                    _copy_list(account->otr_always), g_strdup(account->omemo_policy),
+                                    _copy_list(account->omemo_enabled), _copy_list(account->omemo_disabled),
+                                    _copy_list(account->ox_enabled), _copy_list(account->pgp_enabled),
+                                    g_strdup(account->pgp_keyid), g_strdup(account->startscript),
+                                    g_strdup(account->theme), g_strdup(account->tls_policy),
+                                    g_strdup(account->auth_policy));
+    account_free(account);
+
+    return copy;
+}
+
 void
 account_free(ProfAccount* account)
 {
@@ -212,6 +262,10 @@ account_free(ProfAccount* account)
         return;
     }
 
+    if (--account->refcnt > 0) {
+        return;
+    }
+
     free(account->name);
     free(account->jid);
     free(account->password);
@@ -71,6 +71,7 @@ typedef struct prof_account_t
     gchar* theme;
     gchar* tls_policy;
     gchar* auth_policy;
+    int refcnt;
 } ProfAccount;
 
 ProfAccount* account_new(gchar* name, gchar* jid, gchar* password, gchar* eval_password, gboolean enabled,
@@ -83,6 +84,8 @@ ProfAccount* account_new(gchar* name, gchar* jid, gchar* password, gchar* eval_p
                          gchar* startscript, gchar* theme, gchar* tls_policy, gchar* auth_policy);
 char* account_create_connect_jid(ProfAccount* account);
 gboolean account_eval_password(ProfAccount* account);
+ProfAccount* account_ref(ProfAccount* account);
+ProfAccount* account_unshare(ProfAccount* account);
 void account_free(ProfAccount* account);
 void account_set_server(ProfAccount* account, const char* server);
 void account_set_port(ProfAccount* account, int port);
@@ -59,7 +59,11 @@ static GKeyFile* accounts;
 static Autocomplete all_ac;
 static Autocomplete enabled_ac;
 
+// account name -> ProfAccount, each holding one reference, cleared whenever the accounts file changes
+static GHashTable* account_cache;
+
 static void _save_accounts(void);
+static ProfAccount* _accounts_read_account(const char* const name);
 
 void
 accounts_load(void)
@@ -76,6 +80,8 @@ accounts_load(void)
     accounts = g_key_file_new();
     g_key_file_load_from_file(accounts, accounts_loc, G_KEY_FILE_KEEP_COMMENTS, NULL);
 
+    account_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)account_free);
+
     // create the logins searchable list for autocompletion
     gsize naccounts;
     gchar** account_names = g_key_file_get_groups(accounts, &naccounts);
@@ -95,6 +101,8 @@ accounts_close(void)
 {
     autocomplete_free(all_ac);
     autocomplete_free(enabled_ac);
+    g_hash_table_destroy(account_cache);
+    account_cache = NULL;
     g_key_file_free(accounts);
 }
 
@@ -200,8 +208,39 @@ accounts_get_list(void)
     return g_key_file_get_groups(accounts, NULL);
 }
 
+/*
+ * Returns a reference to a shared account, release it with account_free.
+ * The account must not be changed, use account_unshare to get one that can.
+ */
 ProfAccount*
 accounts_get_account(const char* const name)
+{
+    ProfAccount* account = g_hash_table_lookup(account_cache, name);
+    if (account) {
+        // without a muc.service setting the service comes from the connection, which may have changed
+        if (g_key_file_has_key(accounts, name, "muc.service", NULL)) {
+            return account_ref(account);
+        }
+
+        const char* service = NULL;
+        if (connection_get_status() == JABBER_CONNECTED) {
+            service = connection_jid_for_feature(XMPP_FEATURE_MUC);
+        }
+        if (g_strcmp0(service, account->muc_service) == 0) {
+            return account_ref(account);
+        }
+    }
+
+    account = _accounts_read_account(name);
+    if (account) {
+        g_hash_table_replace(account_cache, g_strdup(name), account_ref(account));
+    }
+
+    return account;
+}
+
+static ProfAccount*
+_accounts_read_account(const char* const name)
 {
     if (!g_key_file_has_group(accounts, name)) {
         return NULL;
@@ -933,6 +972,9 @@ accounts_get_login_status(const char* const account_name)
 static void
 _save_accounts(void)
 {
+    // every change to the accounts file goes through here
+    g_hash_table_remove_all(account_cache);
+
     gsize g_data_size;
     gchar* g_accounts_data = g_key_file_to_data(accounts, &g_data_size, NULL);
 
@@ -47,6 +47,7 @@
 #define FILE_CAPSCACHE                "capscache"
 #define FILE_PROFANITY_IDENTIFIER     "profident"
 #define FILE_BOOKMARK_AUTOJOIN_IGNORE "bookmark_ignore"
+#define FILE_STATS                    "stats"
 
 #define DIR_THEMES    "themes"
 #define DIR_ICONS     "icons"
@@ -61,6 +62,7 @@
 #define DIR_EDITOR    "editor"
 #define DIR_CERTS     "certs"
 #define DIR_PHOTOS    "photos"
+#define DIR_ROSTER    "roster"
 
 void files_create_directories(void);
 
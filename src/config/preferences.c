@@ -71,6 +71,7 @@
 
 static gchar* prefs_loc;
 static GKeyFile* prefs;
+static guint prefs_generation = 0;
 gint log_maxsize = 0;
 
 static Autocomplete boolean_choice_ac;
@@ -85,6 +86,8 @@ static char* _get_default_string(preference_t pref);
 static void
 _prefs_load(void)
 {
+    prefs_generation++;
+
     GError* err = NULL;
     log_maxsize = g_key_file_get_integer(prefs, PREF_GROUP_LOGGING, "maxsize", &err);
     if (err) {
@@ -281,6 +284,13 @@ prefs_load(char* config_file)
     _prefs_load();
 }
 
+// bumped whenever a string preference may have changed, lets callers cache them
+guint
+prefs_get_generation(void)
+{
+    return prefs_generation;
+}
+
 void
 prefs_save(void)
 {
@@ -581,6 +591,7 @@ prefs_get_string_with_option(preference_t pref, gchar* option)
 void
 prefs_set_string(preference_t pref, char* value)
 {
+    prefs_generation++;
     const char* group = _get_group(pref);
     const char* key = _get_key(pref);
     if (value == NULL) {
@@ -593,6 +604,7 @@ prefs_set_string(preference_t pref, char* value)
 void
 prefs_set_string_with_option(preference_t pref, char* option, char* value)
 {
+    prefs_generation++;
     const char* group = _get_group(pref);
     const char* key = _get_key(pref);
     if (value == NULL) {
@@ -818,6 +830,82 @@ prefs_get_tray_timer(void)
     }
 }
 
+gint
+prefs_get_room_join_limit(void)
+{
+    if (!g_key_file_has_key(prefs, PREF_GROUP_MUC, "join.limit", NULL)) {
+        return 5;
+    } else {
+        return g_key_file_get_integer(prefs, PREF_GROUP_MUC, "join.limit", NULL);
+    }
+}
+
+void
+prefs_set_room_join_limit(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_MUC, "join.limit", value);
+}
+
+gint
+prefs_get_stats_dump_interval(void)
+{
+    if (!g_key_file_has_key(prefs, PREF_GROUP_LOGGING, "stats.dump", NULL)) {
+        return 0;
+    } else {
+        return g_key_file_get_integer(prefs, PREF_GROUP_LOGGING, "stats.dump", NULL);
+    }
+}
+
+void
+prefs_set_stats_dump_interval(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_LOGGING, "stats.dump", value);
+}
+
+gint
+prefs_get_plugins_hook_queue(void)
+{
+    if (!g_key_file_has_key(prefs, PREF_GROUP_PLUGINS, "hooks.queue", NULL)) {
+        return 500;
+    } else {
+        return g_key_file_get_integer(prefs, PREF_GROUP_PLUGINS, "hooks.queue", NULL);
+    }
+}
+
+void
+prefs_set_plugins_hook_queue(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_PLUGINS, "hooks.queue", value);
+}
+
+gint
+prefs_get_plugins_hook_budget(void)
+{
+    if (!g_key_file_has_key(prefs, PREF_GROUP_PLUGINS, "hooks.budget", NULL)) {
+        return 100;
+    } else {
+        return g_key_file_get_integer(prefs, PREF_GROUP_PLUGINS, "hooks.budget", NULL);
+    }
+}
+
+void
+prefs_set_plugins_hook_budget(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_PLUGINS, "hooks.budget", value);
+}
+
+gboolean
+prefs_get_plugins_hook_autodisable(void)
+{
+    return g_key_file_get_boolean(prefs, PREF_GROUP_PLUGINS, "hooks.autodisable", NULL);
+}
+
+void
+prefs_set_plugins_hook_autodisable(gboolean value)
+{
+    g_key_file_set_boolean(prefs, PREF_GROUP_PLUGINS, "hooks.autodisable", value);
+}
+
 gint
 prefs_get_statusbartabs(void)
 {
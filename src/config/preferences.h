@@ -206,6 +206,7 @@ void prefs_load(char* config_file);
 void prefs_save(void);
 void prefs_close(void);
 void prefs_reload(void);
+guint prefs_get_generation(void);
 
 char* prefs_find_login(char* prefix);
 void prefs_reset_login_search(void);
@@ -306,6 +307,17 @@ void prefs_add_login(const char* jid);
 void prefs_set_tray_timer(gint value);
 gint prefs_get_tray_timer(void);
 
+void prefs_set_room_join_limit(gint value);
+gint prefs_get_room_join_limit(void);
+void prefs_set_stats_dump_interval(gint value);
+gint prefs_get_stats_dump_interval(void);
+void prefs_set_plugins_hook_queue(gint value);
+gint prefs_get_plugins_hook_queue(void);
+void prefs_set_plugins_hook_budget(gint value);
+gint prefs_get_plugins_hook_budget(void);
+void prefs_set_plugins_hook_autodisable(gboolean value);
+gboolean prefs_get_plugins_hook_autodisable(void);
+
 gboolean prefs_add_alias(const char* const name, const char* const value);
 gboolean prefs_remove_alias(const char* const name);
 char* prefs_get_alias(const char* const name);
@@ -33,11 +33,13 @@
  *
  */
 
+
 #include "config.h"
 
 #include <sys/stat.h>
 #include <sqlite3.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,16 +48,127 @@
 #include "log.h"
 #include "common.h"
 #include "config/files.h"
+#include "config/accounts.h"
+#include "tools/history_format.h"
+#include "tools/mainloop.h"
+#include "tools/stats.h"
+#include "tools/timestamp.h"
 #include "database.h"
+#include "ui/ui.h"
 #include "xmpp/xmpp.h"
 #include "xmpp/message.h"
+#include "xmpp/muc.h"
+
+#define DB_VERSION 2
+
+// legacy rows copied to the current schema per main loop iteration
+#define MIGRATE_CHUNK 5000
+
+// longest a MAM batch transaction is held open before it is committed
+#define BATCH_MAX_AGE G_USEC_PER_SEC
+
+// rows exported or imported per main loop iteration
+#define TRANSFER_CHUNK 5000
+
+// progress is reported every TRANSFER_REPORT rows
+#define TRANSFER_REPORT 50000
+
+// first line of a /history export file, followed by one message per line:
+// timestamp type encryption marked_read from_jid from_resource to_jid to_resource stanza_id archive_id replace_id message
+#define TRANSFER_HEADER "#profanity-history 1"
+#define TRANSFER_FIELDS 12
+
+// chat logs carry the time a line was written rather than the one stored for
+// the message, lines this close to a stored message with the same text are
+// taken to be that message
+#define CHATLOG_IMPORT_TOLERANCE (60 * G_USEC_PER_SEC)
+
+// Jids and Resources store every name once, ChatLogs refers to them by id
+typedef struct db_dictionary_t
+{
+    const char* insert;
+    const char* select;
+    GHashTable* ids;
+} DbDictionary;
 
 static sqlite3* g_chatlog_database;
 
-static void _add_to_db(ProfMessage* message, char* type, const Jid* const from_jid, const Jid* const to_jid);
+// while batch_depth > 0 archived messages share one transaction, committed
+// when a batch ends, before a live message is written or after BATCH_MAX_AGE
+static int batch_depth = 0;
+static gboolean in_transaction = FALSE;
+static gint64 transaction_started = 0;
+
+static sqlite3_stmt* insert_stmt = NULL;
+
+typedef struct db_transfer_t
+{
+    gboolean export;
+    char* path;
+    FILE* fp;
+    sqlite3_stmt* stmt;
+    // chat log files still to import, when importing those instead of an export file
+    gboolean chatlog;
+    GSList* files;
+    char* mybarejid;
+    // our default room nick, for rooms we are not in and have no bookmark for
+    char* mynick;
+    // last row stored before the import began, only those are matched within
+    // CHATLOG_IMPORT_TOLERANCE so repeated lines in a log are all imported
+    sqlite3_int64 last_id;
+    sqlite3_int64 position;
+    guint64 added;
+    guint64 skipped;
+    guint64 reported;
+    gboolean failed;
+} DbTransfer;
+
+typedef struct db_transfer_row_t
+{
+    gint64 timestamp;
+    int type;
+    int encryption;
+    int marked_read;
+    const char* from_jid;
+    const char* from_resource;
+    const char* to_jid;
+    const char* to_resource;
+    const char* stanza_id;
+    const char* archive_id;
+    const char* replace_id;
+    const char* message;
+} DbTransferRow;
+
+// the /history export or import in progress, one at a time
+static DbTransfer* transfer = NULL;
+
+static DbDictionary jids = {
+    "INSERT OR IGNORE INTO `Jids` (`jid`) VALUES (?)",
+    "SELECT `id` FROM `Jids` WHERE `jid` = ?",
+    NULL
+};
+
+static DbDictionary resources = {
+    "INSERT OR IGNORE INTO `Resources` (`resource`) VALUES (?)",
+    "SELECT `id` FROM `Resources` WHERE `resource` = ?",
+    NULL
+};
+
+// rows of a version 1 database wait in ChatLogsLegacy until they are migrated,
+// newest first so recent history is available right away
+static gboolean migrating = FALSE;
+static sqlite3_int64 migrate_first = 0;
+static sqlite3_int64 migrate_last = 0;
+static int migrate_reported = 0;
+
+static void _add_to_db(ProfMessage* message, prof_msg_type_t type, const Jid* const from_jid, const Jid* const to_jid);
 static char* _get_db_filename(ProfAccount* account);
-static prof_msg_type_t _get_message_type_type(const char* const type);
-static prof_enc_t _get_message_enc_type(const char* const encstr);
+static int _get_message_type_code(prof_msg_type_t type);
+static prof_msg_type_t _get_message_type_type(int code);
+static int _get_message_enc_code(prof_enc_t enc);
+static prof_enc_t _get_message_enc_type(int code);
+static void _commit_transaction(void);
+static void _transfer_free(void);
 
 #define auto_sqlite __attribute__((__cleanup__(auto_free_sqlite)))
 
@@ -73,6 +186,41 @@ _get_db_filename(ProfAccount* account)
     return files_file_in_account_data_path(DIR_DATABASE, account->jid, "chatlog.db");
 }
 
+static gint64
+_get_timestamp(GDateTime* time)
+{
+    return g_date_time_to_unix(time) * G_USEC_PER_SEC + g_date_time_get_microsecond(time);
+}
+
+// prof_timestamp(stamp) converts the ISO8601 text of legacy rows to microseconds
+static void
+_sql_timestamp(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+{
+    gint64 usec = 0;
+    if (!timestamp_parse_iso8601((const char*)sqlite3_value_text(argv[0]), &usec)) {
+        usec = 0;
+    }
+    sqlite3_result_int64(ctx, usec);
+}
+
+static sqlite3_int64
+_query_int64(const char* const query)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        return 0;
+    }
+
+    sqlite3_int64 result = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        result = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    return result;
+}
+
 gboolean
 log_database_init(ProfAccount* account)
 {
@@ -95,35 +243,97 @@ log_database_init(ProfAccount* account)
         return FALSE;
     }
 
-    char* err_msg;
+    sqlite3_create_function(g_chatlog_database, "prof_timestamp", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, _sql_timestamp, NULL, NULL);
+
+    char* err_msg = NULL;
+    char* query = "CREATE TABLE IF NOT EXISTS `DbVersion` ( `dv_id` INTEGER PRIMARY KEY, `version` INTEGER UNIQUE)";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    // version 1 stored every column as text, move its rows aside to be
+    // migrated by log_database_migrate_step()
+    sqlite3_int64 version = _query_int64("SELECT MAX(`version`) FROM `DbVersion`");
+    gboolean has_chatlogs = _query_int64("SELECT COUNT(*) FROM `sqlite_master` WHERE `type` = 'table' AND `name` = 'ChatLogs'") > 0;
+    if (version < DB_VERSION && has_chatlogs) {
+        query = "BEGIN TRANSACTION;"
+                "ALTER TABLE `ChatLogs` RENAME TO `ChatLogsLegacy`;"
+                "DROP INDEX IF EXISTS `ChatLogs_archive_id`;"
+                "DROP INDEX IF EXISTS `ChatLogs_stanza_id`;"
+                "COMMIT";
+        if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+            sqlite3_exec(g_chatlog_database, "ROLLBACK", NULL, 0, NULL);
+            goto out;
+        }
+        log_info("Chat log database is version %lld, migrating to version %d", version, DB_VERSION);
+    }
+
     // id is the ID of DB the entry
-    // from_jid is the senders jid
-    // to_jid is the receivers jid
-    // from_resource is the senders resource
-    // to_jid is the receivers resource
+    // from_jid and to_jid are the ids of the senders and receivers bare jid in Jids
+    // from_resource and to_resource are the ids of their resources in Resources, NULL if there is none
     // message is the message text
-    // timestamp the timestamp like "2020/03/24 11:12:14"
-    // type is there to distinguish: message (chat), MUC message (muc), muc pm (mucpm)
+    // timestamp is the time in microseconds since the epoch
+    // type is there to distinguish: message (chat) 1, MUC message (muc) 2, muc pm (mucpm) 3
     // stanza_id is the ID in <message>
     // archive_id is the stanza-id from from XEP-0359: Unique and Stable Stanza IDs used for XEP-0313: Message Archive Management
     // replace_id is the ID from XEP-0308: Last Message Correction
-    // encryption is to distinguish: none, omemo, otr, pgp
+    // encryption is to distinguish: none 0, otr 1, pgp 2, omemo 3, ox 4
     // marked_read is 0/1 whether a message has been marked as read via XEP-0333: Chat Markers
-    char* query = "CREATE TABLE IF NOT EXISTS `ChatLogs` ( `id` INTEGER PRIMARY KEY AUTOINCREMENT, `from_jid` TEXT NOT NULL, `to_jid` TEXT NOT NULL, `from_resource` TEXT, `to_resource` TEXT, `message` TEXT, `timestamp` TEXT, `type` TEXT, `stanza_id` TEXT, `archive_id` TEXT, `replace_id` TEXT, `encryption` TEXT, `marked_read` INTEGER)";
+    // the ids are NULL when a message has none
+    query = "CREATE TABLE IF NOT EXISTS `Jids` ( `id` INTEGER PRIMARY KEY, `jid` TEXT NOT NULL UNIQUE);"
+            "CREATE TABLE IF NOT EXISTS `Resources` ( `id` INTEGER PRIMARY KEY, `resource` TEXT NOT NULL UNIQUE);"
+            "CREATE TABLE IF NOT EXISTS `ChatLogs` ( `id` INTEGER PRIMARY KEY, `from_jid` INTEGER NOT NULL REFERENCES `Jids` (`id`), `to_jid` INTEGER NOT NULL REFERENCES `Jids` (`id`), `from_resource` INTEGER REFERENCES `Resources` (`id`), `to_resource` INTEGER REFERENCES `Resources` (`id`), `message` TEXT, `timestamp` INTEGER NOT NULL, `type` INTEGER, `stanza_id` TEXT, `archive_id` TEXT, `replace_id` TEXT, `encryption` INTEGER, `marked_read` INTEGER)";
     if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
         goto out;
     }
 
-    query = "CREATE TABLE IF NOT EXISTS `DbVersion` ( `dv_id` INTEGER PRIMARY KEY, `version` INTEGER UNIQUE)";
+    query = "INSERT OR IGNORE INTO `DbVersion` (`version`) VALUES('2')";
     if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
         goto out;
     }
 
-    query = "INSERT OR IGNORE INTO `DbVersion` (`version`) VALUES('1')";
+    // history is read per conversation in timestamp order
+    query = "CREATE INDEX IF NOT EXISTS `ChatLogs_conversation` ON `ChatLogs` (`from_jid`, `to_jid`, `timestamp`)";
     if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
         goto out;
     }
 
+    // every insert checks for an existing archive_id or stanza_id
+    query = "CREATE INDEX IF NOT EXISTS `ChatLogs_archive_id` ON `ChatLogs` (`archive_id`) WHERE `archive_id` IS NOT NULL";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    query = "CREATE INDEX IF NOT EXISTS `ChatLogs_stanza_id` ON `ChatLogs` (`stanza_id`) WHERE `stanza_id` IS NOT NULL";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    // corrections are joined to the message they replace
+    query = "CREATE INDEX IF NOT EXISTS `ChatLogs_replace_id` ON `ChatLogs` (`replace_id`) WHERE `replace_id` IS NOT NULL";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    // synced_until is the end of the last MAM catch-up that finished for a contact
+    query = "CREATE TABLE IF NOT EXISTS `MamSync` ( `contact_jid` TEXT PRIMARY KEY, `synced_until` TEXT NOT NULL)";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    // position is the last ChatLogs id written by an export, or the offset an import has reached in its file
+    query = "CREATE TABLE IF NOT EXISTS `Transfers` ( `direction` TEXT NOT NULL, `path` TEXT NOT NULL, `position` INTEGER NOT NULL, PRIMARY KEY (`direction`, `path`))";
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        goto out;
+    }
+
+    if (_query_int64("SELECT COUNT(*) FROM `sqlite_master` WHERE `type` = 'table' AND `name` = 'ChatLogsLegacy'") > 0) {
+        migrating = TRUE;
+        migrate_first = _query_int64("SELECT MIN(`id`) FROM `ChatLogsLegacy`");
+        migrate_last = _query_int64("SELECT MAX(`id`) FROM `ChatLogsLegacy`");
+        migrate_reported = -1;
+    }
+
     log_debug("Initialized SQLite database: %s", filename);
     free(filename);
     return TRUE;
@@ -143,29 +353,228 @@ void
 log_database_close(void)
 {
     if (g_chatlog_database) {
+        if (transfer) {
+            // progress is saved per chunk, running the command again resumes
+            log_info("Stopping history %s of %s", transfer->export ? "export" : "import", transfer->path);
+            _transfer_free();
+        }
+        _commit_transaction();
+        batch_depth = 0;
+        if (insert_stmt) {
+            sqlite3_finalize(insert_stmt);
+            insert_stmt = NULL;
+        }
         sqlite3_close(g_chatlog_database);
         sqlite3_shutdown();
         g_chatlog_database = NULL;
     }
+
+    if (jids.ids) {
+        g_hash_table_destroy(jids.ids);
+        jids.ids = NULL;
+    }
+    if (resources.ids) {
+        g_hash_table_destroy(resources.ids);
+        resources.ids = NULL;
+    }
+    migrating = FALSE;
+}
+
+static void
+_migrate_finish(void)
+{
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "DROP TABLE `ChatLogsLegacy`", NULL, 0, &err_msg)) {
+        log_error("SQLite error: %s", err_msg ? err_msg : "unknown error");
+        sqlite3_free(err_msg);
+    }
+    migrating = FALSE;
+
+    log_info("Chat log database migrated to version %d", DB_VERSION);
+    cons_show("Chat log database migrated, use '/history compact' to reclaim the space of the old format.");
+}
+
+// Copy the newest MIGRATE_CHUNK legacy rows to the current schema, TRUE while
+// rows are left. Called from the main loop so the UI stays responsive.
+gboolean
+log_database_migrate_step(void)
+{
+    if (!g_chatlog_database || !migrating) {
+        return FALSE;
+    }
+
+    // a MAM batch holds the transaction, log_database_batch_end() wakes the
+    // main loop to continue once it is committed
+    if (batch_depth > 0) {
+        return FALSE;
+    }
+
+    if (migrate_reported == -1) {
+        cons_show("Migrating chat log database, older history becomes available as it is converted.");
+        migrate_reported = 0;
+    }
+
+    sqlite3_int64 hi = _query_int64("SELECT MAX(`id`) FROM `ChatLogsLegacy`");
+    if (hi == 0) {
+        _migrate_finish();
+        return FALSE;
+    }
+    sqlite3_int64 lo = hi - MIGRATE_CHUNK;
+
+    auto_sqlite gchar* query = sqlite3_mprintf(
+        "BEGIN TRANSACTION;"
+        "INSERT OR IGNORE INTO `Jids` (`jid`) SELECT `from_jid` FROM `ChatLogsLegacy` WHERE `id` > %lld AND `id` <= %lld UNION SELECT `to_jid` FROM `ChatLogsLegacy` WHERE `id` > %lld AND `id` <= %lld;"
+        "INSERT OR IGNORE INTO `Resources` (`resource`) SELECT `from_resource` FROM `ChatLogsLegacy` WHERE `id` > %lld AND `id` <= %lld AND `from_resource` != '' UNION SELECT `to_resource` FROM `ChatLogsLegacy` WHERE `id` > %lld AND `id` <= %lld AND `to_resource` != '';"
+        "INSERT INTO `ChatLogs` (`from_jid`, `from_resource`, `to_jid`, `to_resource`, `message`, `timestamp`, `stanza_id`, `archive_id`, `replace_id`, `type`, `encryption`, `marked_read`) "
+        "SELECT F.`id`, FR.`id`, T.`id`, TR.`id`, L.`message`, prof_timestamp(L.`timestamp`), NULLIF(L.`stanza_id`, ''), NULLIF(L.`archive_id`, ''), NULLIF(L.`replace_id`, ''), "
+        "CASE L.`type` WHEN 'chat' THEN 1 WHEN 'muc' THEN 2 WHEN 'mucpm' THEN 3 END, "
+        "CASE L.`encryption` WHEN 'otr' THEN 1 WHEN 'pgp' THEN 2 WHEN 'omemo' THEN 3 WHEN 'ox' THEN 4 ELSE 0 END, L.`marked_read` "
+        "FROM `ChatLogsLegacy` AS L JOIN `Jids` AS F ON F.`jid` = L.`from_jid` JOIN `Jids` AS T ON T.`jid` = L.`to_jid` "
+        "LEFT JOIN `Resources` AS FR ON FR.`resource` = L.`from_resource` LEFT JOIN `Resources` AS TR ON TR.`resource` = L.`to_resource` "
+        "WHERE L.`id` > %lld AND L.`id` <= %lld "
+        "AND NOT EXISTS (SELECT 1 FROM `ChatLogs` AS C WHERE C.`archive_id` = NULLIF(L.`archive_id`, '') OR C.`stanza_id` = NULLIF(L.`stanza_id`, ''));"
+        "DELETE FROM `ChatLogsLegacy` WHERE `id` > %lld AND `id` <= %lld;"
+        "COMMIT",
+        lo, hi, lo, hi, lo, hi, lo, hi, lo, hi, lo, hi);
+    if (!query) {
+        log_error("log_database_migrate_step(): SQL query. could not allocate memory");
+        return TRUE;
+    }
+
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
+        log_error("Chat log migration failed: %s", err_msg ? err_msg : "unknown error");
+        cons_show_error("Chat log migration failed: %s", err_msg ? err_msg : "unknown error");
+        cons_show_error("History not migrated yet stays unavailable, migration resumes on the next start.");
+        sqlite3_free(err_msg);
+        sqlite3_exec(g_chatlog_database, "ROLLBACK", NULL, 0, NULL);
+        // leave the legacy rows for the next start instead of retrying every iteration
+        migrating = FALSE;
+        return FALSE;
+    }
+
+    sqlite3_int64 total = migrate_last - migrate_first + 1;
+    int percent = total > 0 ? (int)((migrate_last - MAX(lo, migrate_first - 1)) * 100 / total) : 100;
+    if (percent / 10 > migrate_reported / 10 && percent < 100) {
+        cons_show("Migrating chat log database: %d%%", percent);
+        migrate_reported = percent;
+    }
+
+    if (lo < migrate_first) {
+        _migrate_finish();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static sqlite3_int64
+_get_db_size(void)
+{
+    return _query_int64("PRAGMA page_count") * _query_int64("PRAGMA page_size");
+}
+
+// Rebuild the database file and refresh the query planner statistics
+gboolean
+log_database_compact(gint64* size_before, gint64* size_after)
+{
+    if (!g_chatlog_database) {
+        return FALSE;
+    }
+
+    // VACUUM cannot run inside a transaction
+    _commit_transaction();
+
+    *size_before = _get_db_size();
+
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "VACUUM; ANALYZE", NULL, 0, &err_msg)) {
+        log_error("SQLite error: %s", err_msg ? err_msg : "unknown error");
+        sqlite3_free(err_msg);
+        return FALSE;
+    }
+
+    *size_after = _get_db_size();
+
+    return TRUE;
+}
+
+gboolean
+log_database_migrating(void)
+{
+    return migrating;
+}
+
+// Row id of name in the dictionary, 0 for an empty name or when it is missing
+// and create is FALSE
+static sqlite3_int64
+_dictionary_id(DbDictionary* dict, const char* const name, gboolean create)
+{
+    if (!name || name[0] == '\0') {
+        return 0;
+    }
+
+    if (!dict->ids) {
+        dict->ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    gint64* cached = g_hash_table_lookup(dict->ids, name);
+    if (cached) {
+        return *cached;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (create) {
+        if (sqlite3_prepare_v2(g_chatlog_database, dict->insert, -1, &stmt, NULL) != SQLITE_OK) {
+            log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+            return 0;
+        }
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    if (sqlite3_prepare_v2(g_chatlog_database, dict->select, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+
+    sqlite3_int64 id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    if (id != 0) {
+        gint64* value = g_new(gint64, 1);
+        *value = id;
+        g_hash_table_insert(dict->ids, g_strdup(name), value);
+    }
+
+    return id;
 }
 
 void
 log_database_add_incoming(ProfMessage* message)
 {
+    gint64 start = stats_start();
     if (message->to_jid) {
-        _add_to_db(message, NULL, message->from_jid, message->to_jid);
+        _add_to_db(message, PROF_MSG_TYPE_UNINITIALIZED, message->from_jid, message->to_jid);
     } else {
         Jid* myjid = jid_create(connection_get_fulljid());
 
-        _add_to_db(message, NULL, message->from_jid, myjid);
+        _add_to_db(message, PROF_MSG_TYPE_UNINITIALIZED, message->from_jid, myjid);
 
         jid_destroy(myjid);
     }
+    stats_end(PROF_STATS_DATABASE_ADD, start);
 }
 
 static void
-_log_database_add_outgoing(char* type, const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc)
+_log_database_add_outgoing(prof_msg_type_t type, const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc)
 {
+    gint64 start = stats_start();
     ProfMessage* msg = message_init();
 
     msg->id = id ? strdup(id) : NULL;
@@ -181,24 +590,25 @@ _log_database_add_outgoing(char* type, const char* const id, const char* const b
 
     jid_destroy(myjid);
     message_free(msg);
+    stats_end(PROF_STATS_DATABASE_ADD, start);
 }
 
 void
 log_database_add_outgoing_chat(const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc)
 {
-    _log_database_add_outgoing("chat", id, barejid, message, replace_id, enc);
+    _log_database_add_outgoing(PROF_MSG_TYPE_CHAT, id, barejid, message, replace_id, enc);
 }
 
 void
 log_database_add_outgoing_muc(const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc)
 {
-    _log_database_add_outgoing("muc", id, barejid, message, replace_id, enc);
+    _log_database_add_outgoing(PROF_MSG_TYPE_MUC, id, barejid, message, replace_id, enc);
 }
 
 void
 log_database_add_outgoing_muc_pm(const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc)
 {
-    _log_database_add_outgoing("mucpm", id, barejid, message, replace_id, enc);
+    _log_database_add_outgoing(PROF_MSG_TYPE_MUCPM, id, barejid, message, replace_id, enc);
 }
 
 // Get info (timestamp and stanza_id) of the first or last message in db
@@ -206,46 +616,166 @@ ProfMessage*
 log_database_get_limits_info(const gchar* const contact_barejid, gboolean is_last)
 {
     sqlite3_stmt* stmt = NULL;
-    gchar* query;
     const char* jid = connection_get_fulljid();
     Jid* myjid = jid_create(jid);
     if (!myjid)
         return NULL;
 
-    if (is_last) {
-        query = sqlite3_mprintf("SELECT * FROM (SELECT `archive_id`, `timestamp` from `ChatLogs` WHERE (`from_jid` = '%q' AND `to_jid` = '%q') OR (`from_jid` = '%q' AND `to_jid` = '%q') ORDER BY `timestamp` DESC LIMIT 1) ORDER BY `timestamp` ASC;", contact_barejid, myjid->barejid, myjid->barejid, contact_barejid);
-    } else {
-        query = sqlite3_mprintf("SELECT * FROM (SELECT `archive_id`, `timestamp` from `ChatLogs` WHERE (`from_jid` = '%q' AND `to_jid` = '%q') OR (`from_jid` = '%q' AND `to_jid` = '%q') ORDER BY `timestamp` ASC LIMIT 1) ORDER BY `timestamp` ASC;", contact_barejid, myjid->barejid, myjid->barejid, contact_barejid);
+    sqlite3_int64 contact_id = _dictionary_id(&jids, contact_barejid, FALSE);
+    sqlite3_int64 my_id = _dictionary_id(&jids, myjid->barejid, FALSE);
+    jid_destroy(myjid);
+
+    ProfMessage* msg = message_init();
+    if (contact_id == 0 || my_id == 0) {
+        return msg;
     }
 
+    auto_sqlite gchar* query = sqlite3_mprintf("SELECT `archive_id`, `timestamp` FROM `ChatLogs` WHERE (`from_jid` = ?1 AND `to_jid` = ?2) OR (`from_jid` = ?2 AND `to_jid` = ?1) ORDER BY `timestamp` %s LIMIT 1", is_last ? "DESC" : "ASC");
     if (!query) {
         log_error("log_database_get_last_info(): SQL query. could not allocate memory");
-        return NULL;
+        return msg;
     }
 
-    jid_destroy(myjid);
-
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("log_database_get_last_info(): unknown SQLite error");
-        return NULL;
+        return msg;
     }
-
-    ProfMessage* msg = message_init();
+    sqlite3_bind_int64(stmt, 1, contact_id);
+    sqlite3_bind_int64(stmt, 2, my_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        char* archive_id = (char*)sqlite3_column_text(stmt, 0);
-        char* date = (char*)sqlite3_column_text(stmt, 1);
+        const char* archive_id = (const char*)sqlite3_column_text(stmt, 0);
 
-        msg->stanzaid = strdup(archive_id);
-        msg->timestamp = g_date_time_new_from_iso8601(date, NULL);
+        msg->stanzaid = strdup(archive_id ? archive_id : "");
+        msg->timestamp = timestamp_local_from_usec(sqlite3_column_int64(stmt, 1));
     }
     sqlite3_finalize(stmt);
-    sqlite3_free(query);
 
     return msg;
 }
 
+// Time of the last logged message with contact_barejid, NULL if there is none
+GDateTime*
+log_database_get_last_timestamp(const gchar* const contact_barejid)
+{
+    if (!g_chatlog_database) {
+        return NULL;
+    }
+
+    ProfMessage* last = log_database_get_limits_info(contact_barejid, TRUE);
+    if (!last) {
+        return NULL;
+    }
+
+    GDateTime* result = last->timestamp ? g_date_time_ref(last->timestamp) : NULL;
+    message_free(last);
+
+    return result;
+}
+
+static void
+_commit_transaction(void)
+{
+    if (!in_transaction) {
+        return;
+    }
+
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "COMMIT", NULL, 0, &err_msg)) {
+        log_error("SQLite error: %s", err_msg ? err_msg : "unknown error");
+        sqlite3_free(err_msg);
+    }
+    in_transaction = FALSE;
+}
+
+// Group the archived messages written until the matching
+// log_database_batch_end() into a single transaction. Batches may overlap,
+// e.g. concurrent MAM pages.
+void
+log_database_batch_begin(void)
+{
+    batch_depth++;
+}
+
+void
+log_database_batch_end(void)
+{
+    if (batch_depth > 0) {
+        batch_depth--;
+    }
+
+    if (g_chatlog_database) {
+        _commit_transaction();
+
+        // migrations and transfers wait for batches, continue them without waiting for input
+        if (batch_depth == 0 && (migrating || transfer)) {
+            mainloop_wakeup();
+        }
+    }
+}
+
+// Called from the main loop, a MAM page that is never answered must not keep
+// the messages received so far uncommitted
+void
+log_database_batch_check(void)
+{
+    if (in_transaction && g_get_monotonic_time() - transaction_started >= BATCH_MAX_AGE) {
+        _commit_transaction();
+    }
+}
+
+GDateTime*
+log_database_get_mam_watermark(const gchar* const contact_barejid)
+{
+    if (!g_chatlog_database) {
+        return NULL;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(g_chatlog_database, "SELECT `synced_until` FROM `MamSync` WHERE `contact_jid` = ?", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("log_database_get_mam_watermark(): unknown SQLite error");
+        return NULL;
+    }
+    sqlite3_bind_text(stmt, 1, contact_barejid, -1, SQLITE_STATIC);
+
+    GDateTime* result = NULL;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* synced_until = (const char*)sqlite3_column_text(stmt, 0);
+        if (synced_until) {
+            result = timestamp_local_from_iso8601(synced_until);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    return result;
+}
+
+void
+log_database_set_mam_watermark(const gchar* const contact_barejid, GDateTime* synced_until)
+{
+    if (!g_chatlog_database) {
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(g_chatlog_database, "INSERT OR REPLACE INTO `MamSync` (`contact_jid`, `synced_until`) VALUES (?, ?)", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("log_database_set_mam_watermark(): unknown SQLite error");
+        return;
+    }
+
+    auto_gchar gchar* date_fmt = g_date_time_format_iso8601(synced_until);
+    sqlite3_bind_text(stmt, 1, contact_barejid, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, date_fmt, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_error("log_database_set_mam_watermark(): %s", sqlite3_errmsg(g_chatlog_database));
+    }
+    sqlite3_finalize(stmt);
+}
+
 // Query previous chats, constraints start_time and end_time. If end_time is
 // null the current time is used. from_start gets first few messages if true
 // otherwise the last ones. Flip flips the order of the results
@@ -255,48 +785,62 @@ log_database_get_previous_chat(const gchar* const contact_barejid, char* start_t
     sqlite3_stmt* stmt = NULL;
     const char* jid = connection_get_fulljid();
     Jid* myjid = jid_create(jid);
-    if (!myjid)
+    if (!myjid) {
+        g_free(end_time);
         return NULL;
+    }
+
+    sqlite3_int64 contact_id = _dictionary_id(&jids, contact_barejid, FALSE);
+    sqlite3_int64 my_id = _dictionary_id(&jids, myjid->barejid, FALSE);
+    jid_destroy(myjid);
+
+    gint64 end_usec;
+    if (!timestamp_parse_iso8601(end_time, &end_usec)) {
+        end_usec = g_get_real_time();
+    }
+    g_free(end_time);
+
+    if (contact_id == 0 || my_id == 0) {
+        return NULL;
+    }
 
     // Flip order when querying older pages
     gchar* sort1 = from_start ? "ASC" : "DESC";
     gchar* sort2 = !flip ? "ASC" : "DESC";
-    GDateTime* now = g_date_time_new_now_local();
-    gchar* end_date_fmt = end_time ? end_time : g_date_time_format_iso8601(now);
-    auto_sqlite gchar* query = sqlite3_mprintf("SELECT * FROM (SELECT COALESCE(B.`message`, A.`message`) AS message, A.`timestamp`, A.`from_jid`, A.`type`, A.`encryption` from `ChatLogs` AS A LEFT JOIN `ChatLogs` AS B ON A.`stanza_id` = B.`replace_id` WHERE A.`replace_id` = '' AND ((A.`from_jid` = '%q' AND A.`to_jid` = '%q') OR (A.`from_jid` = '%q' AND A.`to_jid` = '%q')) AND A.`timestamp` < '%q' AND (%Q IS NULL OR A.`timestamp` > %Q) ORDER BY A.`timestamp` %s LIMIT %d) ORDER BY `timestamp` %s;", contact_barejid, myjid->barejid, myjid->barejid, contact_barejid, end_date_fmt, start_time, start_time, sort1, MESSAGES_TO_RETRIEVE, sort2);
-
-    g_date_time_unref(now);
-    g_free(end_date_fmt);
+    auto_sqlite gchar* query = sqlite3_mprintf("SELECT * FROM (SELECT COALESCE(B.`message`, A.`message`) AS message, A.`timestamp`, J.`jid`, A.`type`, A.`encryption`, R.`resource` FROM `ChatLogs` AS A LEFT JOIN `ChatLogs` AS B ON B.`replace_id` = A.`stanza_id` JOIN `Jids` AS J ON J.`id` = A.`from_jid` LEFT JOIN `Resources` AS R ON R.`id` = A.`from_resource` WHERE A.`replace_id` IS NULL AND ((A.`from_jid` = ?1 AND A.`to_jid` = ?2) OR (A.`from_jid` = ?2 AND A.`to_jid` = ?1)) AND A.`timestamp` < ?3 AND (?4 IS NULL OR A.`timestamp` > ?4) ORDER BY A.`timestamp` %s LIMIT %d) ORDER BY `timestamp` %s;", sort1, MESSAGES_TO_RETRIEVE, sort2);
 
     if (!query) {
         log_error("log_database_get_previous_chat(): SQL query. could not allocate memory");
         return NULL;
     }
 
-    jid_destroy(myjid);
-
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("log_database_get_previous_chat(): unknown SQLite error");
         return NULL;
     }
+    sqlite3_bind_int64(stmt, 1, contact_id);
+    sqlite3_bind_int64(stmt, 2, my_id);
+    sqlite3_bind_int64(stmt, 3, end_usec);
+    gint64 start_usec;
+    if (timestamp_parse_iso8601(start_time, &start_usec)) {
+        sqlite3_bind_int64(stmt, 4, start_usec);
+    }
 
     GSList* history = NULL;
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         // TODO: also save to jid. since now part of profmessage
-        char* message = (char*)sqlite3_column_text(stmt, 0);
-        char* date = (char*)sqlite3_column_text(stmt, 1);
-        char* from = (char*)sqlite3_column_text(stmt, 2);
-        char* type = (char*)sqlite3_column_text(stmt, 3);
-        char* encryption = (char*)sqlite3_column_text(stmt, 3);
+        const char* message = (const char*)sqlite3_column_text(stmt, 0);
+        const char* from = (const char*)sqlite3_column_text(stmt, 2);
+        const char* resource = (const char*)sqlite3_column_text(stmt, 5);
 
         ProfMessage* msg = message_init();
-        msg->from_jid = jid_create(from);
-        msg->plain = strdup(message);
-        msg->timestamp = g_date_time_new_from_iso8601(date, NULL);
-        msg->type = _get_message_type_type(type);
-        msg->enc = _get_message_enc_type(encryption);
+        msg->from_jid = resource ? jid_create_from_bare_and_resource(from, resource) : jid_create(from);
+        msg->plain = strdup(message ? message : "");
+        msg->timestamp = timestamp_local_from_usec(sqlite3_column_int64(stmt, 1));
+        msg->type = _get_message_type_type(sqlite3_column_int(stmt, 3));
+        msg->enc = _get_message_enc_type(sqlite3_column_int(stmt, 4));
 
         history = g_slist_append(history, msg);
     }
@@ -305,124 +849,747 @@ log_database_get_previous_chat(const gchar* const contact_barejid, char* start_t
     return history;
 }
 
-static const char*
-_get_message_type_str(prof_msg_type_t type)
+// type and encryption are stored as these codes, keep them stable
+static int
+_get_message_type_code(prof_msg_type_t type)
 {
     switch (type) {
     case PROF_MSG_TYPE_CHAT:
-        return "chat";
+        return 1;
     case PROF_MSG_TYPE_MUC:
-        return "muc";
+        return 2;
     case PROF_MSG_TYPE_MUCPM:
-        return "mucpm";
+        return 3;
     case PROF_MSG_TYPE_UNINITIALIZED:
-        return NULL;
+        return 0;
     }
-    return NULL;
+    return 0;
 }
 
 static prof_msg_type_t
-_get_message_type_type(const char* const type)
+_get_message_type_type(int code)
 {
-    if (g_strcmp0(type, "chat") == 0) {
+    switch (code) {
+    case 1:
         return PROF_MSG_TYPE_CHAT;
-    } else if (g_strcmp0(type, "muc") == 0) {
+    case 2:
         return PROF_MSG_TYPE_MUC;
-    } else if (g_strcmp0(type, "mucpm") == 0) {
+    case 3:
         return PROF_MSG_TYPE_MUCPM;
-    } else {
+    default:
         return PROF_MSG_TYPE_UNINITIALIZED;
     }
 }
 
-static const char*
-_get_message_enc_str(prof_enc_t enc)
+static int
+_get_message_enc_code(prof_enc_t enc)
 {
     switch (enc) {
-    case PROF_MSG_ENC_OX:
-        return "ox";
-    case PROF_MSG_ENC_PGP:
-        return "pgp";
     case PROF_MSG_ENC_OTR:
-        return "otr";
+        return 1;
+    case PROF_MSG_ENC_PGP:
+        return 2;
     case PROF_MSG_ENC_OMEMO:
-        return "omemo";
+        return 3;
+    case PROF_MSG_ENC_OX:
+        return 4;
     case PROF_MSG_ENC_NONE:
-        return "none";
+        return 0;
     }
 
-    return "none";
+    return 0;
 }
 
 static prof_enc_t
-_get_message_enc_type(const char* const encstr)
+_get_message_enc_type(int code)
 {
-    if (g_strcmp0(encstr, "ox") == 0) {
-        return PROF_MSG_ENC_OX;
-    } else if (g_strcmp0(encstr, "pgp") == 0) {
-        return PROF_MSG_ENC_PGP;
-    } else if (g_strcmp0(encstr, "otr") == 0) {
+    switch (code) {
+    case 1:
         return PROF_MSG_ENC_OTR;
-    } else if (g_strcmp0(encstr, "omemo") == 0) {
+    case 2:
+        return PROF_MSG_ENC_PGP;
+    case 3:
         return PROF_MSG_ENC_OMEMO;
+    case 4:
+        return PROF_MSG_ENC_OX;
+    default:
+        return PROF_MSG_ENC_NONE;
+    }
+}
+
+// empty strings are stored as NULL
+static void
+_bind_text(sqlite3_stmt* stmt, int index, const char* const text)
+{
+    if (text && text[0] != '\0') {
+        sqlite3_bind_text(stmt, index, text, -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, index);
     }
+}
 
-    return PROF_MSG_ENC_NONE;
+static void
+_bind_id(sqlite3_stmt* stmt, int index, sqlite3_int64 id)
+{
+    if (id != 0) {
+        sqlite3_bind_int64(stmt, index, id);
+    } else {
+        sqlite3_bind_null(stmt, index);
+    }
 }
 
 static void
-_add_to_db(ProfMessage* message, char* type, const Jid* const from_jid, const Jid* const to_jid)
+_add_to_db(ProfMessage* message, prof_msg_type_t type, const Jid* const from_jid, const Jid* const to_jid)
 {
     if (!g_chatlog_database) {
         log_debug("log_database_add() called but db is not initialized");
         return;
     }
 
-    char* err_msg;
-    gchar* query;
-    gchar* date_fmt;
+    if (!insert_stmt) {
+        const char* query = "INSERT INTO `ChatLogs` (`from_jid`, `from_resource`, `to_jid`, `to_resource`, `message`, `timestamp`, `stanza_id`, `archive_id`, `replace_id`, `type`, `encryption`) SELECT ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11 WHERE NOT EXISTS (SELECT 1 FROM `ChatLogs` WHERE `archive_id` = ?8 OR `stanza_id` = ?7)";
+        if (sqlite3_prepare_v2(g_chatlog_database, query, -1, &insert_stmt, NULL) != SQLITE_OK) {
+            log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+            insert_stmt = NULL;
+            return;
+        }
+    }
 
-    if (message->timestamp) {
-        date_fmt = g_date_time_format_iso8601(message->timestamp);
+    if (message->is_mam && batch_depth > 0) {
+        if (!in_transaction && SQLITE_OK == sqlite3_exec(g_chatlog_database, "BEGIN TRANSACTION", NULL, 0, NULL)) {
+            in_transaction = TRUE;
+            transaction_started = g_get_monotonic_time();
+        }
     } else {
-        GDateTime* dt = g_date_time_new_now_local();
-        date_fmt = g_date_time_format_iso8601(dt);
-        g_date_time_unref(dt);
-    }
-
-    const char* enc = _get_message_enc_str(message->enc);
-
-    if (!type) {
-        type = (char*)_get_message_type_str(message->type);
-    }
-
-    query = sqlite3_mprintf("INSERT INTO `ChatLogs` (`from_jid`, `from_resource`, `to_jid`, `to_resource`, `message`, `timestamp`, `stanza_id`, `archive_id`, `replace_id`, `type`, `encryption`) SELECT '%q', '%q', '%q', '%q', '%q', '%q', '%q', '%q', '%q', '%q', '%q' WHERE NOT EXISTS (SELECT 1 FROM `ChatLogs` WHERE (`archive_id` = '%q' AND `archive_id` != '') OR (`stanza_id` = '%q' AND `stanza_id` != ''))",
-                            from_jid->barejid,
-                            from_jid->resourcepart ? from_jid->resourcepart : "",
-                            to_jid->barejid,
-                            to_jid->resourcepart ? to_jid->resourcepart : "",
-                            message->plain ? message->plain : "",
-                            date_fmt ? date_fmt : "",
-                            message->id ? message->id : "",
-                            message->stanzaid ? message->stanzaid : "",
-                            message->replace_id ? message->replace_id : "",
-                            type ? type : "",
-                            enc ? enc : "",
-                            message->stanzaid ? message->stanzaid : "",
-                            message->id ? message->id : "");
-    if (!query) {
-        log_error("log_database_add(): SQL query. could not allocate memory");
+        // live messages are written right away, together with the batch so far
+        _commit_transaction();
+    }
+
+    if (type == PROF_MSG_TYPE_UNINITIALIZED) {
+        type = message->type;
+    }
+
+    _bind_id(insert_stmt, 1, _dictionary_id(&jids, from_jid->barejid, TRUE));
+    _bind_id(insert_stmt, 2, _dictionary_id(&resources, from_jid->resourcepart, TRUE));
+    _bind_id(insert_stmt, 3, _dictionary_id(&jids, to_jid->barejid, TRUE));
+    _bind_id(insert_stmt, 4, _dictionary_id(&resources, to_jid->resourcepart, TRUE));
+    sqlite3_bind_text(insert_stmt, 5, message->plain ? message->plain : "", -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insert_stmt, 6, message->timestamp ? _get_timestamp(message->timestamp) : g_get_real_time());
+    _bind_text(insert_stmt, 7, message->id);
+    _bind_text(insert_stmt, 8, message->stanzaid);
+    _bind_text(insert_stmt, 9, message->replace_id);
+    _bind_id(insert_stmt, 10, _get_message_type_code(type));
+    sqlite3_bind_int(insert_stmt, 11, _get_message_enc_code(message->enc));
+
+    if (sqlite3_step(insert_stmt) != SQLITE_DONE) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+    }
+    sqlite3_reset(insert_stmt);
+    sqlite3_clear_bindings(insert_stmt);
+}
+
+static sqlite3_int64
+_transfer_get_position(const char* const direction, const char* const path)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(g_chatlog_database, "SELECT `position` FROM `Transfers` WHERE `direction` = ? AND `path` = ?", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, direction, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, path, -1, SQLITE_STATIC);
+
+    sqlite3_int64 position = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        position = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    return position;
+}
+
+static void
+_transfer_set_position(const char* const direction, const char* const path, sqlite3_int64 position)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(g_chatlog_database, "INSERT OR REPLACE INTO `Transfers` (`direction`, `path`, `position`) VALUES (?, ?, ?)", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
         return;
     }
-    g_free(date_fmt);
+    sqlite3_bind_text(stmt, 1, direction, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, path, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 3, position);
 
-    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
-        if (err_msg) {
-            log_error("SQLite error: %s", err_msg);
-            sqlite3_free(err_msg);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+    }
+    sqlite3_finalize(stmt);
+}
+
+static DbTransfer*
+_transfer_new(gboolean export, const char* const path)
+{
+    DbTransfer* result = g_new0(DbTransfer, 1);
+    result->export = export;
+    result->path = g_strdup(path);
+    return result;
+}
+
+static void
+_transfer_free(void)
+{
+    if (!transfer) {
+        return;
+    }
+
+    if (transfer->fp) {
+        fclose(transfer->fp);
+    }
+    if (transfer->stmt) {
+        sqlite3_finalize(transfer->stmt);
+    }
+    g_slist_free_full(transfer->files, g_free);
+    g_free(transfer->mybarejid);
+    g_free(transfer->mynick);
+    g_free(transfer->path);
+    g_free(transfer);
+    transfer = NULL;
+}
+
+gboolean
+log_database_export(const char* const path)
+{
+    if (!g_chatlog_database || transfer) {
+        return FALSE;
+    }
+
+    // continue an earlier export to the same file with the rows added since
+    sqlite3_int64 position = _transfer_get_position("export", path);
+    if (position > 0 && !g_file_test(path, G_FILE_TEST_EXISTS)) {
+        position = 0;
+    }
+
+    const char* query = "SELECT C.`id`, C.`timestamp`, C.`type`, C.`encryption`, C.`marked_read`, F.`jid`, FR.`resource`, T.`jid`, TR.`resource`, C.`stanza_id`, C.`archive_id`, C.`replace_id`, C.`message` "
+                        "FROM `ChatLogs` AS C JOIN `Jids` AS F ON F.`id` = C.`from_jid` JOIN `Jids` AS T ON T.`id` = C.`to_jid` "
+                        "LEFT JOIN `Resources` AS FR ON FR.`id` = C.`from_resource` LEFT JOIN `Resources` AS TR ON TR.`id` = C.`to_resource` "
+                        "WHERE C.`id` > ? ORDER BY C.`id` LIMIT " G_STRINGIFY(TRANSFER_CHUNK);
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        return FALSE;
+    }
+
+    FILE* fp = fopen(path, position > 0 ? "a" : "w");
+    if (!fp) {
+        log_error("Could not open %s for history export: %s", path, g_strerror(errno));
+        sqlite3_finalize(stmt);
+        return FALSE;
+    }
+    g_chmod(path, S_IRUSR | S_IWUSR);
+    if (position == 0) {
+        fprintf(fp, "%s\n", TRANSFER_HEADER);
+    }
+
+    transfer = _transfer_new(TRUE, path);
+    transfer->fp = fp;
+    transfer->stmt = stmt;
+    transfer->position = position;
+
+    return TRUE;
+}
+
+static void
+_list_chatlog_files(const char* const dir, GSList** files)
+{
+    GDir* chatlogs = g_dir_open(dir, 0, NULL);
+    if (!chatlogs) {
+        return;
+    }
+
+    const gchar* name = g_dir_read_name(chatlogs);
+    while (name) {
+        gchar* path = g_build_filename(dir, name, NULL);
+        if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+            _list_chatlog_files(path, files);
+            g_free(path);
+        } else if (g_str_has_suffix(name, ".log")) {
+            *files = g_slist_prepend(*files, path);
+        } else {
+            g_free(path);
+        }
+        name = g_dir_read_name(chatlogs);
+    }
+    g_dir_close(chatlogs);
+}
+
+gboolean
+log_database_import(const char* const path)
+{
+    if (!g_chatlog_database || transfer) {
+        return FALSE;
+    }
+
+    const char* jid = connection_get_fulljid();
+    Jid* myjid = jid_create(jid);
+    if (!myjid) {
+        return FALSE;
+    }
+
+    GSList* files = NULL;
+    FILE* fp = NULL;
+    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        _list_chatlog_files(path, &files);
+        if (!files) {
+            log_error("History import: no chat logs found in %s", path);
+            jid_destroy(myjid);
+            return FALSE;
+        }
+        files = g_slist_sort(files, (GCompareFunc)g_strcmp0);
+    } else {
+        fp = fopen(path, "r");
+        if (!fp) {
+            log_error("Could not open %s for history import: %s", path, g_strerror(errno));
+            jid_destroy(myjid);
+            return FALSE;
+        }
+
+        char* line = NULL;
+        size_t len = 0;
+        gboolean exported = getline(&line, &len, fp) != -1 && g_str_has_prefix(line, TRANSFER_HEADER);
+        free(line);
+
+        if (!exported) {
+            fclose(fp);
+            fp = NULL;
+            if (!g_str_has_suffix(path, ".log")) {
+                log_error("History import: %s is neither a /history export nor a chat log", path);
+                jid_destroy(myjid);
+                return FALSE;
+            }
+            files = g_slist_append(NULL, g_strdup(path));
+        }
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* query = NULL;
+    if (files) {
+        // chat log lines have no ids, an earlier import of the same line has the
+        // same timestamp and messages logged at the time are close to it
+        query = "INSERT INTO `ChatLogs` (`from_jid`, `from_resource`, `to_jid`, `to_resource`, `message`, `timestamp`, `stanza_id`, `archive_id`, `replace_id`, `type`, `encryption`, `marked_read`) "
+                "SELECT ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12 WHERE NOT EXISTS (SELECT 1 FROM `ChatLogs` WHERE `from_jid` = ?1 AND `to_jid` = ?3 "
+                "AND `timestamp` BETWEEN ?6 - " G_STRINGIFY(CHATLOG_IMPORT_TOLERANCE) " AND ?6 + " G_STRINGIFY(CHATLOG_IMPORT_TOLERANCE) " "
+                "AND (`timestamp` = ?6 OR `id` <= ?13) AND (?2 IS NULL OR `from_resource` = ?2) AND `message` IS ?5)";
+    } else {
+        query = "INSERT INTO `ChatLogs` (`from_jid`, `from_resource`, `to_jid`, `to_resource`, `message`, `timestamp`, `stanza_id`, `archive_id`, `replace_id`, `type`, `encryption`, `marked_read`) "
+                "SELECT ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12 WHERE NOT EXISTS (SELECT 1 FROM `ChatLogs` WHERE `archive_id` = ?8 OR `stanza_id` = ?7 "
+                "OR (?7 IS NULL AND ?8 IS NULL AND `from_jid` = ?1 AND `to_jid` = ?3 AND `timestamp` = ?6 AND `message` IS ?5))";
+    }
+    if (sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        if (fp) {
+            fclose(fp);
+        }
+        g_slist_free_full(files, g_free);
+        jid_destroy(myjid);
+        return FALSE;
+    }
+
+    transfer = _transfer_new(FALSE, path);
+    transfer->stmt = stmt;
+    transfer->mybarejid = g_strdup(myjid->barejid);
+    jid_destroy(myjid);
+
+    if (fp) {
+        // resume where an earlier import of the file stopped
+        sqlite3_int64 position = _transfer_get_position("import", path);
+        if (position > 0 && fseeko(fp, position, SEEK_SET) == 0) {
+            transfer->position = position;
         } else {
-            log_error("Unknown SQLite error");
+            transfer->position = ftello(fp);
+        }
+        transfer->fp = fp;
+    } else {
+        transfer->chatlog = TRUE;
+        transfer->files = files;
+        transfer->last_id = _query_int64("SELECT MAX(`id`) FROM `ChatLogs`");
+
+        ProfAccount* account = accounts_get_account(session_get_account_name());
+        if (account) {
+            transfer->mynick = g_strdup(account->muc_nick);
+            account_free(account);
         }
     }
-    sqlite3_free(query);
+
+    return TRUE;
+}
+
+gboolean
+log_database_transferring(void)
+{
+    return transfer != NULL;
+}
+
+static void
+_transfer_insert(const DbTransferRow* const row)
+{
+    sqlite3_int64 from_id = _dictionary_id(&jids, row->from_jid, TRUE);
+    sqlite3_int64 to_id = _dictionary_id(&jids, row->to_jid, TRUE);
+    if (from_id == 0 || to_id == 0) {
+        transfer->skipped++;
+        return;
+    }
+
+    sqlite3_stmt* stmt = transfer->stmt;
+    sqlite3_bind_int64(stmt, 1, from_id);
+    _bind_id(stmt, 2, _dictionary_id(&resources, row->from_resource, TRUE));
+    sqlite3_bind_int64(stmt, 3, to_id);
+    _bind_id(stmt, 4, _dictionary_id(&resources, row->to_resource, TRUE));
+    sqlite3_bind_text(stmt, 5, row->message ? row->message : "", -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 6, row->timestamp);
+    _bind_text(stmt, 7, row->stanza_id);
+    _bind_text(stmt, 8, row->archive_id);
+    _bind_text(stmt, 9, row->replace_id);
+    _bind_id(stmt, 10, row->type);
+    sqlite3_bind_int(stmt, 11, row->encryption);
+    sqlite3_bind_int(stmt, 12, row->marked_read);
+    if (transfer->chatlog) {
+        sqlite3_bind_int64(stmt, 13, transfer->last_id);
+    }
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_error("SQLite error: %s", sqlite3_errmsg(g_chatlog_database));
+        transfer->skipped++;
+    } else if (sqlite3_changes(g_chatlog_database) > 0) {
+        transfer->added++;
+    } else {
+        transfer->skipped++;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+static gboolean
+_transfer_export_step(void)
+{
+    sqlite3_stmt* stmt = transfer->stmt;
+    sqlite3_bind_int64(stmt, 1, transfer->position);
+
+    GString* line = g_string_sized_new(256);
+    int rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        g_string_printf(line, "%" G_GINT64_FORMAT "\t%d\t%d\t%d",
+                        (gint64)sqlite3_column_int64(stmt, 1),
+                        sqlite3_column_int(stmt, 2),
+                        sqlite3_column_int(stmt, 3),
+                        sqlite3_column_int(stmt, 4));
+        for (int i = 5; i < 5 + TRANSFER_FIELDS - 4; i++) {
+            g_string_append_c(line, '\t');
+            history_format_escape(line, (const char*)sqlite3_column_text(stmt, i));
+        }
+        g_string_append_c(line, '\n');
+        fwrite(line->str, 1, line->len, transfer->fp);
+
+        transfer->position = sqlite3_column_int64(stmt, 0);
+        rows++;
+    }
+    sqlite3_reset(stmt);
+    g_string_free(line, TRUE);
+
+    if (fflush(transfer->fp) != 0) {
+        log_error("Error writing history export %s: %s", transfer->path, g_strerror(errno));
+        cons_show_error("Could not write %s, history export stopped.", transfer->path);
+        transfer->failed = TRUE;
+        return FALSE;
+    }
+
+    transfer->added += rows;
+    _transfer_set_position("export", transfer->path, transfer->position);
+
+    return rows == TRANSFER_CHUNK;
+}
+
+static gboolean
+_transfer_import_step(void)
+{
+    sqlite3_exec(g_chatlog_database, "BEGIN TRANSACTION", NULL, 0, NULL);
+
+    char* line = NULL;
+    size_t len = 0;
+    gboolean more = TRUE;
+    for (int rows = 0; rows < TRANSFER_CHUNK; rows++) {
+        if (getline(&line, &len, transfer->fp) == -1) {
+            more = FALSE;
+            break;
+        }
+        history_format_chomp(line);
+
+        char* fields[TRANSFER_FIELDS];
+        if (history_format_split(line, fields, TRANSFER_FIELDS) != TRANSFER_FIELDS) {
+            transfer->skipped++;
+            continue;
+        }
+        for (int i = 4; i < TRANSFER_FIELDS; i++) {
+            history_format_unescape(fields[i]);
+        }
+
+        DbTransferRow row = {
+            .timestamp = g_ascii_strtoll(fields[0], NULL, 10),
+            .type = (int)g_ascii_strtoll(fields[1], NULL, 10),
+            .encryption = (int)g_ascii_strtoll(fields[2], NULL, 10),
+            .marked_read = (int)g_ascii_strtoll(fields[3], NULL, 10),
+            .from_jid = fields[4],
+            .from_resource = fields[5],
+            .to_jid = fields[6],
+            .to_resource = fields[7],
+            .stanza_id = fields[8],
+            .archive_id = fields[9],
+            .replace_id = fields[10],
+            .message = fields[11],
+        };
+        _transfer_insert(&row);
+    }
+    free(line);
+
+    // saved with the rows so an interrupted import resumes exactly here
+    transfer->position = ftello(transfer->fp);
+    _transfer_set_position("import", transfer->path, transfer->position);
+
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "COMMIT", NULL, 0, &err_msg)) {
+        log_error("History import failed: %s", err_msg ? err_msg : "unknown error");
+        sqlite3_free(err_msg);
+        sqlite3_exec(g_chatlog_database, "ROLLBACK", NULL, 0, NULL);
+        cons_show_error("Could not import %s, run the command again to retry.", transfer->path);
+        transfer->failed = TRUE;
+        return FALSE;
+    }
+
+    return more;
+}
+
+// chatlog.c writes one file per contact and day, below rooms/ for groupchats.
+// Our own lines are logged as "me" in chats and under our nick in rooms.
+typedef struct chatlog_import_t
+{
+    const char* contact;
+    const char* resource;
+    prof_msg_type_t type;
+    char* mynick;
+    gint64 timestamp;
+    char* nick;
+    GString* message;
+} ChatlogImport;
+
+static void
+_chatlog_import_flush(ChatlogImport* import)
+{
+    if (!import->message) {
+        return;
+    }
+
+    gboolean outgoing;
+    if (import->type == PROF_MSG_TYPE_MUC) {
+        outgoing = import->mynick && g_strcmp0(import->nick, import->mynick) == 0;
+    } else {
+        outgoing = g_strcmp0(import->nick, "me") == 0;
+    }
+
+    DbTransferRow row = {
+        .timestamp = import->timestamp,
+        .type = _get_message_type_code(import->type),
+        .message = import->message->str,
+    };
+    if (outgoing) {
+        row.from_jid = transfer->mybarejid;
+        row.to_jid = import->contact;
+        row.to_resource = import->resource;
+    } else if (import->type == PROF_MSG_TYPE_MUC) {
+        row.from_jid = import->contact;
+        row.from_resource = import->nick;
+        row.to_jid = transfer->mybarejid;
+    } else {
+        row.from_jid = import->contact;
+        row.from_resource = import->resource;
+        row.to_jid = transfer->mybarejid;
+    }
+    _transfer_insert(&row);
+
+    g_string_free(import->message, TRUE);
+    import->message = NULL;
+    g_free(import->nick);
+    import->nick = NULL;
+}
+
+static void
+_chatlog_import_line(ChatlogImport* import, char* line)
+{
+    gint64 timestamp = 0;
+    char* nick = NULL;
+    char* text = NULL;
+
+    history_chatlog_line_t kind = history_format_parse_chatlog(line, &timestamp, &nick, &text);
+    if (kind == HISTORY_CHATLOG_CONTINUATION) {
+        if (import->message) {
+            g_string_append_c(import->message, '\n');
+            g_string_append(import->message, line);
+        }
+        return;
+    }
+
+    _chatlog_import_flush(import);
+    if (kind == HISTORY_CHATLOG_INVALID) {
+        transfer->skipped++;
+        return;
+    }
+
+    import->timestamp = timestamp;
+    import->nick = g_strdup(nick);
+    import->message = g_string_new(kind == HISTORY_CHATLOG_ACTION ? "/me " : "");
+    g_string_append(import->message, text);
+}
+
+// The nick our own lines in a room log were written under, as far as it is
+// still known: the one we are in the room with, a bookmarked one or the default
+static char*
+_chatlog_import_room_nick(const char* const room)
+{
+    const char* nick = muc_nick(room);
+    if (!nick) {
+        Bookmark* bookmark = bookmark_get_by_jid(room);
+        nick = bookmark ? bookmark->nick : NULL;
+    }
+
+    return g_strdup(nick ? nick : transfer->mynick);
+}
+
+static void
+_chatlog_import_file(const char* const path)
+{
+    GStatBuf st;
+    if (g_stat(path, &st) != 0) {
+        transfer->skipped++;
+        return;
+    }
+
+    // whole files are imported, skip the ones unchanged since the last import
+    if (_transfer_get_position("import", path) == (sqlite3_int64)st.st_size) {
+        return;
+    }
+
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        log_error("Could not open chat log %s: %s", path, g_strerror(errno));
+        return;
+    }
+
+    gchar* dir = g_path_get_dirname(path);
+    gchar* parent = g_path_get_dirname(dir);
+    gchar* dir_name = g_path_get_basename(dir);
+    gchar* parent_name = g_path_get_basename(parent);
+
+    ChatlogImport import = { 0 };
+    char* contact = str_replace(dir_name, "_at_", "@");
+    import.contact = contact;
+    import.type = g_strcmp0(parent_name, "rooms") == 0 ? PROF_MSG_TYPE_MUC : PROF_MSG_TYPE_CHAT;
+    if (import.type == PROF_MSG_TYPE_MUC) {
+        import.mynick = _chatlog_import_room_nick(contact);
+    } else {
+        // private messages in a room are logged as <room>_<nick>, domains have no underscore
+        char* at = strchr(contact, '@');
+        char* underscore = at ? strchr(at, '_') : NULL;
+        if (underscore) {
+            *underscore = '\0';
+            import.resource = underscore + 1;
+            import.type = PROF_MSG_TYPE_MUCPM;
+        }
+    }
+
+    sqlite3_exec(g_chatlog_database, "BEGIN TRANSACTION", NULL, 0, NULL);
+
+    char* line = NULL;
+    size_t len = 0;
+    while (getline(&line, &len, fp) != -1) {
+        history_format_chomp(line);
+        _chatlog_import_line(&import, line);
+    }
+    _chatlog_import_flush(&import);
+    free(line);
+    fclose(fp);
+
+    _transfer_set_position("import", path, (sqlite3_int64)st.st_size);
+
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "COMMIT", NULL, 0, &err_msg)) {
+        log_error("Chat log import of %s failed: %s", path, err_msg ? err_msg : "unknown error");
+        sqlite3_free(err_msg);
+        sqlite3_exec(g_chatlog_database, "ROLLBACK", NULL, 0, NULL);
+    }
+
+    free(contact);
+    g_free(import.mynick);
+    g_free(parent_name);
+    g_free(dir_name);
+    g_free(parent);
+    g_free(dir);
+}
+
+static gboolean
+_transfer_chatlog_step(void)
+{
+    // chat logs hold a day each, import a few per iteration
+    int rows = 0;
+    while (transfer->files && rows < TRANSFER_CHUNK) {
+        char* file = transfer->files->data;
+        transfer->files = g_slist_delete_link(transfer->files, transfer->files);
+
+        guint64 before = transfer->added + transfer->skipped;
+        _chatlog_import_file(file);
+        rows += MAX(1, (int)(transfer->added + transfer->skipped - before));
+        g_free(file);
+    }
+
+    return transfer->files != NULL;
+}
+
+// Continue the /history export or import, one chunk per main loop iteration.
+// Returns TRUE while there is more to do.
+gboolean
+log_database_transfer_step(void)
+{
+    if (!g_chatlog_database || !transfer) {
+        return FALSE;
+    }
+
+    // a MAM batch holds the transaction, log_database_batch_end() wakes the
+    // main loop to continue once it is committed
+    if (batch_depth > 0) {
+        return FALSE;
+    }
+
+    gboolean more;
+    if (transfer->export) {
+        more = _transfer_export_step();
+    } else if (transfer->chatlog) {
+        more = _transfer_chatlog_step();
+    } else {
+        more = _transfer_import_step();
+    }
+
+    guint64 done = transfer->added + transfer->skipped;
+    if (!more) {
+        if (transfer->failed) {
+            log_info("History %s of %s stopped after %" G_GUINT64_FORMAT " messages", transfer->export ? "export" : "import", transfer->path, done);
+        } else if (transfer->export) {
+            cons_show("History export to %s finished, %" G_GUINT64_FORMAT " messages written.", transfer->path, transfer->added);
+        } else {
+            cons_show("History import from %s finished, %" G_GUINT64_FORMAT " messages added, %" G_GUINT64_FORMAT " duplicates or invalid lines skipped.",
+                      transfer->path, transfer->added, transfer->skipped);
+        }
+        _transfer_free();
+    } else if (done / TRANSFER_REPORT > transfer->reported) {
+        transfer->reported = done / TRANSFER_REPORT;
+        cons_show("History %s of %s: %" G_GUINT64_FORMAT " messages so far.", transfer->export ? "export" : "import", transfer->path, done);
+    }
+
+    return more;
 }
@@ -49,6 +49,19 @@ void log_database_add_outgoing_muc(const char* const id, const char* const barej
 void log_database_add_outgoing_muc_pm(const char* const id, const char* const barejid, const char* const message, const char* const replace_id, prof_enc_t enc);
 GSList* log_database_get_previous_chat(const gchar* const contact_barejid, char* start_time, char* end_time, gboolean from_start, gboolean flip);
 ProfMessage* log_database_get_limits_info(const gchar* const contact_barejid, gboolean is_last);
+GDateTime* log_database_get_last_timestamp(const gchar* const contact_barejid);
+void log_database_batch_begin(void);
+void log_database_batch_end(void);
+void log_database_batch_check(void);
+GDateTime* log_database_get_mam_watermark(const gchar* const contact_barejid);
+void log_database_set_mam_watermark(const gchar* const contact_barejid, GDateTime* synced_until);
+gboolean log_database_migrate_step(void);
+gboolean log_database_migrating(void);
+gboolean log_database_compact(gint64* size_before, gint64* size_after);
+gboolean log_database_export(const char* const path);
+gboolean log_database_import(const char* const path);
+gboolean log_database_transfer_step(void);
+gboolean log_database_transferring(void);
 void log_database_close(void);
 
 #endif // DATABASE_H
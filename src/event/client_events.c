@@ -118,7 +118,7 @@ cl_ev_presence_send(const resource_presence_t presence_type, const int idle_secs
 void
 cl_ev_send_msg_correct(ProfChatWin* chatwin, const char* const msg, const char* const oob_url, gboolean correct_last_msg)
 {
-    chat_state_active(chatwin->state);
+    chat_state_active(chatwin->barejid, chatwin->state);
 
     gboolean request_receipt = prefs_get_boolean(PREF_RECEIPTS_REQUEST);
 
@@ -44,6 +44,7 @@
 #include "xmpp/vcard_funcs.h"
 #include "database.h"
 #include "tools/bookmark_ignore.h"
+#include "tools/workqueue.h"
 
 #ifdef HAVE_LIBGPGME
 #include "pgp/gpg.h"
@@ -58,6 +59,8 @@ static gint _success_connections_counter = 0;
 void
 ev_disconnect_cleanup(void)
 {
+    // show whatever the crypto workers still have before the database is closed
+    workqueue_flush();
     ui_disconnected();
     session_disconnect();
     roster_destroy();
@@ -57,7 +57,9 @@
 #include "ui/window_list.h"
 #include "ui/window.h"
 #include "tools/bookmark_ignore.h"
+#include "tools/workqueue.h"
 #include "xmpp/xmpp.h"
+#include "xmpp/message.h"
 #include "xmpp/muc.h"
 #include "xmpp/chat_session.h"
 #include "xmpp/roster_list.h"
@@ -81,6 +83,17 @@
 static void _clean_incoming_message(ProfMessage* message);
 static void _sv_ev_incoming_plain(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message, gboolean logit);
 
+// an incoming message waiting for the crypto workers, or for the ones in front of it
+typedef struct incoming_job_t
+{
+    char* barejid;
+    gboolean new_win;
+    ProfMessage* message;
+    gboolean decrypt;
+    char* plain;
+    gboolean retry;
+} IncomingJob;
+
 void
 sv_ev_login_account_success(char* account_name, gboolean secured)
 {
@@ -108,13 +121,13 @@ sv_ev_login_account_success(char* account_name, gboolean secured)
 
     ui_handle_login_account_success(account, secured);
 
-    // attempt to rejoin all rooms
+    // attempt to rejoin all rooms, focused and active rooms first
     GList* rooms = muc_rooms();
     GList* curr = rooms;
     while (curr) {
         char* password = muc_password(curr->data);
         char* nick = muc_nick(curr->data);
-        presence_join_room(curr->data, nick, password);
+        presence_join_room_queued(curr->data, nick, password, FALSE);
         curr = g_list_next(curr);
     }
     g_list_free(rooms);
@@ -128,6 +141,7 @@ sv_ev_login_account_success(char* account_name, gboolean secured)
     }
 
     ev_inc_connection_counter();
+    prof_startup_profile_report("login");
 
     if (account->startscript) {
         scripts_exec(account->startscript);
@@ -238,6 +252,7 @@ sv_ev_failed_login(void)
     cons_show_error("Login failed.");
     log_info("Login failed");
     tlscerts_clear_current();
+    prof_startup_profile_report("login failed");
 }
 
 void
@@ -276,6 +291,11 @@ sv_ev_room_subject(const char* const room, const char* const nick, const char* c
 void
 sv_ev_room_history(ProfMessage* message)
 {
+    // logged before the join, the room window already shows it
+    if (muc_history_is_logged(message->from_jid->barejid, message->timestamp)) {
+        return;
+    }
+
     if (prefs_get_boolean(PREF_NOTIFY_ROOM_OFFLINE)) {
         // check if this message was sent while we were offline.
         // if so, treat it as a new message rather than a history event.
@@ -384,11 +404,8 @@ sv_ev_room_message(ProfMessage* message)
 
         cons_show_incoming_room_message(message->from_jid->resourcepart, mucwin->roomjid, num, mention, triggers, mucwin->unread, window);
 
-        mucwin->unread++;
+        wins_add_unread(window, mention);
 
-        if (mention) {
-            mucwin->unread_mentions = TRUE;
-        }
         if (triggers) {
             mucwin->unread_triggers = TRUE;
         }
@@ -473,7 +490,7 @@ sv_ev_outgoing_carbon(ProfMessage* message)
         chatwin = chatwin_new(message->to_jid->barejid);
     }
 
-    chat_state_active(chatwin->state);
+    chat_state_active(chatwin->barejid, chatwin->state);
 
     if (message->enc == PROF_MSG_ENC_OMEMO) {
         chatwin_outgoing_carbon(chatwin, message);
@@ -512,10 +529,9 @@ sv_ev_outgoing_carbon(ProfMessage* message)
 }
 
 static void
-_sv_ev_incoming_pgp(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message, gboolean logit)
+_sv_ev_incoming_pgp_decrypted(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message, gboolean logit)
 {
 #ifdef HAVE_LIBGPGME
-    message->plain = p_gpg_decrypt(message->encrypted);
     if (message->plain) {
         message->enc = PROF_MSG_ENC_PGP;
         _clean_incoming_message(message);
@@ -543,6 +559,15 @@ _sv_ev_incoming_pgp(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message
 #endif
 }
 
+static void
+_sv_ev_incoming_pgp(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message, gboolean logit)
+{
+#ifdef HAVE_LIBGPGME
+    message->plain = p_gpg_decrypt(message->encrypted);
+    _sv_ev_incoming_pgp_decrypted(chatwin, new_win, message, logit);
+#endif
+}
+
 static void
 _sv_ev_incoming_ox(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message, gboolean logit)
 {
@@ -625,6 +650,80 @@ _sv_ev_incoming_plain(ProfChatWin* chatwin, gboolean new_win, ProfMessage* messa
     }
 }
 
+static void
+_sv_ev_incoming_dispatch(ProfChatWin* chatwin, gboolean new_win, ProfMessage* message)
+{
+    if (message->enc == PROF_MSG_ENC_OX) {
+        _sv_ev_incoming_ox(chatwin, new_win, message, TRUE);
+    } else if (message->enc == PROF_MSG_ENC_OMEMO) {
+        _sv_ev_incoming_omemo(chatwin, new_win, message, TRUE);
+    } else if (message->encrypted) {
+        if (chatwin->is_otr) {
+            win_println((ProfWin*)chatwin, THEME_DEFAULT, "-", "PGP encrypted message received whilst in OTR session.");
+        } else {
+            _sv_ev_incoming_pgp(chatwin, new_win, message, TRUE);
+        }
+    } else {
+        // otr or plain
+        _sv_ev_incoming_otr(chatwin, new_win, message);
+    }
+}
+
+#ifdef HAVE_LIBGPGME
+static void
+_sv_ev_incoming_decrypt(gpointer data)
+{
+    IncomingJob* job = data;
+    job->plain = p_gpg_decrypt_background(job->message->encrypted, &job->retry);
+}
+
+static void
+_sv_ev_incoming_done(gpointer data)
+{
+    IncomingJob* job = data;
+    ProfMessage* message = job->message;
+
+    // the window might have been closed in the meantime
+    gboolean new_win = job->new_win;
+    ProfChatWin* chatwin = wins_get_chat(job->barejid);
+    if (!chatwin) {
+        chatwin = (ProfChatWin*)wins_new_chat(job->barejid);
+        new_win = TRUE;
+    }
+
+    if (!job->decrypt) {
+        _sv_ev_incoming_dispatch(chatwin, new_win, message);
+    } else if (job->retry) {
+        _sv_ev_incoming_pgp(chatwin, new_win, message, TRUE);
+    } else {
+        message->plain = job->plain;
+        job->plain = NULL;
+        _sv_ev_incoming_pgp_decrypted(chatwin, new_win, message, TRUE);
+    }
+
+    rosterwin_roster();
+
+    g_free(job->plain);
+    free(job->barejid);
+    message_free(message);
+    free(job);
+}
+
+static void
+_sv_ev_incoming_queue(const char* const barejid, gboolean new_win, ProfMessage* message, gboolean decrypt)
+{
+    IncomingJob* job = malloc(sizeof(IncomingJob));
+    job->barejid = strdup(barejid);
+    job->new_win = new_win;
+    job->message = message_ref(message);
+    job->decrypt = decrypt;
+    job->plain = NULL;
+    job->retry = FALSE;
+
+    workqueue_push(barejid, decrypt ? _sv_ev_incoming_decrypt : NULL, _sv_ev_incoming_done, job);
+}
+#endif
+
 void
 sv_ev_incoming_message(ProfMessage* message)
 {
@@ -664,20 +763,18 @@ sv_ev_incoming_message(ProfMessage* message)
 #endif
     }
 
-    if (message->enc == PROF_MSG_ENC_OX) {
-        _sv_ev_incoming_ox(chatwin, new_win, message, TRUE);
-    } else if (message->enc == PROF_MSG_ENC_OMEMO) {
-        _sv_ev_incoming_omemo(chatwin, new_win, message, TRUE);
-    } else if (message->encrypted) {
-        if (chatwin->is_otr) {
-            win_println((ProfWin*)chatwin, THEME_DEFAULT, "-", "PGP encrypted message received whilst in OTR session.");
-        } else {
-            _sv_ev_incoming_pgp(chatwin, new_win, message, TRUE);
-        }
-    } else {
-        // otr or plain
-        _sv_ev_incoming_otr(chatwin, new_win, message);
+#ifdef HAVE_LIBGPGME
+    // PGP messages are decrypted by the crypto workers, the ones following
+    // them in the same conversation wait so everything is shown in order
+    gboolean decrypt = message->enc != PROF_MSG_ENC_OX && message->enc != PROF_MSG_ENC_OMEMO
+                       && message->encrypted && !chatwin->is_otr;
+    if (decrypt || workqueue_pending(looking_for_jid)) {
+        _sv_ev_incoming_queue(looking_for_jid, new_win, message, decrypt);
+        return;
     }
+#endif
+
+    _sv_ev_incoming_dispatch(chatwin, new_win, message);
 
     rosterwin_roster();
     return;
@@ -1332,11 +1429,8 @@ sv_ev_bookmark_autojoin(Bookmark* bookmark)
 
     log_debug("Autojoin %s with nick=%s", bookmark->barejid, nick);
     if (!muc_active(bookmark->barejid)) {
-        presence_join_room(bookmark->barejid, nick, bookmark->password);
         muc_join(bookmark->barejid, nick, bookmark->password, TRUE);
-        iq_room_affiliation_list(bookmark->barejid, "member", false);
-        iq_room_affiliation_list(bookmark->barejid, "admin", false);
-        iq_room_affiliation_list(bookmark->barejid, "owner", false);
+        presence_join_room_queued(bookmark->barejid, nick, bookmark->password, TRUE);
     }
 
     free(nick);
@@ -65,6 +65,7 @@ static char* log_file = NULL;
 static char* account_name = NULL;
 static char* config_file = NULL;
 static char* theme_name = NULL;
+static gboolean startup_profile = FALSE;
 
 int
 main(int argc, char** argv)
@@ -86,6 +87,7 @@ main(int argc, char** argv)
         { "config", 'c', 0, G_OPTION_ARG_STRING, &config_file, "Use an alternative configuration file", NULL },
         { "logfile", 'f', 0, G_OPTION_ARG_STRING, &log_file, "Specify log file", NULL },
         { "theme", 't', 0, G_OPTION_ARG_STRING, &theme_name, "Specify theme name", NULL },
+        { "startup-profile", 0, 0, G_OPTION_ARG_NONE, &startup_profile, "Show how long each part of the startup took", NULL },
         { NULL }
     };
 
@@ -183,7 +185,7 @@ main(int argc, char** argv)
     }
 
     /* Default logging WARN */
-    prof_run(log ? log : "WARN", account_name, config_file, log_file, theme_name);
+    prof_run(log ? log : "WARN", account_name, config_file, log_file, theme_name, startup_profile);
 
     /* Free resources allocated by GOptionContext */
     g_free(log);
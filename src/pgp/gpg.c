@@ -49,6 +49,7 @@
 #include "log.h"
 #include "common.h"
 #include "pgp/gpg.h"
+#include "pgp/gpgcache.h"
 #include "config/files.h"
 #include "tools/autocomplete.h"
 #include "ui/ui.h"
@@ -68,10 +69,23 @@ static char* passphrase;
 static char* passphrase_attempt;
 
 static Autocomplete key_ac;
+// listing the keyring starts the gpg engine, only do it once a key is completed
+static gboolean key_ac_loaded;
+
+// the presence status is signed again on every presence, reuse the last
+// signature while the status, the key and the keyring stay the same
+static struct
+{
+    char* str;
+    char* fp;
+    char* result;
+    guint generation;
+} sign_cache;
 
 static char* _remove_header_footer(char* str, const char* const footer);
 static char* _add_header_footer(const char* const str, const char* const header, const char* const footer);
 static void _save_pubkeys(void);
+static void _sign_cache_clear(void);
 
 void
 _p_gpg_free_pubkeyid(ProfPGPPubKeyId* pubkeyid)
@@ -119,8 +133,7 @@ p_gpg_init(void)
     pubkeys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_p_gpg_free_pubkeyid);
 
     key_ac = autocomplete_new();
-    GHashTable* keys = p_gpg_list_keys();
-    p_gpg_free_keys(keys);
+    key_ac_loaded = FALSE;
 
     passphrase = NULL;
     passphrase_attempt = NULL;
@@ -145,6 +158,9 @@ p_gpg_close(void)
     autocomplete_free(key_ac);
     key_ac = NULL;
 
+    _sign_cache_clear();
+    p_gpg_cache_close();
+
     if (passphrase) {
         free(passphrase);
         passphrase = NULL;
@@ -178,7 +194,7 @@ p_gpg_on_connect(const char* const barejid)
     gchar** jids = g_key_file_get_groups(pubkeyfile, &len);
 
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -196,7 +212,7 @@ p_gpg_on_connect(const char* const barejid)
             g_free(keyid);
         } else {
             gpgme_key_t key = NULL;
-            error = gpgme_get_key(ctx, keyid, &key, 0);
+            error = p_gpg_get_key(ctx, keyid, &key, FALSE);
             if (error || key == NULL) {
                 log_warning("GPG: Failed to get key for %s: %s %s", jid, gpgme_strsource(error), gpgme_strerror(error));
                 continue;
@@ -211,7 +227,7 @@ p_gpg_on_connect(const char* const barejid)
         }
     }
 
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
     g_strfreev(jids);
 
     _save_pubkeys();
@@ -242,21 +258,23 @@ p_gpg_on_disconnect(void)
         free(passphrase_attempt);
         passphrase_attempt = NULL;
     }
+
+    _sign_cache_clear();
 }
 
 gboolean
 p_gpg_addkey(const char* const jid, const char* const keyid)
 {
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         return FALSE;
     }
 
     gpgme_key_t key = NULL;
-    error = gpgme_get_key(ctx, keyid, &key, 0);
-    gpgme_release(ctx);
+    error = p_gpg_get_key(ctx, keyid, &key, FALSE);
+    p_gpg_ctx_release(ctx);
 
     if (error || key == NULL) {
         log_error("GPG: Failed to get key. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -311,7 +329,7 @@ p_gpg_list_keys(void)
     GHashTable* result = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)p_gpg_free_key);
 
     gpgme_ctx_t ctx;
-    error = gpgme_new(&ctx);
+    error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("GPG: Could not list keys. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -380,7 +398,7 @@ p_gpg_list_keys(void)
         }
     }
 
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 
     autocomplete_clear(key_ac);
     GList* ids = g_hash_table_get_keys(result);
@@ -391,6 +409,7 @@ p_gpg_list_keys(void)
         curr = curr->next;
     }
     g_list_free(ids);
+    key_ac_loaded = TRUE;
 
     return result;
 }
@@ -420,7 +439,7 @@ gboolean
 p_gpg_valid_key(const char* const keyid, char** err_str)
 {
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         *err_str = strdup(gpgme_strerror(error));
@@ -428,22 +447,22 @@ p_gpg_valid_key(const char* const keyid, char** err_str)
     }
 
     gpgme_key_t key = NULL;
-    error = gpgme_get_key(ctx, keyid, &key, 1);
+    error = p_gpg_get_key(ctx, keyid, &key, TRUE);
 
     if (error || key == NULL) {
         log_error("GPG: Failed to get key. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         *err_str = strdup(gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return FALSE;
     }
 
     if (key == NULL) {
         *err_str = strdup("Unknown error");
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return FALSE;
     }
 
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
     gpgme_key_unref(key);
     return TRUE;
 }
@@ -463,7 +482,7 @@ p_gpg_verify(const char* const barejid, const char* const sign)
     }
 
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -484,7 +503,7 @@ p_gpg_verify(const char* const barejid, const char* const sign)
 
     if (error) {
         log_error("GPG: Failed to verify. %s %s", gpgme_strsource(error), gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return;
     }
 
@@ -492,7 +511,7 @@ p_gpg_verify(const char* const barejid, const char* const sign)
     if (result) {
         if (result->signatures) {
             gpgme_key_t key = NULL;
-            error = gpgme_get_key(ctx, result->signatures->fpr, &key, 0);
+            error = p_gpg_get_key(ctx, result->signatures->fpr, &key, FALSE);
             if (error) {
                 log_debug("Could not find PGP key with ID %s for %s", result->signatures->fpr, barejid);
             } else {
@@ -507,14 +526,21 @@ p_gpg_verify(const char* const barejid, const char* const sign)
         }
     }
 
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 }
 
 char*
 p_gpg_sign(const char* const str, const char* const fp)
 {
+    if (sign_cache.result
+        && sign_cache.generation == p_gpg_key_cache_generation()
+        && g_strcmp0(sign_cache.str, str) == 0
+        && g_strcmp0(sign_cache.fp, fp) == 0) {
+        return strdup(sign_cache.result);
+    }
+
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         return NULL;
@@ -523,11 +549,11 @@ p_gpg_sign(const char* const str, const char* const fp)
     gpgme_set_passphrase_cb(ctx, (gpgme_passphrase_cb_t)_p_gpg_passphrase_cb, NULL);
 
     gpgme_key_t key = NULL;
-    error = gpgme_get_key(ctx, fp, &key, 1);
+    error = p_gpg_get_key(ctx, fp, &key, TRUE);
 
     if (error || key == NULL) {
         log_error("GPG: Failed to get key. %s %s", gpgme_strsource(error), gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return NULL;
     }
 
@@ -537,7 +563,7 @@ p_gpg_sign(const char* const str, const char* const fp)
 
     if (error) {
         log_error("GPG: Failed to load signer. %s %s", gpgme_strsource(error), gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return NULL;
     }
 
@@ -557,7 +583,7 @@ p_gpg_sign(const char* const str, const char* const fp)
     gpgme_set_armor(ctx, 1);
     error = gpgme_op_sign(ctx, str_data, signed_data, GPGME_SIG_MODE_DETACH);
     gpgme_data_release(str_data);
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 
     if (error) {
         log_error("GPG: Failed to sign string. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -581,6 +607,14 @@ p_gpg_sign(const char* const str, const char* const fp)
         passphrase = strdup(passphrase_attempt);
     }
 
+    if (result) {
+        _sign_cache_clear();
+        sign_cache.str = str ? strdup(str) : NULL;
+        sign_cache.fp = fp ? strdup(fp) : NULL;
+        sign_cache.result = strdup(result);
+        sign_cache.generation = p_gpg_key_cache_generation();
+    }
+
     return result;
 }
 
@@ -602,26 +636,26 @@ p_gpg_encrypt(const char* const barejid, const char* const message, const char*
     keys[2] = NULL;
 
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         return NULL;
     }
 
     gpgme_key_t receiver_key;
-    error = gpgme_get_key(ctx, pubkeyid->id, &receiver_key, 0);
+    error = p_gpg_get_key(ctx, pubkeyid->id, &receiver_key, FALSE);
     if (error || receiver_key == NULL) {
         log_error("GPG: Failed to get receiver_key. %s %s", gpgme_strsource(error), gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return NULL;
     }
     keys[0] = receiver_key;
 
     gpgme_key_t sender_key = NULL;
-    error = gpgme_get_key(ctx, fp, &sender_key, 0);
+    error = p_gpg_get_key(ctx, fp, &sender_key, FALSE);
     if (error || sender_key == NULL) {
         log_error("GPG: Failed to get sender_key. %s %s", gpgme_strsource(error), gpgme_strerror(error));
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return NULL;
     }
     keys[1] = sender_key;
@@ -635,7 +669,7 @@ p_gpg_encrypt(const char* const barejid, const char* const message, const char*
     gpgme_set_armor(ctx, 1);
     error = gpgme_op_encrypt(ctx, keys, GPGME_ENCRYPT_ALWAYS_TRUST, plain, cipher);
     gpgme_data_release(plain);
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
     gpgme_key_unref(receiver_key);
     gpgme_key_unref(sender_key);
 
@@ -663,7 +697,7 @@ char*
 p_gpg_decrypt(const char* const cipher)
 {
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("GPG: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -686,7 +720,7 @@ p_gpg_decrypt(const char* const cipher)
     if (error) {
         log_error("GPG: Failed to encrypt message. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         gpgme_data_release(plain_data);
-        gpgme_release(ctx);
+        p_gpg_ctx_release(ctx);
         return NULL;
     }
 
@@ -696,7 +730,7 @@ p_gpg_decrypt(const char* const cipher)
         gpgme_recipient_t recipient = res->recipients;
         while (recipient) {
             gpgme_key_t key;
-            error = gpgme_get_key(ctx, recipient->keyid, &key, 1);
+            error = p_gpg_get_key(ctx, recipient->keyid, &key, TRUE);
 
             if (!error && key) {
                 const char* addr = gpgme_key_get_string_attr(key, GPGME_ATTR_EMAIL, NULL, 0);
@@ -716,7 +750,7 @@ p_gpg_decrypt(const char* const cipher)
         log_debug("GPG: Decrypted message for recipients: %s", recipients_str->str);
         g_string_free(recipients_str, TRUE);
     }
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 
     size_t len = 0;
     char* plain_str = gpgme_data_release_and_get_mem(plain_data, &len);
@@ -734,6 +768,63 @@ p_gpg_decrypt(const char* const cipher)
     return result;
 }
 
+static gpgme_error_t
+_p_gpg_passphrase_cb_background(void* hook, const char* uid_hint, const char* passphrase_info, int prev_was_bad, int fd)
+{
+    // workers can't prompt, the message is decrypted again on the main thread
+    gboolean* retry = hook;
+    *retry = TRUE;
+
+    return GPG_ERR_CANCELED;
+}
+
+/*
+ * Decrypt from a crypto worker thread. Never prompts and never logs, retry is
+ * set when the message has to go through p_gpg_decrypt on the main thread
+ * instead, e.g. because the key needs a passphrase.
+ */
+char*
+p_gpg_decrypt_background(const char* const cipher, gboolean* retry)
+{
+    *retry = FALSE;
+
+    gpgme_ctx_t ctx;
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
+    if (error) {
+        *retry = TRUE;
+        return NULL;
+    }
+
+    gpgme_set_passphrase_cb(ctx, (gpgme_passphrase_cb_t)_p_gpg_passphrase_cb_background, retry);
+
+    char* cipher_with_headers = _add_header_footer(cipher, PGP_MESSAGE_HEADER, PGP_MESSAGE_FOOTER);
+    gpgme_data_t cipher_data;
+    gpgme_data_new_from_mem(&cipher_data, cipher_with_headers, strlen(cipher_with_headers), 1);
+    free(cipher_with_headers);
+
+    gpgme_data_t plain_data;
+    gpgme_data_new(&plain_data);
+
+    error = gpgme_op_decrypt(ctx, cipher_data, plain_data);
+    gpgme_data_release(cipher_data);
+    p_gpg_ctx_release(ctx);
+
+    if (error) {
+        gpgme_data_release(plain_data);
+        return NULL;
+    }
+
+    size_t len = 0;
+    char* plain_str = gpgme_data_release_and_get_mem(plain_data, &len);
+    char* result = NULL;
+    if (plain_str) {
+        result = g_strndup(plain_str, len);
+    }
+    gpgme_free(plain_str);
+
+    return result;
+}
+
 void
 p_gpg_free_decrypted(char* decrypted)
 {
@@ -743,6 +834,13 @@ p_gpg_free_decrypted(char* decrypted)
 char*
 p_gpg_autocomplete_key(const char* const search_str, gboolean previous, void* context)
 {
+    if (!key_ac_loaded) {
+        GHashTable* keys = p_gpg_list_keys();
+        if (keys) {
+            p_gpg_free_keys(keys);
+        }
+    }
+
     return autocomplete_complete(key_ac, search_str, TRUE, previous);
 }
 
@@ -815,6 +913,17 @@ _add_header_footer(const char* const str, const char* const header, const char*
     return result;
 }
 
+static void
+_sign_cache_clear(void)
+{
+    free(sign_cache.str);
+    free(sign_cache.fp);
+    free(sign_cache.result);
+    sign_cache.str = NULL;
+    sign_cache.fp = NULL;
+    sign_cache.result = NULL;
+}
+
 static void
 _save_pubkeys(void)
 {
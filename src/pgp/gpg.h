@@ -69,6 +69,7 @@ char* p_gpg_sign(const char* const str, const char* const fp);
 void p_gpg_verify(const char* const barejid, const char* const sign);
 char* p_gpg_encrypt(const char* const barejid, const char* const message, const char* const fp);
 char* p_gpg_decrypt(const char* const cipher);
+char* p_gpg_decrypt_background(const char* const cipher, gboolean* retry);
 void p_gpg_free_decrypted(char* decrypted);
 char* p_gpg_autocomplete_key(const char* const search_str, gboolean previous, void* context);
 void p_gpg_autocomplete_key_reset(void);
@@ -0,0 +1,330 @@
+/*
+ * gpgcache.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gpgme.h>
+
+#include "pgp/gpgcache.h"
+
+// idle contexts kept around, creating one spawns and talks to the gpg engine
+#define CTX_POOL_SIZE 4
+
+// keys kept per kind, least recently used ones are dropped first
+#define KEY_CACHE_SIZE 64
+
+// how often the keyring files are checked for modifications
+#define KEYRING_CHECK_INTERVAL G_USEC_PER_SEC
+
+typedef struct key_cache_entry_t
+{
+    char* id;
+    gpgme_key_t key;
+} KeyCacheEntry;
+
+// the crypto workers use contexts and keys from their own threads
+G_LOCK_DEFINE_STATIC(gpgcache);
+
+static GSList* ctx_pool = NULL;
+static guint ctx_pool_len = 0;
+
+static GHashTable* key_cache = NULL;
+static GQueue key_lru = G_QUEUE_INIT;
+static guint generation = 0;
+
+static void _key_cache_clear(void);
+
+static gint64 keyring_stamp = 0;
+static gint64 keyring_checked = 0;
+
+static const char* keyring_files[] = {
+    "pubring.kbx",
+    "pubring.gpg",
+    "secring.gpg",
+    "private-keys-v1.d",
+    "trustdb.gpg",
+    NULL
+};
+
+gpgme_error_t
+p_gpg_ctx_acquire(gpgme_ctx_t* ctx)
+{
+    G_LOCK(gpgcache);
+    if (ctx_pool) {
+        *ctx = ctx_pool->data;
+        ctx_pool = g_slist_delete_link(ctx_pool, ctx_pool);
+        ctx_pool_len--;
+        G_UNLOCK(gpgcache);
+        return GPG_ERR_NO_ERROR;
+    }
+    G_UNLOCK(gpgcache);
+
+    return gpgme_new(ctx);
+}
+
+void
+p_gpg_ctx_release(gpgme_ctx_t ctx)
+{
+    if (!ctx) {
+        return;
+    }
+
+    // back to the settings of a fresh context
+    gpgme_signers_clear(ctx);
+    gpgme_set_passphrase_cb(ctx, NULL, NULL);
+    gpgme_set_protocol(ctx, GPGME_PROTOCOL_OPENPGP);
+    gpgme_set_armor(ctx, 0);
+    gpgme_set_textmode(ctx, 0);
+    gpgme_set_offline(ctx, 0);
+    gpgme_set_keylist_mode(ctx, GPGME_KEYLIST_MODE_LOCAL);
+
+    G_LOCK(gpgcache);
+    if (ctx_pool_len < CTX_POOL_SIZE) {
+        ctx_pool = g_slist_prepend(ctx_pool, ctx);
+        ctx_pool_len++;
+        ctx = NULL;
+    }
+    G_UNLOCK(gpgcache);
+
+    if (ctx) {
+        gpgme_release(ctx);
+    }
+}
+
+static void
+_key_cache_entry_free(KeyCacheEntry* entry)
+{
+    free(entry->id);
+    gpgme_key_unref(entry->key);
+    free(entry);
+}
+
+static gint64
+_keyring_stamp(void)
+{
+    const char* homedir = gpgme_get_dirinfo("homedir");
+    if (!homedir) {
+        return 0;
+    }
+
+    gint64 stamp = 0;
+    for (int i = 0; keyring_files[i]; i++) {
+        gchar* path = g_build_filename(homedir, keyring_files[i], NULL);
+        GStatBuf st;
+        if (g_stat(path, &st) == 0) {
+            stamp = stamp * 31 + (gint64)st.st_mtime + (gint64)st.st_size;
+        }
+        g_free(path);
+    }
+
+    return stamp;
+}
+
+// Drop all cached keys when gpg wrote to the keyring since the last check,
+// e.g. after an import, a key edit or a change of trust from the command line
+static void
+_key_cache_check_keyring(void)
+{
+    gint64 now = g_get_monotonic_time();
+    if (keyring_checked != 0 && now - keyring_checked < KEYRING_CHECK_INTERVAL) {
+        return;
+    }
+    keyring_checked = now;
+
+    gint64 stamp = _keyring_stamp();
+    if (stamp != keyring_stamp) {
+        keyring_stamp = stamp;
+        _key_cache_clear();
+    }
+}
+
+static gchar*
+_key_cache_id(const char* const id, gboolean secret)
+{
+    return g_strdup_printf("%c:%s", secret ? 's' : 'p', id);
+}
+
+gpgme_key_t
+p_gpg_key_cache_lookup(const char* const id, gboolean secret)
+{
+    if (!id) {
+        return NULL;
+    }
+
+    G_LOCK(gpgcache);
+    if (!key_cache) {
+        G_UNLOCK(gpgcache);
+        return NULL;
+    }
+
+    _key_cache_check_keyring();
+
+    gchar* cache_id = _key_cache_id(id, secret);
+    GList* link = g_hash_table_lookup(key_cache, cache_id);
+    g_free(cache_id);
+
+    if (!link) {
+        G_UNLOCK(gpgcache);
+        return NULL;
+    }
+
+    // most recently used entries are kept at the head
+    g_queue_unlink(&key_lru, link);
+    g_queue_push_head_link(&key_lru, link);
+
+    KeyCacheEntry* entry = link->data;
+    gpgme_key_t key = entry->key;
+    gpgme_key_ref(key);
+    G_UNLOCK(gpgcache);
+
+    return key;
+}
+
+void
+p_gpg_key_cache_add(const char* const id, gboolean secret, gpgme_key_t key)
+{
+    if (!id || !key) {
+        return;
+    }
+
+    G_LOCK(gpgcache);
+    if (!key_cache) {
+        key_cache = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+    _key_cache_check_keyring();
+
+    gchar* cache_id = _key_cache_id(id, secret);
+    if (g_hash_table_contains(key_cache, cache_id)) {
+        G_UNLOCK(gpgcache);
+        g_free(cache_id);
+        return;
+    }
+
+    KeyCacheEntry* entry = malloc(sizeof(KeyCacheEntry));
+    if (!entry) {
+        G_UNLOCK(gpgcache);
+        g_free(cache_id);
+        return;
+    }
+    entry->id = strdup(cache_id);
+    entry->key = key;
+    gpgme_key_ref(key);
+    g_free(cache_id);
+
+    g_queue_push_head(&key_lru, entry);
+    g_hash_table_insert(key_cache, entry->id, key_lru.head);
+
+    if (g_queue_get_length(&key_lru) > KEY_CACHE_SIZE) {
+        KeyCacheEntry* oldest = g_queue_pop_tail(&key_lru);
+        g_hash_table_remove(key_cache, oldest->id);
+        _key_cache_entry_free(oldest);
+    }
+    G_UNLOCK(gpgcache);
+}
+
+gpgme_error_t
+p_gpg_get_key(gpgme_ctx_t ctx, const char* const fpr, gpgme_key_t* key, gboolean secret)
+{
+    *key = p_gpg_key_cache_lookup(fpr, secret);
+    if (*key) {
+        return GPG_ERR_NO_ERROR;
+    }
+
+    gpgme_error_t error = gpgme_get_key(ctx, fpr, key, secret ? 1 : 0);
+    if (!error && *key) {
+        p_gpg_key_cache_add(fpr, secret, *key);
+    }
+
+    return error;
+}
+
+static void
+_key_cache_clear(void)
+{
+    if (key_cache) {
+        g_hash_table_remove_all(key_cache);
+    }
+
+    KeyCacheEntry* entry;
+    while ((entry = g_queue_pop_head(&key_lru)) != NULL) {
+        _key_cache_entry_free(entry);
+    }
+
+    generation++;
+}
+
+void
+p_gpg_key_cache_clear(void)
+{
+    G_LOCK(gpgcache);
+    _key_cache_clear();
+    G_UNLOCK(gpgcache);
+}
+
+// Increases every time the cache is cleared, anything derived from cached
+// keys is stale once it changed
+guint
+p_gpg_key_cache_generation(void)
+{
+    G_LOCK(gpgcache);
+    _key_cache_check_keyring();
+    guint result = generation;
+    G_UNLOCK(gpgcache);
+
+    return result;
+}
+
+void
+p_gpg_cache_close(void)
+{
+    G_LOCK(gpgcache);
+    _key_cache_clear();
+    if (key_cache) {
+        g_hash_table_destroy(key_cache);
+        key_cache = NULL;
+    }
+    keyring_stamp = 0;
+    keyring_checked = 0;
+
+    g_slist_free_full(ctx_pool, (GDestroyNotify)gpgme_release);
+    ctx_pool = NULL;
+    ctx_pool_len = 0;
+    G_UNLOCK(gpgcache);
+}
@@ -0,0 +1,53 @@
+/*
+ * gpgcache.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#ifndef PGP_GPGCACHE_H
+#define PGP_GPGCACHE_H
+
+#include <glib.h>
+#include <gpgme.h>
+
+gpgme_error_t p_gpg_ctx_acquire(gpgme_ctx_t* ctx);
+void p_gpg_ctx_release(gpgme_ctx_t ctx);
+
+gpgme_error_t p_gpg_get_key(gpgme_ctx_t ctx, const char* const fpr, gpgme_key_t* key, gboolean secret);
+gpgme_key_t p_gpg_key_cache_lookup(const char* const id, gboolean secret);
+void p_gpg_key_cache_add(const char* const id, gboolean secret, gpgme_key_t key);
+void p_gpg_key_cache_clear(void);
+guint p_gpg_key_cache_generation(void);
+
+void p_gpg_cache_close(void);
+
+#endif
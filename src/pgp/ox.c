@@ -49,6 +49,7 @@
 #include "log.h"
 #include "common.h"
 #include "pgp/ox.h"
+#include "pgp/gpgcache.h"
 #include "config/files.h"
 #include "ui/ui.h"
 
@@ -71,7 +72,7 @@ ox_gpg_public_keys(void)
     GHashTable* result = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)p_gpg_free_key);
 
     gpgme_ctx_t ctx;
-    error = gpgme_new(&ctx);
+    error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("OX: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -85,6 +86,7 @@ ox_gpg_public_keys(void)
         if (error != GPG_ERR_EOF && error != GPG_ERR_NO_ERROR) {
             log_error("OX: gpgme_op_keylist_next %s %s", gpgme_strsource(error), gpgme_strerror(error));
             g_hash_table_destroy(result);
+            p_gpg_ctx_release(ctx);
             return NULL;
         }
         while (!error) {
@@ -137,7 +139,7 @@ ox_gpg_public_keys(void)
             error = gpgme_op_keylist_next(ctx, &key);
         }
     }
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 
     return result;
 }
@@ -150,7 +152,7 @@ p_ox_gpg_signcrypt(const char* const sender_barejid, const char* const recipient
     gpgme_set_locale(NULL, LC_CTYPE, setlocale(LC_CTYPE, NULL));
     gpgme_ctx_t ctx;
 
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
     if (GPG_ERR_NO_ERROR != error) {
         log_error("OX: Failed to create gpgme context. %s %s", gpgme_strsource(error), gpgme_strerror(error));
         return NULL;
@@ -242,7 +244,7 @@ p_ox_gpg_signcrypt(const char* const sender_barejid, const char* const recipient
     char* result = g_base64_encode((unsigned char*)cipher_str, len);
     gpgme_key_release(recp[0]);
     gpgme_key_release(recp[1]);
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
     return result;
 }
 
@@ -282,12 +284,20 @@ static gpgme_key_t
 _ox_key_lookup(const char* const barejid, gboolean secret_only)
 {
     g_assert(barejid);
+
+    auto_gchar gchar* xmppuri = g_strdup_printf("xmpp:%s", barejid);
+
+    // finding the key means listing the whole keyring, remember the result
+    gpgme_key_t key = p_gpg_key_cache_lookup(xmppuri, secret_only);
+    if (key) {
+        return key;
+    }
+
     log_debug("OX: Looking for %s key: %s", secret_only == TRUE ? "Private" : "Public", barejid);
-    gpgme_key_t key = NULL;
     gpgme_error_t error;
 
     gpgme_ctx_t ctx;
-    error = gpgme_new(&ctx);
+    error = p_gpg_ctx_acquire(&ctx);
 
     if (error) {
         log_error("OX: gpgme_new failed: %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -299,32 +309,33 @@ _ox_key_lookup(const char* const barejid, gboolean secret_only)
         error = gpgme_op_keylist_next(ctx, &key);
         if (error != GPG_ERR_EOF && error != GPG_ERR_NO_ERROR) {
             log_error("OX: gpgme_op_keylist_next %s %s", gpgme_strsource(error), gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return NULL;
         }
 
-        GString* xmppuri = g_string_new("xmpp:");
-        g_string_append(xmppuri, barejid);
-
         while (!error) {
             // Looking for XMPP URI UID
             gpgme_user_id_t uid = key->uids;
 
             while (uid) {
                 if (uid->name && strlen(uid->name) >= 10) {
-                    if (g_strcmp0(uid->name, xmppuri->str) == 0) {
-                        gpgme_release(ctx);
+                    if (g_strcmp0(uid->name, xmppuri) == 0) {
+                        gpgme_op_keylist_end(ctx);
+                        p_gpg_ctx_release(ctx);
+                        p_gpg_key_cache_add(xmppuri, secret_only, key);
                         return key;
                     }
                 }
                 uid = uid->next;
             }
             gpgme_key_unref(key);
+            key = NULL;
             error = gpgme_op_keylist_next(ctx, &key);
         }
     }
-    gpgme_release(ctx);
+    p_gpg_ctx_release(ctx);
 
-    return key;
+    return NULL;
 }
 
 static gboolean
@@ -371,7 +382,7 @@ p_ox_gpg_decrypt(char* base64)
     gpgme_check_version(NULL);
     gpgme_set_locale(NULL, LC_CTYPE, setlocale(LC_CTYPE, NULL));
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
     if (GPG_ERR_NO_ERROR != error) {
         log_error("OX: gpgme_new failed: %s %s", gpgme_strsource(error), gpgme_strerror(error));
@@ -413,6 +424,10 @@ p_ox_gpg_decrypt(char* base64)
         log_error("OX: gpgme_op_decrypt: %s", gpgme_strerror(error));
         error = gpgme_op_decrypt(ctx, cipher, plain);
         if (error != 0) {
+            gpgme_data_release(plain);
+            gpgme_data_release(cipher);
+            g_free(encrypted);
+            p_gpg_ctx_release(ctx);
             return NULL;
         }
     }
@@ -423,6 +438,9 @@ p_ox_gpg_decrypt(char* base64)
     memcpy(result, plain_str, len);
     result[len] = '\0';
     gpgme_free(plain_str);
+    gpgme_data_release(cipher);
+    g_free(encrypted);
+    p_gpg_ctx_release(ctx);
     return result;
 }
 
@@ -466,7 +484,7 @@ p_ox_gpg_readkey(const char* const filename, char** key, char** fp)
         gpgme_check_version(NULL);
         gpgme_set_locale(NULL, LC_CTYPE, setlocale(LC_CTYPE, NULL));
         gpgme_ctx_t ctx;
-        gpgme_error_t error = gpgme_new(&ctx);
+        gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
         if (GPG_ERR_NO_ERROR != error) {
             log_error("OX: Read OpenPGP key from file: gpgme_new failed: %s", gpgme_strerror(error));
@@ -476,6 +494,7 @@ p_ox_gpg_readkey(const char* const filename, char** key, char** fp)
         error = gpgme_set_protocol(ctx, GPGME_PROTOCOL_OPENPGP);
         if (error != GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: set GPGME_PROTOCOL_OPENPGP:  %s", gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return;
         }
 
@@ -488,23 +507,27 @@ p_ox_gpg_readkey(const char* const filename, char** key, char** fp)
         error = gpgme_data_new(&gpgme_data);
         if (error != GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: gpgme_data_new %s", gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return;
         }
 
         error = gpgme_data_new_from_mem(&gpgme_data, (char*)data, size, 0);
         if (error != GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: gpgme_data_new_from_mem %s", gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return;
         }
         error = gpgme_op_keylist_from_data_start(ctx, gpgme_data, 0);
         if (error != GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: gpgme_op_keylist_from_data_start %s", gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return;
         }
         gpgme_key_t gkey;
         error = gpgme_op_keylist_next(ctx, &gkey);
         if (error != GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: gpgme_op_keylist_next %s", gpgme_strerror(error));
+            p_gpg_ctx_release(ctx);
             return;
         }
 
@@ -512,11 +535,13 @@ p_ox_gpg_readkey(const char* const filename, char** key, char** fp)
         error = gpgme_op_keylist_next(ctx, &end);
         if (error == GPG_ERR_NO_ERROR) {
             log_error("OX: Read OpenPGP key from file: ambiguous key");
+            p_gpg_ctx_release(ctx);
             return;
         }
 
         if (gkey->revoked || gkey->expired || gkey->disabled || gkey->invalid || gkey->secret) {
             log_error("OX: Read OpenPGP key from file: Key is not valid");
+            p_gpg_ctx_release(ctx);
             return;
         }
 
@@ -524,6 +549,9 @@ p_ox_gpg_readkey(const char* const filename, char** key, char** fp)
 
         *key = strdup(keybase64);
         *fp = strdup(gkey->fpr);
+        g_free(keybase64);
+        gpgme_key_unref(gkey);
+        p_gpg_ctx_release(ctx);
     } else {
         log_error("OX: Read OpenPGP key from file: Unable to read file: %s", error->message);
     }
@@ -539,7 +567,7 @@ p_ox_gpg_import(char* base64_public_key)
     gpgme_check_version(NULL);
     gpgme_set_locale(NULL, LC_CTYPE, setlocale(LC_CTYPE, NULL));
     gpgme_ctx_t ctx;
-    gpgme_error_t error = gpgme_new(&ctx);
+    gpgme_error_t error = p_gpg_ctx_acquire(&ctx);
 
     if (GPG_ERR_NO_ERROR != error) {
         log_error("OX: Read OpenPGP key from file: gpgme_new failed: %s", gpgme_strerror(error));
@@ -549,6 +577,7 @@ p_ox_gpg_import(char* base64_public_key)
     error = gpgme_set_protocol(ctx, GPGME_PROTOCOL_OPENPGP);
     if (error != GPG_ERR_NO_ERROR) {
         log_error("OX: Read OpenPGP key from file: set GPGME_PROTOCOL_OPENPGP:  %s", gpgme_strerror(error));
+        p_gpg_ctx_release(ctx);
         return FALSE;
     }
 
@@ -561,6 +590,7 @@ p_ox_gpg_import(char* base64_public_key)
     error = gpgme_data_new(&gpgme_data);
     if (error != GPG_ERR_NO_ERROR) {
         log_error("OX: Read OpenPGP key from file: gpgme_data_new %s", gpgme_strerror(error));
+        p_gpg_ctx_release(ctx);
         return FALSE;
     }
 
@@ -569,6 +599,11 @@ p_ox_gpg_import(char* base64_public_key)
     if (error != GPG_ERR_NO_ERROR) {
         log_error("OX: Failed to import key");
     }
+    gpgme_data_release(gpgme_data);
+    p_gpg_ctx_release(ctx);
+
+    // a new key may now carry the xmpp: URI of a contact
+    p_gpg_key_cache_clear();
 
     return TRUE;
 }
@@ -50,6 +50,8 @@
 #include "plugins/themes.h"
 #include "plugins/settings.h"
 #include "plugins/disco.h"
+#include "tools/mainloop.h"
+#include "tools/stats.h"
 #include "ui/ui.h"
 #include "xmpp/xmpp.h"
 
@@ -63,8 +65,324 @@
 #include "plugins/c_api.h"
 #endif
 
+// observe-only hook calls run from the main loop for at most this long per iteration
+#define PLUGINS_HOOK_SLICE_US 10000
+
+typedef enum {
+    PLUGIN_HOOK_POST_CHAT_MESSAGE_DISPLAY,
+    PLUGIN_HOOK_POST_CHAT_MESSAGE_SEND,
+    PLUGIN_HOOK_POST_ROOM_MESSAGE_DISPLAY,
+    PLUGIN_HOOK_POST_ROOM_MESSAGE_SEND,
+    PLUGIN_HOOK_ON_ROOM_HISTORY_MESSAGE,
+    PLUGIN_HOOK_POST_PRIV_MESSAGE_DISPLAY,
+    PLUGIN_HOOK_POST_PRIV_MESSAGE_SEND,
+    PLUGIN_HOOK_ON_CONTACT_OFFLINE,
+    PLUGIN_HOOK_ON_CONTACT_PRESENCE,
+    PLUGIN_HOOK_ON_CHAT_WIN_FOCUS,
+    PLUGIN_HOOK_ON_ROOM_WIN_FOCUS
+} plugin_hook_t;
+
+typedef struct plugin_hook_call_t
+{
+    plugin_hook_t hook;
+    char* args[4];
+    int priority;
+    GDateTime* timestamp;
+} PluginHookCall;
+
+// a plugin over its budget this many calls in a row gets reported
+#define PLUGINS_BUDGET_STRIKES 5
+
+typedef struct plugin_hook_stats_t
+{
+    guint count;
+    gint64 total_us;
+    gint64 max_us;
+    guint over_budget;
+} PluginHookStats;
+
+typedef struct plugin_stats_t
+{
+    // hook name -> PluginHookStats
+    GHashTable* hooks;
+    guint strikes;
+    gboolean reported;
+} PluginStats;
+
 static GHashTable* plugins;
 
+// plugin name -> PluginStats
+static GHashTable* plugin_stats = NULL;
+// plugins the budget watchdog unloads on the next main loop iteration
+static GSList* plugins_to_disable = NULL;
+
+static gboolean _plugins_unload(const char* const name, gboolean forget);
+
+static GQueue hook_queue = G_QUEUE_INIT;
+static gboolean hooks_running = FALSE;
+static guint hooks_dropped = 0;
+
+static void
+_plugin_stats_free(PluginStats* stats)
+{
+    g_hash_table_destroy(stats->hooks);
+    free(stats);
+}
+
+static void
+_plugins_hook_end(ProfPlugin* plugin, const char* const hook, gint64 start)
+{
+    stats_end(PROF_STATS_PLUGIN_HOOK, start);
+    gint64 elapsed = g_get_monotonic_time() - start;
+
+    if (!plugin_stats) {
+        plugin_stats = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_plugin_stats_free);
+    }
+
+    PluginStats* stats = g_hash_table_lookup(plugin_stats, plugin->name);
+    if (!stats) {
+        stats = malloc(sizeof(PluginStats));
+        stats->hooks = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free);
+        stats->strikes = 0;
+        stats->reported = FALSE;
+        g_hash_table_insert(plugin_stats, g_strdup(plugin->name), stats);
+    }
+
+    // hook names are string literals
+    PluginHookStats* hook_stats = g_hash_table_lookup(stats->hooks, hook);
+    if (!hook_stats) {
+        hook_stats = calloc(1, sizeof(PluginHookStats));
+        g_hash_table_insert(stats->hooks, (gpointer)hook, hook_stats);
+    }
+    hook_stats->count++;
+    hook_stats->total_us += elapsed;
+    if (elapsed > hook_stats->max_us) {
+        hook_stats->max_us = elapsed;
+    }
+
+    gint budget_ms = prefs_get_plugins_hook_budget();
+    if (budget_ms <= 0 || elapsed <= (gint64)budget_ms * 1000) {
+        stats->strikes = 0;
+        stats->reported = FALSE;
+        return;
+    }
+
+    hook_stats->over_budget++;
+    stats->strikes++;
+    if (stats->strikes < PLUGINS_BUDGET_STRIKES || stats->reported) {
+        return;
+    }
+    stats->reported = TRUE;
+
+    log_warning("Plugin %s exceeded its %dms budget %u times in a row, %s took %.1fms", plugin->name, budget_ms,
+                stats->strikes, hook, elapsed / 1000.0);
+    if (prefs_get_plugins_hook_autodisable()) {
+        cons_show_error("Plugin %s keeps exceeding the %dms budget for hooks, it will be unloaded.", plugin->name, budget_ms);
+        if (!g_slist_find_custom(plugins_to_disable, plugin->name, (GCompareFunc)g_strcmp0)) {
+            plugins_to_disable = g_slist_append(plugins_to_disable, g_strdup(plugin->name));
+            mainloop_wakeup();
+        }
+    } else {
+        cons_show_error("Plugin %s keeps exceeding the %dms budget for hooks, see /plugins stats.", plugin->name, budget_ms);
+    }
+}
+
+static void
+_plugins_hook_call_free(PluginHookCall* call)
+{
+    for (int i = 0; i < 4; i++) {
+        free(call->args[i]);
+    }
+    if (call->timestamp) {
+        g_date_time_unref(call->timestamp);
+    }
+    free(call);
+}
+
+/*
+ * Queue a call to a hook that can't change what profanity does, instead of
+ * letting every plugin run while a stanza is being handled. Returns FALSE
+ * when the hook should run right away.
+ */
+static gboolean
+_plugins_hook_defer(plugin_hook_t hook, const char* const arg0, const char* const arg1, const char* const arg2,
+                    const char* const arg3, int priority, GDateTime* timestamp)
+{
+    if (hooks_running || !plugins || g_hash_table_size(plugins) == 0) {
+        return FALSE;
+    }
+
+    gint max = prefs_get_plugins_hook_queue();
+    if (max <= 0) {
+        return FALSE;
+    }
+
+    // the oldest calls are dropped when the plugins can't keep up
+    while (g_queue_get_length(&hook_queue) >= (guint)max) {
+        _plugins_hook_call_free(g_queue_pop_head(&hook_queue));
+        hooks_dropped++;
+    }
+
+    PluginHookCall* call = malloc(sizeof(PluginHookCall));
+    call->hook = hook;
+    call->args[0] = arg0 ? strdup(arg0) : NULL;
+    call->args[1] = arg1 ? strdup(arg1) : NULL;
+    call->args[2] = arg2 ? strdup(arg2) : NULL;
+    call->args[3] = arg3 ? strdup(arg3) : NULL;
+    call->priority = priority;
+    call->timestamp = timestamp ? g_date_time_ref(timestamp) : NULL;
+    g_queue_push_tail(&hook_queue, call);
+
+    return TRUE;
+}
+
+static void
+_plugins_hook_run(PluginHookCall* call)
+{
+    hooks_running = TRUE;
+
+    switch (call->hook) {
+    case PLUGIN_HOOK_POST_CHAT_MESSAGE_DISPLAY:
+        plugins_post_chat_message_display(call->args[0], call->args[1], call->args[2]);
+        break;
+    case PLUGIN_HOOK_POST_CHAT_MESSAGE_SEND:
+        plugins_post_chat_message_send(call->args[0], call->args[1]);
+        break;
+    case PLUGIN_HOOK_POST_ROOM_MESSAGE_DISPLAY:
+        plugins_post_room_message_display(call->args[0], call->args[1], call->args[2]);
+        break;
+    case PLUGIN_HOOK_POST_ROOM_MESSAGE_SEND:
+        plugins_post_room_message_send(call->args[0], call->args[1]);
+        break;
+    case PLUGIN_HOOK_ON_ROOM_HISTORY_MESSAGE:
+        plugins_on_room_history_message(call->args[0], call->args[1], call->args[2], call->timestamp);
+        break;
+    case PLUGIN_HOOK_POST_PRIV_MESSAGE_DISPLAY:
+        plugins_post_priv_message_display(call->args[0], call->args[1]);
+        break;
+    case PLUGIN_HOOK_POST_PRIV_MESSAGE_SEND:
+        plugins_post_priv_message_send(call->args[0], call->args[1]);
+        break;
+    case PLUGIN_HOOK_ON_CONTACT_OFFLINE:
+        plugins_on_contact_offline(call->args[0], call->args[1], call->args[2]);
+        break;
+    case PLUGIN_HOOK_ON_CONTACT_PRESENCE:
+        plugins_on_contact_presence(call->args[0], call->args[1], call->args[2], call->args[3], call->priority);
+        break;
+    case PLUGIN_HOOK_ON_CHAT_WIN_FOCUS:
+        plugins_on_chat_win_focus(call->args[0]);
+        break;
+    case PLUGIN_HOOK_ON_ROOM_WIN_FOCUS:
+        plugins_on_room_win_focus(call->args[0]);
+        break;
+    }
+
+    hooks_running = FALSE;
+}
+
+// budget_us of 0 runs everything that is queued
+static void
+_plugins_hooks_drain(gint64 budget_us)
+{
+    gint64 start = g_get_monotonic_time();
+
+    PluginHookCall* call;
+    while ((call = g_queue_pop_head(&hook_queue)) != NULL) {
+        _plugins_hook_run(call);
+        _plugins_hook_call_free(call);
+
+        if (budget_us > 0 && g_get_monotonic_time() - start >= budget_us) {
+            break;
+        }
+
+        // unload it before running any more of its queued calls
+        if (budget_us > 0 && plugins_to_disable) {
+            break;
+        }
+    }
+
+    if (hooks_dropped > 0) {
+        log_warning("Plugins fell behind, dropped %u queued hook calls", hooks_dropped);
+        hooks_dropped = 0;
+    }
+}
+
+/*
+ * Per plugin and hook call counts and times, for /plugins stats. Returns a
+ * list of lines to be freed with g_free.
+ */
+GSList*
+plugins_stats_report(void)
+{
+    GSList* lines = NULL;
+    if (!plugin_stats) {
+        return NULL;
+    }
+
+    GList* names = g_list_sort(g_hash_table_get_keys(plugin_stats), (GCompareFunc)g_strcmp0);
+    for (GList* name = names; name; name = g_list_next(name)) {
+        PluginStats* stats = g_hash_table_lookup(plugin_stats, name->data);
+
+        guint count = 0;
+        gint64 total_us = 0;
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, stats->hooks);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            PluginHookStats* hook_stats = value;
+            count += hook_stats->count;
+            total_us += hook_stats->total_us;
+        }
+        lines = g_slist_append(lines, g_strdup_printf("%s: %u calls, %.1fms in total", (char*)name->data, count, total_us / 1000.0));
+
+        GList* hooks = g_list_sort(g_hash_table_get_keys(stats->hooks), (GCompareFunc)g_strcmp0);
+        for (GList* hook = hooks; hook; hook = g_list_next(hook)) {
+            PluginHookStats* hook_stats = g_hash_table_lookup(stats->hooks, hook->data);
+            lines = g_slist_append(lines, g_strdup_printf("  %-28s : count %u, avg %.2fms, max %.2fms, over budget %u",
+                                                          (char*)hook->data, hook_stats->count,
+                                                          hook_stats->total_us / 1000.0 / hook_stats->count,
+                                                          hook_stats->max_us / 1000.0, hook_stats->over_budget));
+        }
+        g_list_free(hooks);
+    }
+    g_list_free(names);
+
+    return lines;
+}
+
+void
+plugins_stats_reset(void)
+{
+    if (plugin_stats) {
+        g_hash_table_remove_all(plugin_stats);
+    }
+}
+
+// Called from the main loop, runs queued observe-only hooks
+void
+plugins_run_hooks(void)
+{
+    while (plugins_to_disable) {
+        char* name = plugins_to_disable->data;
+        plugins_to_disable = g_slist_delete_link(plugins_to_disable, plugins_to_disable);
+
+        // unloaded for this session only, it is loaded again on the next start
+        if (_plugins_unload(name, FALSE)) {
+            cons_show("Unloaded plugin %s, use '/plugins load %s' to load it again.", name, name);
+        }
+        g_free(name);
+    }
+
+    if (!g_queue_is_empty(&hook_queue)) {
+        _plugins_hooks_drain(PLUGINS_HOOK_SLICE_US);
+
+        // the rest runs on the next iteration, not after the input timeout
+        if (!g_queue_is_empty(&hook_queue)) {
+            mainloop_wakeup();
+        }
+    }
+}
+
 void
 plugins_init(void)
 {
@@ -74,9 +392,6 @@ plugins_init(void)
     plugin_themes_init();
     plugin_settings_init();
 
-#ifdef HAVE_PYTHON
-    python_env_init();
-#endif
 #ifdef HAVE_C
     c_env_init();
 #endif
@@ -91,7 +406,7 @@ plugins_init(void)
             if (g_str_has_suffix(filename, ".py")) {
                 ProfPlugin* plugin = python_plugin_create(filename);
                 if (plugin) {
-                    g_hash_table_insert(plugins, strdup(filename), plugin);
+                    plugins_add(filename, plugin);
                     loaded = TRUE;
                 }
             }
@@ -100,7 +415,7 @@ plugins_init(void)
             if (g_str_has_suffix(filename, ".so")) {
                 ProfPlugin* plugin = c_plugin_create(filename);
                 if (plugin) {
-                    g_hash_table_insert(plugins, strdup(filename), plugin);
+                    plugins_add(filename, plugin);
                     loaded = TRUE;
                 }
             }
@@ -230,6 +545,13 @@ plugins_load_all(void)
     return loaded;
 }
 
+// Registers a created plugin under its file name, the plugin is initialised by the caller
+void
+plugins_add(const char* const name, ProfPlugin* plugin)
+{
+    g_hash_table_insert(plugins, strdup(name), plugin);
+}
+
 gboolean
 plugins_load(const char* const name, GString* error_message)
 {
@@ -255,7 +577,7 @@ plugins_load(const char* const name, GString* error_message)
 #endif
     }
     if (plugin) {
-        g_hash_table_insert(plugins, strdup(name), plugin);
+        plugins_add(name, plugin);
         if (connection_get_status() == JABBER_CONNECTED) {
             const char* account_name = session_get_account_name();
             const char* fulljid = connection_get_fulljid();
@@ -298,8 +620,8 @@ plugins_unload_all(void)
     return result;
 }
 
-gboolean
-plugins_unload(const char* const name)
+static gboolean
+_plugins_unload(const char* const name, gboolean forget)
 {
     ProfPlugin* plugin = g_hash_table_lookup(plugins, name);
     if (plugin) {
@@ -314,7 +636,12 @@ plugins_unload(const char* const name)
             c_plugin_destroy(plugin);
         }
 #endif
-        prefs_remove_plugin(name);
+        if (forget) {
+            prefs_remove_plugin(name);
+        }
+        if (plugin_stats) {
+            g_hash_table_remove(plugin_stats, name);
+        }
         g_hash_table_remove(plugins, name);
 
         caps_reset_ver();
@@ -329,6 +656,12 @@ plugins_unload(const char* const name)
     return FALSE;
 }
 
+gboolean
+plugins_unload(const char* const name)
+{
+    return _plugins_unload(name, TRUE);
+}
+
 void
 plugins_reload_all(void)
 {
@@ -434,7 +767,9 @@ plugins_on_start(void)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_start_func(plugin);
+        _plugins_hook_end(plugin, "on_start_func", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -443,11 +778,15 @@ plugins_on_start(void)
 void
 plugins_on_shutdown(void)
 {
+    _plugins_hooks_drain(0);
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_shutdown_func(plugin);
+        _plugins_hook_end(plugin, "on_shutdown_func", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -460,7 +799,9 @@ plugins_on_connect(const char* const account_name, const char* const fulljid)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_connect_func(plugin, account_name, fulljid);
+        _plugins_hook_end(plugin, "on_connect_func", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -469,11 +810,16 @@ plugins_on_connect(const char* const account_name, const char* const fulljid)
 void
 plugins_on_disconnect(const char* const account_name, const char* const fulljid)
 {
+    // everything that happened while connected is seen before the disconnect
+    _plugins_hooks_drain(0);
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_disconnect_func(plugin, account_name, fulljid);
+        _plugins_hook_end(plugin, "on_disconnect_func", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -489,7 +835,9 @@ plugins_pre_chat_message_display(const char* const barejid, const char* const re
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_message = plugin->pre_chat_message_display(plugin, barejid, resource, curr_message);
+        _plugins_hook_end(plugin, "pre_chat_message_display", start);
         if (new_message) {
             free(curr_message);
             curr_message = strdup(new_message);
@@ -505,11 +853,17 @@ plugins_pre_chat_message_display(const char* const barejid, const char* const re
 void
 plugins_post_chat_message_display(const char* const barejid, const char* const resource, const char* message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_CHAT_MESSAGE_DISPLAY, barejid, resource, message, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_chat_message_display(plugin, barejid, resource, message);
+        _plugins_hook_end(plugin, "post_chat_message_display", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -526,7 +880,9 @@ plugins_pre_chat_message_send(const char* const barejid, const char* message)
     while (curr) {
         ProfPlugin* plugin = curr->data;
         if (plugin->contains_hook(plugin, "prof_pre_chat_message_send")) {
+            gint64 start = stats_start();
             new_message = plugin->pre_chat_message_send(plugin, barejid, curr_message);
+            _plugins_hook_end(plugin, "pre_chat_message_send", start);
             if (new_message) {
                 free(curr_message);
                 curr_message = strdup(new_message);
@@ -548,11 +904,17 @@ plugins_pre_chat_message_send(const char* const barejid, const char* message)
 void
 plugins_post_chat_message_send(const char* const barejid, const char* message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_CHAT_MESSAGE_SEND, barejid, message, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_chat_message_send(plugin, barejid, message);
+        _plugins_hook_end(plugin, "post_chat_message_send", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -568,7 +930,9 @@ plugins_pre_room_message_display(const char* const barejid, const char* const ni
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_message = plugin->pre_room_message_display(plugin, barejid, nick, curr_message);
+        _plugins_hook_end(plugin, "pre_room_message_display", start);
         if (new_message) {
             free(curr_message);
             curr_message = strdup(new_message);
@@ -584,11 +948,17 @@ plugins_pre_room_message_display(const char* const barejid, const char* const ni
 void
 plugins_post_room_message_display(const char* const barejid, const char* const nick, const char* message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_ROOM_MESSAGE_DISPLAY, barejid, nick, message, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_room_message_display(plugin, barejid, nick, message);
+        _plugins_hook_end(plugin, "post_room_message_display", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -605,7 +975,9 @@ plugins_pre_room_message_send(const char* const barejid, const char* message)
     while (curr) {
         ProfPlugin* plugin = curr->data;
         if (plugin->contains_hook(plugin, "prof_pre_room_message_send")) {
+            gint64 start = stats_start();
             new_message = plugin->pre_room_message_send(plugin, barejid, curr_message);
+            _plugins_hook_end(plugin, "pre_room_message_send", start);
             if (new_message) {
                 free(curr_message);
                 curr_message = strdup(new_message);
@@ -627,11 +999,17 @@ plugins_pre_room_message_send(const char* const barejid, const char* message)
 void
 plugins_post_room_message_send(const char* const barejid, const char* message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_ROOM_MESSAGE_SEND, barejid, message, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_room_message_send(plugin, barejid, message);
+        _plugins_hook_end(plugin, "post_room_message_send", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -641,6 +1019,10 @@ void
 plugins_on_room_history_message(const char* const barejid, const char* const nick, const char* const message,
                                 GDateTime* timestamp)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_ON_ROOM_HISTORY_MESSAGE, barejid, nick, message, NULL, 0, timestamp)) {
+        return;
+    }
+
     char* timestamp_str = NULL;
     GTimeVal timestamp_tv;
     gboolean res = g_date_time_to_timeval(timestamp, &timestamp_tv);
@@ -652,7 +1034,9 @@ plugins_on_room_history_message(const char* const barejid, const char* const nic
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_room_history_message(plugin, barejid, nick, message, timestamp_str);
+        _plugins_hook_end(plugin, "on_room_history_message", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -671,7 +1055,9 @@ plugins_pre_priv_message_display(const char* const fulljid, const char* message)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_message = plugin->pre_priv_message_display(plugin, jidp->barejid, jidp->resourcepart, curr_message);
+        _plugins_hook_end(plugin, "pre_priv_message_display", start);
         if (new_message) {
             free(curr_message);
             curr_message = strdup(new_message);
@@ -688,13 +1074,19 @@ plugins_pre_priv_message_display(const char* const fulljid, const char* message)
 void
 plugins_post_priv_message_display(const char* const fulljid, const char* message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_PRIV_MESSAGE_DISPLAY, fulljid, message, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     Jid* jidp = jid_create(fulljid);
 
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_priv_message_display(plugin, jidp->barejid, jidp->resourcepart, message);
+        _plugins_hook_end(plugin, "post_priv_message_display", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -714,7 +1106,9 @@ plugins_pre_priv_message_send(const char* const fulljid, const char* const messa
     while (curr) {
         ProfPlugin* plugin = curr->data;
         if (plugin->contains_hook(plugin, "prof_pre_priv_message_send")) {
+            gint64 start = stats_start();
             new_message = plugin->pre_priv_message_send(plugin, jidp->barejid, jidp->resourcepart, curr_message);
+            _plugins_hook_end(plugin, "pre_priv_message_send", start);
             if (new_message) {
                 free(curr_message);
                 curr_message = strdup(new_message);
@@ -738,13 +1132,19 @@ plugins_pre_priv_message_send(const char* const fulljid, const char* const messa
 void
 plugins_post_priv_message_send(const char* const fulljid, const char* const message)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_POST_PRIV_MESSAGE_SEND, fulljid, message, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     Jid* jidp = jid_create(fulljid);
 
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->post_priv_message_send(plugin, jidp->barejid, jidp->resourcepart, message);
+        _plugins_hook_end(plugin, "post_priv_message_send", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -762,7 +1162,9 @@ plugins_on_message_stanza_send(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_stanza = plugin->on_message_stanza_send(plugin, curr_stanza);
+        _plugins_hook_end(plugin, "on_message_stanza_send", start);
         if (new_stanza) {
             free(curr_stanza);
             curr_stanza = strdup(new_stanza);
@@ -784,7 +1186,9 @@ plugins_on_message_stanza_receive(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         gboolean res = plugin->on_message_stanza_receive(plugin, text);
+        _plugins_hook_end(plugin, "on_message_stanza_receive", start);
         if (res == FALSE) {
             cont = FALSE;
         }
@@ -805,7 +1209,9 @@ plugins_on_presence_stanza_send(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_stanza = plugin->on_presence_stanza_send(plugin, curr_stanza);
+        _plugins_hook_end(plugin, "on_presence_stanza_send", start);
         if (new_stanza) {
             free(curr_stanza);
             curr_stanza = strdup(new_stanza);
@@ -827,7 +1233,9 @@ plugins_on_presence_stanza_receive(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         gboolean res = plugin->on_presence_stanza_receive(plugin, text);
+        _plugins_hook_end(plugin, "on_presence_stanza_receive", start);
         if (res == FALSE) {
             cont = FALSE;
         }
@@ -848,7 +1256,9 @@ plugins_on_iq_stanza_send(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         new_stanza = plugin->on_iq_stanza_send(plugin, curr_stanza);
+        _plugins_hook_end(plugin, "on_iq_stanza_send", start);
         if (new_stanza) {
             free(curr_stanza);
             curr_stanza = strdup(new_stanza);
@@ -870,7 +1280,9 @@ plugins_on_iq_stanza_receive(const char* const text)
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         gboolean res = plugin->on_iq_stanza_receive(plugin, text);
+        _plugins_hook_end(plugin, "on_iq_stanza_receive", start);
         if (res == FALSE) {
             cont = FALSE;
         }
@@ -884,11 +1296,17 @@ plugins_on_iq_stanza_receive(const char* const text)
 void
 plugins_on_contact_offline(const char* const barejid, const char* const resource, const char* const status)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_ON_CONTACT_OFFLINE, barejid, resource, status, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_contact_offline(plugin, barejid, resource, status);
+        _plugins_hook_end(plugin, "on_contact_offline", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -897,11 +1315,17 @@ plugins_on_contact_offline(const char* const barejid, const char* const resource
 void
 plugins_on_contact_presence(const char* const barejid, const char* const resource, const char* const presence, const char* const status, const int priority)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_ON_CONTACT_PRESENCE, barejid, resource, presence, status, priority, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_contact_presence(plugin, barejid, resource, presence, status, priority);
+        _plugins_hook_end(plugin, "on_contact_presence", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -910,11 +1334,17 @@ plugins_on_contact_presence(const char* const barejid, const char* const resourc
 void
 plugins_on_chat_win_focus(const char* const barejid)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_ON_CHAT_WIN_FOCUS, barejid, NULL, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_chat_win_focus(plugin, barejid);
+        _plugins_hook_end(plugin, "on_chat_win_focus", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -923,11 +1353,17 @@ plugins_on_chat_win_focus(const char* const barejid)
 void
 plugins_on_room_win_focus(const char* const barejid)
 {
+    if (_plugins_hook_defer(PLUGIN_HOOK_ON_ROOM_WIN_FOCUS, barejid, NULL, NULL, NULL, 0, NULL)) {
+        return;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
     while (curr) {
         ProfPlugin* plugin = curr->data;
+        gint64 start = stats_start();
         plugin->on_room_win_focus(plugin, barejid);
+        _plugins_hook_end(plugin, "on_room_win_focus", start);
         curr = g_list_next(curr);
     }
     g_list_free(values);
@@ -942,6 +1378,14 @@ plugins_get_disco_features(void)
 void
 plugins_shutdown(void)
 {
+    g_queue_clear_full(&hook_queue, (GDestroyNotify)_plugins_hook_call_free);
+    g_slist_free_full(plugins_to_disable, g_free);
+    plugins_to_disable = NULL;
+    if (plugin_stats) {
+        g_hash_table_destroy(plugin_stats);
+        plugin_stats = NULL;
+    }
+
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
 
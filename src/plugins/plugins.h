@@ -109,6 +109,7 @@ typedef struct prof_plugin_t
 } ProfPlugin;
 
 void plugins_init(void);
+void plugins_add(const char* const name, ProfPlugin* plugin);
 GSList* plugins_unloaded_list(void);
 GList* plugins_loaded_list(void);
 char* plugins_autocomplete(const char* const input, gboolean previous);
@@ -172,6 +173,9 @@ void plugins_on_room_win_focus(const char* const barejid);
 
 gboolean plugins_run_command(const char* const cmd);
 void plugins_run_timed(void);
+void plugins_run_hooks(void);
+GSList* plugins_stats_report(void);
+void plugins_stats_reset(void);
 GList* plugins_get_command_names(void);
 gchar* plugins_get_dir(void);
 CommandHelp* plugins_get_help(const char* const cmd);
@@ -50,6 +50,8 @@
 
 static PyThreadState* thread_state;
 static GHashTable* loaded_modules;
+// the interpreter is only started once the first Python plugin is loaded
+static gboolean python_started = FALSE;
 
 static void _python_undefined_error(ProfPlugin* plugin, char* hook, char* type);
 static void _python_type_error(ProfPlugin* plugin, char* hook, char* type);
@@ -95,6 +97,11 @@ python_get_version_number(void)
 void
 python_env_init(void)
 {
+    if (python_started) {
+        return;
+    }
+    python_started = TRUE;
+
     loaded_modules = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)_unref_module);
 
     python_init_prof();
@@ -117,6 +124,7 @@ python_env_init(void)
 ProfPlugin*
 python_plugin_create(const char* const filename)
 {
+    python_env_init();
     disable_python_threads();
 
     PyObject* p_module = g_hash_table_lookup(loaded_modules, filename);
@@ -865,9 +873,15 @@ python_plugin_destroy(ProfPlugin* plugin)
 void
 python_shutdown(void)
 {
+    if (!python_started) {
+        return;
+    }
+
     disable_python_threads();
     g_hash_table_destroy(loaded_modules);
+    loaded_modules = NULL;
     Py_Finalize();
+    python_started = FALSE;
 }
 
 static void
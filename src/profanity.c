@@ -54,6 +54,7 @@
 #include "common.h"
 #include "log.h"
 #include "chatlog.h"
+#include "database.h"
 #include "config/files.h"
 #include "config/tlscerts.h"
 #include "config/accounts.h"
@@ -63,6 +64,11 @@
 #include "config/scripts.h"
 #include "command/cmd_defs.h"
 #include "plugins/plugins.h"
+#include "tools/stats.h"
+#include "tools/workqueue.h"
+#include "tools/http_transfer.h"
+#include "tools/mainloop.h"
+#include "tools/timestamp.h"
 #include "event/client_events.h"
 #include "ui/ui.h"
 #include "ui/window_list.h"
@@ -88,20 +94,50 @@
 #endif
 
 static void _init(char* log_level, char* config_file, char* log_file, char* theme_name);
+static void _init_deferred(void);
 static void _shutdown(void);
 static void _connect_default(const char* const account);
+static void _startup_step(const char* const name);
 
-pthread_mutex_t lock;
 static gboolean force_quit = FALSE;
 
+// _shutdown() only closes the deferred subsystems once they were started
+static gboolean deferred_init_done = FALSE;
+
+typedef struct startup_step_t
+{
+    const char* name;
+    gint64 us;
+} StartupStep;
+
+// NULL unless started with --startup-profile
+static GArray* startup_steps = NULL;
+static gint64 startup_start = 0;
+static gint64 startup_mark = 0;
+
 void
-prof_run(char* log_level, char* account_name, char* config_file, char* log_file, char* theme_name)
+prof_run(char* log_level, char* account_name, char* config_file, char* log_file, char* theme_name, gboolean startup_profile)
 {
     gboolean cont = TRUE;
 
+    if (startup_profile) {
+        startup_steps = g_array_new(FALSE, FALSE, sizeof(StartupStep));
+        startup_start = startup_mark = g_get_monotonic_time();
+    }
+
     _init(log_level, config_file, log_file, theme_name);
+    // show the prompt before bringing up the slower subsystems
+    ui_update();
+    _startup_step("first paint");
+    _init_deferred();
     plugins_on_start();
+    _startup_step("plugins start");
     _connect_default(account_name);
+    _startup_step("connect");
+    // otherwise reported once the login finished
+    if (connection_get_status() != JABBER_CONNECTING) {
+        prof_startup_profile_report(NULL);
+    }
 
     ui_update();
 
@@ -128,9 +164,18 @@ prof_run(char* log_level, char* account_name, char* config_file, char* log_file,
         otr_poll();
 #endif
         plugins_run_timed();
+        plugins_run_hooks();
         notify_remind();
         session_process_events();
+        workqueue_process();
+        http_transfer_process();
+        log_database_batch_check();
+        if (log_database_migrate_step() || log_database_transfer_step()) {
+            // keep migrating or transferring history without waiting for input
+            mainloop_wakeup();
+        }
         iq_autoping_check();
+        stats_dump_check();
         ui_update();
 #ifdef HAVE_GTK
         tray_update();
@@ -168,18 +213,14 @@ _init(char* log_level, char* config_file, char* log_file, char* theme_name)
     signal(SIGINT, SIG_IGN);
     signal(SIGTSTP, SIG_IGN);
     signal(SIGWINCH, ui_sigwinch_handler);
-    if (pthread_mutex_init(&lock, NULL) != 0) {
-        log_error("Mutex init failed");
-        exit(1);
-    }
-
-    pthread_mutex_lock(&lock);
+    mainloop_init();
     files_create_directories();
     log_level_t prof_log_level;
     log_level_from_string(log_level, &prof_log_level);
     prefs_load(config_file);
     log_init(prof_log_level, log_file);
     log_stderr_init(PROF_LEVEL_ERROR);
+    _startup_step("prefs and log");
 
     if (strcmp(PACKAGE_STATUS, "development") == 0) {
 #ifdef HAVE_GIT_VERSION
@@ -193,7 +234,9 @@ _init(char* log_level, char* config_file, char* log_file, char* theme_name)
 
     chat_log_init();
     groupchat_log_init();
+    _startup_step("chat logs");
     accounts_load();
+    _startup_step("accounts");
 
     if (theme_name) {
         theme_init(theme_name);
@@ -202,6 +245,7 @@ _init(char* log_level, char* config_file, char* log_file, char* theme_name)
         theme_init(theme);
         g_free(theme);
     }
+    _startup_step("theme");
 
     ui_init();
     if (prof_log_level == PROF_LEVEL_DEBUG) {
@@ -209,28 +253,82 @@ _init(char* log_level, char* config_file, char* log_file, char* theme_name)
         win_println(console, THEME_DEFAULT, "-", "Debug mode enabled! Logging to: ");
         win_println(console, THEME_DEFAULT, "-", get_log_file_location());
     }
+    _startup_step("ui");
     session_init();
     cmd_init();
+    _startup_step("commands");
     log_info("Initialising contact list");
     muc_init();
     tlscerts_init();
     scripts_init();
+    atexit(_shutdown);
+    inp_nonblocking(TRUE);
+    ui_resize();
+    _startup_step("session");
+}
+
+// Everything the prompt does not need, run once it has been drawn
+static void
+_init_deferred(void)
+{
 #ifdef HAVE_LIBOTR
     otr_init();
+    _startup_step("otr");
 #endif
 #ifdef HAVE_LIBGPGME
     p_gpg_init();
+    _startup_step("pgp");
 #endif
 #ifdef HAVE_OMEMO
     omemo_init();
+    _startup_step("omemo");
 #endif
-    atexit(_shutdown);
     plugins_init();
+    _startup_step("plugins");
 #ifdef HAVE_GTK
     tray_init();
+    _startup_step("tray");
 #endif
-    inp_nonblocking(TRUE);
-    ui_resize();
+    deferred_init_done = TRUE;
+}
+
+static void
+_startup_step(const char* const name)
+{
+    if (!startup_steps) {
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    StartupStep step = { name, now - startup_mark };
+    g_array_append_val(startup_steps, step);
+    startup_mark = now;
+}
+
+// Print the --startup-profile breakdown, last_step names the time since
+// the connection was started if it is reported after the login
+void
+prof_startup_profile_report(const char* const last_step)
+{
+    if (!startup_steps) {
+        return;
+    }
+
+    if (last_step) {
+        _startup_step(last_step);
+    }
+
+    cons_show("");
+    cons_show("Startup profile:");
+    for (guint i = 0; i < startup_steps->len; i++) {
+        StartupStep* step = &g_array_index(startup_steps, StartupStep, i);
+        cons_show("  %-14s %8.1f ms", step->name, step->us / 1000.0);
+        log_info("Startup profile: %s %.1f ms", step->name, step->us / 1000.0);
+    }
+    cons_show("  %-14s %8.1f ms", "total", (startup_mark - startup_start) / 1000.0);
+
+    g_array_free(startup_steps, TRUE);
+    startup_steps = NULL;
 }
 
 static void
@@ -249,29 +347,41 @@ _shutdown(void)
         cl_ev_disconnect();
     }
 #ifdef HAVE_GTK
-    tray_shutdown();
+    if (deferred_init_done) {
+        tray_shutdown();
+    }
 #endif
     session_shutdown();
-    plugins_on_shutdown();
+    if (deferred_init_done) {
+        plugins_on_shutdown();
+    }
     muc_close();
     caps_close();
+    http_transfer_close();
+    workqueue_close();
+    mainloop_close();
+    if (deferred_init_done) {
 #ifdef HAVE_LIBOTR
-    otr_shutdown();
+        otr_shutdown();
 #endif
 #ifdef HAVE_LIBGPGME
-    p_gpg_close();
+        p_gpg_close();
 #endif
 #ifdef HAVE_OMEMO
-    omemo_close();
+        omemo_close();
 #endif
+    }
     chat_log_close();
     theme_close();
     accounts_close();
     tlscerts_close();
     log_stderr_close();
     log_close();
-    plugins_shutdown();
+    if (deferred_init_done) {
+        plugins_shutdown();
+    }
     cmd_uninit();
     ui_close();
+    timestamp_close();
     prefs_close();
 }
@@ -37,12 +37,10 @@
 #ifndef PROFANITY_H
 #define PROFANITY_H
 
-#include <pthread.h>
 #include <glib.h>
 
-void prof_run(char* log_level, char* account_name, char* config_file, char* log_file, char* theme_name);
+void prof_run(char* log_level, char* account_name, char* config_file, char* log_file, char* theme_name, gboolean startup_profile);
 void prof_set_quit(void);
-
-extern pthread_mutex_t lock;
+void prof_startup_profile_report(const char* const last_step);
 
 #endif
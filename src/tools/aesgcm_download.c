@@ -43,120 +43,96 @@
 #include <sys/types.h>
 #include <curl/curl.h>
 #include <gio/gio.h>
-#include <pthread.h>
+#include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 
-#include "profanity.h"
 #include "event/client_events.h"
 #include "tools/http_common.h"
 #include "tools/aesgcm_download.h"
+#include "tools/http_transfer.h"
+#include "tools/workqueue.h"
 #include "omemo/omemo.h"
 #include "config/preferences.h"
 #include "ui/ui.h"
 #include "ui/window.h"
+#include "ui/window_list.h"
 #include "common.h"
 
-#define FALLBACK_MSG ""
-
-void*
-aesgcm_file_get(void* userdata)
+static void
+_aesgcm_download_free(AESGCMDownload* aesgcm_dl)
 {
-    AESGCMDownload* aesgcm_dl = (AESGCMDownload*)userdata;
-
-    char* https_url = NULL;
-    char* fragment = NULL;
-
-    // Convert the aesgcm:// URL to a https:// URL and extract the encoded key
-    // and tag stored in the URL fragment.
-    if (omemo_parse_aesgcm_url(aesgcm_dl->url, &https_url, &fragment) != 0) {
-        cons_show_error("Download failed: Cannot parse URL '%s'.", aesgcm_dl->url);
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
-                                   "Download failed: Cannot parse URL '%s'.",
-                                   aesgcm_dl->url);
-        return NULL;
-    }
-
-    // Create a temporary file used for storing the ciphertext that is to be
-    // retrieved from the https:// URL.
-    gchar* tmpname = NULL;
-    gint tmpfd;
-    if ((tmpfd = g_file_open_tmp("profanity.XXXXXX", &tmpname, NULL)) == -1) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
-                                   "Downloading '%s' failed: Unable to create "
-                                   "temporary ciphertext file for writing "
-                                   "(%s).",
-                                   https_url, g_strerror(errno));
-        return NULL;
+    if (aesgcm_dl->tmpfh) {
+        if (fclose(aesgcm_dl->tmpfh) == EOF) {
+            cons_show_error(g_strerror(errno));
+        }
+        remove(aesgcm_dl->tmpname);
     }
-
-    // Open the target file for storing the cleartext.
-    FILE* outfh = fopen(aesgcm_dl->filename, "wb");
-    if (outfh == NULL) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
-                                   "Downloading '%s' failed: Unable to open "
-                                   "output file at '%s' for writing (%s).",
-                                   https_url, aesgcm_dl->filename,
-                                   g_strerror(errno));
-        return NULL;
+    if (aesgcm_dl->outfh) {
+        if (fclose(aesgcm_dl->outfh) == EOF) {
+            cons_show_error(g_strerror(errno));
+        }
     }
 
-    // We wrap the HTTPDownload tool and use it for retrieving the ciphertext
-    // and storing it in the temporary file previously opened.
-    HTTPDownload* http_dl = malloc(sizeof(HTTPDownload));
-    http_dl->window = aesgcm_dl->window;
-    http_dl->worker = aesgcm_dl->worker;
-    http_dl->url = strdup(https_url);
-    http_dl->filename = strdup(tmpname);
-    http_dl->cmd_template = NULL;
-    aesgcm_dl->http_dl = http_dl;
+    g_free(aesgcm_dl->tmpname);
+    free(aesgcm_dl->https_url);
+    free(aesgcm_dl->fragment);
+    free(aesgcm_dl->cmd_template);
+    free(aesgcm_dl->filename);
+    free(aesgcm_dl->url);
+    free(aesgcm_dl);
+}
 
-    http_file_get(http_dl); // TODO(wstrm): Verify result.
+// runs on a workqueue thread
+static void
+_aesgcm_decrypt(gpointer data)
+{
+    AESGCMDownload* aesgcm_dl = data;
 
-    FILE* tmpfh = fopen(tmpname, "rb");
-    if (tmpfh == NULL) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
-                                   "Downloading '%s' failed: Unable to open "
-                                   "temporary file at '%s' for reading (%s).",
-                                   aesgcm_dl->url, tmpname,
-                                   g_strerror(errno));
-        return NULL;
-    }
+    rewind(aesgcm_dl->tmpfh);
+    aesgcm_dl->crypt_res = omemo_decrypt_file(aesgcm_dl->tmpfh, aesgcm_dl->outfh,
+                                              aesgcm_dl->bytes_received, aesgcm_dl->fragment);
+}
 
-    gcry_error_t crypt_res;
-    crypt_res = omemo_decrypt_file(tmpfh, outfh,
-                                   http_dl->bytes_received, fragment);
+static void
+_aesgcm_decrypt_done(gpointer data)
+{
+    AESGCMDownload* aesgcm_dl = data;
 
-    if (fclose(tmpfh) == EOF) {
-        cons_show_error(g_strerror(errno));
+    // the window may have been closed while decrypting
+    ProfWin* window = aesgcm_dl->window;
+    if (window && wins_get_num(window) == -1) {
+        window = NULL;
     }
 
-    close(tmpfd);
-    remove(tmpname);
-    g_free(tmpname);
-
-    if (crypt_res != GPG_ERR_NO_ERROR) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
-                                   "Downloading '%s' failed: Failed to decrypt "
-                                   "file (%s).",
-                                   https_url, gcry_strerror(crypt_res));
+    if (aesgcm_dl->crypt_res != GPG_ERR_NO_ERROR) {
+        if (window) {
+            http_print_transfer_update(window, aesgcm_dl->url,
+                                       "Downloading '%s' failed: Failed to decrypt "
+                                       "file (%s).",
+                                       aesgcm_dl->https_url, gcry_strerror(aesgcm_dl->crypt_res));
+        }
+    } else if (window) {
+        http_print_transfer_update(window, aesgcm_dl->url,
+                                   "Downloading '%s': done\nSaved to '%s'",
+                                   aesgcm_dl->https_url, aesgcm_dl->filename);
+        win_mark_received(window, aesgcm_dl->url);
     }
 
-    if (fclose(outfh) == EOF) {
+    // the cleartext has to be on disk before handing it to the command
+    if (fclose(aesgcm_dl->outfh) == EOF) {
         cons_show_error(g_strerror(errno));
     }
+    aesgcm_dl->outfh = NULL;
 
-    free(https_url);
-    free(fragment);
-
-    if (aesgcm_dl->cmd_template != NULL) {
+    if (aesgcm_dl->crypt_res == GPG_ERR_NO_ERROR && aesgcm_dl->cmd_template != NULL) {
         gchar** argv = format_call_external_argv(aesgcm_dl->cmd_template,
                                                  aesgcm_dl->filename,
                                                  aesgcm_dl->filename);
 
         // TODO: Log the error.
-        if (!call_external(argv)) {
-            http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
+        if (!call_external(argv) && window) {
+            http_print_transfer_update(window, aesgcm_dl->url,
                                        "Downloading '%s' failed: Unable to call "
                                        "command '%s' with file at '%s' (%s).",
                                        aesgcm_dl->url,
@@ -166,24 +142,102 @@ aesgcm_file_get(void* userdata)
         }
 
         g_strfreev(argv);
-        free(aesgcm_dl->cmd_template);
     }
 
-    free(aesgcm_dl->filename);
-    free(aesgcm_dl->url);
-    free(aesgcm_dl);
+    _aesgcm_download_free(aesgcm_dl);
+}
 
-    return NULL;
+static void
+_aesgcm_download_progress(gpointer data, int percent)
+{
+    AESGCMDownload* aesgcm_dl = data;
+
+    http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
+                               "Downloading '%s': %d%%", aesgcm_dl->https_url, percent);
 }
 
-void
-aesgcm_download_cancel_processes(ProfWin* window)
+static void
+_aesgcm_download_done(gpointer data, ProfWin* window, CURL* curl, CURLcode result)
 {
-    http_download_cancel_processes(window);
+    AESGCMDownload* aesgcm_dl = data;
+
+    if (result != CURLE_OK || fflush(aesgcm_dl->tmpfh) == EOF) {
+        if (window) {
+            http_print_transfer_update(window, aesgcm_dl->url,
+                                       "Downloading '%s' failed: %s",
+                                       aesgcm_dl->https_url,
+                                       result != CURLE_OK ? curl_easy_strerror(result) : g_strerror(errno));
+        }
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &aesgcm_dl->bytes_received);
+    aesgcm_dl->window = window;
+
+    // decrypting large files takes a while, keep it off the main loop
+    workqueue_push(aesgcm_dl->filename, _aesgcm_decrypt, _aesgcm_decrypt_done, aesgcm_dl);
 }
 
+/*
+ * Queue the download of the ciphertext into a temporary file, it is
+ * decrypted into the target file on a worker once the transfer is done.
+ */
 void
-aesgcm_download_add_download(AESGCMDownload* aesgcm_dl)
+aesgcm_file_get(AESGCMDownload* aesgcm_dl)
 {
-    http_download_add_download(aesgcm_dl->http_dl);
+    aesgcm_dl->https_url = NULL;
+    aesgcm_dl->fragment = NULL;
+    aesgcm_dl->tmpname = NULL;
+    aesgcm_dl->tmpfh = NULL;
+    aesgcm_dl->outfh = NULL;
+    aesgcm_dl->bytes_received = 0;
+    aesgcm_dl->crypt_res = GPG_ERR_NO_ERROR;
+
+    // Convert the aesgcm:// URL to a https:// URL and extract the encoded key
+    // and tag stored in the URL fragment.
+    if (omemo_parse_aesgcm_url(aesgcm_dl->url, &aesgcm_dl->https_url, &aesgcm_dl->fragment) != 0) {
+        cons_show_error("Download failed: Cannot parse URL '%s'.", aesgcm_dl->url);
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    http_print_transfer(aesgcm_dl->window, aesgcm_dl->url,
+                        "Downloading '%s': 0%%", aesgcm_dl->https_url);
+
+    // Create a temporary file used for storing the ciphertext that is to be
+    // retrieved from the https:// URL.
+    gint tmpfd;
+    if ((tmpfd = g_file_open_tmp("profanity.XXXXXX", &aesgcm_dl->tmpname, NULL)) == -1
+        || (aesgcm_dl->tmpfh = fdopen(tmpfd, "w+b")) == NULL) {
+        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
+                                   "Downloading '%s' failed: Unable to create "
+                                   "temporary ciphertext file for writing "
+                                   "(%s).",
+                                   aesgcm_dl->https_url, g_strerror(errno));
+        if (tmpfd != -1) {
+            close(tmpfd);
+            remove(aesgcm_dl->tmpname);
+        }
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    // Open the target file for storing the cleartext.
+    aesgcm_dl->outfh = fopen(aesgcm_dl->filename, "wb");
+    if (aesgcm_dl->outfh == NULL) {
+        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->url,
+                                   "Downloading '%s' failed: Unable to open "
+                                   "output file at '%s' for writing (%s).",
+                                   aesgcm_dl->https_url, aesgcm_dl->filename,
+                                   g_strerror(errno));
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    CURL* curl = http_transfer_easy_new(aesgcm_dl->https_url);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)aesgcm_dl->tmpfh);
+
+    http_transfer_start(curl, aesgcm_dl->window, _aesgcm_download_progress, _aesgcm_download_done, aesgcm_dl);
 }
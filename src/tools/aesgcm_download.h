@@ -43,8 +43,8 @@
 
 #include <sys/select.h>
 #include <curl/curl.h>
+#include <gcrypt.h>
 #include "tools/http_common.h"
-#include "tools/http_download.h"
 
 #include "ui/win_types.h"
 
@@ -54,13 +54,15 @@ typedef struct aesgcm_download_t
     char* filename;
     char* cmd_template;
     ProfWin* window;
-    pthread_t worker;
-    HTTPDownload* http_dl;
+    char* https_url;
+    char* fragment;
+    gchar* tmpname;
+    FILE* tmpfh;
+    FILE* outfh;
+    curl_off_t bytes_received;
+    gcry_error_t crypt_res;
 } AESGCMDownload;
 
-void* aesgcm_file_get(void* userdata);
-
-void aesgcm_download_cancel_processes(ProfWin* window);
-void aesgcm_download_add_download(AESGCMDownload* download);
+void aesgcm_file_get(AESGCMDownload* download);
 
 #endif
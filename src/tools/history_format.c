@@ -0,0 +1,168 @@
+/*
+ * history_format.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "tools/history_format.h"
+#include "tools/timestamp.h"
+
+// Append text to line with backslash, tab and line breaks escaped
+void
+history_format_escape(GString* line, const char* const text)
+{
+    if (!text) {
+        return;
+    }
+
+    for (const char* c = text; *c; c++) {
+        switch (*c) {
+        case '\\':
+            g_string_append(line, "\\\\");
+            break;
+        case '\t':
+            g_string_append(line, "\\t");
+            break;
+        case '\n':
+            g_string_append(line, "\\n");
+            break;
+        case '\r':
+            g_string_append(line, "\\r");
+            break;
+        default:
+            g_string_append_c(line, *c);
+            break;
+        }
+    }
+}
+
+// Undo history_format_escape() in place
+void
+history_format_unescape(char* field)
+{
+    char* out = field;
+    for (char* in = field; *in; in++) {
+        if (*in == '\\' && in[1] != '\0') {
+            in++;
+            switch (*in) {
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            default:
+                *out++ = *in;
+                break;
+            }
+        } else {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+}
+
+// Split line in place at its first max - 1 tabs, the last field keeps the
+// rest of the line. Returns the number of fields found.
+int
+history_format_split(char* line, char** fields, int max)
+{
+    int count = 0;
+    char* start = line;
+    while (count < max - 1) {
+        char* tab = strchr(start, '\t');
+        if (!tab) {
+            break;
+        }
+        *tab = '\0';
+        fields[count++] = start;
+        start = tab + 1;
+    }
+    fields[count++] = start;
+
+    return count;
+}
+
+void
+history_format_chomp(char* line)
+{
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        line[--len] = '\0';
+    }
+}
+
+// Parse a chat log line in place. A line that does not start with a
+// timestamp continues the previous message, nick and text are only set for
+// messages and actions.
+history_chatlog_line_t
+history_format_parse_chatlog(char* line, gint64* timestamp, char** nick, char** text)
+{
+    char* sep = strstr(line, " - ");
+    if (!sep) {
+        return HISTORY_CHATLOG_CONTINUATION;
+    }
+
+    *sep = '\0';
+    gboolean stamped = timestamp_parse_iso8601(line, timestamp);
+    if (!stamped) {
+        *sep = ' ';
+        return HISTORY_CHATLOG_CONTINUATION;
+    }
+
+    char* rest = sep + 3;
+    gboolean action = rest[0] == '*';
+    char* end = NULL;
+    if (action) {
+        rest++;
+        end = strchr(rest, ' ');
+    } else {
+        end = strstr(rest, ": ");
+    }
+    if (!end) {
+        return HISTORY_CHATLOG_INVALID;
+    }
+
+    *end = '\0';
+    *nick = rest;
+    *text = end + (action ? 1 : 2);
+
+    return action ? HISTORY_CHATLOG_ACTION : HISTORY_CHATLOG_MESSAGE;
+}
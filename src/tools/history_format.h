@@ -0,0 +1,65 @@
+/*
+ * history_format.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#ifndef TOOLS_HISTORY_FORMAT_H
+#define TOOLS_HISTORY_FORMAT_H
+
+#include <glib.h>
+
+/*
+ * Line formats read and written by /history export and /history import.
+ *
+ * An export file holds one message per line, its fields separated by tabs
+ * with backslash, tab and line breaks escaped in the text fields.
+ *
+ * chatlog.c writes "<timestamp> - <nick>: <message>" or
+ * "<timestamp> - *<nick> <action>", further lines of a message follow as
+ * they are.
+ */
+
+typedef enum {
+    HISTORY_CHATLOG_MESSAGE,
+    HISTORY_CHATLOG_ACTION,
+    HISTORY_CHATLOG_CONTINUATION,
+    HISTORY_CHATLOG_INVALID
+} history_chatlog_line_t;
+
+void history_format_escape(GString* line, const char* const text);
+void history_format_unescape(char* field);
+int history_format_split(char* line, char** fields, int max);
+void history_format_chomp(char* line);
+history_chatlog_line_t history_format_parse_chatlog(char* line, gint64* timestamp, char** nick, char** text);
+
+#endif
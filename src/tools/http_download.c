@@ -43,167 +43,113 @@
 #include <sys/types.h>
 #include <curl/curl.h>
 #include <gio/gio.h>
-#include <pthread.h>
+#include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 
-#include "profanity.h"
 #include "event/client_events.h"
+#include "log.h"
 #include "tools/http_download.h"
-#include "config/cafile.h"
-#include "config/preferences.h"
+#include "tools/http_transfer.h"
 #include "ui/ui.h"
 #include "ui/window.h"
 #include "common.h"
 
-GSList* download_processes = NULL;
-
-static int
-_xferinfo(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+static void
+_http_download_free(HTTPDownload* download)
 {
-    HTTPDownload* download = (HTTPDownload*)userdata;
-
-    pthread_mutex_lock(&lock);
-
-    if (download->cancel) {
-        pthread_mutex_unlock(&lock);
-        return 1;
+    if (download->filehandle) {
+        fclose(download->filehandle);
     }
 
-    if (download->bytes_received == dlnow) {
-        pthread_mutex_unlock(&lock);
-        return 0;
-    } else {
-        download->bytes_received = dlnow;
-    }
+    free(download->url);
+    free(download->filename);
+    g_free(download->partname);
+    free(download->cmd_template);
+    free(download);
+}
 
-    unsigned int dlperc = 0;
-    if (dltotal != 0) {
-        dlperc = (100 * dlnow) / dltotal;
+// runs on the transfer thread
+static size_t
+_http_download_write(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    HTTPDownload* download = userdata;
+
+    // a server ignoring the range sends the whole file again
+    if (download->resume_from > 0) {
+        long http_code = 0;
+        curl_easy_getinfo(download->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != 206) {
+            if (ftruncate(fileno(download->filehandle), 0) != 0) {
+                return 0;
+            }
+        }
+        download->resume_from = 0;
     }
 
-    http_print_transfer_update(download->window, download->url,
-                               "Downloading '%s': %d%%", download->url, dlperc);
-
-    pthread_mutex_unlock(&lock);
-
-    return 0;
+    return fwrite(ptr, 1, size * nmemb, download->filehandle);
 }
 
-#if LIBCURL_VERSION_NUM < 0x072000
-static int
-_older_progress(void* p, double dltotal, double dlnow, double ultotal, double ulnow)
+static void
+_http_download_progress(gpointer data, int percent)
 {
-    return _xferinfo(p, (curl_off_t)dltotal, (curl_off_t)dlnow, (curl_off_t)ultotal, (curl_off_t)ulnow);
+    HTTPDownload* download = data;
+
+    http_print_transfer_update(download->window, download->url,
+                               "Downloading '%s': %d%%", download->url, percent);
 }
-#endif
 
-void*
-http_file_get(void* userdata)
+static void
+_http_download_done(gpointer data, ProfWin* window, CURL* curl, CURLcode result)
 {
-    HTTPDownload* download = (HTTPDownload*)userdata;
-
+    HTTPDownload* download = data;
     char* err = NULL;
 
-    CURL* curl;
-    CURLcode res;
-
-    download->cancel = 0;
-    download->bytes_received = 0;
-
-    pthread_mutex_lock(&lock);
-    http_print_transfer(download->window, download->url,
-                        "Downloading '%s': 0%%", download->url);
-
-    FILE* outfh = fopen(download->filename, "wb");
-    if (outfh == NULL) {
-        http_print_transfer_update(download->window, download->url,
-                                   "Downloading '%s' failed: Unable to open "
-                                   "output file at '%s' for writing (%s).",
-                                   download->url, download->filename,
-                                   g_strerror(errno));
-        goto out;
+    // the range of a part file that already holds the whole file cannot be
+    // satisfied, nothing was written so it only needs to be renamed
+    if (result == CURLE_HTTP_RETURNED_ERROR && download->resume_from > 0) {
+        long http_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code == 416) {
+            result = CURLE_OK;
+        }
     }
 
-    char* cert_path = prefs_get_string(PREF_TLS_CERTPATH);
-    gchar* cafile = cafile_get_name();
-    ProfAccount* account = accounts_get_account(session_get_account_name());
-    gboolean insecure = account->tls_policy && strcmp(account->tls_policy, "trust") == 0;
-    account_free(account);
-    pthread_mutex_unlock(&lock);
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-
-    curl_easy_setopt(curl, CURLOPT_URL, download->url);
-
-#if LIBCURL_VERSION_NUM >= 0x072000
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, _xferinfo);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, download);
-#else
-    curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, _older_progress);
-    curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, download);
-#endif
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)outfh);
-
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "profanity");
-
-    if (cafile) {
-        curl_easy_setopt(curl, CURLOPT_CAINFO, cafile);
-    }
-    if (cert_path) {
-        curl_easy_setopt(curl, CURLOPT_CAPATH, cert_path);
-    }
-    if (insecure) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    if (result != CURLE_OK) {
+        err = strdup(curl_easy_strerror(result));
     }
 
-    if ((res = curl_easy_perform(curl)) != CURLE_OK) {
-        err = strdup(curl_easy_strerror(res));
+    if (fclose(download->filehandle) == EOF && !err) {
+        err = strdup(g_strerror(errno));
     }
+    download->filehandle = NULL;
 
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
-
-    if (fclose(outfh) == EOF) {
+    // a failed download keeps its part file so asking for it again resumes it
+    if (!err && rename(download->partname, download->filename) != 0) {
         err = strdup(g_strerror(errno));
     }
 
-    pthread_mutex_lock(&lock);
-    g_free(cafile);
-    g_free(cert_path);
-    if (err) {
-        if (download->cancel) {
-            http_print_transfer_update(download->window, download->url,
-                                       "Downloading '%s' failed: "
-                                       "Download was canceled",
-                                       download->url);
-        } else {
-            http_print_transfer_update(download->window, download->url,
-                                       "Downloading '%s' failed: %s",
-                                       download->url, err);
-        }
-        free(err);
+    if (!window) {
+        log_info("Download of '%s' was canceled", download->url);
+    } else if (err) {
+        http_print_transfer_update(window, download->url,
+                                   "Downloading '%s' failed: %s",
+                                   download->url, err);
     } else {
-        if (!download->cancel) {
-            http_print_transfer_update(download->window, download->url,
-                                       "Downloading '%s': done\nSaved to '%s'",
-                                       download->url, download->filename);
-            win_mark_received(download->window, download->url);
-        }
+        http_print_transfer_update(window, download->url,
+                                   "Downloading '%s': done\nSaved to '%s'",
+                                   download->url, download->filename);
+        win_mark_received(window, download->url);
     }
 
-    if (download->cmd_template != NULL) {
+    if (!err && download->cmd_template != NULL) {
         gchar** argv = format_call_external_argv(download->cmd_template,
                                                  download->url,
                                                  download->filename);
 
         // TODO: Log the error.
-        if (!call_external(argv)) {
-            http_print_transfer_update(download->window, download->url,
+        if (!call_external(argv) && window) {
+            http_print_transfer_update(window, download->url,
                                        "Downloading '%s' failed: Unable to call "
                                        "command '%s' with file at '%s' (%s).",
                                        download->url,
@@ -213,37 +159,49 @@ http_file_get(void* userdata)
         }
 
         g_strfreev(argv);
-        free(download->cmd_template);
     }
 
-out:
-
-    download_processes = g_slist_remove(download_processes, download);
-    pthread_mutex_unlock(&lock);
-
-    free(download->url);
-    free(download->filename);
-    free(download);
-
-    return NULL;
+    free(err);
+    _http_download_free(download);
 }
 
+/*
+ * Queue the download on the transfer thread. The body is written to
+ * '<filename>.part' which is renamed once complete, a part file left
+ * behind by an earlier attempt is resumed with a range request.
+ */
 void
-http_download_cancel_processes(ProfWin* window)
+http_file_get(HTTPDownload* download)
 {
-    GSList* download_process = download_processes;
-    while (download_process) {
-        HTTPDownload* download = download_process->data;
-        if (download->window == window) {
-            download->cancel = 1;
-            break;
-        }
-        download_process = g_slist_next(download_process);
+    download->curl = NULL;
+    download->resume_from = 0;
+    download->partname = g_strdup_printf("%s.part", download->filename);
+
+    http_print_transfer(download->window, download->url,
+                        "Downloading '%s': 0%%", download->url);
+
+    download->filehandle = fopen(download->partname, "ab");
+    if (download->filehandle == NULL || fseeko(download->filehandle, 0, SEEK_END) != 0) {
+        http_print_transfer_update(download->window, download->url,
+                                   "Downloading '%s' failed: Unable to open "
+                                   "output file at '%s' for writing (%s).",
+                                   download->url, download->partname,
+                                   g_strerror(errno));
+        _http_download_free(download);
+        return;
     }
-}
+    download->resume_from = ftello(download->filehandle);
 
-void
-http_download_add_download(HTTPDownload* download)
-{
-    download_processes = g_slist_append(download_processes, download);
+    CURL* curl = http_transfer_easy_new(download->url);
+    download->curl = curl;
+
+    if (download->resume_from > 0) {
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, download->resume_from);
+    }
+    // error pages must not end up in the part file
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _http_download_write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, download);
+
+    http_transfer_start(curl, download->window, _http_download_progress, _http_download_done, download);
 }
@@ -51,16 +51,14 @@ typedef struct http_download_t
 {
     char* url;
     char* filename;
+    char* partname;
     char* cmd_template;
-    curl_off_t bytes_received;
+    FILE* filehandle;
+    curl_off_t resume_from;
+    CURL* curl;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
 } HTTPDownload;
 
-void* http_file_get(void* userdata);
-
-void http_download_cancel_processes(ProfWin* window);
-void http_download_add_download(HTTPDownload* download);
+void http_file_get(HTTPDownload* download);
 
 #endif
@@ -0,0 +1,372 @@
+/*
+ * http_transfer.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "tools/http_transfer.h"
+#include "tools/mainloop.h"
+#include "config/account.h"
+#include "config/accounts.h"
+#include "config/cafile.h"
+#include "config/preferences.h"
+#include "xmpp/xmpp.h"
+
+// connections open at once, further transfers wait in the multi handle until one is free
+#define HTTP_TRANSFER_MAX_CONNECTIONS 4
+// how long the transfer thread sleeps on idle sockets before looking at new or canceled transfers
+#define HTTP_TRANSFER_POLL_MS 100
+
+typedef struct http_transfer_t
+{
+    CURL* curl;
+    ProfWin* window;
+    http_transfer_progress_t progress;
+    http_transfer_done_t done;
+    gpointer data;
+    // written by the transfer thread, read by the main loop
+    gint percent;
+    gint cancel;
+    // only read on the main loop after the transfer has been handed back
+    CURLcode result;
+    int reported;
+} HTTPTransfer;
+
+static GThread* worker = NULL;
+static CURLM* multi = NULL;
+// transfers to add to the multi handle, main loop -> transfer thread
+static GAsyncQueue* incoming = NULL;
+// finished or canceled transfers, transfer thread -> main loop
+static GAsyncQueue* finished = NULL;
+// every started transfer not yet handed back to its owner, only touched by the main loop
+static GSList* transfers = NULL;
+static gint stopping = 0;
+static HTTPTransfer stop_marker;
+
+static int
+_http_transfer_xferinfo(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+    HTTPTransfer* transfer = userdata;
+
+    if (g_atomic_int_get(&transfer->cancel)) {
+        return 1;
+    }
+
+    curl_off_t total = ultotal != 0 ? ultotal : dltotal;
+    curl_off_t now = ultotal != 0 ? ulnow : dlnow;
+    if (total > 0) {
+        int percent = (int)((100 * now) / total);
+        if (g_atomic_int_get(&transfer->percent) != percent) {
+            g_atomic_int_set(&transfer->percent, percent);
+            mainloop_wakeup();
+        }
+    }
+
+    return 0;
+}
+
+#if LIBCURL_VERSION_NUM < 0x072000
+static int
+_http_transfer_older_progress(void* p, double dltotal, double dlnow, double ultotal, double ulnow)
+{
+    return _http_transfer_xferinfo(p, (curl_off_t)dltotal, (curl_off_t)dlnow, (curl_off_t)ultotal, (curl_off_t)ulnow);
+}
+#endif
+
+static void
+_http_transfer_wakeup(void)
+{
+#if LIBCURL_VERSION_NUM >= 0x074400
+    curl_multi_wakeup(multi);
+#endif
+}
+
+// transfer thread only
+static void
+_http_transfer_finish(HTTPTransfer* transfer, CURLcode result)
+{
+    curl_multi_remove_handle(multi, transfer->curl);
+    transfer->result = result;
+    g_async_queue_push(finished, transfer);
+    mainloop_wakeup();
+}
+
+static gpointer
+_http_transfer_run(gpointer userdata)
+{
+    GSList* active = NULL;
+
+    while (!g_atomic_int_get(&stopping)) {
+        // nothing to drive, sleep until the main loop hands over a transfer
+        HTTPTransfer* transfer = active ? g_async_queue_try_pop(incoming) : g_async_queue_pop(incoming);
+        while (transfer) {
+            if (transfer != &stop_marker) {
+                curl_multi_add_handle(multi, transfer->curl);
+                active = g_slist_prepend(active, transfer);
+            }
+            transfer = g_async_queue_try_pop(incoming);
+        }
+
+        // transfers still waiting for a connection never reach the progress callback
+        GSList* curr = active;
+        while (curr) {
+            GSList* next = g_slist_next(curr);
+            transfer = curr->data;
+            if (g_atomic_int_get(&transfer->cancel)) {
+                active = g_slist_delete_link(active, curr);
+                _http_transfer_finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+            }
+            curr = next;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int left = 0;
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURLcode result = msg->data.result;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&transfer);
+            active = g_slist_remove(active, transfer);
+            _http_transfer_finish(transfer, result);
+        }
+
+        if (active) {
+#if LIBCURL_VERSION_NUM >= 0x074400
+            curl_multi_poll(multi, NULL, 0, HTTP_TRANSFER_POLL_MS, NULL);
+#else
+            curl_multi_wait(multi, NULL, 0, HTTP_TRANSFER_POLL_MS, NULL);
+#endif
+        }
+    }
+
+    for (GSList* curr = active; curr; curr = g_slist_next(curr)) {
+        _http_transfer_finish(curr->data, CURLE_ABORTED_BY_CALLBACK);
+    }
+    g_slist_free(active);
+
+    HTTPTransfer* transfer;
+    while ((transfer = g_async_queue_try_pop(incoming))) {
+        if (transfer != &stop_marker) {
+            transfer->result = CURLE_ABORTED_BY_CALLBACK;
+            g_async_queue_push(finished, transfer);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+_http_transfer_init(void)
+{
+    if (worker) {
+        return;
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)HTTP_TRANSFER_MAX_CONNECTIONS);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)HTTP_TRANSFER_MAX_CONNECTIONS);
+
+    incoming = g_async_queue_new();
+    finished = g_async_queue_new();
+    g_atomic_int_set(&stopping, 0);
+    worker = g_thread_new("http-transfer", _http_transfer_run, NULL);
+}
+
+static void
+_http_transfer_complete(HTTPTransfer* transfer)
+{
+    transfers = g_slist_remove(transfers, transfer);
+    transfer->done(transfer->data, transfer->window, transfer->curl, transfer->result);
+    curl_easy_cleanup(transfer->curl);
+    free(transfer);
+}
+
+/*
+ * Create an easy handle for url with the options every transfer shares,
+ * the caller adds its own before handing it to http_transfer_start().
+ */
+CURL*
+http_transfer_easy_new(const char* const url)
+{
+    _http_transfer_init();
+
+    CURL* curl = curl_easy_init();
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "profanity");
+    // wait for a connection to the same host to become free rather than opening another one
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    gchar* cafile = cafile_get_name();
+    if (cafile) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, cafile);
+    }
+    g_free(cafile);
+
+    char* cert_path = prefs_get_string(PREF_TLS_CERTPATH);
+    if (cert_path) {
+        curl_easy_setopt(curl, CURLOPT_CAPATH, cert_path);
+    }
+    g_free(cert_path);
+
+    ProfAccount* account = accounts_get_account(session_get_account_name());
+    if (account && account->tls_policy && strcmp(account->tls_policy, "trust") == 0) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    }
+    account_free(account);
+
+    return curl;
+}
+
+/*
+ * Queue curl on the transfer thread. progress and done run on the main loop,
+ * done always runs exactly once and the handle is cleaned up after it returns.
+ */
+void
+http_transfer_start(CURL* curl, ProfWin* window, http_transfer_progress_t progress, http_transfer_done_t done, gpointer data)
+{
+    _http_transfer_init();
+
+    HTTPTransfer* transfer = malloc(sizeof(HTTPTransfer));
+    transfer->curl = curl;
+    transfer->window = window;
+    transfer->progress = progress;
+    transfer->done = done;
+    transfer->data = data;
+    transfer->percent = 0;
+    transfer->cancel = 0;
+    transfer->result = CURLE_OK;
+    transfer->reported = 0;
+
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+#if LIBCURL_VERSION_NUM >= 0x072000
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, _http_transfer_xferinfo);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, transfer);
+#else
+    curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, _http_transfer_older_progress);
+    curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, transfer);
+#endif
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    transfers = g_slist_append(transfers, transfer);
+    g_async_queue_push(incoming, transfer);
+    _http_transfer_wakeup();
+}
+
+// Cancel every transfer of a window which is about to be closed
+void
+http_transfer_cancel(ProfWin* window)
+{
+    gboolean canceled = FALSE;
+    for (GSList* curr = transfers; curr; curr = g_slist_next(curr)) {
+        HTTPTransfer* transfer = curr->data;
+        if (transfer->window == window) {
+            transfer->window = NULL;
+            g_atomic_int_set(&transfer->cancel, 1);
+            canceled = TRUE;
+        }
+    }
+
+    if (canceled) {
+        _http_transfer_wakeup();
+    }
+}
+
+// Called from the main loop, reports progress and completes finished transfers
+void
+http_transfer_process(void)
+{
+    if (!transfers) {
+        return;
+    }
+
+    for (GSList* curr = transfers; curr; curr = g_slist_next(curr)) {
+        HTTPTransfer* transfer = curr->data;
+        int percent = g_atomic_int_get(&transfer->percent);
+        if (percent != transfer->reported && transfer->window && transfer->progress) {
+            transfer->reported = percent;
+            transfer->progress(transfer->data, percent);
+        }
+    }
+
+    HTTPTransfer* transfer;
+    while ((transfer = g_async_queue_try_pop(finished))) {
+        _http_transfer_complete(transfer);
+    }
+}
+
+void
+http_transfer_close(void)
+{
+    if (!worker) {
+        return;
+    }
+
+    for (GSList* curr = transfers; curr; curr = g_slist_next(curr)) {
+        HTTPTransfer* transfer = curr->data;
+        transfer->window = NULL;
+        g_atomic_int_set(&transfer->cancel, 1);
+    }
+
+    g_atomic_int_set(&stopping, 1);
+    g_async_queue_push(incoming, &stop_marker);
+    _http_transfer_wakeup();
+    g_thread_join(worker);
+    worker = NULL;
+
+    HTTPTransfer* transfer;
+    while ((transfer = g_async_queue_try_pop(finished))) {
+        _http_transfer_complete(transfer);
+    }
+
+    curl_multi_cleanup(multi);
+    multi = NULL;
+    g_async_queue_unref(incoming);
+    incoming = NULL;
+    g_async_queue_unref(finished);
+    finished = NULL;
+
+    curl_global_cleanup();
+}
@@ -0,0 +1,55 @@
+/*
+ * http_transfer.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#ifndef TOOLS_HTTP_TRANSFER_H
+#define TOOLS_HTTP_TRANSFER_H
+
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "ui/win_types.h"
+
+// runs on the main loop whenever the percentage done changes
+typedef void (*http_transfer_progress_t)(gpointer data, int percent);
+// runs on the main loop once the transfer has finished, window is NULL if it was closed meanwhile
+typedef void (*http_transfer_done_t)(gpointer data, ProfWin* window, CURL* curl, CURLcode result);
+
+CURL* http_transfer_easy_new(const char* const url);
+void http_transfer_start(CURL* curl, ProfWin* window, http_transfer_progress_t progress, http_transfer_done_t done, gpointer data);
+void http_transfer_cancel(ProfWin* window);
+void http_transfer_process(void);
+void http_transfer_close(void);
+
+#endif
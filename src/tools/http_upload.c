@@ -42,14 +42,11 @@
 #include <sys/types.h>
 #include <curl/curl.h>
 #include <gio/gio.h>
-#include <pthread.h>
 #include <assert.h>
 
-#include "profanity.h"
 #include "event/client_events.h"
 #include "tools/http_upload.h"
-#include "config/cafile.h"
-#include "config/preferences.h"
+#include "tools/http_transfer.h"
 #include "ui/ui.h"
 #include "ui/window.h"
 #include "common.h"
@@ -59,72 +56,11 @@
 #define FALLBACK_MSG                ""
 #define FILE_HEADER_BYTES           512
 
-struct curl_data_t
-{
-    char* buffer;
-    size_t size;
-};
-
-GSList* upload_processes = NULL;
-
-static int
-_xferinfo(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
-{
-    HTTPUpload* upload = (HTTPUpload*)userdata;
-
-    pthread_mutex_lock(&lock);
-
-    if (upload->cancel) {
-        pthread_mutex_unlock(&lock);
-        return 1;
-    }
-
-    if (upload->bytes_sent == ulnow) {
-        pthread_mutex_unlock(&lock);
-        return 0;
-    } else {
-        upload->bytes_sent = ulnow;
-    }
-
-    unsigned int ulperc = 0;
-    if (ultotal != 0) {
-        ulperc = (100 * ulnow) / ultotal;
-    }
-
-    gchar* msg = g_strdup_printf("Uploading '%s': %d%%", upload->filename, ulperc);
-    if (!msg) {
-        msg = g_strdup(FALLBACK_MSG);
-    }
-    win_update_entry_message(upload->window, upload->put_url, msg);
-    g_free(msg);
-
-    pthread_mutex_unlock(&lock);
-
-    return 0;
-}
-
-#if LIBCURL_VERSION_NUM < 0x072000
-static int
-_older_progress(void* p, double dltotal, double dlnow, double ultotal, double ulnow)
-{
-    return _xferinfo(p, (curl_off_t)dltotal, (curl_off_t)dlnow, (curl_off_t)ultotal, (curl_off_t)ulnow);
-}
-#endif
-
 static size_t
-_data_callback(void* ptr, size_t size, size_t nmemb, void* data)
+_discard_callback(void* ptr, size_t size, size_t nmemb, void* data)
 {
-    size_t realsize = size * nmemb;
-    struct curl_data_t* mem = (struct curl_data_t*)data;
-    mem->buffer = realloc(mem->buffer, mem->size + realsize + 1);
-
-    if (mem->buffer) {
-        memcpy(&(mem->buffer[mem->size]), ptr, realsize);
-        mem->size += realsize;
-        mem->buffer[mem->size] = 0;
-    }
-
-    return realsize;
+    // the PUT response body is of no interest, keep curl from printing it to stdout
+    return size * nmemb;
 }
 
 int
@@ -156,156 +92,90 @@ out:
     return ret;
 }
 
-void*
-http_file_put(void* userdata)
+static void
+_http_upload_free(HTTPUpload* upload)
 {
-    HTTPUpload* upload = (HTTPUpload*)userdata;
-
-    FILE* fh = NULL;
-
-    char* err = NULL;
-    gchar* content_type_header;
-    // Optional headers
-    gchar* auth_header = NULL;
-    gchar* cookie_header = NULL;
-    gchar* expires_header = NULL;
+    if (upload->filehandle) {
+        fclose(upload->filehandle);
+    }
+    curl_slist_free_all(upload->headers);
 
-    CURL* curl;
-    CURLcode res;
+    free(upload->filename);
+    free(upload->mime_type);
+    free(upload->get_url);
+    free(upload->put_url);
+    free(upload->alt_scheme);
+    free(upload->alt_fragment);
+    free(upload->authorization);
+    free(upload->cookie);
+    free(upload->expires);
+    free(upload);
+}
 
-    upload->cancel = 0;
-    upload->bytes_sent = 0;
+static void
+_http_upload_progress(gpointer data, int percent)
+{
+    HTTPUpload* upload = data;
 
-    pthread_mutex_lock(&lock);
-    gchar* msg = g_strdup_printf("Uploading '%s': 0%%", upload->filename);
+    gchar* msg = g_strdup_printf("Uploading '%s': %d%%", upload->filename, percent);
     if (!msg) {
         msg = g_strdup(FALLBACK_MSG);
     }
-    win_print_http_transfer(upload->window, msg, upload->put_url);
+    win_update_entry_message(upload->window, upload->put_url, msg);
     g_free(msg);
+}
 
-    char* cert_path = prefs_get_string(PREF_TLS_CERTPATH);
-    gchar* cafile = cafile_get_name();
-    ProfAccount* account = accounts_get_account(session_get_account_name());
-    gboolean insecure = account->tls_policy && strcmp(account->tls_policy, "trust") == 0;
-    account_free(account);
-    pthread_mutex_unlock(&lock);
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-
-    curl_easy_setopt(curl, CURLOPT_URL, upload->put_url);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-
-    struct curl_slist* headers = NULL;
-    content_type_header = g_strdup_printf("Content-Type: %s", upload->mime_type);
-    if (!content_type_header) {
-        content_type_header = g_strdup(FALLBACK_CONTENTTYPE_HEADER);
-    }
-    headers = curl_slist_append(headers, content_type_header);
-    headers = curl_slist_append(headers, "Expect:");
-
-    // Optional headers
-    if (upload->authorization) {
-        auth_header = g_strdup_printf("Authorization: %s", upload->authorization);
-        if (!auth_header) {
-            auth_header = g_strdup(FALLBACK_MSG);
-        }
-        headers = curl_slist_append(headers, auth_header);
-    }
-    if (upload->cookie) {
-        cookie_header = g_strdup_printf("Cookie: %s", upload->cookie);
-        if (!cookie_header) {
-            cookie_header = g_strdup(FALLBACK_MSG);
-        }
-        headers = curl_slist_append(headers, cookie_header);
-    }
-    if (upload->expires) {
-        expires_header = g_strdup_printf("Expires: %s", upload->expires);
-        if (!expires_header) {
-            expires_header = g_strdup(FALLBACK_MSG);
-        }
-        headers = curl_slist_append(headers, expires_header);
+static void
+_http_upload_send_url(ProfWin* window, char* url)
+{
+    switch (window->type) {
+    case WIN_CHAT:
+    {
+        ProfChatWin* chatwin = (ProfChatWin*)window;
+        assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
+        cl_ev_send_msg(chatwin, url, url);
+        break;
     }
-
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-#if LIBCURL_VERSION_NUM >= 0x072000
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, _xferinfo);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, upload);
-#else
-    curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, _older_progress);
-    curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, upload);
-#endif
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-
-    struct curl_data_t output;
-    output.buffer = NULL;
-    output.size = 0;
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _data_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&output);
-
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "profanity");
-
-    fh = upload->filehandle;
-
-    if (cafile) {
-        curl_easy_setopt(curl, CURLOPT_CAINFO, cafile);
+    case WIN_PRIVATE:
+    {
+        ProfPrivateWin* privatewin = (ProfPrivateWin*)window;
+        assert(privatewin->memcheck == PROFPRIVATEWIN_MEMCHECK);
+        cl_ev_send_priv_msg(privatewin, url, url);
+        break;
     }
-    if (cert_path) {
-        curl_easy_setopt(curl, CURLOPT_CAPATH, cert_path);
+    case WIN_MUC:
+    {
+        ProfMucWin* mucwin = (ProfMucWin*)window;
+        assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
+        cl_ev_send_muc_msg(mucwin, url, url);
+        break;
     }
-    if (insecure) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    default:
+        break;
     }
+}
 
-    curl_easy_setopt(curl, CURLOPT_READDATA, fh);
-    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)(upload->filesize));
-    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+static void
+_http_upload_done(gpointer data, ProfWin* window, CURL* curl, CURLcode result)
+{
+    HTTPUpload* upload = data;
+    char* err = NULL;
 
-    if ((res = curl_easy_perform(curl)) != CURLE_OK) {
-        err = strdup(curl_easy_strerror(res));
+    if (result != CURLE_OK) {
+        err = strdup(curl_easy_strerror(result));
     } else {
         long http_code = 0;
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-        if (output.buffer) {
-            output.buffer[output.size++] = '\0';
-        }
-
         // XEP-0363 specifies 201 but prosody returns 200
         if (http_code != 200 && http_code != 201) {
             err = g_strdup_printf("Server returned %lu", http_code);
         }
-
-#if 0
-        printf("HTTP Status: %lu\n", http_code);
-        printf("%s\n", output.buffer);
-        printf("%lu bytes retrieved\n", (long)output.size);
-#endif
-    }
-
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
-    curl_slist_free_all(headers);
-
-    if (fh) {
-        fclose(fh);
     }
-    free(output.buffer);
-    g_free(content_type_header);
-    g_free(auth_header);
-    g_free(cookie_header);
-    g_free(expires_header);
-
-    pthread_mutex_lock(&lock);
-    g_free(cafile);
-    g_free(cert_path);
 
     if (err) {
         gchar* msg;
-        if (upload->cancel) {
+        if (!window) {
             msg = g_strdup_printf("Uploading '%s' failed: Upload was canceled", upload->filename);
             if (!msg) {
                 msg = g_strdup(FALLBACK_MSG);
@@ -315,76 +185,98 @@ http_file_put(void* userdata)
             if (!msg) {
                 msg = g_strdup(FALLBACK_MSG);
             }
-            win_update_entry_message(upload->window, upload->put_url, msg);
+            win_update_entry_message(window, upload->put_url, msg);
         }
         cons_show_error(msg);
         g_free(msg);
         free(err);
-    } else {
-        if (!upload->cancel) {
-            msg = g_strdup_printf("Uploading '%s': 100%%", upload->filename);
+    } else if (window) {
+        gchar* msg = g_strdup_printf("Uploading '%s': 100%%", upload->filename);
+        if (!msg) {
+            msg = g_strdup(FALLBACK_MSG);
+        }
+        win_update_entry_message(window, upload->put_url, msg);
+        win_mark_received(window, upload->put_url);
+        g_free(msg);
+
+        char* url = NULL;
+        if (format_alt_url(upload->get_url, upload->alt_scheme, upload->alt_fragment, &url) != 0) {
+            gchar* msg = g_strdup_printf("Uploading '%s' failed: Bad URL ('%s')", upload->filename, upload->get_url);
             if (!msg) {
                 msg = g_strdup(FALLBACK_MSG);
             }
-            win_update_entry_message(upload->window, upload->put_url, msg);
-            win_mark_received(upload->window, upload->put_url);
+            cons_show_error(msg);
             g_free(msg);
+        } else {
+            _http_upload_send_url(window, url);
+            curl_free(url);
+        }
+    }
 
-            char* url = NULL;
-            if (format_alt_url(upload->get_url, upload->alt_scheme, upload->alt_fragment, &url) != 0) {
-                gchar* msg = g_strdup_printf("Uploading '%s' failed: Bad URL ('%s')", upload->filename, upload->get_url);
-                if (!msg) {
-                    msg = g_strdup(FALLBACK_MSG);
-                }
-                cons_show_error(msg);
-                g_free(msg);
-            } else {
-                switch (upload->window->type) {
-                case WIN_CHAT:
-                {
-                    ProfChatWin* chatwin = (ProfChatWin*)(upload->window);
-                    assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
-                    cl_ev_send_msg(chatwin, url, url);
-                    break;
-                }
-                case WIN_PRIVATE:
-                {
-                    ProfPrivateWin* privatewin = (ProfPrivateWin*)(upload->window);
-                    assert(privatewin->memcheck == PROFPRIVATEWIN_MEMCHECK);
-                    cl_ev_send_priv_msg(privatewin, url, url);
-                    break;
-                }
-                case WIN_MUC:
-                {
-                    ProfMucWin* mucwin = (ProfMucWin*)(upload->window);
-                    assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
-                    cl_ev_send_muc_msg(mucwin, url, url);
-                    break;
-                }
-                default:
-                    break;
-                }
-
-                curl_free(url);
-            }
+    _http_upload_free(upload);
+}
+
+/*
+ * Queue the PUT of upload on the transfer thread, the file is streamed
+ * from its handle and the URL is sent to the window once it is done.
+ */
+void
+http_file_put(HTTPUpload* upload)
+{
+    upload->headers = NULL;
+
+    gchar* msg = g_strdup_printf("Uploading '%s': 0%%", upload->filename);
+    if (!msg) {
+        msg = g_strdup(FALLBACK_MSG);
+    }
+    win_print_http_transfer(upload->window, msg, upload->put_url);
+    g_free(msg);
+
+    CURL* curl = http_transfer_easy_new(upload->put_url);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+
+    gchar* content_type_header = g_strdup_printf("Content-Type: %s", upload->mime_type);
+    if (!content_type_header) {
+        content_type_header = g_strdup(FALLBACK_CONTENTTYPE_HEADER);
+    }
+    upload->headers = curl_slist_append(upload->headers, content_type_header);
+    upload->headers = curl_slist_append(upload->headers, "Expect:");
+    g_free(content_type_header);
+
+    // Optional headers
+    if (upload->authorization) {
+        gchar* auth_header = g_strdup_printf("Authorization: %s", upload->authorization);
+        if (!auth_header) {
+            auth_header = g_strdup(FALLBACK_MSG);
+        }
+        upload->headers = curl_slist_append(upload->headers, auth_header);
+        g_free(auth_header);
+    }
+    if (upload->cookie) {
+        gchar* cookie_header = g_strdup_printf("Cookie: %s", upload->cookie);
+        if (!cookie_header) {
+            cookie_header = g_strdup(FALLBACK_MSG);
+        }
+        upload->headers = curl_slist_append(upload->headers, cookie_header);
+        g_free(cookie_header);
+    }
+    if (upload->expires) {
+        gchar* expires_header = g_strdup_printf("Expires: %s", upload->expires);
+        if (!expires_header) {
+            expires_header = g_strdup(FALLBACK_MSG);
         }
+        upload->headers = curl_slist_append(upload->headers, expires_header);
+        g_free(expires_header);
     }
 
-    upload_processes = g_slist_remove(upload_processes, upload);
-    pthread_mutex_unlock(&lock);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, upload->headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _discard_callback);
 
-    free(upload->filename);
-    free(upload->mime_type);
-    free(upload->get_url);
-    free(upload->put_url);
-    free(upload->alt_scheme);
-    free(upload->alt_fragment);
-    free(upload->authorization);
-    free(upload->cookie);
-    free(upload->expires);
-    free(upload);
+    curl_easy_setopt(curl, CURLOPT_READDATA, upload->filehandle);
+    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)(upload->filesize));
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
 
-    return NULL;
+    http_transfer_start(curl, upload->window, _http_upload_progress, _http_upload_done, upload);
 }
 
 char*
@@ -418,23 +310,3 @@ file_size(int filedes)
     fstat(filedes, &st);
     return st.st_size;
 }
-
-void
-http_upload_cancel_processes(ProfWin* window)
-{
-    GSList* upload_process = upload_processes;
-    while (upload_process) {
-        HTTPUpload* upload = upload_process->data;
-        if (upload->window == window) {
-            upload->cancel = 1;
-            break;
-        }
-        upload_process = g_slist_next(upload_process);
-    }
-}
-
-void
-http_upload_add_upload(HTTPUpload* upload)
-{
-    upload_processes = g_slist_append(upload_processes, upload);
-}
@@ -50,15 +50,13 @@ typedef struct http_upload_t
     char* filename;
     FILE* filehandle;
     off_t filesize;
-    curl_off_t bytes_sent;
     char* mime_type;
     char* get_url;
     char* put_url;
     char* alt_scheme;
     char* alt_fragment;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
+    struct curl_slist* headers;
     // Additional headers
     // (NULL if they shouldn't be send in the PUT)
     char* authorization;
@@ -66,12 +64,9 @@ typedef struct http_upload_t
     char* expires;
 } HTTPUpload;
 
-void* http_file_put(void* userdata);
+void http_file_put(HTTPUpload* upload);
 
 char* file_mime_type(const char* const filename);
 off_t file_size(int filedes);
 
-void http_upload_cancel_processes(ProfWin* window);
-void http_upload_add_upload(HTTPUpload* upload);
-
 #endif
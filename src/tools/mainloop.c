@@ -0,0 +1,143 @@
+/*
+ * mainloop.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "log.h"
+#include "tools/mainloop.h"
+
+// read end, also the write end with eventfd
+static int wakeup_fd = -1;
+#ifndef __linux__
+static int wakeup_write_fd = -1;
+#endif
+
+void
+mainloop_init(void)
+{
+    if (wakeup_fd != -1) {
+        return;
+    }
+
+#ifdef __linux__
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        log_error("Could not create main loop eventfd: %s", g_strerror(errno));
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        log_error("Could not create main loop pipe: %s", g_strerror(errno));
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    wakeup_fd = fds[0];
+    wakeup_write_fd = fds[1];
+#endif
+}
+
+void
+mainloop_close(void)
+{
+    if (wakeup_fd != -1) {
+        close(wakeup_fd);
+        wakeup_fd = -1;
+    }
+#ifndef __linux__
+    if (wakeup_write_fd != -1) {
+        close(wakeup_write_fd);
+        wakeup_write_fd = -1;
+    }
+#endif
+}
+
+// The descriptor the main loop waits on next to its input, -1 without one
+int
+mainloop_fd(void)
+{
+    return wakeup_fd;
+}
+
+// Safe to call from any thread, wakes the main loop if it is waiting for input
+void
+mainloop_wakeup(void)
+{
+    // a full counter or pipe already means a pending wakeup
+#ifdef __linux__
+    if (wakeup_fd != -1) {
+        uint64_t one = 1;
+        ssize_t res = write(wakeup_fd, &one, sizeof(one));
+        (void)res;
+    }
+#else
+    if (wakeup_write_fd != -1) {
+        char one = 1;
+        ssize_t res = write(wakeup_write_fd, &one, sizeof(one));
+        (void)res;
+    }
+#endif
+}
+
+// Called from the main loop once the descriptor is readable
+void
+mainloop_drain(void)
+{
+    if (wakeup_fd == -1) {
+        return;
+    }
+
+#ifdef __linux__
+    uint64_t count;
+    ssize_t res = read(wakeup_fd, &count, sizeof(count));
+    (void)res;
+#else
+    char buf[64];
+    while (read(wakeup_fd, buf, sizeof(buf)) > 0) {
+    }
+#endif
+}
@@ -42,6 +42,16 @@
 
 #include "common.h"
 
+// a token of the input line, only copied once the arguments are known to be valid
+typedef struct parse_slice_t
+{
+    const char* start;
+    size_t len;
+} ParseSlice;
+
+// slices for commands with up to this many arguments stay on the stack
+#define PARSE_STACK_SLICES 16
+
 static gchar**
 _parse_args_helper(const char* const inp, int min, int max, gboolean* result, gboolean with_freetext)
 {
@@ -50,126 +60,109 @@ _parse_args_helper(const char* const inp, int min, int max, gboolean* result, gb
         return NULL;
     }
 
-    // copy and strip input of leading/trailing whitespace
-    char* copy = strdup(inp);
-    g_strstrip(copy);
+    // ignore leading/trailing whitespace
+    const char* p = inp;
+    while (g_ascii_isspace(*p)) {
+        p++;
+    }
+    const char* end = p + strlen(p);
+    while (end > p && g_ascii_isspace(end[-1])) {
+        end--;
+    }
+
+    // the command and max arguments, one more token means there are too many
+    int capacity = max + 2;
+    ParseSlice stack_slices[PARSE_STACK_SLICES];
+    ParseSlice* slices = capacity <= PARSE_STACK_SLICES ? stack_slices : g_new(ParseSlice, capacity);
+    int count = 0;
 
-    int inp_size = g_utf8_strlen(copy, -1);
     gboolean in_token = FALSE;
-    gboolean in_freetext = FALSE;
     gboolean in_quotes = FALSE;
-    char* token_start = &copy[0];
-    int token_size = 0;
+    const char* token_start = p;
     int num_tokens = 0;
-    GSList* tokens = NULL;
-
-    // add tokens to GSList
-    for (int i = 0; i < inp_size; i++) {
-        gchar* curr_ch = g_utf8_offset_to_pointer(copy, i);
-        gunichar curr_uni = g_utf8_get_char(curr_ch);
 
+    // spaces and quotes are ASCII, so the input can be scanned bytewise
+    while (p < end && count < capacity) {
         if (!in_token) {
-            if (curr_uni == ' ') {
+            if (*p == ' ') {
+                p++;
                 continue;
-            } else {
-                in_token = TRUE;
-                if (with_freetext) {
-                    num_tokens++;
-                }
-                if (with_freetext && (num_tokens == max + 1) && (curr_uni != '"')) {
-                    in_freetext = TRUE;
-                } else if (curr_uni == '"') {
-                    in_quotes = TRUE;
-                    i++;
-                    gchar* next_ch = g_utf8_next_char(curr_ch);
-                    gunichar next_uni = g_utf8_get_char(next_ch);
-
-                    if (next_uni == '"') {
-                        tokens = g_slist_append(tokens, g_strndup(curr_ch,
-                                                                  0));
-                        token_size = 0;
-                        in_token = FALSE;
-                        in_quotes = FALSE;
-                    } else {
-                        token_start = next_ch;
-                        token_size += g_unichar_to_utf8(next_uni, NULL);
-                    }
-                }
-                if (curr_uni == '"') {
-                    gchar* next_ch = g_utf8_next_char(curr_ch);
-                    token_start = next_ch;
-                } else {
-                    token_start = curr_ch;
-                    token_size += g_unichar_to_utf8(curr_uni, NULL);
-                }
             }
-        } else {
-            if (in_quotes) {
-                if (curr_uni == '"') {
-                    tokens = g_slist_append(tokens, g_strndup(token_start,
-                                                              token_size));
-                    token_size = 0;
+
+            in_token = TRUE;
+            if (with_freetext) {
+                num_tokens++;
+            }
+
+            if (with_freetext && (num_tokens == max + 1) && (*p != '"')) {
+                // the rest of the line is the last argument
+                token_start = p;
+                p = end;
+            } else if (*p == '"') {
+                // the character after the opening quote always belongs to the token
+                const char* next = p + 1;
+                if (next < end && *next == '"') {
+                    slices[count].start = next;
+                    slices[count].len = 0;
+                    count++;
                     in_token = FALSE;
-                    in_quotes = FALSE;
                 } else {
-                    if (curr_uni != '"') {
-                        token_size += g_unichar_to_utf8(curr_uni, NULL);
-                    }
+                    in_quotes = TRUE;
+                    token_start = next;
                 }
+                p = next < end ? MIN(g_utf8_next_char(next), end) : end;
             } else {
-                if (with_freetext && in_freetext) {
-                    token_size += g_unichar_to_utf8(curr_uni, NULL);
-                } else if (curr_uni == ' ') {
-                    tokens = g_slist_append(tokens, g_strndup(token_start,
-                                                              token_size));
-                    token_size = 0;
-                    in_token = FALSE;
-                } else {
-                    token_size += g_unichar_to_utf8(curr_uni, NULL);
-                }
+                token_start = p;
+                p++;
+            }
+        } else if (in_quotes) {
+            if (*p == '"') {
+                slices[count].start = token_start;
+                slices[count].len = p - token_start;
+                count++;
+                in_token = FALSE;
+                in_quotes = FALSE;
             }
+            p++;
+        } else if (*p == ' ') {
+            slices[count].start = token_start;
+            slices[count].len = p - token_start;
+            count++;
+            in_token = FALSE;
+            p++;
+        } else {
+            p++;
         }
     }
 
-    if (in_token) {
-        tokens = g_slist_append(tokens, g_strndup(token_start, token_size));
+    if (in_token && count < capacity) {
+        slices[count].start = token_start;
+        slices[count].len = end - token_start;
+        count++;
     }
 
-    free(copy);
-
-    int num = g_slist_length(tokens) - 1;
+    int num = count - 1;
+    gchar** args = NULL;
 
     // if num args not valid return NULL
     if ((num < min) || (num > max)) {
-        g_slist_free_full(tokens, free);
         *result = FALSE;
-        return NULL;
-
-        // if min allowed is 0 and 0 found, return empty char* array
-    } else if (min == 0 && num == 0) {
-        g_slist_free_full(tokens, free);
-        gchar** args = g_malloc((num + 1) * sizeof(*args));
-        args[0] = NULL;
-        *result = TRUE;
-        return args;
 
-        // otherwise return args array
+        // otherwise return args array, empty if there are none
     } else {
-        gchar** args = g_malloc((num + 1) * sizeof(*args));
-        GSList* token = tokens;
-        token = g_slist_next(token);
-        int arg_count = 0;
-
-        while (token) {
-            args[arg_count++] = strdup(token->data);
-            token = g_slist_next(token);
+        args = g_new(gchar*, num + 1);
+        for (int i = 0; i < num; i++) {
+            args[i] = g_strndup(slices[i + 1].start, slices[i + 1].len);
         }
-
-        args[arg_count] = NULL;
-        g_slist_free_full(tokens, free);
+        args[num] = NULL;
         *result = TRUE;
-        return args;
     }
+
+    if (slices != stack_slices) {
+        g_free(slices);
+    }
+
+    return args;
 }
 
 /*
@@ -0,0 +1,234 @@
+/*
+ * stats.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "log.h"
+#include "config/files.h"
+#include "config/preferences.h"
+#include "tools/stats.h"
+
+// bucket i holds samples below 2^(i+1) microseconds, the last one everything above
+#define STATS_BUCKETS 24
+
+typedef struct stats_histogram_t
+{
+    guint64 count;
+    gint64 total_us;
+    gint64 max_us;
+    guint64 buckets[STATS_BUCKETS];
+} StatsHistogram;
+
+static const char* probe_names[PROF_STATS_MAX] = {
+    [PROF_STATS_CONNECTION_EVENTS] = "connection events",
+    [PROF_STATS_MESSAGE_HANDLER] = "message handler",
+    [PROF_STATS_PRESENCE_HANDLER] = "presence handler",
+    [PROF_STATS_IQ_HANDLER] = "iq handler",
+    [PROF_STATS_UI_UPDATE] = "ui update",
+    [PROF_STATS_WIN_REDRAW] = "window redraw",
+    [PROF_STATS_DATABASE_ADD] = "database add",
+    [PROF_STATS_CHATLOG] = "chat log",
+    [PROF_STATS_PLUGIN_HOOK] = "plugin hooks",
+};
+
+static const char* counter_names[PROF_STATS_COUNTER_MAX] = {
+    [PROF_STATS_CHAT_STATES_SENT] = "chat states sent",
+    [PROF_STATS_CHAT_STATES_DROPPED] = "chat states dropped",
+    [PROF_STATS_PRESENCE_SENT] = "presence sent",
+    [PROF_STATS_PRESENCE_DROPPED] = "presence dropped",
+};
+
+static StatsHistogram histograms[PROF_STATS_MAX];
+static guint64 counters[PROF_STATS_COUNTER_MAX];
+static gint64 since = 0;
+static gint64 last_dump = 0;
+
+gint64
+stats_start(void)
+{
+    return g_get_monotonic_time();
+}
+
+void
+stats_end(stats_probe_t probe, gint64 start)
+{
+    gint64 elapsed = g_get_monotonic_time() - start;
+    if (elapsed < 0) {
+        elapsed = 0;
+    }
+
+    StatsHistogram* hist = &histograms[probe];
+    hist->count++;
+    hist->total_us += elapsed;
+    if (elapsed > hist->max_us) {
+        hist->max_us = elapsed;
+    }
+
+    guint bucket = g_bit_storage((gulong)elapsed) - 1;
+    if (bucket >= STATS_BUCKETS) {
+        bucket = STATS_BUCKETS - 1;
+    }
+    hist->buckets[bucket]++;
+}
+
+void
+stats_count(stats_counter_t counter)
+{
+    counters[counter]++;
+}
+
+guint64
+stats_counter(stats_counter_t counter)
+{
+    return counters[counter];
+}
+
+void
+stats_reset(void)
+{
+    memset(histograms, 0, sizeof(histograms));
+    memset(counters, 0, sizeof(counters));
+    since = g_get_monotonic_time();
+}
+
+// upper bound of the bucket containing the given percentile
+static gint64
+_percentile(StatsHistogram* hist, guint percent)
+{
+    guint64 wanted = (hist->count * percent + 99) / 100;
+    guint64 seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= wanted) {
+            return i == STATS_BUCKETS - 1 ? hist->max_us : (gint64)1 << (i + 1);
+        }
+    }
+
+    return hist->max_us;
+}
+
+GSList*
+stats_report(void)
+{
+    GSList* lines = NULL;
+
+    if (since == 0) {
+        since = g_get_monotonic_time();
+    }
+    gint64 secs = (g_get_monotonic_time() - since) / G_USEC_PER_SEC;
+    lines = g_slist_append(lines, g_strdup_printf("Sampled over %" G_GINT64_FORMAT " seconds, times in microseconds:", secs));
+
+    for (int i = 0; i < PROF_STATS_MAX; i++) {
+        StatsHistogram* hist = &histograms[i];
+        if (hist->count == 0) {
+            lines = g_slist_append(lines, g_strdup_printf("  %-18s : no samples", probe_names[i]));
+            continue;
+        }
+
+        lines = g_slist_append(lines, g_strdup_printf("  %-18s : count %" G_GUINT64_FORMAT ", avg %" G_GINT64_FORMAT ", p50 <%" G_GINT64_FORMAT ", p99 <%" G_GINT64_FORMAT ", max %" G_GINT64_FORMAT,
+                                                      probe_names[i],
+                                                      hist->count,
+                                                      hist->total_us / (gint64)hist->count,
+                                                      _percentile(hist, 50),
+                                                      _percentile(hist, 99),
+                                                      hist->max_us));
+    }
+
+    lines = g_slist_append(lines, g_strdup("Outbound stanzas:"));
+    for (int i = 0; i < PROF_STATS_COUNTER_MAX; i++) {
+        lines = g_slist_append(lines, g_strdup_printf("  %-19s : %" G_GUINT64_FORMAT, counter_names[i], counters[i]));
+    }
+
+    return lines;
+}
+
+gboolean
+stats_dump(void)
+{
+    gchar* filename = files_get_data_path(FILE_STATS);
+    FILE* fp = fopen(filename, "a");
+    if (!fp) {
+        log_error("Could not open stats file %s", filename);
+        g_free(filename);
+        return FALSE;
+    }
+    g_chmod(filename, S_IRUSR | S_IWUSR);
+
+    GDateTime* now = g_date_time_new_now_local();
+    gchar* date_fmt = g_date_time_format_iso8601(now);
+    fprintf(fp, "%s\n", date_fmt);
+    g_free(date_fmt);
+    g_date_time_unref(now);
+
+    GSList* lines = stats_report();
+    for (GSList* curr = lines; curr; curr = g_slist_next(curr)) {
+        fprintf(fp, "%s\n", (char*)curr->data);
+    }
+    g_slist_free_full(lines, g_free);
+
+    int result = fclose(fp);
+    if (result == EOF) {
+        log_error("Error closing file %s, errno = %d", filename, errno);
+    }
+    g_free(filename);
+
+    return result != EOF;
+}
+
+void
+stats_dump_check(void)
+{
+    gint interval = prefs_get_stats_dump_interval();
+    if (interval <= 0) {
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    if (last_dump == 0) {
+        last_dump = now;
+        return;
+    }
+
+    if (now - last_dump >= (gint64)interval * G_USEC_PER_SEC) {
+        last_dump = now;
+        stats_dump();
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * stats.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#ifndef TOOLS_STATS_H
+#define TOOLS_STATS_H
+
+#include <glib.h>
+
+typedef enum {
+    PROF_STATS_CONNECTION_EVENTS,
+    PROF_STATS_MESSAGE_HANDLER,
+    PROF_STATS_PRESENCE_HANDLER,
+    PROF_STATS_IQ_HANDLER,
+    PROF_STATS_UI_UPDATE,
+    PROF_STATS_WIN_REDRAW,
+    PROF_STATS_DATABASE_ADD,
+    PROF_STATS_CHATLOG,
+    PROF_STATS_PLUGIN_HOOK,
+    PROF_STATS_MAX
+} stats_probe_t;
+
+typedef enum {
+    PROF_STATS_CHAT_STATES_SENT,
+    PROF_STATS_CHAT_STATES_DROPPED,
+    PROF_STATS_PRESENCE_SENT,
+    PROF_STATS_PRESENCE_DROPPED,
+    PROF_STATS_COUNTER_MAX
+} stats_counter_t;
+
+gint64 stats_start(void);
+void stats_end(stats_probe_t probe, gint64 start);
+void stats_count(stats_counter_t counter);
+guint64 stats_counter(stats_counter_t counter);
+void stats_reset(void);
+
+GSList* stats_report(void);
+gboolean stats_dump(void);
+void stats_dump_check(void);
+
+#endif
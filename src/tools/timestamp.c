@@ -0,0 +1,284 @@
+/*
+ * timestamp.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "tools/timestamp.h"
+
+typedef struct timestamp_format_t
+{
+    gint64 second;
+    GTimeSpan offset;
+    gchar* result;
+} TimestampFormat;
+
+// looked up once, GTimeZone knows the offset for any point in time
+static GTimeZone* local_tz = NULL;
+// format string -> the last second formatted with it
+static GHashTable* formats = NULL;
+
+static gboolean
+_timestamp_digits(const char** str, int count, int* result)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        char c = (*str)[i];
+        if (!g_ascii_isdigit(c)) {
+            return FALSE;
+        }
+        value = value * 10 + (c - '0');
+    }
+
+    *str += count;
+    *result = value;
+    return TRUE;
+}
+
+// days since 1970-01-01 in the proleptic Gregorian calendar
+static gint64
+_timestamp_days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    gint64 era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+}
+
+/*
+ * Parse an XEP-0082 DateTime, or the legacy CCYYMMDDThh:mm:ss stamp of
+ * XEP-0091, into microseconds since the epoch in a single pass. Stamps
+ * without a zone are UTC.
+ */
+gboolean
+timestamp_parse_iso8601(const char* const str, gint64* usec)
+{
+    if (!str) {
+        return FALSE;
+    }
+
+    const char* p = str;
+    int year, month, day, hour, minute, second;
+
+    if (!_timestamp_digits(&p, 4, &year)) {
+        return FALSE;
+    }
+    gboolean extended = *p == '-';
+    if (extended) {
+        p++;
+    }
+    if (!_timestamp_digits(&p, 2, &month)) {
+        return FALSE;
+    }
+    if (extended && *p++ != '-') {
+        return FALSE;
+    }
+    if (!_timestamp_digits(&p, 2, &day)) {
+        return FALSE;
+    }
+    if (*p != 'T' && *p != 't' && *p != ' ') {
+        return FALSE;
+    }
+    p++;
+    if (!_timestamp_digits(&p, 2, &hour) || *p++ != ':'
+        || !_timestamp_digits(&p, 2, &minute) || *p++ != ':'
+        || !_timestamp_digits(&p, 2, &second)) {
+        return FALSE;
+    }
+
+    gint64 fraction = 0;
+    if (*p == '.' || *p == ',') {
+        p++;
+        if (!g_ascii_isdigit(*p)) {
+            return FALSE;
+        }
+        gint64 scale = G_USEC_PER_SEC;
+        while (g_ascii_isdigit(*p)) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+
+    int offset = 0;
+    if (*p == 'Z' || *p == 'z') {
+        p++;
+    } else if (*p == '+' || *p == '-') {
+        int sign = *p++ == '-' ? -1 : 1;
+        int offset_hours, offset_minutes = 0;
+        if (!_timestamp_digits(&p, 2, &offset_hours)) {
+            return FALSE;
+        }
+        if (*p == ':') {
+            p++;
+            if (!_timestamp_digits(&p, 2, &offset_minutes)) {
+                return FALSE;
+            }
+        } else if (g_ascii_isdigit(*p) && !_timestamp_digits(&p, 2, &offset_minutes)) {
+            return FALSE;
+        }
+        offset = sign * (offset_hours * 3600 + offset_minutes * 60);
+    }
+
+    if (*p != '\0') {
+        return FALSE;
+    }
+
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > g_date_get_days_in_month(month, year)
+        || hour > 23 || minute > 59 || second > 60) {
+        return FALSE;
+    }
+    // a leap second is shown as the last second of the minute
+    if (second == 60) {
+        second = 59;
+    }
+
+    gint64 seconds = _timestamp_days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    *usec = seconds * G_USEC_PER_SEC + fraction;
+
+    return TRUE;
+}
+
+// Microseconds since the epoch as local time
+GDateTime*
+timestamp_local_from_usec(gint64 usec)
+{
+    if (!local_tz) {
+        local_tz = g_time_zone_new_local();
+    }
+
+    GDateTime* utc = g_date_time_new_from_unix_utc(usec / G_USEC_PER_SEC);
+    if (!utc) {
+        return NULL;
+    }
+    GDateTime* local = g_date_time_to_timezone(utc, local_tz);
+    g_date_time_unref(utc);
+
+    gint64 fraction = usec % G_USEC_PER_SEC;
+    if (local && fraction != 0) {
+        GDateTime* exact = g_date_time_add(local, fraction);
+        g_date_time_unref(local);
+        local = exact;
+    }
+
+    return local;
+}
+
+// Parse an ISO8601 stamp into local time, NULL if it is not valid
+GDateTime*
+timestamp_local_from_iso8601(const char* const str)
+{
+    gint64 usec;
+    if (!timestamp_parse_iso8601(str, &usec)) {
+        return NULL;
+    }
+
+    return timestamp_local_from_usec(usec);
+}
+
+static void
+_timestamp_format_free(TimestampFormat* entry)
+{
+    g_free(entry->result);
+    g_free(entry);
+}
+
+/*
+ * g_date_time_format() with the result of the last call for a format kept
+ * until the second changes. The string belongs to the cache and stays
+ * valid until the next call with the same format.
+ */
+const char*
+timestamp_format(GDateTime* time, const char* const format)
+{
+    if (!formats) {
+        formats = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_timestamp_format_free);
+    }
+
+    TimestampFormat* entry = g_hash_table_lookup(formats, format);
+    if (!entry) {
+        entry = g_new0(TimestampFormat, 1);
+        g_hash_table_insert(formats, g_strdup(format), entry);
+    }
+
+    gint64 second = g_date_time_to_unix(time);
+    GTimeSpan offset = g_date_time_get_utc_offset(time);
+    // sub-second formats change within a second
+    gboolean cacheable = strstr(format, "%f") == NULL;
+    if (cacheable && entry->result && entry->second == second && entry->offset == offset) {
+        return entry->result;
+    }
+
+    g_free(entry->result);
+    entry->result = g_date_time_format(time, format);
+    entry->second = second;
+    entry->offset = offset;
+
+    return entry->result;
+}
+
+// XEP-0082 UTC datetime keeping the microseconds, e.g. 2020-03-24T11:12:14.000500Z, free with g_free
+gchar*
+timestamp_to_iso8601_usec(GDateTime* time)
+{
+    GDateTime* utc = g_date_time_to_utc(time);
+    gchar* seconds = g_date_time_format(utc, "%Y-%m-%dT%H:%M:%S");
+    gchar* result = g_strdup_printf("%s.%06dZ", seconds, g_date_time_get_microsecond(utc));
+
+    g_free(seconds);
+    g_date_time_unref(utc);
+
+    return result;
+}
+
+void
+timestamp_close(void)
+{
+    if (formats) {
+        g_hash_table_destroy(formats);
+        formats = NULL;
+    }
+    if (local_tz) {
+        g_time_zone_unref(local_tz);
+        local_tz = NULL;
+    }
+}
@@ -0,0 +1,201 @@
+/*
+ * workqueue.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib.h>
+
+#include "tools/workqueue.h"
+#include "tools/mainloop.h"
+
+// workers never outnumber this, decryption is mostly waiting for the gpg engine
+#define WORKQUEUE_MAX_THREADS 4
+
+typedef struct workqueue_job_t
+{
+    workqueue_work_t work;
+    workqueue_done_t done;
+    gpointer data;
+    gboolean finished;
+} WorkqueueJob;
+
+static GThreadPool* pool = NULL;
+
+// key -> GQueue of WorkqueueJob in submission order, only touched by the main thread
+static GHashTable* queues = NULL;
+
+static GMutex finished_lock;
+static GCond finished_cond;
+
+static void
+_workqueue_run(gpointer data, gpointer user_data)
+{
+    WorkqueueJob* job = data;
+    job->work(job->data);
+
+    g_mutex_lock(&finished_lock);
+    job->finished = TRUE;
+    g_cond_broadcast(&finished_cond);
+    g_mutex_unlock(&finished_lock);
+
+    mainloop_wakeup();
+}
+
+static gboolean
+_workqueue_job_finished(WorkqueueJob* job)
+{
+    g_mutex_lock(&finished_lock);
+    gboolean result = job->finished;
+    g_mutex_unlock(&finished_lock);
+
+    return result;
+}
+
+static void
+_workqueue_queue_free(GQueue* queue)
+{
+    // only empty queues are removed, anything left is dropped on close
+    g_queue_free_full(queue, free);
+}
+
+/*
+ * Run work on a worker thread and done on the main loop afterwards. Jobs
+ * sharing a key complete in the order they were pushed, work may be NULL
+ * for jobs which only have to wait for the ones in front of them.
+ */
+void
+workqueue_push(const char* const key, workqueue_work_t work, workqueue_done_t done, gpointer data)
+{
+    if (!queues) {
+        queues = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_workqueue_queue_free);
+    }
+
+    WorkqueueJob* job = malloc(sizeof(WorkqueueJob));
+    job->work = work;
+    job->done = done;
+    job->data = data;
+    job->finished = (work == NULL);
+
+    GQueue* queue = g_hash_table_lookup(queues, key);
+    if (!queue) {
+        queue = g_queue_new();
+        g_hash_table_insert(queues, g_strdup(key), queue);
+    }
+    g_queue_push_tail(queue, job);
+
+    if (!work) {
+        return;
+    }
+
+    if (!pool) {
+        gint threads = MIN(g_get_num_processors(), WORKQUEUE_MAX_THREADS);
+        pool = g_thread_pool_new(_workqueue_run, NULL, MAX(threads, 1), FALSE, NULL);
+    }
+    g_thread_pool_push(pool, job, NULL);
+}
+
+gboolean
+workqueue_pending(const char* const key)
+{
+    return queues && g_hash_table_contains(queues, key);
+}
+
+// Called from the main loop, completes finished jobs in order for every key
+void
+workqueue_process(void)
+{
+    if (!queues || g_hash_table_size(queues) == 0) {
+        return;
+    }
+
+    // done callbacks may push new jobs, so collect before running them
+    GSList* ready = NULL;
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, queues);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GQueue* queue = value;
+        while (!g_queue_is_empty(queue) && _workqueue_job_finished(g_queue_peek_head(queue))) {
+            ready = g_slist_prepend(ready, g_queue_pop_head(queue));
+        }
+        if (g_queue_is_empty(queue)) {
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+
+    ready = g_slist_reverse(ready);
+    for (GSList* curr = ready; curr; curr = g_slist_next(curr)) {
+        WorkqueueJob* job = curr->data;
+        job->done(job->data);
+    }
+    g_slist_free_full(ready, free);
+}
+
+// Wait for every queued job and complete it, e.g. before disconnecting
+void
+workqueue_flush(void)
+{
+    while (queues && g_hash_table_size(queues) > 0) {
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, queues);
+        g_hash_table_iter_next(&iter, NULL, &value);
+        WorkqueueJob* head = g_queue_peek_head(value);
+
+        g_mutex_lock(&finished_lock);
+        while (!head->finished) {
+            g_cond_wait(&finished_cond, &finished_lock);
+        }
+        g_mutex_unlock(&finished_lock);
+
+        workqueue_process();
+    }
+}
+
+void
+workqueue_close(void)
+{
+    workqueue_flush();
+
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+        pool = NULL;
+    }
+    if (queues) {
+        g_hash_table_destroy(queues);
+        queues = NULL;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * workqueue.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link the code of portions of this program with the OpenSSL library under
+ * certain conditions as described in each individual source file, and
+ * distribute linked combinations including the two.
+ *
+ * You must obey the GNU General Public License in all respects for all of the
+ * code used other than OpenSSL. If you modify file(s) with this exception, you
+ * may extend this exception to your version of the file(s), but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version. If you delete this exception statement from all
+ * source files in the program, then also delete it here.
+ *
+ */
+
+#ifndef TOOLS_WORKQUEUE_H
+#define TOOLS_WORKQUEUE_H
+
+#include <glib.h>
+
+// runs on a worker thread, must not touch the UI or other main thread state
+typedef void (*workqueue_work_t)(gpointer data);
+// runs on the main loop once the job and all jobs queued before it with the same key are done
+typedef void (*workqueue_done_t)(gpointer data);
+
+void workqueue_push(const char* const key, workqueue_work_t work, workqueue_done_t done, gpointer data);
+gboolean workqueue_pending(const char* const key);
+void workqueue_process(void);
+void workqueue_flush(void);
+void workqueue_close(void);
+
+#endif
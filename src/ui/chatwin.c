@@ -353,7 +353,7 @@ chatwin_incoming_msg(ProfChatWin* chatwin, ProfMessage* message, gboolean win_cr
                 flash();
             }
 
-            chatwin->unread++;
+            wins_add_unread(window, FALSE);
         }
 
         // TODO: so far we don't ask for MAM when incoming message occurs.
@@ -630,6 +630,37 @@ chatwin_db_history(ProfChatWin* chatwin, char* start_time, char* end_time, gbool
     return has_items;
 }
 
+// Called when a MAM catch-up finished, the history is drawn once the window is focused
+void
+chatwin_mam_history_done(ProfChatWin* chatwin, const char* const end_time)
+{
+    assert(chatwin != NULL);
+
+    g_free(chatwin->mam_history_end);
+    chatwin->mam_history_end = g_strdup(end_time);
+    chatwin->mam_history_pending = TRUE;
+
+    if (wins_is_current((ProfWin*)chatwin)) {
+        chatwin_show_pending_history(chatwin);
+    }
+}
+
+void
+chatwin_show_pending_history(ProfChatWin* chatwin)
+{
+    if (!chatwin->mam_history_pending) {
+        return;
+    }
+    chatwin->mam_history_pending = FALSE;
+
+    win_remove_loading_history((ProfWin*)chatwin);
+
+    // chatwin_db_history() takes ownership of end_time
+    char* end_time = chatwin->mam_history_end;
+    chatwin->mam_history_end = NULL;
+    chatwin_db_history(chatwin, NULL, end_time, TRUE);
+}
+
 static void
 _chatwin_set_last_message(ProfChatWin* chatwin, const char* const id, const char* const message)
 {
@@ -769,6 +769,7 @@ cons_show_bookmarks(const GList* list)
     } else {
         cons_show("Automatic invite bookmarking (/bookmark invites): OFF");
     }
+    cons_show("Concurrent room joins on login (/bookmark joinlimit): %d", prefs_get_room_join_limit());
 
     cons_alert(NULL);
 }
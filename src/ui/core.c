@@ -65,6 +65,7 @@
 #include "command/cmd_ac.h"
 #include "config/preferences.h"
 #include "config/theme.h"
+#include "tools/stats.h"
 #include "ui/ui.h"
 #include "ui/titlebar.h"
 #include "ui/statusbar.h"
@@ -85,6 +86,8 @@
 static int inp_size;
 static gboolean perform_resize = FALSE;
 static GTimer* ui_idle_time;
+// last title written to the terminal
+static char* term_title = NULL;
 
 #ifdef HAVE_LIBXSS
 static Display* display;
@@ -128,6 +131,7 @@ ui_sigwinch_handler(int sig)
 void
 ui_update(void)
 {
+    gint64 start = stats_start();
     ProfWin* current = wins_get_current();
     if (current->layout->paged == 0) {
         win_move_to_end(current);
@@ -147,6 +151,7 @@ ui_update(void)
         perform_resize = FALSE;
         ui_resize();
     }
+    stats_end(PROF_STATS_UI_UPDATE, start);
 }
 
 unsigned long
@@ -692,6 +697,12 @@ ui_focus_win(ProfWin* window)
     int i = wins_get_num(window);
     wins_set_current_by_num(i);
 
+    if (window->type == WIN_CHAT) {
+        chatwin_show_pending_history((ProfChatWin*)window);
+    } else if (window->type == WIN_XML) {
+        xmlwin_show_pending((ProfXMLWin*)window);
+    }
+
     if (i == 1) {
         title_bar_console();
         rosterwin_roster();
@@ -1097,6 +1108,8 @@ ui_contact_offline(char* barejid, char* resource, char* status)
 void
 ui_clear_win_title(void)
 {
+    g_free(term_title);
+    term_title = NULL;
     fputs("\e]0;\a", stdout);
     fflush(stdout);
 }
@@ -1111,6 +1124,7 @@ ui_goodbye_title(void)
 static void
 _ui_draw_term_title(void)
 {
+    char* title = NULL;
     jabber_conn_status_t status = connection_get_status();
 
     if (status == JABBER_CONNECTED) {
@@ -1118,14 +1132,24 @@ _ui_draw_term_title(void)
         gint unread = wins_get_total_unread();
 
         if (unread != 0) {
-            fprintf(stdout, "\e]0;Profanity (%d) - %s\a", unread, jid);
+            title = g_strdup_printf("Profanity (%d) - %s", unread, jid);
         } else {
-            fprintf(stdout, "\e]0;Profanity - %s\a", jid);
+            title = g_strdup_printf("Profanity - %s", jid);
         }
     } else {
-        fputs("\e]0;Profanity\a", stdout);
+        title = g_strdup("Profanity");
+    }
+
+    // only write to the terminal when the title actually changes
+    if (g_strcmp0(title, term_title) == 0) {
+        g_free(title);
+        return;
     }
+
+    fprintf(stdout, "\e]0;%s\a", title);
     fflush(stdout);
+    g_free(term_title);
+    term_title = title;
 }
 
 void
@@ -43,7 +43,6 @@
 #include <wchar.h>
 #include <sys/time.h>
 #include <errno.h>
-#include <pthread.h>
 
 #include <readline/readline.h>
 #include <readline/history.h>
@@ -75,6 +74,7 @@
 #include "xmpp/roster_list.h"
 #include "xmpp/chat_state.h"
 #include "tools/editor.h"
+#include "tools/mainloop.h"
 
 static WINDOW* inp_win;
 static int pad_start = 0;
@@ -172,10 +172,13 @@ inp_readline(void)
     p_rl_timeout.tv_usec = inp_timeout % 1000 * 1000;
     FD_ZERO(&fds);
     FD_SET(fileno(rl_instream), &fds);
+    // workers wake us up when they have results for the main loop
+    int wakeup_fd = mainloop_fd();
+    if (wakeup_fd != -1) {
+        FD_SET(wakeup_fd, &fds);
+    }
     errno = 0;
-    pthread_mutex_unlock(&lock);
     r = select(FD_SETSIZE, &fds, NULL, NULL, &p_rl_timeout);
-    pthread_mutex_lock(&lock);
     if (r < 0) {
         if (errno != EINTR) {
             const char* err_msg = strerror(errno);
@@ -184,6 +187,10 @@ inp_readline(void)
         return NULL;
     }
 
+    if (wakeup_fd != -1 && FD_ISSET(wakeup_fd, &fds)) {
+        mainloop_drain();
+    }
+
     if (FD_ISSET(fileno(rl_instream), &fds)) {
         rl_callback_read_char();
 
@@ -871,7 +878,7 @@ _inp_rl_win_attention_handler(int count, int key)
 {
     ProfWin* current = wins_get_current();
     if (current) {
-        gboolean attention = win_toggle_attention(current);
+        gboolean attention = wins_toggle_attention(current);
         if (attention) {
             win_println(current, THEME_DEFAULT, "!", "Attention flag has been activated");
         } else {
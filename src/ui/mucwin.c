@@ -43,6 +43,7 @@
 #include <stdlib.h>
 
 #include "log.h"
+#include "database.h"
 #include "config/preferences.h"
 #include "plugins/plugins.h"
 #include "ui/window.h"
@@ -53,6 +54,7 @@
 #endif
 
 static void _mucwin_set_last_message(ProfMucWin* mucwin, const char* const id, const char* const message);
+static void _mucwin_history(ProfMucWin* mucwin);
 
 ProfMucWin*
 mucwin_new(const char* const barejid)
@@ -62,6 +64,10 @@ mucwin_new(const char* const barejid)
 
     mucwin->last_msg_timestamp = NULL;
 
+    if (prefs_get_boolean(PREF_CHLOG) && prefs_get_boolean(PREF_HISTORY)) {
+        _mucwin_history(mucwin);
+    }
+
 #ifdef HAVE_OMEMO
     if (muc_anonymity_type(mucwin->roomjid) == MUC_ANONYMITY_TYPE_NONANONYMOUS && omemo_automatic_start(barejid)) {
         omemo_start_muc_sessions(barejid);
@@ -74,6 +80,24 @@ mucwin_new(const char* const barejid)
     return mucwin;
 }
 
+// The join asks the server for the messages since the last logged one,
+// show the logged messages before them
+static void
+_mucwin_history(ProfMucWin* mucwin)
+{
+    GSList* history = log_database_get_previous_chat(mucwin->roomjid, NULL, NULL, FALSE, FALSE);
+
+    for (GSList* curr = history; curr; curr = g_slist_next(curr)) {
+        ProfMessage* msg = curr->data;
+        // private messages share the room jid
+        if (msg->type != PROF_MSG_TYPE_MUCPM) {
+            win_print_history((ProfWin*)mucwin, msg);
+        }
+    }
+
+    g_slist_free_full(history, (GDestroyNotify)message_free);
+}
+
 void
 mucwin_role_change(ProfMucWin* mucwin, const char* const role, const char* const actor, const char* const reason)
 {
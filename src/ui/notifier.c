@@ -57,6 +57,215 @@
 
 static GTimer* remind_timer;
 
+#ifdef HAVE_LIBNOTIFY
+typedef struct notify_request_t
+{
+    // notifications with the same key update each other, NULL for one-off ones
+    char* key;
+    // count the messages behind a key and show the number
+    gboolean counted;
+    char* message;
+    int timeout;
+    char* category;
+} NotifyRequest;
+
+typedef struct notify_entry_t
+{
+    NotifyNotification* notification;
+    int count;
+    gint64 expires;
+} NotifyEntry;
+
+// libnotify is only ever used from this thread, a D-Bus round trip per
+// notification must not hold up the UI
+static GThread* notify_thread = NULL;
+static GAsyncQueue* notify_queue = NULL;
+// errors are logged from the main thread
+static GAsyncQueue* notify_errors = NULL;
+// key -> NotifyEntry, owned by the notification thread
+static GHashTable* notify_entries = NULL;
+
+static void
+_notify_request_free(NotifyRequest* request)
+{
+    g_free(request->key);
+    g_free(request->message);
+    g_free(request->category);
+    g_free(request);
+}
+
+static void
+_notify_entry_free(NotifyEntry* entry)
+{
+    g_object_unref(entry->notification);
+    g_free(entry);
+}
+
+static void
+_notify_show(NotifyRequest* request, int merged)
+{
+    if (!notify_is_initted() && !notify_init("Profanity")) {
+        g_async_queue_push(notify_errors, g_strdup("Libnotify not initialised."));
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    NotifyEntry* entry = request->key ? g_hash_table_lookup(notify_entries, request->key) : NULL;
+    if (entry && now >= entry->expires) {
+        g_hash_table_remove(notify_entries, request->key);
+        entry = NULL;
+    }
+
+    gchar* body;
+    int count = entry ? entry->count + merged : merged;
+    if (request->counted && count > 1) {
+        body = g_strdup_printf("%s\n(%d new messages)", request->message, count);
+    } else {
+        body = g_strdup(request->message);
+    }
+
+    NotifyNotification* notification;
+    if (entry) {
+        // still on screen, replace its text instead of stacking another one
+        notification = entry->notification;
+        notify_notification_update(notification, "Profanity", body, NULL);
+    } else {
+        notification = notify_notification_new("Profanity", body, NULL);
+    }
+    notify_notification_set_timeout(notification, request->timeout);
+    notify_notification_set_category(notification, request->category);
+    notify_notification_set_urgency(notification, NOTIFY_URGENCY_NORMAL);
+
+    GError* error = NULL;
+    gboolean notify_success = notify_notification_show(notification, &error);
+
+    if (!notify_success) {
+        g_async_queue_push(notify_errors, g_strdup_printf("Error sending desktop notification: %s, %s", body, error->message));
+        g_error_free(error);
+
+        // the notification daemon might have gone away, start over on the next one
+        if (!entry) {
+            g_object_unref(notification);
+        }
+        g_hash_table_remove_all(notify_entries);
+        notify_uninit();
+    } else if (request->key) {
+        if (!entry) {
+            entry = g_new0(NotifyEntry, 1);
+            entry->notification = notification;
+            g_hash_table_insert(notify_entries, g_strdup(request->key), entry);
+        }
+        entry->count = count;
+        entry->expires = now + (gint64)request->timeout * 1000;
+    } else {
+        g_object_unref(notification);
+    }
+
+    g_free(body);
+}
+
+static gpointer
+_notify_thread_run(gpointer data)
+{
+    notify_entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_notify_entry_free);
+
+    gboolean quit = FALSE;
+    while (!quit) {
+        // take the whole burst, only the latest notification per key is shown
+        GList* batch = g_list_append(NULL, g_async_queue_pop(notify_queue));
+        NotifyRequest* request;
+        while ((request = g_async_queue_try_pop(notify_queue)) != NULL) {
+            batch = g_list_append(batch, request);
+        }
+
+        GHashTable* merged = g_hash_table_new(g_str_hash, g_str_equal);
+        for (GList* curr = batch; curr; curr = g_list_next(curr)) {
+            request = curr->data;
+            if (request->key) {
+                gint n = GPOINTER_TO_INT(g_hash_table_lookup(merged, request->key));
+                g_hash_table_insert(merged, request->key, GINT_TO_POINTER(n + 1));
+            }
+        }
+
+        for (GList* curr = batch; curr; curr = g_list_next(curr)) {
+            request = curr->data;
+            if (!request->message) {
+                quit = TRUE;
+            } else if (!request->key) {
+                _notify_show(request, 1);
+            } else {
+                gint n = GPOINTER_TO_INT(g_hash_table_lookup(merged, request->key));
+                gboolean last = TRUE;
+                for (GList* next = g_list_next(curr); next; next = g_list_next(next)) {
+                    NotifyRequest* later = next->data;
+                    if (g_strcmp0(later->key, request->key) == 0) {
+                        last = FALSE;
+                        break;
+                    }
+                }
+                if (last) {
+                    _notify_show(request, n);
+                }
+            }
+        }
+
+        g_hash_table_destroy(merged);
+        g_list_free_full(batch, (GDestroyNotify)_notify_request_free);
+    }
+
+    g_hash_table_destroy(notify_entries);
+    notify_entries = NULL;
+    if (notify_is_initted()) {
+        notify_uninit();
+    }
+
+    return NULL;
+}
+
+static void
+_notify_push(const char* const key, gboolean counted, const char* const message, int timeout, const char* const category)
+{
+    if (!notify_thread) {
+        notify_queue = g_async_queue_new();
+        notify_errors = g_async_queue_new_full(g_free);
+        notify_thread = g_thread_new("notify", _notify_thread_run, NULL);
+    }
+
+    NotifyRequest* request = g_new0(NotifyRequest, 1);
+    request->key = g_strdup(key);
+    request->counted = counted;
+    request->message = g_strdup(message);
+    request->timeout = timeout;
+    request->category = g_strdup(category);
+    g_async_queue_push(notify_queue, request);
+}
+
+static void
+_notify_log_errors(void)
+{
+    if (!notify_errors) {
+        return;
+    }
+
+    char* error;
+    while ((error = g_async_queue_try_pop(notify_errors)) != NULL) {
+        log_error("%s", error);
+        g_free(error);
+    }
+}
+#endif
+
+// Like notify(), but notifications with the same key replace each other
+static void
+_notify_keyed(const char* const key, gboolean counted, const char* const message, int timeout, const char* const category)
+{
+#ifdef HAVE_LIBNOTIFY
+    _notify_push(key, counted, message, timeout, category);
+#else
+    notify(message, timeout, category);
+#endif
+}
+
 void
 notifier_initialise(void)
 {
@@ -67,8 +276,17 @@ void
 notifier_uninit(void)
 {
 #ifdef HAVE_LIBNOTIFY
-    if (notify_is_initted()) {
-        notify_uninit();
+    if (notify_thread) {
+        // a request without a message stops the thread
+        g_async_queue_push(notify_queue, g_new0(NotifyRequest, 1));
+        g_thread_join(notify_thread);
+        notify_thread = NULL;
+
+        _notify_log_errors();
+        g_async_queue_unref(notify_queue);
+        notify_queue = NULL;
+        g_async_queue_unref(notify_errors);
+        notify_errors = NULL;
     }
 #endif
     g_timer_destroy(remind_timer);
@@ -78,7 +296,9 @@ void
 notify_typing(const char* const name)
 {
     gchar* message = g_strdup_printf("%s: typing...", name);
-    notify(message, 10000, "Incoming message");
+    gchar* key = g_strdup_printf("typing:%s", name);
+    _notify_keyed(key, FALSE, message, 10000, "Incoming message");
+    g_free(key);
     g_free(message);
 }
 
@@ -112,7 +332,9 @@ notify_message(const char* const name, int num, const char* const text)
         g_string_append_printf(message, "\n%s", text);
     }
 
-    notify(message->str, 10000, "incoming message");
+    gchar* key = g_strdup_printf("chat:%s", name);
+    _notify_keyed(key, TRUE, message->str, 10000, "incoming message");
+    g_free(key);
     g_string_free(message, TRUE);
 }
 
@@ -130,7 +352,9 @@ notify_room_message(const char* const nick, const char* const room, int num, con
         g_string_append_printf(message, "\n%s", text);
     }
 
-    notify(message->str, 10000, "incoming message");
+    gchar* key = g_strdup_printf("room:%s", room);
+    _notify_keyed(key, TRUE, message->str, 10000, "incoming message");
+    g_free(key);
 
     g_string_free(message, TRUE);
 }
@@ -147,6 +371,10 @@ notify_subscription(const char* const from)
 void
 notify_remind(void)
 {
+#ifdef HAVE_LIBNOTIFY
+    _notify_log_errors();
+#endif
+
     gdouble elapsed = g_timer_elapsed(remind_timer, NULL);
     gint remind_period = prefs_get_notify_remind();
     if (remind_period > 0 && elapsed >= remind_period) {
@@ -186,7 +414,7 @@ notify_remind(void)
         }
 
         if ((donotify && unread > 0) || (open > 0) || (subs > 0)) {
-            notify(text->str, 5000, "Incoming message");
+            _notify_keyed("remind", FALSE, text->str, 5000, "Incoming message");
         }
 
         g_string_free(text, TRUE);
@@ -199,36 +427,7 @@ void
 notify(const char* const message, int timeout, const char* const category)
 {
 #ifdef HAVE_LIBNOTIFY
-    log_debug("Attempting notification: %s", message);
-    if (notify_is_initted()) {
-        log_debug("Reinitialising libnotify");
-        notify_uninit();
-    } else {
-        log_debug("Initialising libnotify");
-    }
-    notify_init("Profanity");
-
-    if (notify_is_initted()) {
-        NotifyNotification* notification;
-        notification = notify_notification_new("Profanity", message, NULL);
-        notify_notification_set_timeout(notification, timeout);
-        notify_notification_set_category(notification, category);
-        notify_notification_set_urgency(notification, NOTIFY_URGENCY_NORMAL);
-
-        GError* error = NULL;
-        gboolean notify_success = notify_notification_show(notification, &error);
-
-        if (!notify_success) {
-            log_error("Error sending desktop notification:");
-            log_error("  -> Message : %s", message);
-            log_error("  -> Error   : %s", error->message);
-            g_error_free(error);
-        } else {
-            log_debug("Notification sent.");
-        }
-    } else {
-        log_error("Libnotify not initialised.");
-    }
+    _notify_push(NULL, FALSE, message, timeout, category);
 #endif
 #ifdef PLATFORM_CYGWIN
     NOTIFYICONDATA nid;
@@ -81,27 +81,149 @@ static GSList* _filter_contacts_with_presence(GSList* contacts, const char* cons
 static theme_item_t _get_roster_theme(roster_contact_theme_t theme_type, const char* presence);
 static int _compare_rooms_name(ProfMucWin* a, ProfMucWin* b);
 static int _compare_rooms_unread(ProfMucWin* a, ProfMucWin* b);
+static void _rosterwin_draw(ProfLayoutSplit* layout);
+static void _rosterwin_draw_begin(void);
+static void _rosterwin_draw_end(void);
+static ProfChatWin* _rosterwin_get_chat(const char* const barejid);
+
+static void _rosterwin_rows_begin(int width);
+static void _rosterwin_rows_end(void);
+static void _rosterwin_row_begin(const char* const kind, const char* const id);
+static void _rosterwin_row_end(void);
+static void _rosterwin_row_attron(int attrs);
+static void _rosterwin_row_attroff(int attrs);
+static void _rosterwin_row_print(char* msg, gboolean newline, gboolean wrap, int indent);
+static void _rosterwin_row_newline(void);
+static void _rosterwin_row_replay(WINDOW* win, GString* ops);
+static void _rosterwin_compose(ProfLayoutSplit* layout);
+
+// roster preferences used for each contact row, read once per draw
+typedef struct roster_draw_prefs_t
+{
+    gboolean wrap;
+    gboolean color_nick;
+    gboolean resource;
+    gboolean resource_join;
+    gboolean presence;
+    gboolean status;
+    gboolean priority;
+    gboolean offline;
+    gboolean empty;
+    gboolean count_zero;
+    gboolean by_presence;
+    int contact_indent;
+    int resource_indent;
+    int presence_indent;
+    char* contact_char;
+    char* resource_char;
+    char* header_char;
+    char* unreadpos;
+    char* countpref;
+} RosterDrawPrefs;
+
+static RosterDrawPrefs draw_prefs;
+
+// chat windows by barejid, built once per draw
+static GHashTable* draw_chatwins = NULL;
+
+static gboolean roster_dirty = FALSE;
+
+// drawing calls recorded for a row, replayed onto the roster pad
+typedef enum {
+    ROW_OP_ATTRON = 'a',
+    ROW_OP_ATTROFF = 'o',
+    ROW_OP_PRINT = 'p',
+    ROW_OP_NEWLINE = 'n'
+} row_op_t;
+
+#define ROW_PRINT_NEWLINE 0x01
+#define ROW_PRINT_WRAP    0x02
+
+// one roster entry (header, contact, room, private chat) as last drawn
+typedef struct roster_row_t
+{
+    char* key;
+    GString* ops;
+    int height;
+    int drawn_y;
+    gboolean dirty;
+    guint generation;
+} RosterRow;
+
+// rows by key, and the rows of the last draw in order
+static GHashTable* roster_rows = NULL;
+static GPtrArray* roster_order = NULL;
+static guint roster_generation = 0;
+static gboolean roster_rows_changed = FALSE;
+
+// row being recorded
+static gboolean row_open = FALSE;
+static GString* row_key = NULL;
+static GString* row_ops = NULL;
+
+// scratch pad of the roster width, rows are replayed here to measure their wrapped height
+static WINDOW* row_measure = NULL;
+
+// what is currently on the roster pad
+static WINDOW* composed_win = NULL;
+static int composed_width = -1;
+static int composed_top = -1;
+static int composed_height = 0;
 
 void
 rosterwin_roster(void)
+{
+    roster_dirty = TRUE;
+}
+
+// the roster pad was recreated, nothing drawn on the old one is there
+void
+rosterwin_roster_reset(void)
+{
+    composed_win = NULL;
+    roster_dirty = TRUE;
+}
+
+void
+rosterwin_roster_flush(void)
 {
     ProfWin* console = wins_get_console();
     if (!console) {
         return;
     }
 
-    jabber_conn_status_t conn_status = connection_get_status();
-    if (conn_status != JABBER_CONNECTED) {
+    ProfLayoutSplit* layout = (ProfLayoutSplit*)console->layout;
+    assert(layout->memcheck == LAYOUT_SPLIT_MEMCHECK);
+
+    if (layout->subwin == NULL) {
         return;
     }
 
-    ProfLayoutSplit* layout = (ProfLayoutSplit*)console->layout;
-    assert(layout->memcheck == LAYOUT_SPLIT_MEMCHECK);
+    // row heights were measured at the old width
+    if (row_measure && getmaxx(row_measure) != getmaxx(layout->subwin)) {
+        roster_dirty = TRUE;
+    }
+
+    if (roster_dirty) {
+        roster_dirty = FALSE;
+
+        jabber_conn_status_t conn_status = connection_get_status();
+        if (conn_status != JABBER_CONNECTED) {
+            return;
+        }
 
-    if (layout->subwin != NULL) {
-        werase(layout->subwin);
+        _rosterwin_draw(layout);
     }
 
+    _rosterwin_compose(layout);
+}
+
+static void
+_rosterwin_draw(ProfLayoutSplit* layout)
+{
+    _rosterwin_draw_begin();
+    _rosterwin_rows_begin(getmaxx(layout->subwin));
+
     char* roomspos = prefs_get_string(PREF_ROSTER_ROOMS_POS);
     if (prefs_get_boolean(PREF_ROSTER_ROOMS) && (g_strcmp0(roomspos, "first") == 0)) {
         _rosterwin_print_rooms(layout);
@@ -181,6 +303,8 @@ rosterwin_roster(void)
     }
 
     g_free(roomspos);
+    _rosterwin_rows_end();
+    _rosterwin_draw_end();
 }
 
 static void
@@ -238,7 +362,7 @@ _rosterwin_contacts_by_presence(ProfLayoutSplit* layout, const char* const prese
     g_slist_free(contacts);
 
     // if this group has contacts, or if we want to show empty groups
-    if (filtered_contacts || prefs_get_boolean(PREF_ROSTER_EMPTY)) {
+    if (filtered_contacts || draw_prefs.empty) {
         _rosterwin_contacts_header(layout, title, filtered_contacts);
     }
 
@@ -269,7 +393,7 @@ _rosterwin_contacts_by_group(ProfLayoutSplit* layout, char* group)
     GSList* filtered_contacts = _filter_contacts(contacts);
     g_slist_free(contacts);
 
-    if (filtered_contacts || prefs_get_boolean(PREF_ROSTER_EMPTY)) {
+    if (filtered_contacts || draw_prefs.empty) {
         if (group) {
             _rosterwin_contacts_header(layout, group, filtered_contacts);
         } else {
@@ -293,6 +417,8 @@ _rosterwin_unsubscribed_item(ProfLayoutSplit* layout, ProfChatWin* chatwin)
     const char* const presence = "offline";
     int unread = 0;
 
+    _rosterwin_row_begin("unsubscribed", name);
+
     roster_contact_theme_t theme_type = ROSTER_CONTACT;
     if (chatwin->unread > 0) {
         theme_type = ROSTER_CONTACT_UNREAD;
@@ -303,9 +429,9 @@ _rosterwin_unsubscribed_item(ProfLayoutSplit* layout, ProfChatWin* chatwin)
 
     theme_item_t presence_colour = _get_roster_theme(theme_type, presence);
 
-    wattron(layout->subwin, theme_attrs(presence_colour));
+    _rosterwin_row_attron(theme_attrs(presence_colour));
     GString* msg = g_string_new(" ");
-    int indent = prefs_get_roster_contact_indent();
+    int indent = draw_prefs.contact_indent;
     int current_indent = 0;
     if (indent > 0) {
         current_indent += indent;
@@ -314,28 +440,24 @@ _rosterwin_unsubscribed_item(ProfLayoutSplit* layout, ProfChatWin* chatwin)
             indent--;
         }
     }
-    char* ch = prefs_get_roster_contact_char();
-    if (ch) {
-        g_string_append_printf(msg, "%s", ch);
-        free(ch);
+    if (draw_prefs.contact_char) {
+        g_string_append(msg, draw_prefs.contact_char);
     }
 
-    char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-    if ((g_strcmp0(unreadpos, "before") == 0) && unread > 0) {
+    if ((g_strcmp0(draw_prefs.unreadpos, "before") == 0) && unread > 0) {
         g_string_append_printf(msg, "(%d) ", unread);
         unread = 0;
     }
     g_string_append(msg, name);
-    if ((g_strcmp0(unreadpos, "after") == 0) && unread > 0) {
+    if ((g_strcmp0(draw_prefs.unreadpos, "after") == 0) && unread > 0) {
         g_string_append_printf(msg, " (%d)", unread);
     }
-    g_free(unreadpos);
 
-    win_sub_newline_lazy(layout->subwin);
-    gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
-    win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+    _rosterwin_row_newline();
+    gboolean wrap = draw_prefs.wrap;
+    _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
     g_string_free(msg, TRUE);
-    wattroff(layout->subwin, theme_attrs(presence_colour));
+    _rosterwin_row_attroff(theme_attrs(presence_colour));
 }
 
 static void
@@ -347,8 +469,10 @@ _rosterwin_contact(ProfLayoutSplit* layout, PContact contact)
     const char* barejid = p_contact_barejid(contact);
     int unread = 0;
 
+    _rosterwin_row_begin("contact", barejid);
+
     roster_contact_theme_t theme_type = ROSTER_CONTACT;
-    ProfChatWin* chatwin = wins_get_chat(barejid);
+    ProfChatWin* chatwin = _rosterwin_get_chat(barejid);
     if (chatwin) {
         if (chatwin->unread > 0) {
             theme_type = ROSTER_CONTACT_UNREAD;
@@ -360,15 +484,15 @@ _rosterwin_contact(ProfLayoutSplit* layout, PContact contact)
 
     theme_item_t presence_colour = _get_roster_theme(theme_type, presence);
     int colour = 0;
-    if (prefs_get_boolean(PREF_ROSTER_COLOR_NICK)) {
+    if (draw_prefs.color_nick) {
         colour = theme_hash_attrs(name);
-        wattron(layout->subwin, colour);
+        _rosterwin_row_attron(colour);
     } else {
-        wattron(layout->subwin, theme_attrs(presence_colour));
+        _rosterwin_row_attron(theme_attrs(presence_colour));
     }
 
     GString* msg = g_string_new(" ");
-    int indent = prefs_get_roster_contact_indent();
+    int indent = draw_prefs.contact_indent;
     int current_indent = 0;
     if (indent > 0) {
         current_indent += indent;
@@ -377,50 +501,46 @@ _rosterwin_contact(ProfLayoutSplit* layout, PContact contact)
             indent--;
         }
     }
-    char* ch = prefs_get_roster_contact_char();
-    if (ch) {
-        g_string_append_printf(msg, "%s", ch);
-        free(ch);
+    if (draw_prefs.contact_char) {
+        g_string_append(msg, draw_prefs.contact_char);
     }
 
-    char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-    if ((g_strcmp0(unreadpos, "before") == 0) && unread > 0) {
+    if ((g_strcmp0(draw_prefs.unreadpos, "before") == 0) && unread > 0) {
         g_string_append_printf(msg, "(%d) ", unread);
         unread = 0;
     }
     g_string_append(msg, name);
-    if (g_strcmp0(unreadpos, "after") == 0) {
-        if (!prefs_get_boolean(PREF_ROSTER_RESOURCE)) {
+    if (g_strcmp0(draw_prefs.unreadpos, "after") == 0) {
+        if (!draw_prefs.resource) {
             if (unread > 0) {
                 g_string_append_printf(msg, " (%d)", unread);
             }
             unread = 0;
         }
     }
-    g_free(unreadpos);
 
-    win_sub_newline_lazy(layout->subwin);
-    gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
-    win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+    _rosterwin_row_newline();
+    gboolean wrap = draw_prefs.wrap;
+    _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
     g_string_free(msg, TRUE);
 
-    if (prefs_get_boolean(PREF_ROSTER_COLOR_NICK)) {
-        wattroff(layout->subwin, colour);
+    if (draw_prefs.color_nick) {
+        _rosterwin_row_attroff(colour);
     } else {
-        wattroff(layout->subwin, theme_attrs(presence_colour));
+        _rosterwin_row_attroff(theme_attrs(presence_colour));
     }
 
-    if (prefs_get_boolean(PREF_ROSTER_RESOURCE)) {
+    if (draw_prefs.resource) {
         _rosterwin_resources(layout, contact, current_indent, theme_type, unread);
-    } else if (prefs_get_boolean(PREF_ROSTER_PRESENCE) || prefs_get_boolean(PREF_ROSTER_STATUS)) {
+    } else if (draw_prefs.presence || draw_prefs.status) {
         if (unread > 0) {
             GString* unreadmsg = g_string_new("");
             g_string_append_printf(unreadmsg, " (%d)", unread);
 
-            wattron(layout->subwin, theme_attrs(presence_colour));
-            win_sub_print(layout->subwin, unreadmsg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_attron(theme_attrs(presence_colour));
+            _rosterwin_row_print(unreadmsg->str, FALSE, wrap, current_indent);
             g_string_free(unreadmsg, TRUE);
-            wattroff(layout->subwin, theme_attrs(presence_colour));
+            _rosterwin_row_attroff(theme_attrs(presence_colour));
         }
 
         _rosterwin_presence(layout, presence, status, current_indent);
@@ -437,29 +557,27 @@ _rosterwin_presence(ProfLayoutSplit* layout, const char* presence, const char* s
         return;
     }
 
-    char* by = prefs_get_string(PREF_ROSTER_BY);
-    gboolean by_presence = g_strcmp0(by, "presence") == 0;
-    g_free(by);
+    gboolean by_presence = draw_prefs.by_presence;
 
-    int presence_indent = prefs_get_roster_presence_indent();
+    int presence_indent = draw_prefs.presence_indent;
     if (presence_indent > 0) {
         current_indent += presence_indent;
     }
 
-    gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+    gboolean wrap = draw_prefs.wrap;
     theme_item_t colour = _get_roster_theme(ROSTER_CONTACT, presence);
 
     // show only status when grouped by presence
     if (by_presence) {
-        if (status && prefs_get_boolean(PREF_ROSTER_STATUS)) {
+        if (status && draw_prefs.status) {
 
-            wattron(layout->subwin, theme_attrs(colour));
+            _rosterwin_row_attron(theme_attrs(colour));
             if (presence_indent == -1) {
                 GString* msg = g_string_new("");
                 g_string_append_printf(msg, ": \"%s\"", status);
-                win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+                _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
                 g_string_free(msg, TRUE);
-                wattroff(layout->subwin, theme_attrs(colour));
+                _rosterwin_row_attroff(theme_attrs(colour));
             } else {
                 GString* msg = g_string_new(" ");
                 while (current_indent > 0) {
@@ -467,47 +585,47 @@ _rosterwin_presence(ProfLayoutSplit* layout, const char* presence, const char* s
                     current_indent--;
                 }
                 g_string_append_printf(msg, "\"%s\"", status);
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+                _rosterwin_row_newline();
+                _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
                 g_string_free(msg, TRUE);
-                wattroff(layout->subwin, theme_attrs(colour));
+                _rosterwin_row_attroff(theme_attrs(colour));
             }
         }
 
         // show both presence and status when not grouped by presence
-    } else if (prefs_get_boolean(PREF_ROSTER_PRESENCE) || (status && prefs_get_boolean(PREF_ROSTER_STATUS))) {
-        wattron(layout->subwin, theme_attrs(colour));
+    } else if (draw_prefs.presence || (status && draw_prefs.status)) {
+        _rosterwin_row_attron(theme_attrs(colour));
         if (presence_indent == -1) {
             GString* msg = g_string_new("");
-            if (prefs_get_boolean(PREF_ROSTER_PRESENCE)) {
+            if (draw_prefs.presence) {
                 g_string_append_printf(msg, ": %s", presence);
-                if (status && prefs_get_boolean(PREF_ROSTER_STATUS)) {
+                if (status && draw_prefs.status) {
                     g_string_append_printf(msg, " \"%s\"", status);
                 }
-            } else if (status && prefs_get_boolean(PREF_ROSTER_STATUS)) {
+            } else if (status && draw_prefs.status) {
                 g_string_append_printf(msg, ": \"%s\"", status);
             }
-            win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
             g_string_free(msg, TRUE);
-            wattroff(layout->subwin, theme_attrs(colour));
+            _rosterwin_row_attroff(theme_attrs(colour));
         } else {
             GString* msg = g_string_new(" ");
             while (current_indent > 0) {
                 g_string_append(msg, " ");
                 current_indent--;
             }
-            if (prefs_get_boolean(PREF_ROSTER_PRESENCE)) {
+            if (draw_prefs.presence) {
                 g_string_append(msg, presence);
-                if (status && prefs_get_boolean(PREF_ROSTER_STATUS)) {
+                if (status && draw_prefs.status) {
                     g_string_append_printf(msg, " \"%s\"", status);
                 }
-            } else if (status && prefs_get_boolean(PREF_ROSTER_STATUS)) {
+            } else if (status && draw_prefs.status) {
                 g_string_append_printf(msg, "\"%s\"", status);
             }
-            win_sub_newline_lazy(layout->subwin);
-            win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_newline();
+            _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
             g_string_free(msg, TRUE);
-            wattroff(layout->subwin, theme_attrs(colour));
+            _rosterwin_row_attroff(theme_attrs(colour));
         }
     }
 }
@@ -516,7 +634,7 @@ static void
 _rosterwin_resources(ProfLayoutSplit* layout, PContact contact, int current_indent, roster_contact_theme_t theme_type,
                      int unread)
 {
-    gboolean join = prefs_get_boolean(PREF_ROSTER_RESOURCE_JOIN);
+    gboolean join = draw_prefs.resource_join;
 
     GList* resources = p_contact_get_available_resources(contact);
     if (resources) {
@@ -527,55 +645,49 @@ _rosterwin_resources(ProfLayoutSplit* layout, PContact contact, int current_inde
             const char* resource_presence = string_from_resource_presence(resource->presence);
             theme_item_t resource_presence_colour = _get_roster_theme(theme_type, resource_presence);
 
-            wattron(layout->subwin, theme_attrs(resource_presence_colour));
+            _rosterwin_row_attron(theme_attrs(resource_presence_colour));
             GString* msg = g_string_new("");
-            char* ch = prefs_get_roster_resource_char();
-            if (ch) {
-                g_string_append_printf(msg, "%s", ch);
-                free(ch);
+            if (draw_prefs.resource_char) {
+                g_string_append(msg, draw_prefs.resource_char);
             } else {
                 g_string_append(msg, " ");
             }
             g_string_append(msg, resource->name);
-            if (prefs_get_boolean(PREF_ROSTER_PRIORITY)) {
+            if (draw_prefs.priority) {
                 g_string_append_printf(msg, " %d", resource->priority);
             }
 
-            char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-            if ((g_strcmp0(unreadpos, "after") == 0) && unread > 0) {
+            if ((g_strcmp0(draw_prefs.unreadpos, "after") == 0) && unread > 0) {
                 g_string_append_printf(msg, " (%d)", unread);
             }
-            g_free(unreadpos);
 
-            gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
-            win_sub_print(layout->subwin, msg->str, FALSE, wrap, 0);
+            gboolean wrap = draw_prefs.wrap;
+            _rosterwin_row_print(msg->str, FALSE, wrap, 0);
             g_string_free(msg, TRUE);
-            wattroff(layout->subwin, theme_attrs(resource_presence_colour));
+            _rosterwin_row_attroff(theme_attrs(resource_presence_colour));
 
-            if (prefs_get_boolean(PREF_ROSTER_PRESENCE) || prefs_get_boolean(PREF_ROSTER_STATUS)) {
+            if (draw_prefs.presence || draw_prefs.status) {
                 _rosterwin_presence(layout, resource_presence, resource->status, current_indent);
             }
 
             // resource(s) on new lines
         } else {
-            gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+            gboolean wrap = draw_prefs.wrap;
 
-            char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-            if ((g_strcmp0(unreadpos, "after") == 0) && unread > 0) {
+            if ((g_strcmp0(draw_prefs.unreadpos, "after") == 0) && unread > 0) {
                 GString* unreadmsg = g_string_new("");
                 g_string_append_printf(unreadmsg, " (%d)", unread);
 
                 const char* presence = p_contact_presence(contact);
                 theme_item_t presence_colour = _get_roster_theme(theme_type, presence);
 
-                wattron(layout->subwin, theme_attrs(presence_colour));
-                win_sub_print(layout->subwin, unreadmsg->str, FALSE, wrap, current_indent);
+                _rosterwin_row_attron(theme_attrs(presence_colour));
+                _rosterwin_row_print(unreadmsg->str, FALSE, wrap, current_indent);
                 g_string_free(unreadmsg, TRUE);
-                wattroff(layout->subwin, theme_attrs(presence_colour));
+                _rosterwin_row_attroff(theme_attrs(presence_colour));
             }
-            g_free(unreadpos);
 
-            int resource_indent = prefs_get_roster_resource_indent();
+            int resource_indent = draw_prefs.resource_indent;
             if (resource_indent > 0) {
                 current_indent += resource_indent;
             }
@@ -586,68 +698,62 @@ _rosterwin_resources(ProfLayoutSplit* layout, PContact contact, int current_inde
                 const char* resource_presence = string_from_resource_presence(resource->presence);
                 theme_item_t resource_presence_colour = _get_roster_theme(ROSTER_CONTACT, resource_presence);
 
-                wattron(layout->subwin, theme_attrs(resource_presence_colour));
+                _rosterwin_row_attron(theme_attrs(resource_presence_colour));
                 GString* msg = g_string_new(" ");
                 int this_indent = current_indent;
                 while (this_indent > 0) {
                     g_string_append(msg, " ");
                     this_indent--;
                 }
-                char* ch = prefs_get_roster_resource_char();
-                if (ch) {
-                    g_string_append_printf(msg, "%s", ch);
-                    free(ch);
+                if (draw_prefs.resource_char) {
+                    g_string_append(msg, draw_prefs.resource_char);
                 }
                 g_string_append(msg, resource->name);
-                if (prefs_get_boolean(PREF_ROSTER_PRIORITY)) {
+                if (draw_prefs.priority) {
                     g_string_append_printf(msg, " %d", resource->priority);
                 }
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+                _rosterwin_row_newline();
+                _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
                 g_string_free(msg, TRUE);
-                wattroff(layout->subwin, theme_attrs(resource_presence_colour));
+                _rosterwin_row_attroff(theme_attrs(resource_presence_colour));
 
-                if (prefs_get_boolean(PREF_ROSTER_PRESENCE) || prefs_get_boolean(PREF_ROSTER_STATUS)) {
+                if (draw_prefs.presence || draw_prefs.status) {
                     _rosterwin_presence(layout, resource_presence, resource->status, current_indent);
                 }
 
                 curr_resource = g_list_next(curr_resource);
             }
         }
-    } else if (prefs_get_boolean(PREF_ROSTER_PRESENCE) || prefs_get_boolean(PREF_ROSTER_STATUS)) {
+    } else if (draw_prefs.presence || draw_prefs.status) {
         const char* presence = p_contact_presence(contact);
         const char* status = p_contact_status(contact);
         theme_item_t presence_colour = _get_roster_theme(theme_type, presence);
-        gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+        gboolean wrap = draw_prefs.wrap;
 
-        char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-        if ((g_strcmp0(unreadpos, "after") == 0) && unread > 0) {
+        if ((g_strcmp0(draw_prefs.unreadpos, "after") == 0) && unread > 0) {
             GString* unreadmsg = g_string_new("");
             g_string_append_printf(unreadmsg, " (%d)", unread);
 
-            wattron(layout->subwin, theme_attrs(presence_colour));
-            win_sub_print(layout->subwin, unreadmsg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_attron(theme_attrs(presence_colour));
+            _rosterwin_row_print(unreadmsg->str, FALSE, wrap, current_indent);
             g_string_free(unreadmsg, TRUE);
-            wattroff(layout->subwin, theme_attrs(presence_colour));
+            _rosterwin_row_attroff(theme_attrs(presence_colour));
         }
-        g_free(unreadpos);
         _rosterwin_presence(layout, presence, status, current_indent);
     } else {
-        gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+        gboolean wrap = draw_prefs.wrap;
 
-        char* unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
-        if ((g_strcmp0(unreadpos, "after") == 0) && unread > 0) {
+        if ((g_strcmp0(draw_prefs.unreadpos, "after") == 0) && unread > 0) {
             GString* unreadmsg = g_string_new("");
             g_string_append_printf(unreadmsg, " (%d)", unread);
             const char* presence = p_contact_presence(contact);
             theme_item_t presence_colour = _get_roster_theme(theme_type, presence);
 
-            wattron(layout->subwin, theme_attrs(presence_colour));
-            win_sub_print(layout->subwin, unreadmsg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_attron(theme_attrs(presence_colour));
+            _rosterwin_row_print(unreadmsg->str, FALSE, wrap, current_indent);
             g_string_free(unreadmsg, TRUE);
-            wattroff(layout->subwin, theme_attrs(presence_colour));
+            _rosterwin_row_attroff(theme_attrs(presence_colour));
         }
-        g_free(unreadpos);
     }
 
     g_list_free(resources);
@@ -735,16 +841,18 @@ _rosterwin_rooms_by_service(ProfLayoutSplit* layout)
 static void
 _rosterwin_room(ProfLayoutSplit* layout, ProfMucWin* mucwin)
 {
+    _rosterwin_row_begin("room", mucwin->roomjid);
+
     GString* msg = g_string_new(" ");
 
     if (mucwin->unread_mentions) {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_MENTION));
+        _rosterwin_row_attron(theme_attrs(THEME_ROSTER_ROOM_MENTION));
     } else if (mucwin->unread_triggers) {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_TRIGGER));
+        _rosterwin_row_attron(theme_attrs(THEME_ROSTER_ROOM_TRIGGER));
     } else if (mucwin->unread > 0) {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_UNREAD));
+        _rosterwin_row_attron(theme_attrs(THEME_ROSTER_ROOM_UNREAD));
     } else {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_ROOM));
+        _rosterwin_row_attron(theme_attrs(THEME_ROSTER_ROOM));
     }
 
     int indent = prefs_get_roster_contact_indent();
@@ -808,19 +916,19 @@ _rosterwin_room(ProfLayoutSplit* layout, ProfMucWin* mucwin)
     }
     g_free(unreadpos);
 
-    win_sub_newline_lazy(layout->subwin);
+    _rosterwin_row_newline();
     gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
-    win_sub_print(layout->subwin, msg->str, FALSE, wrap, current_indent);
+    _rosterwin_row_print(msg->str, FALSE, wrap, current_indent);
     g_string_free(msg, TRUE);
 
     if (mucwin->unread_mentions) {
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_MENTION));
+        _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_ROOM_MENTION));
     } else if (mucwin->unread_triggers) {
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_TRIGGER));
+        _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_ROOM_TRIGGER));
     } else if (mucwin->unread > 0) {
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_ROOM_UNREAD));
+        _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_ROOM_UNREAD));
     } else {
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_ROOM));
+        _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_ROOM));
     }
 
     char* privpref = prefs_get_string(PREF_ROSTER_PRIVATE);
@@ -829,7 +937,7 @@ _rosterwin_room(ProfLayoutSplit* layout, ProfMucWin* mucwin)
         GList* curr = privs;
         while (curr) {
             ProfPrivateWin* privwin = curr->data;
-            win_sub_newline_lazy(layout->subwin);
+            _rosterwin_row_newline();
 
             GString* privmsg = g_string_new(" ");
             indent = prefs_get_roster_contact_indent();
@@ -885,9 +993,9 @@ _rosterwin_room(ProfLayoutSplit* layout, ProfMucWin* mucwin)
                 colour = _get_roster_theme(ROSTER_CONTACT_ACTIVE, presence);
             }
 
-            wattron(layout->subwin, theme_attrs(colour));
-            win_sub_print(layout->subwin, privmsg->str, FALSE, wrap, current_indent);
-            wattroff(layout->subwin, theme_attrs(colour));
+            _rosterwin_row_attron(theme_attrs(colour));
+            _rosterwin_row_print(privmsg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_attroff(theme_attrs(colour));
 
             g_string_free(privmsg, TRUE);
             curr = g_list_next(curr);
@@ -935,7 +1043,8 @@ _rosterwin_private_chats(ProfLayoutSplit* layout, GList* orphaned_privchats)
         GList* curr = privs;
         while (curr) {
             ProfPrivateWin* privwin = curr->data;
-            win_sub_newline_lazy(layout->subwin);
+            _rosterwin_row_begin("private", privwin->fulljid);
+            _rosterwin_row_newline();
 
             GString* privmsg = g_string_new(" ");
             int indent = prefs_get_roster_contact_indent();
@@ -984,9 +1093,9 @@ _rosterwin_private_chats(ProfLayoutSplit* layout, GList* orphaned_privchats)
 
             gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
 
-            wattron(layout->subwin, theme_attrs(colour));
-            win_sub_print(layout->subwin, privmsg->str, FALSE, wrap, current_indent);
-            wattroff(layout->subwin, theme_attrs(colour));
+            _rosterwin_row_attron(theme_attrs(colour));
+            _rosterwin_row_print(privmsg->str, FALSE, wrap, current_indent);
+            _rosterwin_row_attroff(theme_attrs(colour));
 
             g_string_free(privmsg, TRUE);
             curr = g_list_next(curr);
@@ -1032,7 +1141,8 @@ _compare_rooms_unread(ProfMucWin* a, ProfMucWin* b)
 static void
 _rosterwin_unsubscribed_header(ProfLayoutSplit* layout, GList* wins)
 {
-    win_sub_newline_lazy(layout->subwin);
+    _rosterwin_row_begin("header", "Unsubscribed");
+    _rosterwin_row_newline();
 
     GString* header = g_string_new(" ");
     char* ch = prefs_get_roster_header_char();
@@ -1069,9 +1179,9 @@ _rosterwin_unsubscribed_header(ProfLayoutSplit* layout, GList* wins)
 
     gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
 
-    wattron(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-    win_sub_print(layout->subwin, header->str, FALSE, wrap, 1);
-    wattroff(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_attron(theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_print(header->str, FALSE, wrap, 1);
+    _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_HEADER));
 
     g_string_free(header, TRUE);
 }
@@ -1079,52 +1189,47 @@ _rosterwin_unsubscribed_header(ProfLayoutSplit* layout, GList* wins)
 static void
 _rosterwin_contacts_header(ProfLayoutSplit* layout, const char* const title, GSList* contacts)
 {
-    win_sub_newline_lazy(layout->subwin);
+    _rosterwin_row_begin("header", title);
+    _rosterwin_row_newline();
 
     GString* header = g_string_new(" ");
-    char* ch = prefs_get_roster_header_char();
-    if (ch) {
-        g_string_append_printf(header, "%s", ch);
-        free(ch);
+    if (draw_prefs.header_char) {
+        g_string_append(header, draw_prefs.header_char);
     }
 
     g_string_append(header, title);
 
-    char* countpref = prefs_get_string(PREF_ROSTER_COUNT);
-    if (g_strcmp0(countpref, "items") == 0) {
+    if (g_strcmp0(draw_prefs.countpref, "items") == 0) {
         int itemcount = g_slist_length(contacts);
-        if (itemcount == 0 && prefs_get_boolean(PREF_ROSTER_COUNT_ZERO)) {
+        if (itemcount == 0 && draw_prefs.count_zero) {
             g_string_append_printf(header, " (%d)", itemcount);
         } else {
             g_string_append_printf(header, " (%d)", itemcount);
         }
-    } else if (g_strcmp0(countpref, "unread") == 0) {
+    } else if (g_strcmp0(draw_prefs.countpref, "unread") == 0) {
         int unreadcount = 0;
         GSList* curr = contacts;
         while (curr) {
             PContact contact = curr->data;
             const char* barejid = p_contact_barejid(contact);
-            ProfChatWin* chatwin = wins_get_chat(barejid);
+            ProfChatWin* chatwin = _rosterwin_get_chat(barejid);
             if (chatwin) {
                 unreadcount += chatwin->unread;
             }
             curr = g_slist_next(curr);
         }
-        if (unreadcount == 0 && prefs_get_boolean(PREF_ROSTER_COUNT_ZERO)) {
+        if (unreadcount == 0 && draw_prefs.count_zero) {
             g_string_append_printf(header, " (%d)", unreadcount);
         } else if (unreadcount > 0) {
             g_string_append_printf(header, " (%d)", unreadcount);
         }
     }
-    g_free(countpref);
 
-    gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+    gboolean wrap = draw_prefs.wrap;
 
-    if (layout->subwin != NULL) {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-        win_sub_print(layout->subwin, header->str, FALSE, wrap, 1);
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-    }
+    _rosterwin_row_attron(theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_print(header->str, FALSE, wrap, 1);
+    _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_HEADER));
 
     g_string_free(header, TRUE);
 }
@@ -1132,7 +1237,8 @@ _rosterwin_contacts_header(ProfLayoutSplit* layout, const char* const title, GSL
 static void
 _rosterwin_rooms_header(ProfLayoutSplit* layout, GList* rooms, char* title)
 {
-    win_sub_newline_lazy(layout->subwin);
+    _rosterwin_row_begin("rooms", title);
+    _rosterwin_row_newline();
     GString* header = g_string_new(" ");
     char* ch = prefs_get_roster_header_char();
     if (ch) {
@@ -1183,11 +1289,9 @@ _rosterwin_rooms_header(ProfLayoutSplit* layout, GList* rooms, char* title)
 
     gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
 
-    if (layout->subwin != NULL) {
-        wattron(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-        win_sub_print(layout->subwin, header->str, FALSE, wrap, 1);
-        wattroff(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-    }
+    _rosterwin_row_attron(theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_print(header->str, FALSE, wrap, 1);
+    _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_HEADER));
 
     g_string_free(header, TRUE);
 }
@@ -1195,7 +1299,8 @@ _rosterwin_rooms_header(ProfLayoutSplit* layout, GList* rooms, char* title)
 static void
 _rosterwin_private_header(ProfLayoutSplit* layout, GList* privs)
 {
-    win_sub_newline_lazy(layout->subwin);
+    _rosterwin_row_begin("header", "Private chats");
+    _rosterwin_row_newline();
 
     GString* title_str = g_string_new(" ");
     char* ch = prefs_get_roster_header_char();
@@ -1231,9 +1336,9 @@ _rosterwin_private_header(ProfLayoutSplit* layout, GList* privs)
 
     gboolean wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
 
-    wattron(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
-    win_sub_print(layout->subwin, title_str->str, FALSE, wrap, 1);
-    wattroff(layout->subwin, theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_attron(theme_attrs(THEME_ROSTER_HEADER));
+    _rosterwin_row_print(title_str->str, FALSE, wrap, 1);
+    _rosterwin_row_attroff(theme_attrs(THEME_ROSTER_HEADER));
 
     g_string_free(title_str, TRUE);
 }
@@ -1241,77 +1346,345 @@ _rosterwin_private_header(ProfLayoutSplit* layout, GList* privs)
 static GSList*
 _filter_contacts(GSList* contacts)
 {
-    GSList* filtered_contacts = NULL;
-
     // if show offline, include all contacts
-    if (prefs_get_boolean(PREF_ROSTER_OFFLINE)) {
-        GSList* curr = contacts;
-        while (curr) {
-            filtered_contacts = g_slist_append(filtered_contacts, curr->data);
-            curr = g_slist_next(curr);
-        }
-        // if dont show offline
-    } else {
-        GSList* curr = contacts;
-        while (curr) {
-            PContact contact = curr->data;
-            const char* presence = p_contact_presence(contact);
+    if (draw_prefs.offline) {
+        return g_slist_copy(contacts);
+    }
 
-            // include if offline and unread messages
-            if (g_strcmp0(presence, "offline") == 0) {
-                ProfChatWin* chatwin = wins_get_chat(p_contact_barejid(contact));
-                if (chatwin && chatwin->unread > 0) {
-                    filtered_contacts = g_slist_append(filtered_contacts, contact);
-                }
+    GSList* filtered_contacts = NULL;
+    GSList* curr = contacts;
+    while (curr) {
+        PContact contact = curr->data;
+        const char* presence = p_contact_presence(contact);
 
-                // include if not offline
-            } else {
-                filtered_contacts = g_slist_append(filtered_contacts, contact);
+        // include if offline and unread messages
+        if (g_strcmp0(presence, "offline") == 0) {
+            ProfChatWin* chatwin = _rosterwin_get_chat(p_contact_barejid(contact));
+            if (chatwin && chatwin->unread > 0) {
+                filtered_contacts = g_slist_prepend(filtered_contacts, contact);
             }
-            curr = g_slist_next(curr);
+
+            // include if not offline
+        } else {
+            filtered_contacts = g_slist_prepend(filtered_contacts, contact);
         }
+        curr = g_slist_next(curr);
     }
 
-    return filtered_contacts;
+    return g_slist_reverse(filtered_contacts);
 }
 
 static GSList*
 _filter_contacts_with_presence(GSList* contacts, const char* const presence)
 {
+    // any presence other than offline, or if show offline, include all contacts
+    if (g_strcmp0(presence, "offline") != 0 || draw_prefs.offline) {
+        return g_slist_copy(contacts);
+    }
+
+    // otherwise show offline contacts with unread messages
     GSList* filtered_contacts = NULL;
+    GSList* curr = contacts;
+    while (curr) {
+        PContact contact = curr->data;
+        ProfChatWin* chatwin = _rosterwin_get_chat(p_contact_barejid(contact));
+        if (chatwin && chatwin->unread > 0) {
+            filtered_contacts = g_slist_prepend(filtered_contacts, contact);
+        }
+        curr = g_slist_next(curr);
+    }
 
-    // handling offline contacts
-    if (g_strcmp0(presence, "offline") == 0) {
+    return g_slist_reverse(filtered_contacts);
+}
 
-        // if show offline, include all contacts
-        if (prefs_get_boolean(PREF_ROSTER_OFFLINE)) {
-            GSList* curr = contacts;
-            while (curr) {
-                filtered_contacts = g_slist_append(filtered_contacts, curr->data);
-                curr = g_slist_next(curr);
-            }
+static void
+_rosterwin_draw_begin(void)
+{
+    draw_prefs.wrap = prefs_get_boolean(PREF_ROSTER_WRAP);
+    draw_prefs.color_nick = prefs_get_boolean(PREF_ROSTER_COLOR_NICK);
+    draw_prefs.resource = prefs_get_boolean(PREF_ROSTER_RESOURCE);
+    draw_prefs.resource_join = prefs_get_boolean(PREF_ROSTER_RESOURCE_JOIN);
+    draw_prefs.presence = prefs_get_boolean(PREF_ROSTER_PRESENCE);
+    draw_prefs.status = prefs_get_boolean(PREF_ROSTER_STATUS);
+    draw_prefs.priority = prefs_get_boolean(PREF_ROSTER_PRIORITY);
+    draw_prefs.offline = prefs_get_boolean(PREF_ROSTER_OFFLINE);
+    draw_prefs.empty = prefs_get_boolean(PREF_ROSTER_EMPTY);
+    draw_prefs.count_zero = prefs_get_boolean(PREF_ROSTER_COUNT_ZERO);
+    draw_prefs.contact_indent = prefs_get_roster_contact_indent();
+    draw_prefs.resource_indent = prefs_get_roster_resource_indent();
+    draw_prefs.presence_indent = prefs_get_roster_presence_indent();
+    draw_prefs.contact_char = prefs_get_roster_contact_char();
+    draw_prefs.resource_char = prefs_get_roster_resource_char();
+    draw_prefs.header_char = prefs_get_roster_header_char();
+    draw_prefs.unreadpos = prefs_get_string(PREF_ROSTER_UNREAD);
+    draw_prefs.countpref = prefs_get_string(PREF_ROSTER_COUNT);
 
-            // otherwise show if unread messages
-        } else {
-            GSList* curr = contacts;
-            while (curr) {
-                PContact contact = curr->data;
-                ProfChatWin* chatwin = wins_get_chat(p_contact_barejid(contact));
-                if (chatwin && chatwin->unread > 0) {
-                    filtered_contacts = g_slist_append(filtered_contacts, contact);
-                }
-                curr = g_slist_next(curr);
-            }
+    char* by = prefs_get_string(PREF_ROSTER_BY);
+    draw_prefs.by_presence = g_strcmp0(by, "presence") == 0;
+    g_free(by);
+
+    // one pass over the windows instead of a lookup per contact
+    draw_chatwins = g_hash_table_new(g_str_hash, g_str_equal);
+    GList* chatwins = wins_get_chat_windows();
+    GList* curr = chatwins;
+    while (curr) {
+        ProfChatWin* chatwin = curr->data;
+        g_hash_table_insert(draw_chatwins, chatwin->barejid, chatwin);
+        curr = g_list_next(curr);
+    }
+    g_list_free(chatwins);
+}
+
+static void
+_rosterwin_draw_end(void)
+{
+    free(draw_prefs.contact_char);
+    free(draw_prefs.resource_char);
+    free(draw_prefs.header_char);
+    g_free(draw_prefs.unreadpos);
+    g_free(draw_prefs.countpref);
+    memset(&draw_prefs, 0, sizeof(draw_prefs));
+
+    g_hash_table_destroy(draw_chatwins);
+    draw_chatwins = NULL;
+}
+
+static ProfChatWin*
+_rosterwin_get_chat(const char* const barejid)
+{
+    return g_hash_table_lookup(draw_chatwins, barejid);
+}
+
+static void
+_rosterwin_row_free(RosterRow* row)
+{
+    g_string_free(row->ops, TRUE);
+    free(row->key);
+    free(row);
+}
+
+static gboolean
+_rosterwin_row_stale(gpointer key, gpointer value, gpointer user_data)
+{
+    RosterRow* row = value;
+    return row->generation != roster_generation;
+}
+
+static void
+_rosterwin_rows_begin(int width)
+{
+    if (roster_rows == NULL) {
+        roster_rows = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)_rosterwin_row_free);
+        roster_order = g_ptr_array_new();
+        row_key = g_string_new(NULL);
+        row_ops = g_string_new(NULL);
+    }
+
+    // wrapped heights depend on the width, start over when it changes
+    if (row_measure == NULL || getmaxx(row_measure) != width) {
+        if (row_measure) {
+            delwin(row_measure);
         }
+        row_measure = newpad(PAD_SIZE, width);
+        g_hash_table_remove_all(roster_rows);
+    }
 
-        // any other presence, include all
-    } else {
-        GSList* curr = contacts;
-        while (curr) {
-            filtered_contacts = g_slist_append(filtered_contacts, curr->data);
-            curr = g_slist_next(curr);
+    g_ptr_array_set_size(roster_order, 0);
+    roster_generation++;
+    row_open = FALSE;
+    g_string_truncate(row_ops, 0);
+}
+
+static void
+_rosterwin_rows_end(void)
+{
+    _rosterwin_row_end();
+    g_hash_table_foreach_remove(roster_rows, _rosterwin_row_stale, NULL);
+    roster_rows_changed = TRUE;
+}
+
+static void
+_rosterwin_row_begin(const char* const kind, const char* const id)
+{
+    _rosterwin_row_end();
+    g_string_printf(row_key, "%s:%s", kind, id ? id : "");
+    row_open = TRUE;
+}
+
+static void
+_rosterwin_row_end(void)
+{
+    if (!row_open) {
+        return;
+    }
+    row_open = FALSE;
+
+    // a contact in several groups is listed once per group
+    GString* key = g_string_new(row_key->str);
+    RosterRow* row = g_hash_table_lookup(roster_rows, key->str);
+    int count = 1;
+    while (row && row->generation == roster_generation) {
+        g_string_printf(key, "%s#%d", row_key->str, ++count);
+        row = g_hash_table_lookup(roster_rows, key->str);
+    }
+
+    if (row == NULL) {
+        row = malloc(sizeof(RosterRow));
+        row->key = strdup(key->str);
+        row->ops = g_string_new(NULL);
+        row->height = -1;
+        row->drawn_y = -1;
+        row->dirty = TRUE;
+        g_hash_table_insert(roster_rows, row->key, row);
+    }
+    g_string_free(key, TRUE);
+
+    if (row->height < 0 || row->ops->len != row_ops->len || memcmp(row->ops->str, row_ops->str, row_ops->len) != 0) {
+        GString* swap = row->ops;
+        row->ops = row_ops;
+        row_ops = swap;
+
+        wmove(row_measure, 0, 0);
+        _rosterwin_row_replay(row_measure, row->ops);
+        row->height = getcury(row_measure) + (getcurx(row_measure) > 0 ? 1 : 0);
+        row->dirty = TRUE;
+    }
+    g_string_truncate(row_ops, 0);
+
+    row->generation = roster_generation;
+    g_ptr_array_add(roster_order, row);
+}
+
+static void
+_rosterwin_row_attron(int attrs)
+{
+    g_string_append_c(row_ops, ROW_OP_ATTRON);
+    g_string_append_len(row_ops, (const char*)&attrs, sizeof(attrs));
+}
+
+static void
+_rosterwin_row_attroff(int attrs)
+{
+    g_string_append_c(row_ops, ROW_OP_ATTROFF);
+    g_string_append_len(row_ops, (const char*)&attrs, sizeof(attrs));
+}
+
+static void
+_rosterwin_row_print(char* msg, gboolean newline, gboolean wrap, int indent)
+{
+    char flags = (newline ? ROW_PRINT_NEWLINE : 0) | (wrap ? ROW_PRINT_WRAP : 0);
+
+    g_string_append_c(row_ops, ROW_OP_PRINT);
+    g_string_append_c(row_ops, flags);
+    g_string_append_len(row_ops, (const char*)&indent, sizeof(indent));
+    g_string_append_len(row_ops, msg, strlen(msg) + 1);
+}
+
+static void
+_rosterwin_row_newline(void)
+{
+    g_string_append_c(row_ops, ROW_OP_NEWLINE);
+}
+
+static void
+_rosterwin_row_replay(WINDOW* win, GString* ops)
+{
+    wattrset(win, A_NORMAL);
+
+    const char* curr = ops->str;
+    const char* end = ops->str + ops->len;
+    while (curr < end) {
+        char op = *curr++;
+        int value;
+        switch (op) {
+        case ROW_OP_ATTRON:
+            memcpy(&value, curr, sizeof(value));
+            curr += sizeof(value);
+            wattron(win, value);
+            break;
+        case ROW_OP_ATTROFF:
+            memcpy(&value, curr, sizeof(value));
+            curr += sizeof(value);
+            wattroff(win, value);
+            break;
+        case ROW_OP_PRINT:
+        {
+            char flags = *curr++;
+            memcpy(&value, curr, sizeof(value));
+            curr += sizeof(value);
+            char* msg = (char*)curr;
+            curr += strlen(msg) + 1;
+            win_sub_print(win, msg, flags & ROW_PRINT_NEWLINE, flags & ROW_PRINT_WRAP, value);
+            break;
+        }
+        case ROW_OP_NEWLINE:
+            win_sub_newline_lazy(win);
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+// lay the rows out from their cached heights and draw those in the visible
+// slice of the pad that changed or moved since they were last drawn
+static void
+_rosterwin_compose(ProfLayoutSplit* layout)
+{
+    if (roster_order == NULL) {
+        return;
+    }
+
+    WINDOW* win = layout->subwin;
+    int width = getmaxx(win);
+    int top = layout->sub_y_pos;
+
+    if (!roster_rows_changed && win == composed_win && width == composed_width && top == composed_top) {
+        return;
+    }
+
+    if (win != composed_win || width != composed_width) {
+        werase(win);
+        composed_height = 0;
+        for (guint i = 0; i < roster_order->len; i++) {
+            RosterRow* row = g_ptr_array_index(roster_order, i);
+            row->drawn_y = -1;
+        }
+    }
+
+    int bottom = MIN(top + getmaxy(stdscr), PAD_SIZE);
+    int y = 0;
+    for (guint i = 0; i < roster_order->len; i++) {
+        RosterRow* row = g_ptr_array_index(roster_order, i);
+        gboolean visible = row->height > 0 && y < bottom && y + row->height > top;
+
+        if (!visible) {
+            row->drawn_y = -1;
+        } else if (row->dirty || row->drawn_y != y) {
+            for (int line = y; line < y + row->height && line < PAD_SIZE; line++) {
+                wmove(win, line, 0);
+                wclrtoeol(win);
+            }
+            wmove(win, y, 0);
+            _rosterwin_row_replay(win, row->ops);
+            row->drawn_y = y;
+            row->dirty = FALSE;
         }
+
+        y += row->height;
     }
 
-    return filtered_contacts;
+    if (y < composed_height) {
+        wmove(win, y, 0);
+        wclrtobot(win);
+    }
+
+    // paging reads the end of the roster from the cursor
+    wmove(win, MAX(MIN(y, PAD_SIZE) - 1, 0), 0);
+
+    composed_win = win;
+    composed_width = width;
+    composed_top = top;
+    composed_height = y;
+    roster_rows_changed = FALSE;
 }
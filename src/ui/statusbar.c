@@ -69,6 +69,7 @@ typedef struct _status_bar_t
 {
     gchar* time;
     char* prompt;
+    char* progress;
     char* fulljid;
     GHashTable* tabs;
     int current_tab;
@@ -96,6 +97,7 @@ status_bar_init(void)
     statusbar = malloc(sizeof(StatusBar));
     statusbar->time = NULL;
     statusbar->prompt = NULL;
+    statusbar->progress = NULL;
     statusbar->fulljid = NULL;
     statusbar->tabs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_destroy_tab);
     StatusBarTab* console = calloc(1, sizeof(StatusBarTab));
@@ -125,6 +127,9 @@ status_bar_close(void)
         if (statusbar->prompt) {
             free(statusbar->prompt);
         }
+        if (statusbar->progress) {
+            free(statusbar->progress);
+        }
         if (statusbar->fulljid) {
             free(statusbar->fulljid);
         }
@@ -256,6 +261,29 @@ status_bar_clear_prompt(void)
     status_bar_draw();
 }
 
+void
+status_bar_set_progress(const char* const progress)
+{
+    if (statusbar->progress) {
+        free(statusbar->progress);
+        statusbar->progress = NULL;
+    }
+    statusbar->progress = strdup(progress);
+
+    status_bar_draw();
+}
+
+void
+status_bar_clear_progress(void)
+{
+    if (statusbar->progress) {
+        free(statusbar->progress);
+        statusbar->progress = NULL;
+    }
+
+    status_bar_draw();
+}
+
 void
 status_bar_set_fulljid(const char* const fulljid)
 {
@@ -474,6 +502,11 @@ _status_bar_draw_maintext(int pos)
         return;
     }
 
+    if (statusbar->progress) {
+        mvwprintw(statusbar_win, 0, pos, "%s", statusbar->progress);
+        return;
+    }
+
     gboolean stop = FALSE;
 
     if (statusbar->fulljid) {
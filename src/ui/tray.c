@@ -154,6 +154,21 @@ _tray_change_icon(gpointer data)
     return TRUE;
 }
 
+/*
+ * Window activity listener
+ *
+ * Switches the icon as soon as the first message arrives or the last one is read,
+ * instead of waiting for the next timer tick.
+ *
+ */
+static void
+_tray_activity(int unread, int mentions, int attention)
+{
+    if ((unread > 0) != (unread_messages > 0)) {
+        _tray_change_icon(NULL);
+    }
+}
+
 void
 tray_init(void)
 {
@@ -212,12 +227,14 @@ tray_enable(void)
     _tray_change_icon(NULL);
     int interval = prefs_get_tray_timer() * 1000;
     timer = g_timeout_add(interval, _tray_change_icon, NULL);
+    wins_activity_listen(_tray_activity);
 }
 
 void
 tray_disable(void)
 {
     shutting_down = TRUE;
+    wins_activity_unlisten(_tray_activity);
     g_source_remove(timer);
     if (prof_tray) {
         g_clear_object(&prof_tray);
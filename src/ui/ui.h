@@ -146,6 +146,8 @@ void chatwin_unset_incoming_char(ProfChatWin* chatwin);
 void chatwin_set_outgoing_char(ProfChatWin* chatwin, const char* const ch);
 void chatwin_unset_outgoing_char(ProfChatWin* chatwin);
 gboolean chatwin_db_history(ProfChatWin* chatwin, char* start_time, char* end_time, gboolean flip);
+void chatwin_mam_history_done(ProfChatWin* chatwin, const char* const end_time);
+void chatwin_show_pending_history(ProfChatWin* chatwin);
 
 // MUC window
 ProfMucWin* mucwin_new(const char* const barejid);
@@ -229,6 +231,11 @@ char* confwin_get_string(ProfConfWin* confwin);
 
 // xml console
 void xmlwin_show(ProfXMLWin* xmlwin, const char* const msg);
+void xmlwin_show_pending(ProfXMLWin* xmlwin);
+void xmlwin_set_filter(ProfXMLWin* xmlwin, const char* const kind, const char* const value);
+void xmlwin_show_filters(ProfXMLWin* xmlwin, ProfWin* window);
+gboolean xmlwin_capture_start(ProfXMLWin* xmlwin, const char* const path);
+void xmlwin_capture_stop(ProfXMLWin* xmlwin);
 char* xmlwin_get_string(ProfXMLWin* xmlwin);
 
 // vCard window
@@ -362,9 +369,13 @@ void status_bar_inactive(const int win);
 void status_bar_active(const int win, win_type_t wintype, char* identifier);
 void status_bar_new(const int win, win_type_t wintype, char* identifier);
 void status_bar_set_all_inactive(void);
+void status_bar_set_progress(const char* const progress);
+void status_bar_clear_progress(void);
 
 // roster window
 void rosterwin_roster(void);
+void rosterwin_roster_flush(void);
+void rosterwin_roster_reset(void);
 
 // occupants window
 void occupantswin_occupants(const char* const room);
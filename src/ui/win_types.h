@@ -181,6 +181,9 @@ typedef struct prof_chat_win_t
     char* last_message;
     char* last_msg_id;
     gboolean has_attention;
+    // MAM catch-up finished while the window was not focused
+    gboolean mam_history_pending;
+    char* mam_history_end;
 } ProfChatWin;
 
 typedef struct prof_muc_win_t
@@ -231,6 +234,16 @@ typedef struct prof_private_win_t
 typedef struct prof_xml_win_t
 {
     ProfWin window;
+    // raw stanzas, oldest first, only the ones shown are printed to the window
+    GQueue* stanzas;
+    gsize stanzas_size;
+    // newest stanzas not printed yet, the window is only drawn while visible
+    guint pending;
+    char* filter_element;
+    char* filter_ns;
+    char* filter_jid;
+    FILE* capture;
+    char* capture_path;
     unsigned long memcheck;
 } ProfXMLWin;
 
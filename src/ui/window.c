@@ -55,6 +55,8 @@
 #include "log.h"
 #include "config/theme.h"
 #include "config/preferences.h"
+#include "tools/stats.h"
+#include "tools/timestamp.h"
 #include "ui/ui.h"
 #include "ui/window.h"
 #include "ui/screen.h"
@@ -161,6 +163,8 @@ win_create_chat(const char* const barejid)
     new_win->last_message = NULL;
     new_win->last_msg_id = NULL;
     new_win->has_attention = FALSE;
+    new_win->mam_history_pending = FALSE;
+    new_win->mam_history_end = NULL;
     new_win->memcheck = PROFCHATWIN_MEMCHECK;
 
     return &new_win->window;
@@ -261,6 +265,14 @@ win_create_xmlconsole(void)
     ProfXMLWin* new_win = malloc(sizeof(ProfXMLWin));
     new_win->window.type = WIN_XML;
     new_win->window.layout = _win_create_simple_layout();
+    new_win->stanzas = g_queue_new();
+    new_win->stanzas_size = 0;
+    new_win->pending = 0;
+    new_win->filter_element = NULL;
+    new_win->filter_ns = NULL;
+    new_win->filter_jid = NULL;
+    new_win->capture = NULL;
+    new_win->capture_path = NULL;
 
     new_win->memcheck = PROFXMLWIN_MEMCHECK;
 
@@ -553,6 +565,9 @@ win_show_subwin(ProfWin* window)
     layout->subwin = newpad(PAD_SIZE, subwin_cols);
     wbkgd(layout->subwin, theme_attrs(THEME_TEXT));
     wresize(layout->base.win, PAD_SIZE, cols - subwin_cols);
+    if (window->type == WIN_CONSOLE) {
+        rosterwin_roster_reset();
+    }
     win_redraw(window);
 }
 
@@ -583,6 +598,7 @@ win_free(ProfWin* window)
         free(chatwin->outgoing_char);
         free(chatwin->last_message);
         free(chatwin->last_msg_id);
+        g_free(chatwin->mam_history_end);
         chat_state_free(chatwin->state);
         break;
     }
@@ -617,6 +633,16 @@ win_free(ProfWin* window)
         free(pluginwin->plugin_name);
         break;
     }
+    case WIN_XML:
+    {
+        ProfXMLWin* xmlwin = (ProfXMLWin*)window;
+        xmlwin_capture_stop(xmlwin);
+        g_queue_free_full(xmlwin->stanzas, free);
+        free(xmlwin->filter_element);
+        free(xmlwin->filter_ns);
+        free(xmlwin->filter_jid);
+        break;
+    }
     default:
         break;
     }
@@ -707,6 +733,9 @@ win_sub_page_down(ProfWin* window)
     if (window->layout->type == LAYOUT_SPLIT) {
         int rows = getmaxy(stdscr);
         int page_space = rows - 4;
+        if (window->type == WIN_CONSOLE) {
+            rosterwin_roster_flush();
+        }
         ProfLayoutSplit* split_layout = (ProfLayoutSplit*)window->layout;
         int sub_y = getcury(split_layout->subwin);
         int* sub_y_pos = &(split_layout->sub_y_pos);
@@ -807,6 +836,10 @@ win_update_virtual(ProfWin* window)
     int row_end = screen_mainwin_row_end();
     if (window->layout->type == LAYOUT_SPLIT) {
         ProfLayoutSplit* layout = (ProfLayoutSplit*)window->layout;
+        // roster changes are drawn once, when the console is next shown
+        if (window->type == WIN_CONSOLE) {
+            rosterwin_roster_flush();
+        }
         if (layout->subwin) {
             int subwin_cols = 0;
             if (window->type == WIN_MUC) {
@@ -849,6 +882,7 @@ win_refresh_with_subwin(ProfWin* window)
         subwin_cols = win_occpuants_cols();
     } else if (window->type == WIN_CONSOLE) {
         subwin_cols = win_roster_cols();
+        rosterwin_roster_flush();
     } else {
         // Other window types don't support subwindows, we shouldn't be here
         return;
@@ -1490,6 +1524,10 @@ win_print_history(ProfWin* window, const ProfMessage* const message)
 
     if (g_strcmp0(jidp->barejid, message->from_jid->barejid) == 0) {
         display_name = strdup("me");
+    } else if (window->type == WIN_MUC && message->from_jid->resourcepart) {
+        // occupants are logged with their nick as resource
+        display_name = strdup(message->from_jid->resourcepart);
+        flags = NO_ME;
     } else {
         display_name = roster_get_msg_display_name(message->from_jid->barejid, message->from_jid->resourcepart);
         flags = NO_ME;
@@ -1759,51 +1797,76 @@ _win_printf(ProfWin* window, const char* show_char, int pad_indent, GDateTime* t
     va_end(arg);
 }
 
-static void
-_win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDateTime* time,
-                    int flags, theme_item_t theme_item, const char* const from, const char* const message, DeliveryReceipt* receipt)
+// time formats are looked up for every printed line, keep them until the preferences change
+static const char*
+_win_get_time_pref(ProfWin* window)
 {
-    // flags : 1st bit =  0/1 - me/not me. define: NO_ME
-    //         2nd bit =  0/1 - date/no date. define: NO_DATE
-    //         3rd bit =  0/1 - eol/no eol. define: NO_EOL
-    //         4th bit =  0/1 - color from/no color from. define: NO_COLOUR_FROM
-    //         5th bit =  0/1 - color date/no date. define: NO_COLOUR_DATE
-    //         6th bit =  0/1 - trusted/untrusted. define: UNTRUSTED
-    gboolean me_message = FALSE;
-    int offset = 0;
-    int colour = theme_attrs(THEME_ME);
-    size_t indent = 0;
+    static GHashTable* time_prefs = NULL;
+    static guint time_prefs_generation = 0;
+
+    if (time_prefs == NULL) {
+        time_prefs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    }
+    if (time_prefs_generation != prefs_get_generation()) {
+        g_hash_table_remove_all(time_prefs);
+        time_prefs_generation = prefs_get_generation();
+    }
 
-    char* time_pref = NULL;
+    preference_t pref;
     switch (window->type) {
     case WIN_CHAT:
-        time_pref = prefs_get_string(PREF_TIME_CHAT);
+        pref = PREF_TIME_CHAT;
         break;
     case WIN_MUC:
-        time_pref = prefs_get_string(PREF_TIME_MUC);
+        pref = PREF_TIME_MUC;
         break;
     case WIN_CONFIG:
-        time_pref = prefs_get_string(PREF_TIME_CONFIG);
+        pref = PREF_TIME_CONFIG;
         break;
     case WIN_PRIVATE:
-        time_pref = prefs_get_string(PREF_TIME_PRIVATE);
+        pref = PREF_TIME_PRIVATE;
         break;
     case WIN_XML:
-        time_pref = prefs_get_string(PREF_TIME_XMLCONSOLE);
+        pref = PREF_TIME_XMLCONSOLE;
         break;
     default:
-        time_pref = prefs_get_string(PREF_TIME_CONSOLE);
+        pref = PREF_TIME_CONSOLE;
         break;
     }
 
-    gchar* date_fmt = NULL;
-    if (g_strcmp0(time_pref, "off") == 0 || time == NULL) {
-        date_fmt = g_strdup("");
-    } else {
-        date_fmt = g_date_time_format(time, time_pref);
+    gpointer key = GINT_TO_POINTER(pref);
+    char* time_pref = g_hash_table_lookup(time_prefs, key);
+    if (time_pref == NULL && !g_hash_table_contains(time_prefs, key)) {
+        time_pref = prefs_get_string(pref);
+        g_hash_table_insert(time_prefs, key, time_pref);
+    }
+
+    return time_pref;
+}
+
+static void
+_win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDateTime* time,
+                    int flags, theme_item_t theme_item, const char* const from, const char* const message, DeliveryReceipt* receipt)
+{
+    // flags : 1st bit =  0/1 - me/not me. define: NO_ME
+    //         2nd bit =  0/1 - date/no date. define: NO_DATE
+    //         3rd bit =  0/1 - eol/no eol. define: NO_EOL
+    //         4th bit =  0/1 - color from/no color from. define: NO_COLOUR_FROM
+    //         5th bit =  0/1 - color date/no date. define: NO_COLOUR_DATE
+    //         6th bit =  0/1 - trusted/untrusted. define: UNTRUSTED
+    gboolean me_message = FALSE;
+    int offset = 0;
+    int colour = theme_attrs(THEME_ME);
+    size_t indent = 0;
+
+    const char* time_pref = _win_get_time_pref(window);
+    const char* date_fmt = "";
+    if (time != NULL && time_pref != NULL && g_strcmp0(time_pref, "off") != 0) {
+        date_fmt = timestamp_format(time, time_pref);
+        if (date_fmt == NULL) {
+            date_fmt = "";
+        }
     }
-    g_free(time_pref);
-    assert(date_fmt != NULL);
 
     if (strlen(date_fmt) != 0) {
         indent = 3 + strlen(date_fmt);
@@ -1890,8 +1953,6 @@ _win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDat
             wattroff(window->layout->win, theme_attrs(theme_item));
         }
     }
-
-    g_free(date_fmt);
 }
 
 static void
@@ -2036,6 +2097,7 @@ win_print_trackbar(ProfWin* window)
 void
 win_redraw(ProfWin* window)
 {
+    gint64 start = stats_start();
     int size;
     werase(window->layout->win);
     size = buffer_size(window->layout->buffer);
@@ -2051,6 +2113,7 @@ win_redraw(ProfWin* window)
             _win_print_internal(window, e->show_char, e->pad_indent, e->time, e->flags, e->theme_item, e->display_from, e->message, e->receipt);
         }
     }
+    stats_end(PROF_STATS_WIN_REDRAW, start);
 }
 
 void
@@ -2065,7 +2128,7 @@ win_print_loading_history(ProfWin* window)
         timestamp = g_date_time_new_now_local();
     }
 
-    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, LOADING_MESSAGE, NULL, NULL);
+    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, LOADING_MESSAGE, NULL, LOADING_MESSAGE_ID);
 
     if (is_buffer_empty)
         g_date_time_unref(timestamp);
@@ -2073,6 +2136,17 @@ win_print_loading_history(ProfWin* window)
     win_redraw(window);
 }
 
+// Remove the "Loading messages ..." line, wherever history or new messages
+// have placed it by now
+void
+win_remove_loading_history(ProfWin* window)
+{
+    ProfBuffEntry* entry = buffer_get_entry_by_id(window->layout->buffer, LOADING_MESSAGE_ID);
+    if (entry && entry->theme_item == THEME_ROOMINFO) {
+        buffer_remove_entry_by_id(window->layout->buffer, LOADING_MESSAGE_ID);
+    }
+}
+
 gboolean
 win_has_active_subwin(ProfWin* window)
 {
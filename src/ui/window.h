@@ -58,6 +58,8 @@
 
 #define PAD_SIZE        1000
 #define LOADING_MESSAGE "Loading older messages…"
+// buffer entry id of the loading line, so it can be removed wherever it ended up
+#define LOADING_MESSAGE_ID "prof-loading-history"
 
 void win_move_to_end(ProfWin* window);
 void win_show_status_string(ProfWin* window, const char* const from,
@@ -79,6 +81,7 @@ void win_print_http_transfer(ProfWin* window, const char* const message, char* u
 void win_newline(ProfWin* window);
 void win_redraw(ProfWin* window);
 void win_print_loading_history(ProfWin* window);
+void win_remove_loading_history(ProfWin* window);
 int win_roster_cols(void);
 int win_occpuants_cols(void);
 void win_sub_print(WINDOW* win, char* msg, gboolean newline, gboolean wrap, int indent);
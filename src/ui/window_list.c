@@ -50,7 +50,7 @@
 #include "ui/window_list.h"
 #include "xmpp/xmpp.h"
 #include "xmpp/roster_list.h"
-#include "tools/http_upload.h"
+#include "tools/http_transfer.h"
 
 #ifdef HAVE_OMEMO
 #include "omemo/omemo.h"
@@ -61,8 +61,17 @@ static int current;
 static Autocomplete wins_ac;
 static Autocomplete wins_close_ac;
 
+// activity totals over all windows, updated as messages arrive and windows
+// are focussed or closed so they never need a scan of all windows
+static int total_unread = 0;
+static int total_mentions = 0;
+static int total_attention = 0;
+static GSList* activity_listeners = NULL;
+
 static int _wins_cmp_num(gconstpointer a, gconstpointer b);
 static int _wins_get_next_available_num(GList* used);
+static void _wins_activity_changed(void);
+static void _wins_activity_remove(ProfWin* window);
 
 void
 wins_init(void)
@@ -73,6 +82,9 @@ wins_init(void)
     g_hash_table_insert(windows, GINT_TO_POINTER(1), console);
 
     current = 1;
+    total_unread = 0;
+    total_mentions = 0;
+    total_attention = 0;
 
     wins_ac = autocomplete_new();
     autocomplete_add(wins_ac, "console");
@@ -146,6 +158,25 @@ wins_get_chat_unsubscribed(void)
     return result;
 }
 
+GList*
+wins_get_chat_windows(void)
+{
+    GList* result = NULL;
+    GList* values = g_hash_table_get_values(windows);
+    GList* curr = values;
+
+    while (curr) {
+        ProfWin* window = curr->data;
+        if (window->type == WIN_CHAT) {
+            result = g_list_prepend(result, window);
+        }
+        curr = g_list_next(curr);
+    }
+
+    g_list_free(values);
+    return result;
+}
+
 ProfConfWin*
 wins_get_conf(const char* const roomjid)
 {
@@ -345,22 +376,32 @@ wins_set_current_by_num(int i)
     ProfWin* window = g_hash_table_lookup(windows, GINT_TO_POINTER(i));
     if (window) {
         current = i;
+        int unread = total_unread;
         if (window->type == WIN_CHAT) {
             ProfChatWin* chatwin = (ProfChatWin*)window;
             assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
+            total_unread -= chatwin->unread;
             chatwin->unread = 0;
             plugins_on_chat_win_focus(chatwin->barejid);
         } else if (window->type == WIN_MUC) {
             ProfMucWin* mucwin = (ProfMucWin*)window;
             assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
+            total_unread -= mucwin->unread;
+            if (mucwin->unread_mentions) {
+                total_mentions--;
+            }
             mucwin->unread = 0;
             mucwin->unread_mentions = FALSE;
             mucwin->unread_triggers = FALSE;
             plugins_on_room_win_focus(mucwin->roomjid);
         } else if (window->type == WIN_PRIVATE) {
             ProfPrivateWin* privatewin = (ProfPrivateWin*)window;
+            total_unread -= privatewin->unread;
             privatewin->unread = 0;
         }
+        if (unread != total_unread) {
+            _wins_activity_changed();
+        }
 
         // if we switched to console
         if (current == 0) {
@@ -532,8 +573,8 @@ wins_close_by_num(int i)
 
         ProfWin* window = wins_get_by_num(i);
         if (window) {
-            // cancel upload processes of this window
-            http_upload_cancel_processes(window);
+            // cancel transfers of this window
+            http_transfer_cancel(window);
 
             switch (window->type) {
             case WIN_CHAT:
@@ -599,6 +640,7 @@ wins_close_by_num(int i)
             }
         }
 
+        _wins_activity_remove(window);
         g_hash_table_remove(windows, GINT_TO_POINTER(i));
         status_bar_inactive(i);
     }
@@ -726,6 +768,11 @@ wins_new_vcard(vCard* vcard)
 gboolean
 wins_do_notify_remind(void)
 {
+    // nothing to remind of, and every window would say so
+    if (total_unread == 0) {
+        return FALSE;
+    }
+
     GList* values = g_hash_table_get_values(windows);
     GList* curr = values;
 
@@ -744,17 +791,118 @@ wins_do_notify_remind(void)
 int
 wins_get_total_unread(void)
 {
-    int result = 0;
-    GList* values = g_hash_table_get_values(windows);
-    GList* curr = values;
+    return total_unread;
+}
+
+int
+wins_get_total_mentions(void)
+{
+    return total_mentions;
+}
+
+int
+wins_get_total_attention(void)
+{
+    return total_attention;
+}
+
+void
+wins_add_unread(ProfWin* window, gboolean mention)
+{
+    switch (window->type) {
+    case WIN_CHAT:
+    {
+        ProfChatWin* chatwin = (ProfChatWin*)window;
+        assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
+        chatwin->unread++;
+        break;
+    }
+    case WIN_MUC:
+    {
+        ProfMucWin* mucwin = (ProfMucWin*)window;
+        assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
+        mucwin->unread++;
+        if (mention && !mucwin->unread_mentions) {
+            mucwin->unread_mentions = TRUE;
+            total_mentions++;
+        }
+        break;
+    }
+    case WIN_PRIVATE:
+    {
+        ProfPrivateWin* privatewin = (ProfPrivateWin*)window;
+        assert(privatewin->memcheck == PROFPRIVATEWIN_MEMCHECK);
+        privatewin->unread++;
+        break;
+    }
+    default:
+        return;
+    }
+
+    total_unread++;
+    _wins_activity_changed();
+}
 
+gboolean
+wins_toggle_attention(ProfWin* window)
+{
+    gboolean had_attention = win_has_attention(window);
+    gboolean attention = win_toggle_attention(window);
+    if (attention != had_attention) {
+        total_attention += attention ? 1 : -1;
+        _wins_activity_changed();
+    }
+
+    return attention;
+}
+
+void
+wins_activity_listen(WinsActivityListener listener)
+{
+    if (!g_slist_find(activity_listeners, listener)) {
+        activity_listeners = g_slist_append(activity_listeners, listener);
+    }
+}
+
+void
+wins_activity_unlisten(WinsActivityListener listener)
+{
+    activity_listeners = g_slist_remove(activity_listeners, listener);
+}
+
+static void
+_wins_activity_changed(void)
+{
+    GSList* curr = activity_listeners;
     while (curr) {
-        ProfWin* window = curr->data;
-        result += win_unread(window);
-        curr = g_list_next(curr);
+        WinsActivityListener listener = curr->data;
+        listener(total_unread, total_mentions, total_attention);
+        curr = g_slist_next(curr);
     }
-    g_list_free(values);
-    return result;
+}
+
+static void
+_wins_activity_remove(ProfWin* window)
+{
+    int unread = win_unread(window);
+    gboolean mention = FALSE;
+    if (window->type == WIN_MUC) {
+        mention = ((ProfMucWin*)window)->unread_mentions;
+    }
+    gboolean attention = win_has_attention(window);
+
+    if (unread == 0 && !mention && !attention) {
+        return;
+    }
+
+    total_unread -= unread;
+    if (mention) {
+        total_mentions--;
+    }
+    if (attention) {
+        total_attention--;
+    }
+    _wins_activity_changed();
 }
 
 void
@@ -1168,6 +1316,10 @@ wins_create_summary_attention()
 {
     GSList* result = NULL;
 
+    if (total_attention == 0) {
+        return NULL;
+    }
+
     GList* keys = g_hash_table_get_keys(windows);
     keys = g_list_sort(keys, _wins_cmp_num);
     GList* curr = keys;
@@ -1236,6 +1388,11 @@ void
 wins_destroy(void)
 {
     g_hash_table_destroy(windows);
+    g_slist_free(activity_listeners);
+    activity_listeners = NULL;
+    total_unread = 0;
+    total_mentions = 0;
+    total_attention = 0;
     autocomplete_free(wins_ac);
     autocomplete_free(wins_close_ac);
 }
@@ -1243,6 +1400,10 @@ wins_destroy(void)
 ProfWin*
 wins_get_next_unread(void)
 {
+    if (total_unread == 0) {
+        return NULL;
+    }
+
     // get and sort win nums
     GList* values = g_hash_table_get_keys(windows);
     values = g_list_sort(values, _wins_cmp_num);
@@ -1268,6 +1429,10 @@ wins_get_next_unread(void)
 ProfWin*
 wins_get_next_attention(void)
 {
+    if (total_attention == 0) {
+        return NULL;
+    }
+
     // get and sort win nums
     GList* values = g_hash_table_get_values(windows);
     values = g_list_sort(values, _wins_cmp_num);
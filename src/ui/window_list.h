@@ -38,6 +38,9 @@
 
 #include "ui/ui.h"
 
+// called with the new totals whenever unread, mention or attention counts change
+typedef void (*WinsActivityListener)(int unread, int mentions, int attention);
+
 void wins_init(void);
 
 ProfWin* wins_new_xmlconsole(void);
@@ -57,6 +60,7 @@ void wins_remove_nick(const char* const barejid, const char* const oldnick);
 ProfWin* wins_get_console(void);
 ProfChatWin* wins_get_chat(const char* const barejid);
 GList* wins_get_chat_unsubscribed(void);
+GList* wins_get_chat_windows(void);
 ProfMucWin* wins_get_muc(const char* const roomjid);
 ProfConfWin* wins_get_conf(const char* const roomjid);
 ProfPrivateWin* wins_get_private(const char* const fulljid);
@@ -83,6 +87,12 @@ void wins_close_by_num(int i);
 gboolean wins_is_current(ProfWin* window);
 gboolean wins_do_notify_remind(void);
 int wins_get_total_unread(void);
+int wins_get_total_mentions(void);
+int wins_get_total_attention(void);
+void wins_add_unread(ProfWin* window, gboolean mention);
+gboolean wins_toggle_attention(ProfWin* window);
+void wins_activity_listen(WinsActivityListener listener);
+void wins_activity_unlisten(WinsActivityListener listener);
 void wins_resize_all(void);
 GSList* wins_get_chat_recipients(void);
 GSList* wins_get_prune_wins(void);
@@ -36,28 +36,262 @@
 #include "config.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 
+#include "ui/ui.h"
 #include "ui/win_types.h"
+#include "ui/window.h"
 #include "ui/window_list.h"
 
-void
-xmlwin_show(ProfXMLWin* xmlwin, const char* const msg)
-{
-    assert(xmlwin != NULL);
+// raw stanza bytes kept while the console is open, older ones are dropped
+#define XMLWIN_RING_SIZE (1024 * 1024)
+// stanzas printed at most when the console comes into view, about a few pages
+#define XMLWIN_RENDER_MAX 100
 
-    ProfWin* window = (ProfWin*)xmlwin;
+static void
+_xmlwin_print(ProfWin* window, const char* const msg)
+{
     if (g_str_has_prefix(msg, "SENT:")) {
         win_println(window, THEME_DEFAULT, "-", "SENT:");
         win_println(window, THEME_ONLINE, "-", "%s", &msg[6]);
         win_println(window, THEME_ONLINE, "-", "");
-    } else if (g_str_has_prefix(msg, "RECV:")) {
+    } else {
         win_println(window, THEME_DEFAULT, "-", "RECV:");
         win_println(window, THEME_AWAY, "-", "%s", &msg[6]);
         win_println(window, THEME_AWAY, "-", "");
     }
 }
 
+// <name followed by whitespace, '>' or '/', anywhere in the stanza
+static gboolean
+_xmlwin_has_element(const char* const xml, const char* const name)
+{
+    size_t len = strlen(name);
+    const char* curr = xml;
+    while ((curr = strchr(curr, '<'))) {
+        curr++;
+        if (strncmp(curr, name, len) == 0) {
+            char end = curr[len];
+            if (end == '>' || end == '/' || g_ascii_isspace(end)) {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+// attr='value', with resource also attr='value/...'
+static gboolean
+_xmlwin_has_attribute(const char* const xml, const char* const attr, const char* const value, gboolean resource)
+{
+    size_t attr_len = strlen(attr);
+    size_t value_len = strlen(value);
+    const char* curr = xml;
+    while ((curr = strstr(curr, attr))) {
+        const char* found = curr;
+        curr += attr_len;
+        if (found == xml || !g_ascii_isspace(found[-1]) || *curr != '=') {
+            continue;
+        }
+        char quote = curr[1];
+        if (quote != '\'' && quote != '"') {
+            continue;
+        }
+        const char* val = &curr[2];
+        if (strncmp(val, value, value_len) != 0) {
+            continue;
+        }
+        char end = val[value_len];
+        if (end == quote || (resource && end == '/')) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+_xmlwin_matches(ProfXMLWin* xmlwin, const char* const msg)
+{
+    const char* xml = &msg[6];
+
+    if (xmlwin->filter_element && !_xmlwin_has_element(xml, xmlwin->filter_element)) {
+        return FALSE;
+    }
+    if (xmlwin->filter_ns && !_xmlwin_has_attribute(xml, "xmlns", xmlwin->filter_ns, FALSE)) {
+        return FALSE;
+    }
+    if (xmlwin->filter_jid
+        && !_xmlwin_has_attribute(xml, "from", xmlwin->filter_jid, TRUE)
+        && !_xmlwin_has_attribute(xml, "to", xmlwin->filter_jid, TRUE)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void
+xmlwin_show(ProfXMLWin* xmlwin, const char* const msg)
+{
+    assert(xmlwin != NULL);
+
+    if (!g_str_has_prefix(msg, "SENT:") && !g_str_has_prefix(msg, "RECV:")) {
+        return;
+    }
+
+    if (xmlwin->capture) {
+        if (fprintf(xmlwin->capture, "%s\n\n", msg) < 0 || fflush(xmlwin->capture) != 0) {
+            cons_show_error("XML console capture to %s failed: %s", xmlwin->capture_path, g_strerror(errno));
+            xmlwin_capture_stop(xmlwin);
+        }
+    }
+
+    size_t len = strlen(msg);
+    g_queue_push_tail(xmlwin->stanzas, strdup(msg));
+    xmlwin->stanzas_size += len;
+    xmlwin->pending++;
+
+    while (xmlwin->stanzas_size > XMLWIN_RING_SIZE && g_queue_get_length(xmlwin->stanzas) > 1) {
+        char* oldest = g_queue_pop_head(xmlwin->stanzas);
+        xmlwin->stanzas_size -= strlen(oldest);
+        free(oldest);
+    }
+    xmlwin->pending = MIN(xmlwin->pending, g_queue_get_length(xmlwin->stanzas));
+
+    if (wins_is_current((ProfWin*)xmlwin)) {
+        xmlwin_show_pending(xmlwin);
+    }
+}
+
+// Print the stanzas received while the console was not visible
+void
+xmlwin_show_pending(ProfXMLWin* xmlwin)
+{
+    assert(xmlwin != NULL);
+
+    if (xmlwin->pending == 0) {
+        return;
+    }
+
+    // walk back over the pending stanzas, keeping the newest ones which match
+    GList* first = NULL;
+    guint shown = 0;
+    guint seen = 0;
+    for (GList* curr = g_queue_peek_tail_link(xmlwin->stanzas); curr && seen < xmlwin->pending; curr = g_list_previous(curr)) {
+        seen++;
+        if (_xmlwin_matches(xmlwin, curr->data)) {
+            first = curr;
+            if (++shown == XMLWIN_RENDER_MAX) {
+                break;
+            }
+        }
+    }
+    xmlwin->pending = 0;
+
+    for (GList* curr = first; curr; curr = g_list_next(curr)) {
+        if (_xmlwin_matches(xmlwin, curr->data)) {
+            _xmlwin_print((ProfWin*)xmlwin, curr->data);
+        }
+    }
+}
+
+/*
+ * Only show stanzas matching the filter of kind "element", "ns" or "jid",
+ * a NULL value removes the filter. The console is redrawn from the ring.
+ */
+void
+xmlwin_set_filter(ProfXMLWin* xmlwin, const char* const kind, const char* const value)
+{
+    assert(xmlwin != NULL);
+
+    char** filter = NULL;
+    if (g_strcmp0(kind, "element") == 0) {
+        filter = &xmlwin->filter_element;
+    } else if (g_strcmp0(kind, "ns") == 0) {
+        filter = &xmlwin->filter_ns;
+    } else if (g_strcmp0(kind, "jid") == 0) {
+        filter = &xmlwin->filter_jid;
+    }
+
+    if (filter) {
+        free(*filter);
+        *filter = value ? strdup(value) : NULL;
+    } else if (!kind) {
+        free(xmlwin->filter_element);
+        xmlwin->filter_element = NULL;
+        free(xmlwin->filter_ns);
+        xmlwin->filter_ns = NULL;
+        free(xmlwin->filter_jid);
+        xmlwin->filter_jid = NULL;
+    }
+
+    win_clear((ProfWin*)xmlwin);
+    xmlwin->pending = g_queue_get_length(xmlwin->stanzas);
+    if (wins_is_current((ProfWin*)xmlwin)) {
+        xmlwin_show_pending(xmlwin);
+    }
+}
+
+void
+xmlwin_show_filters(ProfXMLWin* xmlwin, ProfWin* window)
+{
+    assert(xmlwin != NULL);
+
+    if (!xmlwin->filter_element && !xmlwin->filter_ns && !xmlwin->filter_jid) {
+        win_println(window, THEME_DEFAULT, "!", "XML console shows all stanzas.");
+        return;
+    }
+
+    win_println(window, THEME_DEFAULT, "!", "XML console filters:");
+    if (xmlwin->filter_element) {
+        win_println(window, THEME_DEFAULT, "!", "  element : %s", xmlwin->filter_element);
+    }
+    if (xmlwin->filter_ns) {
+        win_println(window, THEME_DEFAULT, "!", "  ns      : %s", xmlwin->filter_ns);
+    }
+    if (xmlwin->filter_jid) {
+        win_println(window, THEME_DEFAULT, "!", "  jid     : %s", xmlwin->filter_jid);
+    }
+}
+
+// Append every stanza, filtered or not, to path until stopped or the console closes
+gboolean
+xmlwin_capture_start(ProfXMLWin* xmlwin, const char* const path)
+{
+    assert(xmlwin != NULL);
+
+    FILE* capture = fopen(path, "a");
+    if (!capture) {
+        return FALSE;
+    }
+    // raw stanzas include the authentication exchange
+    g_chmod(path, S_IRUSR | S_IWUSR);
+
+    xmlwin_capture_stop(xmlwin);
+    xmlwin->capture = capture;
+    xmlwin->capture_path = strdup(path);
+
+    return TRUE;
+}
+
+void
+xmlwin_capture_stop(ProfXMLWin* xmlwin)
+{
+    assert(xmlwin != NULL);
+
+    if (xmlwin->capture) {
+        fclose(xmlwin->capture);
+        xmlwin->capture = NULL;
+    }
+    free(xmlwin->capture_path);
+    xmlwin->capture_path = NULL;
+}
+
 char*
 xmlwin_get_string(ProfXMLWin* xmlwin)
 {
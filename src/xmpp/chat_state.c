@@ -36,11 +36,13 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <glib.h>
 
 #include "config/preferences.h"
+#include "tools/stats.h"
 #include "ui/window_list.h"
 #include "ui/win_types.h"
 #include "xmpp/xmpp.h"
@@ -50,7 +52,24 @@
 #define PAUSED_TIMEOUT   10.0
 #define INACTIVE_TIMEOUT 30.0
 
-static void _send_if_supported(const char* const barejid, void (*send_func)(const char* const));
+// chat states wait this long for a newer state that makes them redundant
+#define COALESCE_TIMEOUT 0.5
+
+typedef struct pending_chat_state_t
+{
+    char* jid;
+    chat_state_type_t type;
+    gint64 queued;
+} PendingChatState;
+
+// barejid -> PendingChatState, at most one outgoing state per contact
+static GHashTable* pending_states = NULL;
+
+static void _send_if_supported(const char* const barejid, chat_state_type_t type);
+static void _queue_state(const char* const barejid, const char* const jid, chat_state_type_t type);
+static gboolean _drop_pending(const char* const barejid);
+static void _pending_state_free(PendingChatState* pending);
+static void _send_pending(PendingChatState* pending);
 
 ChatState*
 chat_state_new(void)
@@ -81,7 +100,7 @@ chat_state_handle_idle(const char* const barejid, ChatState* state)
         state->type = CHAT_STATE_PAUSED;
         g_timer_start(state->timer);
         if (prefs_get_boolean(PREF_STATES) && prefs_get_boolean(PREF_OUTTYPE)) {
-            _send_if_supported(barejid, message_send_paused);
+            _send_if_supported(barejid, CHAT_STATE_PAUSED);
         }
         return;
     }
@@ -91,7 +110,7 @@ chat_state_handle_idle(const char* const barejid, ChatState* state)
         state->type = CHAT_STATE_INACTIVE;
         g_timer_start(state->timer);
         if (prefs_get_boolean(PREF_STATES)) {
-            _send_if_supported(barejid, message_send_inactive);
+            _send_if_supported(barejid, CHAT_STATE_INACTIVE);
         }
         return;
     }
@@ -104,7 +123,7 @@ chat_state_handle_idle(const char* const barejid, ChatState* state)
                 // never move to GONE when resource override
                 if (!session->resource_override) {
                     if (prefs_get_boolean(PREF_STATES)) {
-                        _send_if_supported(barejid, message_send_gone);
+                        _send_if_supported(barejid, CHAT_STATE_GONE);
                     }
                     chat_session_remove(barejid);
                     state->type = CHAT_STATE_GONE;
@@ -112,7 +131,7 @@ chat_state_handle_idle(const char* const barejid, ChatState* state)
                 }
             } else {
                 if (prefs_get_boolean(PREF_STATES)) {
-                    message_send_gone(barejid);
+                    _queue_state(barejid, barejid, CHAT_STATE_GONE);
                 }
                 state->type = CHAT_STATE_GONE;
                 g_timer_start(state->timer);
@@ -130,14 +149,19 @@ chat_state_handle_typing(const char* const barejid, ChatState* state)
         state->type = CHAT_STATE_COMPOSING;
         g_timer_start(state->timer);
         if (prefs_get_boolean(PREF_STATES) && prefs_get_boolean(PREF_OUTTYPE)) {
-            _send_if_supported(barejid, message_send_composing);
+            _send_if_supported(barejid, CHAT_STATE_COMPOSING);
         }
     }
 }
 
 void
-chat_state_active(ChatState* state)
+chat_state_active(const char* const barejid, ChatState* state)
 {
+    // the outgoing message carries the active state
+    if (_drop_pending(barejid)) {
+        stats_count(PROF_STATS_CHAT_STATES_DROPPED);
+    }
+
     state->type = CHAT_STATE_ACTIVE;
     g_timer_start(state->timer);
 }
@@ -147,7 +171,7 @@ chat_state_gone(const char* const barejid, ChatState* state)
 {
     if (state->type != CHAT_STATE_GONE) {
         if (prefs_get_boolean(PREF_STATES)) {
-            _send_if_supported(barejid, message_send_gone);
+            _send_if_supported(barejid, CHAT_STATE_GONE);
         }
         state->type = CHAT_STATE_GONE;
         g_timer_start(state->timer);
@@ -188,24 +212,107 @@ chat_state_activity(void)
     }
 }
 
+void
+chat_state_flush(gboolean force)
+{
+    if (!pending_states || g_hash_table_size(pending_states) == 0) {
+        return;
+    }
+
+    gboolean connected = connection_get_status() == JABBER_CONNECTED;
+    gint64 now = g_get_monotonic_time();
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, pending_states);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        PendingChatState* pending = value;
+        if (!connected) {
+            stats_count(PROF_STATS_CHAT_STATES_DROPPED);
+        } else if (force || (now - pending->queued) >= COALESCE_TIMEOUT * G_USEC_PER_SEC) {
+            _send_pending(pending);
+        } else {
+            continue;
+        }
+        g_hash_table_iter_remove(&iter);
+    }
+}
+
 static void
-_send_if_supported(const char* const barejid, void (*send_func)(const char* const))
+_send_if_supported(const char* const barejid, chat_state_type_t type)
 {
-    gboolean send = TRUE;
-    GString* jid = g_string_new(barejid);
     ChatSession* session = chat_session_get(barejid);
-    if (session) {
-        if (session->send_states) {
-            g_string_append(jid, "/");
-            g_string_append(jid, session->resource);
-        } else {
-            send = FALSE;
+    if (!session) {
+        _queue_state(barejid, barejid, type);
+    } else if (session->send_states) {
+        char* jid = g_strdup_printf("%s/%s", barejid, session->resource);
+        _queue_state(barejid, jid, type);
+        g_free(jid);
+    } else if (_drop_pending(barejid)) {
+        stats_count(PROF_STATS_CHAT_STATES_DROPPED);
+    }
+}
+
+static void
+_queue_state(const char* const barejid, const char* const jid, chat_state_type_t type)
+{
+    if (!pending_states) {
+        pending_states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_pending_state_free);
+    }
+
+    PendingChatState* pending = g_hash_table_lookup(pending_states, barejid);
+    if (pending) {
+        stats_count(PROF_STATS_CHAT_STATES_DROPPED);
+
+        // the contact never saw us composing, so there is nothing to pause
+        if (pending->type == CHAT_STATE_COMPOSING && type == CHAT_STATE_PAUSED) {
+            stats_count(PROF_STATS_CHAT_STATES_DROPPED);
+            g_hash_table_remove(pending_states, barejid);
+            return;
         }
     }
 
-    if (send) {
-        send_func(jid->str);
+    pending = malloc(sizeof(PendingChatState));
+    pending->jid = strdup(jid);
+    pending->type = type;
+    pending->queued = g_get_monotonic_time();
+    g_hash_table_replace(pending_states, g_strdup(barejid), pending);
+}
+
+static gboolean
+_drop_pending(const char* const barejid)
+{
+    return pending_states && g_hash_table_remove(pending_states, barejid);
+}
+
+static void
+_pending_state_free(PendingChatState* pending)
+{
+    if (pending) {
+        free(pending->jid);
+        free(pending);
+    }
+}
+
+static void
+_send_pending(PendingChatState* pending)
+{
+    switch (pending->type) {
+    case CHAT_STATE_COMPOSING:
+        message_send_composing(pending->jid);
+        break;
+    case CHAT_STATE_PAUSED:
+        message_send_paused(pending->jid);
+        break;
+    case CHAT_STATE_INACTIVE:
+        message_send_inactive(pending->jid);
+        break;
+    case CHAT_STATE_GONE:
+        message_send_gone(pending->jid);
+        break;
+    default:
+        return;
     }
 
-    g_string_free(jid, TRUE);
+    stats_count(PROF_STATS_CHAT_STATES_SENT);
 }
@@ -60,7 +60,9 @@ void chat_state_activity(void);
 
 void chat_state_handle_idle(const char* const barejid, ChatState* state);
 void chat_state_handle_typing(const char* const barejid, ChatState* state);
-void chat_state_active(ChatState* state);
+void chat_state_active(const char* const barejid, ChatState* state);
 void chat_state_gone(const char* const barejid, ChatState* state);
 
+void chat_state_flush(gboolean force);
+
 #endif
@@ -50,6 +50,7 @@
 #include "config/files.h"
 #include "config/preferences.h"
 #include "event/server_events.h"
+#include "tools/stats.h"
 #include "xmpp/connection.h"
 #include "xmpp/session.h"
 #include "xmpp/stanza.h"
@@ -156,9 +157,11 @@ connection_init(void)
 void
 connection_check_events(void)
 {
+    gint64 start = stats_start();
     conn.xmpp_in_event_loop = TRUE;
     xmpp_run_once(conn.xmpp_ctx, 10);
     conn.xmpp_in_event_loop = FALSE;
+    stats_end(PROF_STATS_CONNECTION_EVENTS, start);
 }
 
 void
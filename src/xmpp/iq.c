@@ -48,10 +48,12 @@
 
 #include "profanity.h"
 #include "log.h"
+#include "common.h"
 #include "config/preferences.h"
 #include "event/server_events.h"
 #include "plugins/plugins.h"
 #include "tools/http_upload.h"
+#include "tools/stats.h"
 #include "ui/ui.h"
 #include "ui/window_list.h"
 #include "xmpp/xmpp.h"
@@ -104,13 +106,25 @@ typedef struct command_config_data_t
     char* command;
 } CommandConfigData;
 
-typedef struct mam_rsm_userdata
+// one catch-up of a conversation, possibly split into several time slices
+// that are paged concurrently
+typedef struct mam_sync_t
 {
     char* barejid;
+    GDateTime* enddate;
+    int refs;
+    int slices;
+    int slices_done;
+    gboolean failed;
+} MamSync;
+
+// one outstanding RSM page of a slice
+typedef struct mam_rsm_userdata
+{
+    MamSync* sync;
     char* start_datestr;
     char* end_datestr;
     gboolean fetch_next;
-    ProfChatWin* win;
 } MamRsmUserdata;
 
 typedef struct late_delivery_userdata
@@ -121,6 +135,7 @@ typedef struct late_delivery_userdata
 } LateDeliveryUserdata;
 
 static int _iq_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
+static int _iq_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
 
 static void _error_handler(xmpp_stanza_t* const stanza);
 static void _disco_info_get_handler(xmpp_stanza_t* const stanza);
@@ -158,6 +173,7 @@ static int _mam_rsm_id_handler(xmpp_stanza_t* const stanza, void* const userdata
 static int _register_change_password_result_id_handler(xmpp_stanza_t* const stanza, void* const userdata);
 
 static void _iq_mam_request(ProfChatWin* win, GDateTime* startdate, GDateTime* enddate);
+static void _mam_rsm_userdata_free(MamRsmUserdata* data);
 static void _iq_free_room_data(ProfRoomInfoData* roominfo);
 static void _iq_free_affiliation_set(ProfPrivilegeSet* affiliation_set);
 static void _iq_free_affiliation_list(ProfAffiliationList* affiliation_list);
@@ -178,6 +194,16 @@ static gboolean received_disco_items = FALSE;
 
 static int
 _iq_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
+{
+    gint64 start = stats_start();
+    int result = _iq_handler_internal(conn, stanza, userdata);
+    stats_end(PROF_STATS_IQ_HANDLER, start);
+
+    return result;
+}
+
+static int
+_iq_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
 {
     log_debug("iq stanza handler fired");
 
@@ -230,7 +256,8 @@ _iq_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const us
     if (roster && (g_strcmp0(type, STANZA_TYPE_SET) == 0)) {
         roster_set_handler(stanza);
     }
-    if (roster && (g_strcmp0(type, STANZA_TYPE_RESULT) == 0)) {
+    // a versioned roster request is answered with an empty result when nothing changed
+    if ((roster || g_strcmp0(xmpp_stanza_get_id(stanza), "roster") == 0) && (g_strcmp0(type, STANZA_TYPE_RESULT) == 0)) {
         roster_result_handler(stanza);
     }
 
@@ -2477,8 +2504,7 @@ _http_upload_response_id_handler(xmpp_stanza_t* const stanza, void* const userda
                 }
             }
 
-            pthread_create(&(upload->worker), NULL, &http_file_put, upload);
-            http_upload_add_upload(upload);
+            http_file_put(upload);
         } else {
             log_error("Invalid XML in HTTP Upload slot");
             return 1;
@@ -2602,8 +2628,7 @@ static int
 _mam_buffer_commit_handler(xmpp_stanza_t* const stanza, void* const userdata)
 {
     ProfChatWin* chatwin = (ProfChatWin*)userdata;
-    // Remove the "Loading messages ..." message
-    buffer_remove_entry(((ProfWin*)chatwin)->layout->buffer, 0);
+    win_remove_loading_history((ProfWin*)chatwin);
     chatwin_db_history(chatwin, NULL, NULL, TRUE);
     return 0;
 }
@@ -2632,7 +2657,7 @@ iq_mam_request_older(ProfChatWin* win)
     }
 
     xmpp_ctx_t* const ctx = connection_get_ctx();
-    xmpp_stanza_t* iq = stanza_create_mam_iq(ctx, win->barejid, NULL, enddate, firstid, NULL);
+    xmpp_stanza_t* iq = stanza_create_mam_iq(ctx, win->barejid, NULL, enddate, firstid, NULL, MESSAGES_TO_RETRIEVE);
     iq_id_handler_add(xmpp_stanza_get_id(iq), _mam_buffer_commit_handler, NULL, win);
 
     g_free(enddate);
@@ -2644,72 +2669,159 @@ iq_mam_request_older(ProfChatWin* win)
     return;
 }
 
+// time slices a catch-up is split into, and the shortest slice worth its own query
+#define MAM_SYNC_SLICES      4
+#define MAM_SYNC_MIN_SLICE   G_TIME_SPAN_HOUR
+#define MAM_SYNC_PAGE_SIZE   100
+
+static void
+_mam_sync_send_page(MamSync* sync, const char* const start_datestr, const char* const end_datestr, const char* const firstid, gboolean fetch_next)
+{
+    xmpp_ctx_t* const ctx = connection_get_ctx();
+    xmpp_stanza_t* iq = stanza_create_mam_iq(ctx, sync->barejid, start_datestr, end_datestr, firstid, NULL, MAM_SYNC_PAGE_SIZE);
+
+    MamRsmUserdata* data = malloc(sizeof(MamRsmUserdata));
+    if (data) {
+        data->sync = sync;
+        data->start_datestr = start_datestr ? strdup(start_datestr) : NULL;
+        data->end_datestr = end_datestr ? strdup(end_datestr) : NULL;
+        data->fetch_next = fetch_next;
+        sync->refs++;
+
+        // the archived messages of this page arrive before the result and are written in one transaction
+        log_database_batch_begin();
+        iq_id_handler_add(xmpp_stanza_get_id(iq), _mam_rsm_id_handler, (ProfIqFreeCallback)_mam_rsm_userdata_free, data);
+    }
+
+    iq_send_stanza(iq);
+    xmpp_stanza_release(iq);
+}
+
+static void
+_mam_sync_finish(MamSync* sync)
+{
+    gboolean finished = sync->slices_done == sync->slices;
+    if (finished && !sync->failed) {
+        log_database_set_mam_watermark(sync->barejid, sync->enddate);
+    }
+
+    // pages dropped on disconnect neither finish nor fail
+    if (finished || sync->failed) {
+        ProfChatWin* chatwin = wins_get_chat(sync->barejid);
+        if (chatwin) {
+            auto_gchar gchar* end_str = g_date_time_format(sync->enddate, mam_timestamp_format_string);
+            // Convert to iso8601
+            end_str[strlen(end_str) - 3] = '\0';
+            chatwin_mam_history_done(chatwin, end_str);
+        }
+    }
+
+    free(sync->barejid);
+    g_date_time_unref(sync->enddate);
+    free(sync);
+}
+
+static void
+_mam_rsm_userdata_free(MamRsmUserdata* data)
+{
+    log_database_batch_end();
+
+    MamSync* sync = data->sync;
+    free(data->start_datestr);
+    free(data->end_datestr);
+    free(data);
+
+    sync->refs--;
+    if (sync->refs == 0) {
+        _mam_sync_finish(sync);
+    }
+}
+
 void
 _iq_mam_request(ProfChatWin* win, GDateTime* startdate, GDateTime* enddate)
 {
     if (connection_supports(XMPP_FEATURE_MAM2) == FALSE) {
         log_warning("Server doesn't advertise %s feature.", XMPP_FEATURE_MAM2);
         cons_show_error("Server doesn't support MAM (%s).", XMPP_FEATURE_MAM2);
-        g_date_time_unref(startdate);
-        g_date_time_unref(enddate);
+        if (startdate) {
+            g_date_time_unref(startdate);
+        }
+        if (enddate) {
+            g_date_time_unref(enddate);
+        }
         return;
     }
 
-    char* firstid = "";
-    char* startdate_str = NULL;
-    char* enddate_str = NULL;
-    gboolean fetch_next = FALSE;
-
-    if (startdate) {
-        startdate_str = g_date_time_format(startdate, mam_timestamp_format_string);
-        fetch_next = TRUE;
-        g_date_time_unref(startdate);
+    if (!enddate) {
+        enddate = g_date_time_new_now_utc();
     }
 
-    if (enddate) {
-        enddate_str = g_date_time_format(enddate, mam_timestamp_format_string);
+    MamSync* sync = malloc(sizeof(MamSync));
+    if (!sync) {
+        if (startdate) {
+            g_date_time_unref(startdate);
+        }
         g_date_time_unref(enddate);
-    } else {
-        GDateTime* now = g_date_time_new_now_utc();
-        enddate_str = g_date_time_format(now, mam_timestamp_format_string);
-        g_date_time_unref(now);
+        return;
+    }
+    sync->barejid = strdup(win->barejid);
+    sync->enddate = enddate;
+    sync->refs = 0;
+    sync->slices = 1;
+    sync->slices_done = 0;
+    sync->failed = FALSE;
+
+    // without a start only the latest page is fetched
+    if (!startdate) {
+        auto_gchar gchar* enddate_str = g_date_time_format(enddate, mam_timestamp_format_string);
+        _mam_sync_send_page(sync, NULL, enddate_str, "", FALSE);
+        return;
     }
 
-    xmpp_ctx_t* const ctx = connection_get_ctx();
+    // Split the range so that the slices are paged backwards in parallel
+    // instead of one page after the other
+    GTimeSpan span = g_date_time_difference(enddate, startdate);
+    if (span > MAM_SYNC_MIN_SLICE) {
+        sync->slices = (int)CLAMP(span / MAM_SYNC_MIN_SLICE, 1, MAM_SYNC_SLICES);
+    }
 
-    xmpp_stanza_t* iq = stanza_create_mam_iq(ctx, win->barejid, startdate_str, enddate_str, firstid, NULL);
+    for (int i = 0; i < sync->slices; i++) {
+        GDateTime* slice_start = g_date_time_add(startdate, span / sync->slices * i);
+        GDateTime* slice_end = i == sync->slices - 1 ? g_date_time_ref(enddate) : g_date_time_add(startdate, span / sync->slices * (i + 1));
+        auto_gchar gchar* start_str = g_date_time_format(slice_start, mam_timestamp_format_string);
+        auto_gchar gchar* end_str = g_date_time_format(slice_end, mam_timestamp_format_string);
 
-    MamRsmUserdata* data = malloc(sizeof(MamRsmUserdata));
-    if (data) {
-        data->start_datestr = startdate_str;
-        data->end_datestr = enddate_str;
-        data->barejid = strdup(win->barejid);
-        data->fetch_next = fetch_next;
-        data->win = win;
+        _mam_sync_send_page(sync, start_str, end_str, "", TRUE);
 
-        iq_id_handler_add(xmpp_stanza_get_id(iq), _mam_rsm_id_handler, NULL, data);
+        g_date_time_unref(slice_start);
+        g_date_time_unref(slice_end);
     }
 
-    iq_send_stanza(iq);
-    xmpp_stanza_release(iq);
-
-    return;
+    g_date_time_unref(startdate);
 }
 
 void
 iq_mam_request(ProfChatWin* win, GDateTime* enddate)
 {
-    ProfMessage* last_msg = log_database_get_limits_info(win->barejid, TRUE);
-    GDateTime* startdate = g_date_time_add_seconds(last_msg->timestamp, 0);
-    message_free(last_msg);
+    // resume from the end of the last finished catch-up, the newest
+    // message could be newer than a gap left by an interrupted one
+    GDateTime* startdate = log_database_get_mam_watermark(win->barejid);
+    if (!startdate) {
+        ProfMessage* last_msg = log_database_get_limits_info(win->barejid, TRUE);
+        if (last_msg && last_msg->timestamp) {
+            startdate = g_date_time_add_seconds(last_msg->timestamp, 0);
+        }
+        message_free(last_msg);
+    }
 
     // Save request for later if disco items haven't been received yet
     if (!received_disco_items) {
         LateDeliveryUserdata* cur_del_data = malloc(sizeof(LateDeliveryUserdata));
         cur_del_data->win = win;
-        cur_del_data->enddate = g_date_time_ref(enddate);
-        cur_del_data->startdate = g_date_time_ref(startdate);
+        cur_del_data->enddate = enddate;
+        cur_del_data->startdate = startdate;
         late_delivery_windows = g_slist_append(late_delivery_windows, cur_del_data);
+        return;
     }
 
     _iq_mam_request(win, startdate, enddate);
@@ -2720,81 +2832,47 @@ iq_mam_request(ProfChatWin* win, GDateTime* enddate)
 static int
 _mam_rsm_id_handler(xmpp_stanza_t* const stanza, void* const userdata)
 {
+    MamRsmUserdata* data = (MamRsmUserdata*)userdata;
+    MamSync* sync = data->sync;
+
     const char* type = xmpp_stanza_get_type(stanza);
     if (g_strcmp0(type, "error") == 0) {
         char* error_message = stanza_get_error_message(stanza);
         cons_show_error("Server error: %s", error_message);
         log_debug("MAM Error: %s", error_message);
         free(error_message);
-    } else if (g_strcmp0(type, "result") == 0) {
-        xmpp_stanza_t* fin = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_FIN, STANZA_NS_MAM2);
-        if (fin) {
-            gboolean is_complete = g_strcmp0(xmpp_stanza_get_attribute(fin, "complete"), "true") == 0;
-            MamRsmUserdata* data = (MamRsmUserdata*)userdata;
-            ProfWin* window = (ProfWin*)data->win;
-
-            buffer_remove_entry(window->layout->buffer, 0);
-
-            char* start_str = NULL;
-            if (data->start_datestr) {
-                start_str = strdup(data->start_datestr);
-                // Convert to iso8601
-                start_str[strlen(start_str) - 3] = '\0';
-            }
-            char* end_str = NULL;
-            if (data->end_datestr) {
-                end_str = strdup(data->end_datestr);
-                // Convert to iso8601
-                end_str[strlen(end_str) - 3] = '\0';
-            }
-
-            if (is_complete || !data->fetch_next) {
-                chatwin_db_history(data->win, is_complete ? NULL : start_str, end_str, TRUE);
-                // TODO free memory
-                if (start_str) {
-                    free(start_str);
-                    free(data->start_datestr);
-                }
-
-                if (end_str) {
-                    free(data->end_datestr);
-                }
-
-                free(data->barejid);
-                free(data);
-                return 0;
-            }
-
-            chatwin_db_history(data->win, start_str, end_str, TRUE);
-            if (start_str)
-                free(start_str);
-
-            xmpp_stanza_t* set = xmpp_stanza_get_child_by_name_and_ns(fin, STANZA_TYPE_SET, STANZA_NS_RSM);
-            if (set) {
-                win_print_loading_history(window);
-
-                char* firstid = NULL;
-                xmpp_stanza_t* first = xmpp_stanza_get_child_by_name(set, STANZA_NAME_FIRST);
-                firstid = xmpp_stanza_get_text(first);
+        sync->failed = TRUE;
+        return 0;
+    }
 
-                // 4.3.2. send same stanza with set,max stanza
-                xmpp_ctx_t* const ctx = connection_get_ctx();
+    if (g_strcmp0(type, "result") != 0) {
+        return 0;
+    }
 
-                if (end_str) {
-                    free(data->end_datestr);
-                }
-                data->end_datestr = NULL;
-                xmpp_stanza_t* iq = stanza_create_mam_iq(ctx, data->barejid, data->start_datestr, data->end_datestr, firstid, NULL);
-                free(firstid);
+    xmpp_stanza_t* fin = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_FIN, STANZA_NS_MAM2);
+    if (!fin) {
+        sync->failed = TRUE;
+        return 0;
+    }
 
-                iq_id_handler_add(xmpp_stanza_get_id(iq), _mam_rsm_id_handler, NULL, data);
+    gboolean is_complete = g_strcmp0(xmpp_stanza_get_attribute(fin, "complete"), "true") == 0;
+    if (is_complete || !data->fetch_next) {
+        sync->slices_done++;
+        return 0;
+    }
 
-                iq_send_stanza(iq);
-                xmpp_stanza_release(iq);
-            }
-        }
+    xmpp_stanza_t* set = xmpp_stanza_get_child_by_name_and_ns(fin, STANZA_TYPE_SET, STANZA_NS_RSM);
+    xmpp_stanza_t* first = set ? xmpp_stanza_get_child_by_name(set, STANZA_NAME_FIRST) : NULL;
+    char* firstid = first ? xmpp_stanza_get_text(first) : NULL;
+    if (!firstid) {
+        sync->slices_done++;
+        return 0;
     }
 
+    // 4.3.2. send same stanza with set,max stanza
+    _mam_sync_send_page(sync, data->start_datestr, NULL, firstid, TRUE);
+    xmpp_free(connection_get_ctx(), firstid);
+
     return 0;
 }
 
@@ -48,6 +48,7 @@
 #include "pgp/gpg.h"
 #include "pgp/ox.h"
 #include "plugins/plugins.h"
+#include "tools/stats.h"
 #include "ui/ui.h"
 #include "ui/window_list.h"
 #include "xmpp/chat_session.h"
@@ -74,22 +75,53 @@ typedef struct p_message_handle_t
     void* userdata;
 } ProfMessageHandler;
 
+// Children of a <message/> the handlers are interested in, collected in a
+// single walk over the stanza. Each member is the first matching child.
+typedef struct p_message_extensions_t
+{
+    xmpp_stanza_t* body;
+    xmpp_stanza_t* subject;
+    xmpp_stanza_t* x;
+    xmpp_stanza_t* form;
+    xmpp_stanza_t* propose;
+    xmpp_stanza_t* mam_result;
+    xmpp_stanza_t* mucuser;
+    xmpp_stanza_t* conference;
+    xmpp_stanza_t* captcha;
+    xmpp_stanza_t* receipt;
+    xmpp_stanza_t* pubsub_event;
+    xmpp_stanza_t* carbon_sent;
+    xmpp_stanza_t* carbon_received;
+    xmpp_stanza_t* stanza_id;
+    xmpp_stanza_t* origin_id;
+    xmpp_stanza_t* replace;
+    xmpp_stanza_t* encrypted;
+    xmpp_stanza_t* ox;
+    gboolean active;
+    gboolean composing;
+    gboolean paused;
+    gboolean inactive;
+    gboolean gone;
+} ProfMessageExtensions;
+
 static int _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
+static int _message_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
+static void _message_extensions_scan(xmpp_stanza_t* const stanza, ProfMessageExtensions* ext);
 static void _handle_error(xmpp_stanza_t* const stanza);
-static void _handle_groupchat(xmpp_stanza_t* const stanza);
+static void _handle_groupchat(xmpp_stanza_t* const stanza, const ProfMessageExtensions* const ext);
 static void _handle_muc_user(xmpp_stanza_t* const stanza);
 static void _handle_muc_private_message(xmpp_stanza_t* const stanza);
 static void _handle_conference(xmpp_stanza_t* const stanza);
 static void _handle_captcha(xmpp_stanza_t* const stanza);
-static void _handle_receipt_received(xmpp_stanza_t* const stanza);
-static void _handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, const char* result_id, GDateTime* timestamp);
+static void _handle_receipt_received(xmpp_stanza_t* const stanza, xmpp_stanza_t* const receipt);
+static void _handle_chat(xmpp_stanza_t* const stanza, const ProfMessageExtensions* const ext, gboolean is_mam, gboolean is_carbon, const char* result_id, GDateTime* timestamp);
 static void _handle_ox_chat(xmpp_stanza_t* const stanza, ProfMessage* message, gboolean is_mam);
 static xmpp_stanza_t* _handle_carbons(xmpp_stanza_t* const stanza);
 static void _send_message_stanza(xmpp_stanza_t* const stanza);
-static gboolean _handle_mam(xmpp_stanza_t* const stanza);
+static gboolean _handle_mam(xmpp_stanza_t* const result);
 static void _handle_pubsub(xmpp_stanza_t* const stanza, xmpp_stanza_t* const event);
-static gboolean _handle_form(xmpp_stanza_t* const stanza);
-static gboolean _handle_jingle_message(xmpp_stanza_t* const stanza);
+static gboolean _handle_form(xmpp_stanza_t* const stanza, xmpp_stanza_t* const form);
+static gboolean _handle_jingle_message(xmpp_stanza_t* const stanza, xmpp_stanza_t* const propose);
 static gboolean _should_ignore_based_on_silence(xmpp_stanza_t* const stanza);
 
 #ifdef HAVE_LIBGPGME
@@ -125,29 +157,125 @@ _handle_headline(xmpp_stanza_t* const stanza)
 }
 
 static void
-_handle_chat_states(xmpp_stanza_t* const stanza, Jid* const jid)
+_handle_chat_states(const ProfMessageExtensions* const ext, Jid* const jid)
 {
-    gboolean gone = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_GONE) != NULL;
-    gboolean typing = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_COMPOSING) != NULL;
-    gboolean paused = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_PAUSED) != NULL;
-    gboolean inactive = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_INACTIVE) != NULL;
-    if (gone) {
+    if (ext->gone) {
         sv_ev_gone(jid->barejid, jid->resourcepart);
-    } else if (typing) {
+    } else if (ext->composing) {
         sv_ev_typing(jid->barejid, jid->resourcepart);
-    } else if (paused) {
+    } else if (ext->paused) {
         sv_ev_paused(jid->barejid, jid->resourcepart);
-    } else if (inactive) {
+    } else if (ext->inactive) {
         sv_ev_inactive(jid->barejid, jid->resourcepart);
-    } else if (stanza_contains_chat_state(stanza)) {
+    } else if (ext->active) {
         sv_ev_activity(jid->barejid, jid->resourcepart, TRUE);
     } else {
         sv_ev_activity(jid->barejid, jid->resourcepart, FALSE);
     }
 }
 
+static void
+_message_extensions_scan(xmpp_stanza_t* const stanza, ProfMessageExtensions* ext)
+{
+    memset(ext, 0, sizeof(ProfMessageExtensions));
+
+    xmpp_stanza_t* child = xmpp_stanza_get_children(stanza);
+    for (; child; child = xmpp_stanza_get_next(child)) {
+        const char* name = xmpp_stanza_get_name(child);
+        if (!name) {
+            continue;
+        }
+        const char* ns = xmpp_stanza_get_ns(child);
+
+        // by element name
+        if (!ext->body && strcmp(name, STANZA_NAME_BODY) == 0) {
+            ext->body = child;
+        }
+        if (!ext->subject && strcmp(name, STANZA_NAME_SUBJECT) == 0) {
+            ext->subject = child;
+        }
+        if (!ext->x && strcmp(name, STANZA_NAME_X) == 0) {
+            ext->x = child;
+        }
+        if (strcmp(name, STANZA_NAME_ACTIVE) == 0) {
+            ext->active = TRUE;
+        } else if (strcmp(name, STANZA_NAME_COMPOSING) == 0) {
+            ext->composing = TRUE;
+        } else if (strcmp(name, STANZA_NAME_PAUSED) == 0) {
+            ext->paused = TRUE;
+        } else if (strcmp(name, STANZA_NAME_INACTIVE) == 0) {
+            ext->inactive = TRUE;
+        } else if (strcmp(name, STANZA_NAME_GONE) == 0) {
+            ext->gone = TRUE;
+        }
+
+        if (!ns) {
+            continue;
+        }
+
+        // by element name and namespace
+        if (!ext->form && strcmp(name, STANZA_NAME_X) == 0 && strcmp(ns, STANZA_NS_DATA) == 0) {
+            ext->form = child;
+        }
+        if (!ext->propose && strcmp(name, STANZA_NAME_PROPOSE) == 0 && strcmp(ns, STANZA_NS_JINGLE_MESSAGE) == 0) {
+            ext->propose = child;
+        }
+        if (!ext->mam_result && strcmp(name, STANZA_NAME_RESULT) == 0 && strcmp(ns, STANZA_NS_MAM2) == 0) {
+            ext->mam_result = child;
+        }
+        if (!ext->carbon_sent && strcmp(name, STANZA_NAME_SENT) == 0 && strcmp(ns, STANZA_NS_CARBONS) == 0) {
+            ext->carbon_sent = child;
+        }
+        if (!ext->carbon_received && strcmp(name, STANZA_NAME_RECEIVED) == 0 && strcmp(ns, STANZA_NS_CARBONS) == 0) {
+            ext->carbon_received = child;
+        }
+        if (!ext->stanza_id && strcmp(name, STANZA_NAME_STANZA_ID) == 0 && strcmp(ns, STANZA_NS_STABLE_ID) == 0) {
+            ext->stanza_id = child;
+        }
+        if (!ext->origin_id && strcmp(name, STANZA_NAME_ORIGIN_ID) == 0 && strcmp(ns, STANZA_NS_STABLE_ID) == 0) {
+            ext->origin_id = child;
+        }
+
+        // by namespace
+        if (!ext->mucuser && strcmp(ns, STANZA_NS_MUC_USER) == 0) {
+            ext->mucuser = child;
+        }
+        if (!ext->conference && strcmp(ns, STANZA_NS_CONFERENCE) == 0) {
+            ext->conference = child;
+        }
+        if (!ext->captcha && strcmp(ns, STANZA_NS_CAPTCHA) == 0) {
+            ext->captcha = child;
+        }
+        if (!ext->receipt && strcmp(ns, STANZA_NS_RECEIPTS) == 0) {
+            ext->receipt = child;
+        }
+        if (!ext->pubsub_event && strcmp(ns, STANZA_NS_PUBSUB_EVENT) == 0) {
+            ext->pubsub_event = child;
+        }
+        if (!ext->replace && strcmp(ns, STANZA_NS_LAST_MESSAGE_CORRECTION) == 0) {
+            ext->replace = child;
+        }
+        if (!ext->encrypted && strcmp(ns, STANZA_NS_ENCRYPTED) == 0) {
+            ext->encrypted = child;
+        }
+        if (!ext->ox && strcmp(ns, STANZA_NS_OPENPGP_0) == 0) {
+            ext->ox = child;
+        }
+    }
+}
+
 static int
 _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
+{
+    gint64 start = stats_start();
+    int result = _message_handler_internal(conn, stanza, userdata);
+    stats_end(PROF_STATS_MESSAGE_HANDLER, start);
+
+    return result;
+}
+
+static int
+_message_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
 {
     log_debug("Message stanza handler fired");
 
@@ -158,17 +286,19 @@ _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* con
     // type according to RFC 6121
     const char* type = xmpp_stanza_get_type(stanza);
 
+    ProfMessageExtensions ext;
+    _message_extensions_scan(stanza, &ext);
+
     if (type && g_strcmp0(type, STANZA_TYPE_ERROR) == 0) {
         _handle_error(stanza);
     } else if (type && g_strcmp0(type, STANZA_TYPE_GROUPCHAT) == 0) {
         // XEP-0045: Multi-User Chat
-        _handle_groupchat(stanza);
+        _handle_groupchat(stanza, &ext);
 
     } else if (type && g_strcmp0(type, STANZA_TYPE_HEADLINE) == 0) {
-        xmpp_stanza_t* event = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_PUBSUB_EVENT);
         // TODO: do we want to handle all pubsub here or should additionally check for STANZA_NS_MOOD?
-        if (event) {
-            _handle_pubsub(stanza, event);
+        if (ext.pubsub_event) {
+            _handle_pubsub(stanza, ext.pubsub_event);
             return 1;
         } else {
             _handle_headline(stanza);
@@ -182,50 +312,45 @@ _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* con
         }
 
         // XEP-0353: Jingle Message Initiation
-        if (_handle_jingle_message(stanza)) {
+        if (_handle_jingle_message(stanza, ext.propose)) {
             return 1;
         }
 
         // XEP-0045: Multi-User Chat 8.6 Voice Requests
-        if (_handle_form(stanza)) {
+        if (_handle_form(stanza, ext.form)) {
             return 1;
         }
 
         // XEP-0313: Message Archive Management
-        if (_handle_mam(stanza)) {
+        if (_handle_mam(ext.mam_result)) {
             return 1;
         }
 
         // XEP-0045: Multi-User Chat - invites - presence
-        xmpp_stanza_t* mucuser = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_MUC_USER);
-        if (mucuser) {
+        if (ext.mucuser) {
             _handle_muc_user(stanza);
         }
 
         // XEP-0249: Direct MUC Invitations
-        xmpp_stanza_t* conference = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_CONFERENCE);
-        if (conference) {
+        if (ext.conference) {
             _handle_conference(stanza);
             return 1;
         }
 
         // XEP-0158: CAPTCHA Forms
-        xmpp_stanza_t* captcha = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_CAPTCHA);
-        if (captcha) {
+        if (ext.captcha) {
             _handle_captcha(stanza);
             return 1;
         }
 
         // XEP-0184: Message Delivery Receipts
-        xmpp_stanza_t* receipts = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_RECEIPTS);
-        if (receipts) {
-            _handle_receipt_received(stanza);
+        if (ext.receipt) {
+            _handle_receipt_received(stanza, ext.receipt);
         }
 
         // XEP-0060: Publish-Subscribe
-        xmpp_stanza_t* event = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_PUBSUB_EVENT);
-        if (event) {
-            _handle_pubsub(stanza, event);
+        if (ext.pubsub_event) {
+            _handle_pubsub(stanza, ext.pubsub_event);
             return 1;
         }
 
@@ -235,9 +360,9 @@ _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* con
         // XEP-0280: Message Carbons
         // Only allow `<sent xmlns='urn:xmpp:carbons:2'>` and `<received xmlns='urn:xmpp:carbons:2'>` carbons
         // Thus ignoring `<private xmlns="urn:xmpp:carbons:2"/>`
-        xmpp_stanza_t* carbons = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_SENT, STANZA_NS_CARBONS);
+        xmpp_stanza_t* carbons = ext.carbon_sent;
         if (!carbons) {
-            carbons = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_RECEIVED, STANZA_NS_CARBONS);
+            carbons = ext.carbon_received;
         }
 
         if (carbons) {
@@ -260,8 +385,12 @@ _message_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* con
             free(mybarejid);
         }
 
-        if (msg_stanza) {
-            _handle_chat(msg_stanza, FALSE, is_carbon, NULL, NULL);
+        if (msg_stanza == stanza) {
+            _handle_chat(stanza, &ext, FALSE, is_carbon, NULL, NULL);
+        } else if (msg_stanza) {
+            ProfMessageExtensions carbon_ext;
+            _message_extensions_scan(msg_stanza, &carbon_ext);
+            _handle_chat(msg_stanza, &carbon_ext, FALSE, is_carbon, NULL, NULL);
         }
     } else {
         // none of the allowed types
@@ -288,9 +417,8 @@ message_muc_submit_voice_approve(ProfConfWin* confwin)
 }
 
 static gboolean
-_handle_form(xmpp_stanza_t* const stanza)
+_handle_form(xmpp_stanza_t* const stanza, xmpp_stanza_t* const result)
 {
-    xmpp_stanza_t* result = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_X, STANZA_NS_DATA);
     if (!result) {
         return FALSE;
     }
@@ -349,13 +477,27 @@ message_init(void)
     message->timestamp = NULL;
     message->trusted = true;
     message->type = PROF_MSG_TYPE_UNINITIALIZED;
+    message->refcnt = 1;
 
     return message;
 }
 
+// keep a message around after its handler returned, e.g. while it is being decrypted
+ProfMessage*
+message_ref(ProfMessage* message)
+{
+    message->refcnt++;
+    return message;
+}
+
 void
 message_free(ProfMessage* message)
 {
+    if (message->refcnt > 1) {
+        message->refcnt--;
+        return;
+    }
+
     xmpp_ctx_t* ctx = connection_get_ctx();
     if (message->from_jid) {
         jid_destroy(message->from_jid);
@@ -1025,7 +1167,7 @@ _room_config_handler(xmpp_stanza_t* const stanza, void* const userdata)
 }
 
 static void
-_handle_groupchat(xmpp_stanza_t* const stanza)
+_handle_groupchat(xmpp_stanza_t* const stanza, const ProfMessageExtensions* const ext)
 {
     xmpp_ctx_t* ctx = connection_get_ctx();
 
@@ -1039,10 +1181,9 @@ _handle_groupchat(xmpp_stanza_t* const stanza)
     }
 
     // handle room subject
-    xmpp_stanza_t* subject = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_SUBJECT);
-    if (subject) {
+    if (ext->subject) {
         // subject_text is optional, can be NULL
-        char* subject_text = xmpp_stanza_get_text(subject);
+        char* subject_text = xmpp_stanza_get_text(ext->subject);
         sv_ev_room_subject(from_jid->barejid, from_jid->resourcepart, subject_text);
         xmpp_free(ctx, subject_text);
 
@@ -1054,10 +1195,8 @@ _handle_groupchat(xmpp_stanza_t* const stanza)
         char* broadcast;
         broadcast = xmpp_message_get_body(stanza);
         if (!broadcast) {
-            xmpp_stanza_t* x = xmpp_stanza_get_child_by_name(stanza, "x");
-
-            if (x) {
-                xmpp_stanza_t* status = xmpp_stanza_get_child_by_name(x, "status");
+            if (ext->x) {
+                xmpp_stanza_t* status = xmpp_stanza_get_child_by_name(ext->x, "status");
 
                 if (status) {
                     const char* code = xmpp_stanza_get_attribute(status, "code");
@@ -1107,25 +1246,22 @@ _handle_groupchat(xmpp_stanza_t* const stanza)
     }
 
     char* stanzaid = NULL;
-    xmpp_stanza_t* stanzaidst = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_STANZA_ID, STANZA_NS_STABLE_ID);
-    if (stanzaidst) {
-        stanzaid = (char*)xmpp_stanza_get_attribute(stanzaidst, STANZA_ATTR_ID);
+    if (ext->stanza_id) {
+        stanzaid = (char*)xmpp_stanza_get_attribute(ext->stanza_id, STANZA_ATTR_ID);
         if (stanzaid) {
             message->stanzaid = strdup(stanzaid);
         }
     }
 
-    xmpp_stanza_t* origin = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_ORIGIN_ID, STANZA_NS_STABLE_ID);
-    if (origin) {
-        char* originid = (char*)xmpp_stanza_get_attribute(origin, STANZA_ATTR_ID);
+    if (ext->origin_id) {
+        char* originid = (char*)xmpp_stanza_get_attribute(ext->origin_id, STANZA_ATTR_ID);
         if (originid) {
             message->originid = strdup(originid);
         }
     }
 
-    xmpp_stanza_t* replace_id_stanza = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_LAST_MESSAGE_CORRECTION);
-    if (replace_id_stanza) {
-        const char* replace_id = xmpp_stanza_get_id(replace_id_stanza);
+    if (ext->replace) {
+        const char* replace_id = xmpp_stanza_get_id(ext->replace);
         if (replace_id) {
             message->replace_id = strdup(replace_id);
         }
@@ -1204,9 +1340,8 @@ _message_send_receipt(const char* const fulljid, const char* const message_id)
 }
 
 static void
-_handle_receipt_received(xmpp_stanza_t* const stanza)
+_handle_receipt_received(xmpp_stanza_t* const stanza, xmpp_stanza_t* const receipt)
 {
-    xmpp_stanza_t* receipt = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_RECEIPTS);
     if (receipt) {
         const char* name = xmpp_stanza_get_name(receipt);
         if ((name == NULL) || (g_strcmp0(name, "received") != 0)) {
@@ -1233,7 +1368,7 @@ _handle_receipt_received(xmpp_stanza_t* const stanza)
 }
 
 static void
-_receipt_request_handler(xmpp_stanza_t* const stanza)
+_receipt_request_handler(xmpp_stanza_t* const stanza, xmpp_stanza_t* const receipts)
 {
     if (!prefs_get_boolean(PREF_RECEIPTS_SEND)) {
         return;
@@ -1244,7 +1379,6 @@ _receipt_request_handler(xmpp_stanza_t* const stanza)
         return;
     }
 
-    xmpp_stanza_t* receipts = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_RECEIPTS);
     if (!receipts) {
         return;
     }
@@ -1360,13 +1494,13 @@ _handle_carbons(xmpp_stanza_t* const stanza)
 }
 
 static void
-_handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, const char* result_id, GDateTime* timestamp)
+_handle_chat(xmpp_stanza_t* const stanza, const ProfMessageExtensions* const ext, gboolean is_mam, gboolean is_carbon, const char* result_id, GDateTime* timestamp)
 {
     // some clients send the mucuser namespace with private messages
     // if the namespace exists, and the stanza contains a body element, assume its a private message
     // otherwise exit the handler
-    xmpp_stanza_t* mucuser = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_MUC_USER);
-    xmpp_stanza_t* body = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_BODY);
+    xmpp_stanza_t* mucuser = ext->mucuser;
+    xmpp_stanza_t* body = ext->body;
     if (mucuser && body == NULL) {
         return;
     }
@@ -1422,9 +1556,8 @@ _handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, c
     } else {
         // live messages use XEP-0359 <stanza-id>
         char* stanzaid = NULL;
-        xmpp_stanza_t* stanzaidst = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_STANZA_ID, STANZA_NS_STABLE_ID);
-        if (stanzaidst) {
-            stanzaid = (char*)xmpp_stanza_get_attribute(stanzaidst, STANZA_ATTR_ID);
+        if (ext->stanza_id) {
+            stanzaid = (char*)xmpp_stanza_get_attribute(ext->stanza_id, STANZA_ATTR_ID);
             if (stanzaid) {
                 message->stanzaid = strdup(stanzaid);
             }
@@ -1432,9 +1565,8 @@ _handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, c
     }
 
     // replace id for XEP-0308: Last Message Correction
-    xmpp_stanza_t* replace_id_stanza = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_LAST_MESSAGE_CORRECTION);
-    if (replace_id_stanza) {
-        const char* replace_id = xmpp_stanza_get_id(replace_id_stanza);
+    if (ext->replace) {
+        const char* replace_id = xmpp_stanza_get_id(ext->replace);
         if (replace_id) {
             message->replace_id = strdup(replace_id);
         }
@@ -1463,13 +1595,11 @@ _handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, c
     }
 #endif
 
-    xmpp_stanza_t* encrypted = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_ENCRYPTED);
-    if (encrypted) {
-        message->encrypted = xmpp_stanza_get_text(encrypted);
+    if (ext->encrypted) {
+        message->encrypted = xmpp_stanza_get_text(ext->encrypted);
     }
 
-    xmpp_stanza_t* ox = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_OPENPGP_0);
-    if (ox) {
+    if (ext->ox) {
         _handle_ox_chat(stanza, message, FALSE);
     }
 
@@ -1488,14 +1618,14 @@ _handle_chat(xmpp_stanza_t* const stanza, gboolean is_mam, gboolean is_carbon, c
             free(mybarejid);
         } else {
             sv_ev_incoming_message(message);
-            _receipt_request_handler(stanza);
+            _receipt_request_handler(stanza, ext->receipt);
         }
     }
 
     // 0085 works only with resource
     if (jid->resourcepart) {
         // XEP-0085: Chat Stase Notifications
-        _handle_chat_states(stanza, jid);
+        _handle_chat_states(ext, jid);
     }
 
     message_free(message);
@@ -1543,9 +1673,8 @@ _handle_ox_chat(xmpp_stanza_t* const stanza, ProfMessage* message, gboolean is_m
 }
 
 static gboolean
-_handle_mam(xmpp_stanza_t* const stanza)
+_handle_mam(xmpp_stanza_t* const result)
 {
-    xmpp_stanza_t* result = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_RESULT, STANZA_NS_MAM2);
     if (!result) {
         return FALSE;
     }
@@ -1563,8 +1692,17 @@ _handle_mam(xmpp_stanza_t* const stanza)
     GDateTime* timestamp = stanza_get_delay_from(forwarded, NULL);
 
     xmpp_stanza_t* message_stanza = xmpp_stanza_get_child_by_ns(forwarded, "jabber:client");
+    if (!message_stanza) {
+        log_warning("MAM received with no message element");
+        if (timestamp) {
+            g_date_time_unref(timestamp);
+        }
+        return TRUE;
+    }
 
-    _handle_chat(message_stanza, TRUE, FALSE, result_id, timestamp);
+    ProfMessageExtensions ext;
+    _message_extensions_scan(message_stanza, &ext);
+    _handle_chat(message_stanza, &ext, TRUE, FALSE, result_id, timestamp);
 
     return TRUE;
 }
@@ -1727,10 +1865,8 @@ message_request_voice(const char* const roomjid)
 }
 
 static gboolean
-_handle_jingle_message(xmpp_stanza_t* const stanza)
+_handle_jingle_message(xmpp_stanza_t* const stanza, xmpp_stanza_t* const propose)
 {
-    xmpp_stanza_t* propose = xmpp_stanza_get_child_by_name_and_ns(stanza, STANZA_NAME_PROPOSE, STANZA_NS_JINGLE_MESSAGE);
-
     if (propose) {
         xmpp_stanza_t* description = xmpp_stanza_get_child_by_ns(propose, STANZA_NS_JINGLE_RTP);
         if (description) {
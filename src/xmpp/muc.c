@@ -81,6 +81,9 @@ GHashTable* invite_passwords = NULL;
 Autocomplete invite_ac = NULL;
 Autocomplete confservers_ac = NULL;
 
+// room -> time of the last logged message when the room was joined
+static GHashTable* history_since = NULL;
+
 static void _free_room(ChatRoom* room);
 static gint _compare_occupants(Occupant* a, Occupant* b);
 static muc_role_t _role_from_string(const char* const role);
@@ -98,6 +101,7 @@ muc_init(void)
     confservers_ac = autocomplete_new();
     rooms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_free_room);
     invite_passwords = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    history_since = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_date_time_unref);
 }
 
 void
@@ -107,8 +111,10 @@ muc_close(void)
     autocomplete_free(confservers_ac);
     g_hash_table_destroy(rooms);
     g_hash_table_destroy(invite_passwords);
+    g_hash_table_destroy(history_since);
     rooms = NULL;
     invite_passwords = NULL;
+    history_since = NULL;
     invite_ac = NULL;
     confservers_ac = NULL;
 }
@@ -245,6 +251,33 @@ void
 muc_leave(const char* const room)
 {
     g_hash_table_remove(rooms, room);
+    g_hash_table_remove(history_since, room);
+}
+
+void
+muc_set_history_since(const char* const room, GDateTime* since)
+{
+    if (since) {
+        g_hash_table_replace(history_since, strdup(room), g_date_time_ref(since));
+    } else {
+        g_hash_table_remove(history_since, room);
+    }
+}
+
+/*
+ * Whether a message the room replays on join was already logged, and so
+ * shown with the room history, when it is stamped at or before the time
+ * the join asked for history since.
+ */
+gboolean
+muc_history_is_logged(const char* const room, GDateTime* timestamp)
+{
+    GDateTime* since = g_hash_table_lookup(history_since, room);
+    if (!since || !timestamp) {
+        return FALSE;
+    }
+
+    return g_date_time_compare(timestamp, since) <= 0;
 }
 
 gboolean
@@ -86,6 +86,8 @@ void muc_close(void);
 
 void muc_join(const char* const room, const char* const nick, const char* const password, gboolean autojoin);
 void muc_leave(const char* const room);
+void muc_set_history_since(const char* const room, GDateTime* since);
+gboolean muc_history_is_logged(const char* const room, GDateTime* timestamp);
 
 gboolean muc_active(const char* const room);
 gboolean muc_autojoin(const char* const room);
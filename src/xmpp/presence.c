@@ -47,10 +47,13 @@
 #include "profanity.h"
 #include "log.h"
 #include "common.h"
+#include "database.h"
 #include "config/preferences.h"
 #include "event/server_events.h"
 #include "plugins/plugins.h"
+#include "tools/stats.h"
 #include "ui/ui.h"
+#include "ui/window_list.h"
 #include "xmpp/connection.h"
 #include "xmpp/capabilities.h"
 #include "xmpp/session.h"
@@ -59,9 +62,40 @@
 #include "xmpp/xmpp.h"
 #include "xmpp/muc.h"
 
+// seconds to wait for a queued room join before giving up on its slot
+#define JOIN_QUEUE_TIMEOUT 30
+
+typedef struct pending_join_t
+{
+    char* room;
+    char* nick;
+    char* passwd;
+    gboolean affiliations;
+    int priority;
+    GTimer* started;
+} PendingJoin;
+
+typedef struct pending_presence_t
+{
+    resource_presence_t presence_type;
+    int idle;
+    char* signed_status;
+} PendingPresence;
+
 static Autocomplete sub_requests_ac;
 
+// own presence waiting for the end of the event loop iteration, a newer one replaces it
+static PendingPresence* pending_presence = NULL;
+
+// joins waiting for a free slot, ordered by priority
+static GList* join_queue = NULL;
+// joins sent, waiting for our own presence from the room
+static GList* join_inflight = NULL;
+static int join_total = 0;
+static int join_done = 0;
+
 static int _presence_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
+static int _presence_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata);
 
 static void _presence_error_handler(xmpp_stanza_t* const stanza);
 static void _unavailable_handler(xmpp_stanza_t* const stanza);
@@ -74,6 +108,15 @@ static void _available_handler(xmpp_stanza_t* const stanza);
 void _send_caps_request(char* node, char* caps_key, char* id, char* from);
 static void _send_room_presence(xmpp_stanza_t* presence);
 static void _send_presence_stanza(xmpp_stanza_t* const stanza);
+static void _send_own_presence(PendingPresence* pending);
+static void _pending_presence_free(PendingPresence* pending);
+
+static void _join_queue_process(void);
+static void _join_queue_complete(const char* const room);
+static void _pending_join_free(PendingJoin* join);
+static gint _pending_join_cmp(PendingJoin* join, const char* const room);
+static gint _pending_join_priority_cmp(PendingJoin* a, PendingJoin* b);
+static int _join_priority(const char* const room);
 
 void
 presence_sub_requests_init(void)
@@ -202,6 +245,66 @@ presence_send(const resource_presence_t presence_type, const int idle, char* sig
     const int pri = accounts_get_priority_for_presence_type(session_get_account_name(), presence_type);
     connection_set_priority(pri);
 
+    // set last presence for account
+    const char* last = stanza_get_presence_string_from_type(presence_type);
+    if (last == NULL) {
+        last = STANZA_TEXT_ONLINE;
+    }
+
+    char* account = session_get_account_name();
+    accounts_set_last_presence(account, last);
+    accounts_set_last_status(account, msg);
+
+    if (pending_presence) {
+        log_debug("Dropping superseded presence update");
+        stats_count(PROF_STATS_PRESENCE_DROPPED);
+        _pending_presence_free(pending_presence);
+    }
+
+    pending_presence = malloc(sizeof(PendingPresence));
+    pending_presence->presence_type = presence_type;
+    pending_presence->idle = idle;
+    pending_presence->signed_status = signed_status ? strdup(signed_status) : NULL;
+}
+
+void
+presence_flush(void)
+{
+    if (!pending_presence) {
+        return;
+    }
+
+    // take it first, sending goes through _send_presence_stanza which flushes too
+    PendingPresence* pending = pending_presence;
+    pending_presence = NULL;
+
+    if (connection_get_status() == JABBER_CONNECTED) {
+        _send_own_presence(pending);
+    } else {
+        stats_count(PROF_STATS_PRESENCE_DROPPED);
+    }
+    _pending_presence_free(pending);
+}
+
+static void
+_pending_presence_free(PendingPresence* pending)
+{
+    if (pending) {
+        free(pending->signed_status);
+        free(pending);
+    }
+}
+
+static void
+_send_own_presence(PendingPresence* pending)
+{
+    const resource_presence_t presence_type = pending->presence_type;
+    const int idle = pending->idle;
+    const char* const signed_status = pending->signed_status;
+
+    char* msg = connection_get_presence_msg();
+    const int pri = accounts_get_priority_for_presence_type(session_get_account_name(), presence_type);
+
     xmpp_ctx_t* const ctx = connection_get_ctx();
     xmpp_stanza_t* presence = xmpp_presence_new(ctx);
 
@@ -242,15 +345,7 @@ presence_send(const resource_presence_t presence_type, const int idle, char* sig
 
     xmpp_stanza_release(presence);
 
-    // set last presence for account
-    const char* last = show;
-    if (last == NULL) {
-        last = STANZA_TEXT_ONLINE;
-    }
-
-    char* account = session_get_account_name();
-    accounts_set_last_presence(account, last);
-    accounts_set_last_status(account, msg);
+    stats_count(PROF_STATS_PRESENCE_SENT);
 }
 
 static void
@@ -287,8 +382,15 @@ presence_join_room(const char* const room, const char* const nick, const char* c
     char* status = connection_get_presence_msg();
     int pri = accounts_get_priority_for_presence_type(session_get_account_name(), presence_type);
 
+    // the room window shows the logged history, the server only has to send what came after it
+    GDateTime* history_since = NULL;
+    if (prefs_get_boolean(PREF_CHLOG) && prefs_get_boolean(PREF_HISTORY)) {
+        history_since = log_database_get_last_timestamp(room);
+    }
+    muc_set_history_since(room, history_since);
+
     xmpp_ctx_t* ctx = connection_get_ctx();
-    xmpp_stanza_t* presence = stanza_create_room_join_presence(ctx, jid->fulljid, passwd);
+    xmpp_stanza_t* presence = stanza_create_room_join_presence(ctx, jid->fulljid, passwd, history_since);
     stanza_attach_show(ctx, presence, show);
     stanza_attach_status(ctx, presence, status);
     stanza_attach_priority(ctx, presence, pri);
@@ -297,9 +399,80 @@ presence_join_room(const char* const room, const char* const nick, const char* c
     _send_presence_stanza(presence);
 
     xmpp_stanza_release(presence);
+    if (history_since) {
+        g_date_time_unref(history_since);
+    }
     jid_destroy(jid);
 }
 
+void
+presence_join_room_queued(const char* const room, const char* const nick, const char* const passwd, gboolean affiliations)
+{
+    assert(room != NULL);
+    assert(nick != NULL);
+
+    if (g_list_find_custom(join_queue, room, (GCompareFunc)_pending_join_cmp)
+        || g_list_find_custom(join_inflight, room, (GCompareFunc)_pending_join_cmp)) {
+        return;
+    }
+
+    PendingJoin* join = malloc(sizeof(PendingJoin));
+    join->room = strdup(room);
+    join->nick = strdup(nick);
+    join->passwd = passwd ? strdup(passwd) : NULL;
+    join->affiliations = affiliations;
+    join->priority = _join_priority(room);
+    join->started = NULL;
+
+    log_debug("Queueing room join for %s, priority %d", room, join->priority);
+    join_queue = g_list_insert_sorted(join_queue, join, (GCompareFunc)_pending_join_priority_cmp);
+    join_total++;
+
+    _join_queue_process();
+}
+
+void
+presence_join_queue_check(void)
+{
+    if (!join_inflight) {
+        return;
+    }
+
+    gboolean expired = FALSE;
+    GList* curr = join_inflight;
+    while (curr) {
+        GList* next = g_list_next(curr);
+        PendingJoin* join = curr->data;
+        if (g_timer_elapsed(join->started, NULL) > JOIN_QUEUE_TIMEOUT) {
+            log_warning("No response joining room %s, releasing join slot", join->room);
+            join_inflight = g_list_delete_link(join_inflight, curr);
+            _pending_join_free(join);
+            join_done++;
+            expired = TRUE;
+        }
+        curr = next;
+    }
+
+    if (expired) {
+        _join_queue_process();
+    }
+}
+
+void
+presence_join_queue_clear(void)
+{
+    if (join_queue || join_inflight) {
+        status_bar_clear_progress();
+    }
+
+    g_list_free_full(join_queue, (GDestroyNotify)_pending_join_free);
+    g_list_free_full(join_inflight, (GDestroyNotify)_pending_join_free);
+    join_queue = NULL;
+    join_inflight = NULL;
+    join_total = 0;
+    join_done = 0;
+}
+
 void
 presence_change_room_nick(const char* const room, const char* const nick)
 {
@@ -349,6 +522,16 @@ presence_leave_chat_room(const char* const room_jid)
 
 static int
 _presence_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
+{
+    gint64 start = stats_start();
+    int result = _presence_handler_internal(conn, stanza, userdata);
+    stats_end(PROF_STATS_PRESENCE_HANDLER, start);
+
+    return result;
+}
+
+static int
+_presence_handler_internal(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const userdata)
 {
     log_debug("Presence stanza handler fired");
 
@@ -423,6 +606,7 @@ _presence_error_handler(xmpp_stanza_t* const stanza)
             muc_leave(fulljid->barejid);
         }
         cons_show_error("Error joining room %s, reason: %s", fulljid->barejid, error_cond);
+        _join_queue_complete(fulljid->barejid);
         jid_destroy(fulljid);
 
         return;
@@ -772,6 +956,7 @@ _muc_user_self_handler(xmpp_stanza_t* stanza)
             }
         }
         sv_ev_muc_self_online(room, nick, config_required, role, affiliation, actor, reason, jid, show_str, status_str);
+        _join_queue_complete(room);
         free(show_str);
         free(status_str);
         free(reason);
@@ -899,6 +1084,9 @@ _muc_user_handler(xmpp_stanza_t* const stanza)
 static void
 _send_presence_stanza(xmpp_stanza_t* const stanza)
 {
+    // keep our own presence ahead of anything sent after it
+    presence_flush();
+
     char* text;
     size_t text_size;
     xmpp_stanza_to_text(stanza, &text, &text_size);
@@ -913,3 +1101,101 @@ _send_presence_stanza(xmpp_stanza_t* const stanza)
     }
     xmpp_free(connection_get_ctx(), text);
 }
+
+static void
+_pending_join_free(PendingJoin* join)
+{
+    if (join) {
+        free(join->room);
+        free(join->nick);
+        free(join->passwd);
+        if (join->started) {
+            g_timer_destroy(join->started);
+        }
+        free(join);
+    }
+}
+
+static gint
+_pending_join_cmp(PendingJoin* join, const char* const room)
+{
+    return g_strcmp0(join->room, room);
+}
+
+static gint
+_pending_join_priority_cmp(PendingJoin* a, PendingJoin* b)
+{
+    return a->priority - b->priority;
+}
+
+// lower is joined first: the focused room, rooms with unread messages,
+// rooms that already have a window, then everything else
+static int
+_join_priority(const char* const room)
+{
+    ProfMucWin* mucwin = wins_get_muc(room);
+    if (!mucwin) {
+        return 3;
+    }
+    if (wins_get_current() == (ProfWin*)mucwin) {
+        return 0;
+    }
+    if (mucwin->unread > 0) {
+        return 1;
+    }
+    return 2;
+}
+
+static void
+_join_queue_process(void)
+{
+    gint limit = prefs_get_room_join_limit();
+
+    while (join_queue && (limit <= 0 || (gint)g_list_length(join_inflight) < limit)) {
+        PendingJoin* join = join_queue->data;
+        join_queue = g_list_delete_link(join_queue, join_queue);
+
+        // room was left while waiting for a slot
+        if (!muc_active(join->room)) {
+            _pending_join_free(join);
+            join_done++;
+            continue;
+        }
+
+        presence_join_room(join->room, join->nick, join->passwd);
+        if (join->affiliations) {
+            iq_room_affiliation_list(join->room, "member", false);
+            iq_room_affiliation_list(join->room, "admin", false);
+            iq_room_affiliation_list(join->room, "owner", false);
+        }
+        join->started = g_timer_new();
+        join_inflight = g_list_append(join_inflight, join);
+    }
+
+    if (join_queue || join_inflight) {
+        char* progress = g_strdup_printf("Joining rooms %d/%d", join_done, join_total);
+        status_bar_set_progress(progress);
+        g_free(progress);
+    } else if (join_total > 0) {
+        log_info("Joined %d queued rooms", join_total);
+        status_bar_clear_progress();
+        join_total = 0;
+        join_done = 0;
+    }
+}
+
+static void
+_join_queue_complete(const char* const room)
+{
+    GList* found = g_list_find_custom(join_inflight, room, (GCompareFunc)_pending_join_cmp);
+    if (!found) {
+        return;
+    }
+
+    PendingJoin* join = found->data;
+    join_inflight = g_list_delete_link(join_inflight, found);
+    _pending_join_free(join);
+    join_done++;
+
+    _join_queue_process();
+}
@@ -39,5 +39,8 @@
 void presence_handlers_init(void);
 void presence_sub_requests_init(void);
 void presence_clear_sub_requests(void);
+void presence_join_queue_check(void);
+void presence_join_queue_clear(void);
+void presence_flush(void);
 
 #endif
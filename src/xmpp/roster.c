@@ -40,11 +40,15 @@
 #include <string.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
 
 #include <strophe.h>
 
 #include "profanity.h"
 #include "log.h"
+#include "common.h"
+#include "config/files.h"
 #include "config/preferences.h"
 #include "plugins/plugins.h"
 #include "event/server_events.h"
@@ -66,16 +70,143 @@ typedef struct _group_data
     char* group;
 } GroupData;
 
+#define ROSTER_CACHE_GROUP "roster"
+
+// roster of the last session, used when the server answers the versioned
+// request with an empty result because nothing changed (RFC 6121 2.6)
+static GKeyFile* roster_cache = NULL;
+
 // id handlers
 static int _group_add_id_handler(xmpp_stanza_t* const stanza, void* const userdata);
 static int _group_remove_id_handler(xmpp_stanza_t* const stanza, void* const userdata);
 static void _free_group_data(GroupData* data);
 
+static gchar*
+_roster_cache_path(void)
+{
+    char* barejid = connection_get_barejid();
+    if (!barejid) {
+        return NULL;
+    }
+    gchar* path = files_file_in_account_data_path(DIR_ROSTER, barejid, "roster");
+    free(barejid);
+
+    return path;
+}
+
+static void
+_roster_cache_free(void)
+{
+    if (roster_cache) {
+        g_key_file_free(roster_cache);
+        roster_cache = NULL;
+    }
+}
+
+// Add the contacts of the cached roster to the local roster
+static void
+_roster_cache_apply(void)
+{
+    gsize count = 0;
+    gchar** sections = g_key_file_get_groups(roster_cache, &count);
+
+    for (gsize i = 0; i < count; i++) {
+        if (g_strcmp0(sections[i], ROSTER_CACHE_GROUP) == 0) {
+            continue;
+        }
+
+        auto_gchar gchar* barejid = g_key_file_get_string(roster_cache, sections[i], "jid", NULL);
+        if (!barejid) {
+            continue;
+        }
+        auto_gchar gchar* name = g_key_file_get_string(roster_cache, sections[i], "name", NULL);
+        auto_gchar gchar* sub = g_key_file_get_string(roster_cache, sections[i], "subscription", NULL);
+        gboolean pending_out = g_key_file_get_boolean(roster_cache, sections[i], "pending_out", NULL);
+
+        GSList* groups = NULL;
+        gchar** group_names = g_key_file_get_string_list(roster_cache, sections[i], "groups", NULL, NULL);
+        for (int j = 0; group_names && group_names[j]; j++) {
+            groups = g_slist_append(groups, strdup(group_names[j]));
+        }
+        g_strfreev(group_names);
+
+        if (!roster_add(barejid, name, groups, sub, pending_out)) {
+            log_warning("Attempt to add contact twice: %s", barejid);
+        }
+    }
+
+    g_strfreev(sections);
+}
+
+// Write the local roster at version ver, servers without roster versioning
+// send no ver and nothing is cached
+static void
+_roster_cache_save(const char* const ver)
+{
+    if (!ver) {
+        return;
+    }
+
+    auto_gchar gchar* path = _roster_cache_path();
+    if (!path) {
+        return;
+    }
+
+    GKeyFile* cache = g_key_file_new();
+    g_key_file_set_string(cache, ROSTER_CACHE_GROUP, "ver", ver);
+
+    GSList* contacts = roster_get_contacts(ROSTER_ORD_NAME);
+    int index = 0;
+    for (GSList* curr = contacts; curr; curr = g_slist_next(curr)) {
+        PContact contact = curr->data;
+        auto_gchar gchar* section = g_strdup_printf("contact%d", index++);
+
+        g_key_file_set_string(cache, section, "jid", p_contact_barejid(contact));
+        if (p_contact_name(contact)) {
+            g_key_file_set_string(cache, section, "name", p_contact_name(contact));
+        }
+        if (p_contact_subscription(contact)) {
+            g_key_file_set_string(cache, section, "subscription", p_contact_subscription(contact));
+        }
+        g_key_file_set_boolean(cache, section, "pending_out", p_contact_pending_out(contact));
+
+        GPtrArray* groups = g_ptr_array_new();
+        for (GSList* group = p_contact_groups(contact); group; group = g_slist_next(group)) {
+            g_ptr_array_add(groups, group->data);
+        }
+        g_key_file_set_string_list(cache, section, "groups", (const gchar* const*)groups->pdata, groups->len);
+        g_ptr_array_free(groups, TRUE);
+    }
+    g_slist_free(contacts);
+
+    gsize data_size;
+    auto_gchar gchar* data = g_key_file_to_data(cache, &data_size, NULL);
+    if (!g_file_set_contents(path, data, data_size, NULL)) {
+        log_warning("Could not write roster cache: %s", path);
+    }
+    g_chmod(path, S_IRUSR | S_IWUSR);
+    g_key_file_free(cache);
+}
+
 void
 roster_request(void)
 {
+    _roster_cache_free();
+
+    auto_gchar gchar* ver = NULL;
+    auto_gchar gchar* path = _roster_cache_path();
+    if (path && g_file_test(path, G_FILE_TEST_EXISTS)) {
+        roster_cache = g_key_file_new();
+        if (g_key_file_load_from_file(roster_cache, path, G_KEY_FILE_NONE, NULL)) {
+            ver = g_key_file_get_string(roster_cache, ROSTER_CACHE_GROUP, "ver", NULL);
+        }
+        if (!ver) {
+            _roster_cache_free();
+        }
+    }
+
     xmpp_ctx_t* const ctx = connection_get_ctx();
-    xmpp_stanza_t* iq = stanza_create_roster_iq(ctx);
+    xmpp_stanza_t* iq = stanza_create_roster_iq(ctx, ver);
     iq_send_stanza(iq);
     xmpp_stanza_release(iq);
 }
@@ -258,6 +389,8 @@ roster_set_handler(xmpp_stanza_t* const stanza)
 
     g_free(barejid_lower);
 
+    _roster_cache_save(xmpp_stanza_get_attribute(query, STANZA_ATTR_VER));
+
     return;
 }
 
@@ -272,7 +405,18 @@ roster_result_handler(xmpp_stanza_t* const stanza)
 
     // handle initial roster response
     xmpp_stanza_t* query = xmpp_stanza_get_child_by_name(stanza, STANZA_NAME_QUERY);
-    xmpp_stanza_t* item = xmpp_stanza_get_children(query);
+
+    // the roster did not change since the cached version, changes arrive as pushes
+    if (!query && roster_cache) {
+        log_debug("Roster unchanged, using cached roster");
+        _roster_cache_apply();
+        _roster_cache_free();
+        sv_ev_roster_received();
+        return;
+    }
+    _roster_cache_free();
+
+    xmpp_stanza_t* item = query ? xmpp_stanza_get_children(query) : NULL;
 
     while (item) {
         const char* barejid = xmpp_stanza_get_attribute(item, STANZA_ATTR_JID);
@@ -301,6 +445,10 @@ roster_result_handler(xmpp_stanza_t* const stanza)
         item = xmpp_stanza_get_next(item);
     }
 
+    if (query) {
+        _roster_cache_save(xmpp_stanza_get_attribute(query, STANZA_ATTR_VER));
+    }
+
     sv_ev_roster_received();
 
     return;
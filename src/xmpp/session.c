@@ -59,6 +59,7 @@
 #include "xmpp/xmpp.h"
 #include "xmpp/muc.h"
 #include "xmpp/chat_session.h"
+#include "xmpp/chat_state.h"
 #include "xmpp/jid.h"
 
 #ifdef HAVE_OMEMO
@@ -222,12 +223,15 @@ session_disconnect(void)
         iq_rooms_cache_clear();
         iq_handlers_clear();
 
+        presence_flush();
+        chat_state_flush(TRUE);
         connection_disconnect();
         message_handlers_clear();
 
         connection_clear_data();
         chat_sessions_clear();
         presence_clear_sub_requests();
+        presence_join_queue_clear();
     }
 
     connection_set_disconnected();
@@ -252,6 +256,11 @@ session_process_events(void)
 {
     int reconnect_sec;
 
+    // hand coalesced updates to libstrophe so they go out with this iteration's writes,
+    // or drop them when the connection is gone
+    presence_flush();
+    chat_state_flush(FALSE);
+
     jabber_conn_status_t conn_status = connection_get_status();
     switch (conn_status) {
     case JABBER_CONNECTED:
@@ -260,6 +269,7 @@ session_process_events(void)
     case JABBER_RAW_CONNECTING:
     case JABBER_DISCONNECTING:
         connection_check_events();
+        presence_join_queue_check();
         break;
     case JABBER_DISCONNECTED:
         reconnect_sec = prefs_get_reconnect();
@@ -325,6 +335,7 @@ session_login_success(gboolean secured)
 
     message_handlers_init();
     presence_handlers_init();
+    presence_join_queue_clear();
     iq_handlers_init();
 
     // logged in with account
@@ -393,6 +404,7 @@ session_lost_connection(void)
 {
     /* this callback also clears all cached data */
     sv_ev_lost_connection();
+    presence_join_queue_clear();
     if (prefs_get_reconnect() != 0) {
         assert(reconnect_timer == NULL);
         reconnect_timer = g_timer_new();
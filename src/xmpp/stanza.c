@@ -59,6 +59,7 @@
 #include "xmpp/form.h"
 #include "xmpp/muc.h"
 #include "database.h"
+#include "tools/timestamp.h"
 
 static void _stanza_add_unique_id(xmpp_stanza_t* stanza);
 static char* _stanza_create_sha1_hash(char* str);
@@ -542,7 +543,7 @@ stanza_create_mediated_invite(xmpp_ctx_t* ctx, const char* const room,
 
 xmpp_stanza_t*
 stanza_create_room_join_presence(xmpp_ctx_t* const ctx,
-                                 const char* const full_room_jid, const char* const passwd)
+                                 const char* const full_room_jid, const char* const passwd, GDateTime* history_since)
 {
     xmpp_stanza_t* presence = xmpp_presence_new(ctx);
     xmpp_stanza_set_to(presence, full_room_jid);
@@ -563,6 +564,18 @@ stanza_create_room_join_presence(xmpp_ctx_t* const ctx,
         xmpp_stanza_release(pass);
     }
 
+    // only ask for the room history we have not logged yet, whole seconds would
+    // have the server resend the messages logged within the last second
+    if (history_since) {
+        auto_gchar gchar* since = timestamp_to_iso8601_usec(history_since);
+
+        xmpp_stanza_t* history = xmpp_stanza_new(ctx);
+        xmpp_stanza_set_name(history, STANZA_NAME_HISTORY);
+        xmpp_stanza_set_attribute(history, STANZA_ATTR_SINCE, since);
+        xmpp_stanza_add_child(x, history);
+        xmpp_stanza_release(history);
+    }
+
     xmpp_stanza_add_child(presence, x);
     xmpp_stanza_release(x);
 
@@ -873,13 +886,16 @@ stanza_create_software_version_iq(xmpp_ctx_t* ctx, const char* const fulljid)
 }
 
 xmpp_stanza_t*
-stanza_create_roster_iq(xmpp_ctx_t* ctx)
+stanza_create_roster_iq(xmpp_ctx_t* ctx, const char* const ver)
 {
     xmpp_stanza_t* iq = xmpp_iq_new(ctx, STANZA_TYPE_GET, "roster");
 
     xmpp_stanza_t* query = xmpp_stanza_new(ctx);
     xmpp_stanza_set_name(query, STANZA_NAME_QUERY);
     xmpp_stanza_set_ns(query, XMPP_NS_ROSTER);
+    if (ver) {
+        xmpp_stanza_set_attribute(query, STANZA_ATTR_VER, ver);
+    }
 
     xmpp_stanza_add_child(iq, query);
     xmpp_stanza_release(query);
@@ -1167,20 +1183,11 @@ stanza_get_delay(xmpp_stanza_t* const stanza)
 static GDateTime*
 _stanza_get_delay_timestamp_xep0203(xmpp_stanza_t* const delay_stanza)
 {
-    GTimeVal utc_stamp;
     const char* xmlns = xmpp_stanza_get_attribute(delay_stanza, STANZA_ATTR_XMLNS);
 
     if (xmlns && (g_strcmp0(xmlns, "urn:xmpp:delay") == 0)) {
         const char* stamp = xmpp_stanza_get_attribute(delay_stanza, STANZA_ATTR_STAMP);
-
-        if (stamp && (g_time_val_from_iso8601(stamp, &utc_stamp))) {
-
-            GDateTime* datetime = g_date_time_new_from_iso8601(stamp, NULL);
-            GDateTime* local_datetime = g_date_time_to_local(datetime);
-            g_date_time_unref(datetime);
-
-            return local_datetime;
-        }
+        return timestamp_local_from_iso8601(stamp);
     }
 
     return NULL;
@@ -1189,19 +1196,12 @@ _stanza_get_delay_timestamp_xep0203(xmpp_stanza_t* const delay_stanza)
 static GDateTime*
 _stanza_get_delay_timestamp_xep0091(xmpp_stanza_t* const x_stanza)
 {
-    GTimeVal utc_stamp;
     const char* xmlns = xmpp_stanza_get_attribute(x_stanza, STANZA_ATTR_XMLNS);
 
     if (xmlns && (g_strcmp0(xmlns, "jabber:x:delay") == 0)) {
+        // stamps without a zone are UTC here
         const char* stamp = xmpp_stanza_get_attribute(x_stanza, STANZA_ATTR_STAMP);
-        if (stamp && (g_time_val_from_iso8601(stamp, &utc_stamp))) {
-
-            GDateTime* datetime = g_date_time_new_from_iso8601(stamp, NULL);
-            GDateTime* local_datetime = g_date_time_to_local(datetime);
-            g_date_time_unref(datetime);
-
-            return local_datetime;
-        }
+        return timestamp_local_from_iso8601(stamp);
     }
 
     return NULL;
@@ -2721,7 +2721,7 @@ stanza_attach_correction(xmpp_ctx_t* ctx, xmpp_stanza_t* stanza, const char* con
 }
 
 xmpp_stanza_t*
-stanza_create_mam_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const startdate, const char* const enddate, const char* const firstid, const char* const lastid)
+stanza_create_mam_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const startdate, const char* const enddate, const char* const firstid, const char* const lastid, int max_results)
 {
     char* id = connection_create_stanza_id();
     xmpp_stanza_t* iq = xmpp_iq_new(ctx, STANZA_TYPE_SET, id);
@@ -2809,7 +2809,7 @@ stanza_create_mam_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const s
     xmpp_stanza_set_name(max, STANZA_NAME_MAX);
 
     max_text = xmpp_stanza_new(ctx);
-    char* txt = g_strdup_printf("%d", MESSAGES_TO_RETRIEVE);
+    char* txt = g_strdup_printf("%d", max_results);
     xmpp_stanza_set_text(max_text, txt);
     g_free(txt);
 
@@ -90,6 +90,7 @@
 #define STANZA_NAME_STORAGE          "storage"
 #define STANZA_NAME_NICK             "nick"
 #define STANZA_NAME_PASSWORD         "password"
+#define STANZA_NAME_HISTORY          "history"
 #define STANZA_NAME_CONFERENCE       "conference"
 #define STANZA_NAME_VALUE            "value"
 #define STANZA_NAME_DESTROY          "destroy"
@@ -192,6 +193,7 @@
 #define STANZA_ATTR_PASSWORD       "password"
 #define STANZA_ATTR_STATUS         "status"
 #define STANZA_ATTR_DATE           "date"
+#define STANZA_ATTR_SINCE          "since"
 #define STANZA_ATTR_V4_FINGERPRINT "v4-fingerprint"
 #define STANZA_ATTR_FILENAME       "filename"
 #define STANZA_ATTR_SIZE           "size"
@@ -305,7 +307,7 @@ xmpp_stanza_t* stanza_attach_origin_id(xmpp_ctx_t* ctx, xmpp_stanza_t* stanza, c
 xmpp_stanza_t* stanza_attach_correction(xmpp_ctx_t* ctx, xmpp_stanza_t* stanza, const char* const replace_id);
 
 xmpp_stanza_t* stanza_create_room_join_presence(xmpp_ctx_t* const ctx,
-                                                const char* const full_room_jid, const char* const passwd);
+                                                const char* const full_room_jid, const char* const passwd, GDateTime* history_since);
 
 xmpp_stanza_t* stanza_create_room_newnick_presence(xmpp_ctx_t* ctx,
                                                    const char* const full_room_jid);
@@ -313,7 +315,7 @@ xmpp_stanza_t* stanza_create_room_newnick_presence(xmpp_ctx_t* ctx,
 xmpp_stanza_t* stanza_create_room_leave_presence(xmpp_ctx_t* ctx,
                                                  const char* const room, const char* const nick);
 
-xmpp_stanza_t* stanza_create_roster_iq(xmpp_ctx_t* ctx);
+xmpp_stanza_t* stanza_create_roster_iq(xmpp_ctx_t* ctx, const char* const ver);
 xmpp_stanza_t* stanza_create_ping_iq(xmpp_ctx_t* ctx, const char* const target);
 xmpp_stanza_t* stanza_create_disco_info_iq(xmpp_ctx_t* ctx, const char* const id,
                                            const char* const to, const char* const node);
@@ -419,7 +421,7 @@ xmpp_stanza_t* stanza_create_avatar_retrieve_data_request(xmpp_ctx_t* ctx, const
 xmpp_stanza_t* stanza_create_avatar_data_publish_iq(xmpp_ctx_t* ctx, const char* img_data, gsize len);
 xmpp_stanza_t* stanza_create_avatar_metadata_publish_iq(xmpp_ctx_t* ctx, const char* img_data, gsize len, int height, int width);
 xmpp_stanza_t* stanza_create_vcard_request_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const stanza_id);
-xmpp_stanza_t* stanza_create_mam_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const startdate, const char* const enddate, const char* const firstid, const char* const lastid);
+xmpp_stanza_t* stanza_create_mam_iq(xmpp_ctx_t* ctx, const char* const jid, const char* const startdate, const char* const enddate, const char* const firstid, const char* const lastid, int max_results);
 xmpp_stanza_t* stanza_change_password(xmpp_ctx_t* ctx, const char* const user, const char* const password);
 xmpp_stanza_t* stanza_register_new_account(xmpp_ctx_t* ctx, const char* const user, const char* const password);
 xmpp_stanza_t* stanza_request_voice(xmpp_ctx_t* ctx, const char* const room);
@@ -175,6 +175,7 @@ typedef struct prof_message_t
     gboolean trusted;
     gboolean is_mam;
     prof_msg_type_t type;
+    int refcnt;
 } ProfMessage;
 
 void session_init(void);
@@ -228,6 +229,7 @@ gint presence_sub_request_count(void);
 void presence_reset_sub_request_search(void);
 char* presence_sub_request_find(const char* const search_str, gboolean previous, void* context);
 void presence_join_room(const char* const room, const char* const nick, const char* const passwd);
+void presence_join_room_queued(const char* const room, const char* const nick, const char* const passwd, gboolean affiliations);
 void presence_change_room_nick(const char* const room, const char* const nick);
 void presence_leave_chat_room(const char* const room_jid);
 void presence_send(resource_presence_t status, int idle, char* signed_status);
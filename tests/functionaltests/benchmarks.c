@@ -0,0 +1,367 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include <stabber.h>
+#include <expect.h>
+
+#include "proftest.h"
+
+#define PROF_BENCH(test) unit_test_setup_teardown(test, init_prof_test, close_prof_test)
+
+// stanzas sent between two markers, each batch gives one latency sample
+#define BENCH_BATCH 100
+
+#define BENCH_ROSTER_SIZE    5000
+#define BENCH_MUC_OCCUPANTS  2000
+#define BENCH_MAM_MESSAGES   50000
+#define BENCH_PRESENCE_STORM 20000
+
+typedef struct bench_result_t
+{
+    const char* name;
+    int stanzas;
+    gint64 elapsed_us;
+    GArray* batch_us;
+} BenchResult;
+
+static int marker_count = 0;
+
+static pid_t
+_read_ppid(pid_t pid, char* comm, size_t comm_len)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    int ppid = -1;
+    char name[256] = { 0 };
+    if (fscanf(fp, "%*d (%255[^)]) %*c %d", name, &ppid) != 2) {
+        ppid = -1;
+    }
+    fclose(fp);
+
+    if (comm) {
+        g_strlcpy(comm, name, comm_len);
+    }
+
+    return ppid;
+}
+
+// start_profanity.sh runs profanity below the process spawned by expect
+static pid_t
+_prof_pid(void)
+{
+    DIR* proc = opendir("/proc");
+    if (!proc) {
+        return -1;
+    }
+
+    pid_t result = -1;
+    struct dirent* entry;
+    while ((entry = readdir(proc)) != NULL) {
+        pid_t pid = atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+
+        char comm[256];
+        pid_t parent = _read_ppid(pid, comm, sizeof(comm));
+        if (g_strcmp0(comm, "profanity") != 0) {
+            continue;
+        }
+
+        int depth = 0;
+        while (parent > 1 && depth < 4) {
+            if (parent == exp_pid) {
+                result = pid;
+                break;
+            }
+            parent = _read_ppid(parent, NULL, 0);
+            depth++;
+        }
+        if (result != -1) {
+            break;
+        }
+    }
+    closedir(proc);
+
+    return result;
+}
+
+static long
+_peak_rss_kb(void)
+{
+    pid_t pid = _prof_pid();
+    if (pid == -1) {
+        return -1;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    long result = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            result = atol(line + 6);
+            break;
+        }
+    }
+    fclose(fp);
+
+    return result;
+}
+
+// a headline is printed to the console as soon as it is handled, and
+// stanzas are handled in order, so seeing it means everything before
+// it has been processed
+static void
+_wait_for_marker(void)
+{
+    marker_count++;
+
+    char* marker = g_strdup_printf("bench-marker-%d", marker_count);
+    char* stanza = g_strdup_printf(
+        "<message type='headline' to='stabber@localhost/profanity' from='localhost'>"
+            "<body>%s</body>"
+        "</message>",
+        marker);
+    stbbr_send(stanza);
+
+    char* expected = g_strdup_printf("Headline: %s", marker);
+    assert_true(prof_output_exact(expected));
+
+    g_free(expected);
+    g_free(stanza);
+    g_free(marker);
+}
+
+static gint
+_cmp_gint64(gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64*)a;
+    gint64 y = *(const gint64*)b;
+    return (x > y) - (x < y);
+}
+
+static BenchResult*
+_bench_result_new(const char* const name)
+{
+    BenchResult* result = malloc(sizeof(BenchResult));
+    result->name = name;
+    result->stanzas = 0;
+    result->elapsed_us = 0;
+    result->batch_us = g_array_new(FALSE, FALSE, sizeof(gint64));
+    return result;
+}
+
+static void
+_bench_result_report(BenchResult* result)
+{
+    double secs = result->elapsed_us / 1000000.0;
+    double rate = secs > 0 ? result->stanzas / secs : 0;
+
+    printf("\n%s\n", result->name);
+    printf("  stanzas          : %d\n", result->stanzas);
+    printf("  elapsed          : %.3f s\n", secs);
+    printf("  stanzas/sec      : %.0f\n", rate);
+
+    if (result->batch_us->len > 0) {
+        g_array_sort(result->batch_us, _cmp_gint64);
+        guint p50 = (result->batch_us->len - 1) * 50 / 100;
+        guint p99 = (result->batch_us->len - 1) * 99 / 100;
+        printf("  latency p50      : %.1f us/stanza\n", (double)g_array_index(result->batch_us, gint64, p50) / BENCH_BATCH);
+        printf("  latency p99      : %.1f us/stanza\n", (double)g_array_index(result->batch_us, gint64, p99) / BENCH_BATCH);
+    }
+
+    long rss = _peak_rss_kb();
+    if (rss >= 0) {
+        printf("  peak rss         : %ld kB\n", rss);
+    }
+
+    g_array_free(result->batch_us, TRUE);
+    free(result);
+}
+
+// send count stanzas built by make_stanza, timing each batch until its marker shows up
+static void
+_bench_replay(BenchResult* result, int count, char* (*make_stanza)(int i))
+{
+    gint64 start = g_get_monotonic_time();
+    gint64 batch_start = start;
+
+    for (int i = 0; i < count; i++) {
+        char* stanza = make_stanza(i);
+        stbbr_send(stanza);
+        g_free(stanza);
+
+        if ((i + 1) % BENCH_BATCH == 0 || i == count - 1) {
+            _wait_for_marker();
+            gint64 now = g_get_monotonic_time();
+            if ((i + 1) % BENCH_BATCH == 0) {
+                gint64 batch = now - batch_start;
+                g_array_append_val(result->batch_us, batch);
+            }
+            batch_start = now;
+        }
+    }
+
+    result->elapsed_us = g_get_monotonic_time() - start;
+    result->stanzas += count;
+}
+
+static char*
+_roster_items(int count)
+{
+    GString* items = g_string_new("");
+    for (int i = 0; i < count; i++) {
+        g_string_append_printf(items, "<item jid='contact%d@localhost' subscription='both' name='Contact %d'/>", i, i);
+    }
+    return g_string_free(items, FALSE);
+}
+
+static char*
+_presence_stanza(int i)
+{
+    static const char* shows[] = { "away", "xa", "dnd", "chat" };
+    return g_strdup_printf(
+        "<presence to='stabber@localhost/profanity' from='contact%d@localhost/res%d'>"
+            "<show>%s</show>"
+            "<status>status %d</status>"
+        "</presence>",
+        i % BENCH_ROSTER_SIZE, i % 3, shows[i % 4], i);
+}
+
+static char*
+_occupant_stanza(int i)
+{
+    return g_strdup_printf(
+        "<presence to='stabber@localhost/profanity' from='benchroom@conference.localhost/occupant%d'>"
+            "<x xmlns='http://jabber.org/protocol/muc#user'>"
+                "<item role='participant' jid='occupant%d@localhost/res' affiliation='none'/>"
+            "</x>"
+        "</presence>",
+        i, i);
+}
+
+static char*
+_mam_stanza(int i)
+{
+    return g_strdup_printf(
+        "<message to='stabber@localhost/profanity' from='stabber@localhost'>"
+            "<result xmlns='urn:xmpp:mam:2' queryid='bench' id='archive-%d'>"
+                "<forwarded xmlns='urn:xmpp:forward:0'>"
+                    "<delay xmlns='urn:xmpp:delay' stamp='2023-01-01T00:%02d:%02dZ'/>"
+                    "<message xmlns='jabber:client' type='chat' to='stabber@localhost' from='contact%d@localhost/res' id='msg-%d'>"
+                        "<body>archived message %d</body>"
+                    "</message>"
+                "</forwarded>"
+            "</result>"
+        "</message>",
+        i, (i / 60) % 60, i % 60, i % 50, i, i);
+}
+
+void
+bench_roster_push(void** state)
+{
+    BenchResult* result = _bench_result_new("Roster push");
+
+    char* items = _roster_items(BENCH_ROSTER_SIZE);
+
+    gint64 start = g_get_monotonic_time();
+    prof_connect_with_roster(items);
+    prof_timeout(300);
+    _wait_for_marker();
+    result->elapsed_us = g_get_monotonic_time() - start;
+    result->stanzas = BENCH_ROSTER_SIZE;
+
+    prof_timeout_reset();
+    g_free(items);
+
+    _bench_result_report(result);
+}
+
+void
+bench_muc_join(void** state)
+{
+    BenchResult* result = _bench_result_new("MUC join");
+
+    prof_connect();
+    prof_timeout(300);
+
+    prof_input("/join benchroom@conference.localhost");
+    _bench_replay(result, BENCH_MUC_OCCUPANTS, _occupant_stanza);
+
+    stbbr_send(
+        "<presence to='stabber@localhost/profanity' from='benchroom@conference.localhost/stabber'>"
+            "<x xmlns='http://jabber.org/protocol/muc#user'>"
+                "<item role='participant' jid='stabber@localhost/profanity' affiliation='none'/>"
+            "</x>"
+            "<status code='110'/>"
+        "</presence>"
+    );
+    assert_true(prof_output_exact("-> You have joined the room as stabber, role: participant, affiliation: none"));
+
+    prof_timeout_reset();
+
+    _bench_result_report(result);
+}
+
+void
+bench_mam_replay(void** state)
+{
+    BenchResult* result = _bench_result_new("MAM replay");
+
+    prof_connect();
+    prof_timeout(600);
+
+    _bench_replay(result, BENCH_MAM_MESSAGES, _mam_stanza);
+
+    prof_timeout_reset();
+
+    _bench_result_report(result);
+}
+
+void
+bench_presence_storm(void** state)
+{
+    BenchResult* result = _bench_result_new("Presence storm");
+
+    char* items = _roster_items(BENCH_ROSTER_SIZE);
+    prof_connect_with_roster(items);
+    g_free(items);
+    prof_timeout(300);
+
+    _bench_replay(result, BENCH_PRESENCE_STORM, _presence_stanza);
+
+    prof_timeout_reset();
+
+    _bench_result_report(result);
+}
+
+int
+main(int argc, char* argv[])
+{
+    const UnitTest all_benchmarks[] = {
+        PROF_BENCH(bench_roster_push),
+        PROF_BENCH(bench_muc_join),
+        PROF_BENCH(bench_mam_replay),
+        PROF_BENCH(bench_presence_storm),
+    };
+
+    return run_tests(all_benchmarks);
+}
@@ -0,0 +1,171 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <gpgme.h>
+
+#include "pgp/gpgcache.h"
+
+// messages encrypted and decrypted per run
+#define BENCH_MESSAGES 200
+
+#define BENCH_UID "Profanity Benchmark <bench@localhost>"
+
+static const char* message = "The quick brown fox jumps over the lazy dog, a typical chat message.";
+
+static char* fpr = NULL;
+
+typedef gpgme_error_t (*acquire_func)(gpgme_ctx_t* ctx);
+typedef void (*release_func)(gpgme_ctx_t ctx);
+typedef gpgme_error_t (*get_key_func)(gpgme_ctx_t ctx, const char* const fpr, gpgme_key_t* key, gboolean secret);
+
+typedef struct bench_mode_t
+{
+    const char* name;
+    acquire_func acquire;
+    release_func release;
+    get_key_func get_key;
+} BenchMode;
+
+static gpgme_error_t
+_fresh_get_key(gpgme_ctx_t ctx, const char* const fpr, gpgme_key_t* key, gboolean secret)
+{
+    return gpgme_get_key(ctx, fpr, key, secret ? 1 : 0);
+}
+
+static void
+_check(gpgme_error_t error, const char* what)
+{
+    if (error) {
+        fprintf(stderr, "%s failed: %s %s\n", what, gpgme_strsource(error), gpgme_strerror(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void
+_create_key(void)
+{
+    gpgme_ctx_t ctx;
+    _check(gpgme_new(&ctx), "gpgme_new");
+    _check(gpgme_op_createkey(ctx, BENCH_UID, "default", 0, 0, NULL,
+                              GPGME_CREATE_NOPASSWD | GPGME_CREATE_NOEXPIRE),
+           "gpgme_op_createkey");
+
+    gpgme_genkey_result_t result = gpgme_op_genkey_result(ctx);
+    fpr = strdup(result->fpr);
+    gpgme_release(ctx);
+}
+
+static char*
+_encrypt(BenchMode* mode, size_t* len)
+{
+    gpgme_ctx_t ctx;
+    _check(mode->acquire(&ctx), "acquire");
+    gpgme_set_armor(ctx, 1);
+
+    gpgme_key_t keys[2] = { NULL, NULL };
+    _check(mode->get_key(ctx, fpr, &keys[0], FALSE), "get_key");
+
+    gpgme_data_t plain;
+    gpgme_data_t cipher;
+    _check(gpgme_data_new_from_mem(&plain, message, strlen(message), 0), "gpgme_data_new_from_mem");
+    _check(gpgme_data_new(&cipher), "gpgme_data_new");
+    _check(gpgme_op_encrypt(ctx, keys, GPGME_ENCRYPT_ALWAYS_TRUST, plain, cipher), "gpgme_op_encrypt");
+
+    gpgme_data_release(plain);
+    gpgme_key_unref(keys[0]);
+    mode->release(ctx);
+
+    return gpgme_data_release_and_get_mem(cipher, len);
+}
+
+static void
+_decrypt(BenchMode* mode, const char* encrypted, size_t len)
+{
+    gpgme_ctx_t ctx;
+    _check(mode->acquire(&ctx), "acquire");
+    gpgme_set_armor(ctx, 1);
+
+    gpgme_data_t cipher;
+    gpgme_data_t plain;
+    _check(gpgme_data_new_from_mem(&cipher, encrypted, len, 0), "gpgme_data_new_from_mem");
+    _check(gpgme_data_new(&plain), "gpgme_data_new");
+    _check(gpgme_op_decrypt(ctx, cipher, plain), "gpgme_op_decrypt");
+
+    size_t plain_len;
+    char* plain_str = gpgme_data_release_and_get_mem(plain, &plain_len);
+    if (plain_len != strlen(message) || memcmp(plain_str, message, plain_len) != 0) {
+        fprintf(stderr, "decrypted message does not match\n");
+        exit(EXIT_FAILURE);
+    }
+
+    gpgme_free(plain_str);
+    gpgme_data_release(cipher);
+    mode->release(ctx);
+}
+
+static void
+_bench(BenchMode* mode)
+{
+    char* encrypted[BENCH_MESSAGES];
+    size_t lens[BENCH_MESSAGES];
+
+    gint64 start = g_get_monotonic_time();
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        encrypted[i] = _encrypt(mode, &lens[i]);
+    }
+    gint64 encrypt_us = g_get_monotonic_time() - start;
+
+    start = g_get_monotonic_time();
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        _decrypt(mode, encrypted[i], lens[i]);
+        gpgme_free(encrypted[i]);
+    }
+    gint64 decrypt_us = g_get_monotonic_time() - start;
+
+    printf("\n%s\n", mode->name);
+    printf("  messages         : %d\n", BENCH_MESSAGES);
+    printf("  encrypt/sec      : %.0f\n", BENCH_MESSAGES / (encrypt_us / 1000000.0));
+    printf("  decrypt/sec      : %.0f\n", BENCH_MESSAGES / (decrypt_us / 1000000.0));
+}
+
+int
+main(int argc, char* argv[])
+{
+    // never touch the keyring of the user running the benchmark
+    GError* error = NULL;
+    gchar* homedir = g_dir_make_tmp("prof-gpg-bench-XXXXXX", &error);
+    if (!homedir) {
+        fprintf(stderr, "Could not create GNUPGHOME: %s\n", error->message);
+        g_error_free(error);
+        return EXIT_FAILURE;
+    }
+    g_setenv("GNUPGHOME", homedir, TRUE);
+
+    setlocale(LC_ALL, "");
+    gpgme_check_version(NULL);
+    gpgme_set_locale(NULL, LC_CTYPE, setlocale(LC_CTYPE, NULL));
+
+    _create_key();
+
+    BenchMode fresh = { "New context and key lookup per message", gpgme_new, gpgme_release, _fresh_get_key };
+    BenchMode pooled = { "Pooled context and cached key", p_gpg_ctx_acquire, p_gpg_ctx_release, p_gpg_get_key };
+
+    _bench(&fresh);
+    _bench(&pooled);
+
+    p_gpg_cache_close();
+    free(fpr);
+
+    gchar* kill = g_strdup_printf("gpgconf --homedir '%s' --kill all", homedir);
+    gchar* rm = g_strdup_printf("rm -rf '%s'", homedir);
+    if (system(kill) != 0 || system(rm) != 0) {
+        fprintf(stderr, "Could not clean up %s\n", homedir);
+    }
+    g_free(rm);
+    g_free(kill);
+    g_free(homedir);
+
+    return EXIT_SUCCESS;
+}
@@ -51,3 +51,42 @@ void
 log_database_close(void)
 {
 }
+void
+log_database_batch_check(void)
+{
+}
+gboolean
+log_database_migrate_step(void)
+{
+    return FALSE;
+}
+gboolean
+log_database_migrating(void)
+{
+    return FALSE;
+}
+gboolean
+log_database_compact(gint64* size_before, gint64* size_after)
+{
+    return FALSE;
+}
+gboolean
+log_database_export(const char* const path)
+{
+    return FALSE;
+}
+gboolean
+log_database_import(const char* const path)
+{
+    return FALSE;
+}
+gboolean
+log_database_transfer_step(void)
+{
+    return FALSE;
+}
+gboolean
+log_database_transferring(void)
+{
+    return FALSE;
+}
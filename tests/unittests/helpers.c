@@ -10,6 +10,7 @@
 #include "common.h"
 #include "helpers.h"
 #include "config/preferences.h"
+#include "tools/stats.h"
 #include "xmpp/chat_session.h"
 
 void
@@ -78,6 +79,23 @@ close_chat_sessions(void** state)
     close_preferences(NULL);
 }
 
+void
+init_chat_states(void** state)
+{
+    load_preferences(state);
+    prefs_set_boolean(PREF_STATES, TRUE);
+    prefs_set_boolean(PREF_OUTTYPE, TRUE);
+    chat_sessions_init();
+    stats_reset();
+}
+
+void
+close_chat_states(void** state)
+{
+    chat_sessions_clear();
+    close_preferences(state);
+}
+
 int
 utf8_pos_to_col(char* str, int utf8_pos)
 {
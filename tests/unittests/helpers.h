@@ -6,6 +6,9 @@ void close_preferences(void** state);
 void init_chat_sessions(void** state);
 void close_chat_sessions(void** state);
 
+void init_chat_states(void** state);
+void close_chat_states(void** state);
+
 int utf8_pos_to_col(char* str, int utf8_pos);
 
 void glist_set_cmp(GCompareFunc func);
@@ -57,6 +57,13 @@ p_gpg_decrypt(const char* const cipher)
     return NULL;
 }
 
+char*
+p_gpg_decrypt_background(const char* const cipher, gboolean* retry)
+{
+    *retry = FALSE;
+    return NULL;
+}
+
 void
 p_gpg_on_connect(const char* const barejid)
 {
@@ -0,0 +1,111 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+
+#include "tools/stats.h"
+#include "xmpp/xmpp.h"
+#include "xmpp/chat_state.h"
+
+void
+chat_state_sent_on_flush(void** state)
+{
+    ChatState* chat_state = chat_state_new();
+
+    chat_state_handle_typing("buddy@server.org", chat_state);
+    assert_int_equal(0, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+
+    will_return(connection_get_status, JABBER_CONNECTED);
+    chat_state_flush(TRUE);
+
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+    assert_int_equal(0, stats_counter(PROF_STATS_CHAT_STATES_DROPPED));
+
+    chat_state_free(chat_state);
+}
+
+void
+chat_state_waits_for_coalesce_timeout(void** state)
+{
+    ChatState* chat_state = chat_state_new();
+
+    chat_state_handle_typing("buddy@server.org", chat_state);
+
+    will_return(connection_get_status, JABBER_CONNECTED);
+    chat_state_flush(FALSE);
+    assert_int_equal(0, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+
+    will_return(connection_get_status, JABBER_CONNECTED);
+    chat_state_flush(TRUE);
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+
+    chat_state_free(chat_state);
+}
+
+void
+chat_state_composing_dropped_by_message(void** state)
+{
+    ChatState* chat_state = chat_state_new();
+
+    chat_state_handle_typing("buddy@server.org", chat_state);
+    chat_state_active("buddy@server.org", chat_state);
+    chat_state_flush(TRUE);
+
+    assert_int_equal(0, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_DROPPED));
+
+    chat_state_free(chat_state);
+}
+
+void
+chat_state_composing_superseded_by_gone(void** state)
+{
+    ChatState* chat_state = chat_state_new();
+
+    chat_state_handle_typing("buddy@server.org", chat_state);
+    chat_state_gone("buddy@server.org", chat_state);
+
+    will_return(connection_get_status, JABBER_CONNECTED);
+    chat_state_flush(TRUE);
+
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_DROPPED));
+
+    chat_state_free(chat_state);
+}
+
+void
+chat_state_keeps_one_per_contact(void** state)
+{
+    ChatState* chat_state1 = chat_state_new();
+    ChatState* chat_state2 = chat_state_new();
+
+    chat_state_handle_typing("buddy1@server.org", chat_state1);
+    chat_state_handle_typing("buddy2@server.org", chat_state2);
+
+    will_return(connection_get_status, JABBER_CONNECTED);
+    chat_state_flush(TRUE);
+
+    assert_int_equal(2, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+
+    chat_state_free(chat_state1);
+    chat_state_free(chat_state2);
+}
+
+void
+chat_state_dropped_when_disconnected(void** state)
+{
+    ChatState* chat_state = chat_state_new();
+
+    chat_state_handle_typing("buddy@server.org", chat_state);
+
+    will_return(connection_get_status, JABBER_DISCONNECTED);
+    chat_state_flush(TRUE);
+
+    assert_int_equal(0, stats_counter(PROF_STATS_CHAT_STATES_SENT));
+    assert_int_equal(1, stats_counter(PROF_STATS_CHAT_STATES_DROPPED));
+
+    chat_state_free(chat_state);
+}
@@ -0,0 +1,6 @@
+void chat_state_sent_on_flush(void** state);
+void chat_state_waits_for_coalesce_timeout(void** state);
+void chat_state_composing_dropped_by_message(void** state);
+void chat_state_composing_superseded_by_gone(void** state);
+void chat_state_keeps_one_per_contact(void** state);
+void chat_state_dropped_when_disconnected(void** state);
@@ -0,0 +1,64 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "config.h"
+
+#include "command/cmd_funcs.h"
+#include "xmpp/xmpp.h"
+
+#include "ui/stub_ui.h"
+
+#define CMD_HISTORY "/history"
+
+void
+cmd_history_export_shows_usage_when_no_file(void** state)
+{
+    gchar* args[] = { "export", NULL };
+
+    expect_string(cons_bad_cmd_usage, cmd, CMD_HISTORY);
+
+    gboolean result = cmd_history(NULL, CMD_HISTORY, args);
+    assert_true(result);
+}
+
+void
+cmd_history_import_shows_usage_when_no_file(void** state)
+{
+    gchar* args[] = { "import", NULL };
+
+    expect_string(cons_bad_cmd_usage, cmd, CMD_HISTORY);
+
+    gboolean result = cmd_history(NULL, CMD_HISTORY, args);
+    assert_true(result);
+}
+
+void
+cmd_history_export_shows_message_when_disconnected(void** state)
+{
+    gchar* args[] = { "export", "history.txt", NULL };
+
+    will_return(connection_get_status, JABBER_DISCONNECTED);
+
+    expect_cons_show("You are not currently connected.");
+
+    gboolean result = cmd_history(NULL, CMD_HISTORY, args);
+    assert_true(result);
+}
+
+void
+cmd_history_import_shows_message_when_disconnected(void** state)
+{
+    gchar* args[] = { "import", "history.txt", NULL };
+
+    will_return(connection_get_status, JABBER_DISCONNECTED);
+
+    expect_cons_show("You are not currently connected.");
+
+    gboolean result = cmd_history(NULL, CMD_HISTORY, args);
+    assert_true(result);
+}
@@ -0,0 +1,4 @@
+void cmd_history_export_shows_usage_when_no_file(void** state);
+void cmd_history_import_shows_usage_when_no_file(void** state);
+void cmd_history_export_shows_message_when_disconnected(void** state);
+void cmd_history_import_shows_message_when_disconnected(void** state);
@@ -0,0 +1,120 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools/history_format.h"
+
+void
+history_format_escape_roundtrip(void** state)
+{
+    const char* text = "tab\there\\n not a newline\nline two\r\n\\";
+    GString* line = g_string_new("");
+    history_format_escape(line, text);
+
+    assert_null(strchr(line->str, '\t'));
+    assert_null(strchr(line->str, '\n'));
+    assert_null(strchr(line->str, '\r'));
+    assert_string_equal(line->str, "tab\\there\\\\n not a newline\\nline two\\r\\n\\\\");
+
+    history_format_unescape(line->str);
+    assert_string_equal(line->str, text);
+
+    g_string_free(line, TRUE);
+}
+
+void
+history_format_unescape_keeps_trailing_backslash(void** state)
+{
+    char field[] = "ends with \\";
+    history_format_unescape(field);
+    assert_string_equal(field, "ends with \\");
+}
+
+void
+history_format_split_keeps_tabs_in_last_field(void** state)
+{
+    char line[] = "1585048334000000\t1\t0\t1\tbuddy@server.org\tphone\tme@server.org\t\tid1\t\t\tsee\tyou";
+    char* fields[12];
+
+    assert_int_equal(history_format_split(line, fields, 12), 12);
+    assert_string_equal(fields[0], "1585048334000000");
+    assert_string_equal(fields[4], "buddy@server.org");
+    assert_string_equal(fields[5], "phone");
+    assert_string_equal(fields[7], "");
+    assert_string_equal(fields[8], "id1");
+    assert_string_equal(fields[10], "");
+    assert_string_equal(fields[11], "see\tyou");
+}
+
+void
+history_format_split_counts_short_line(void** state)
+{
+    char line[] = "1585048334000000\t1\t0";
+    char* fields[12];
+
+    assert_int_equal(history_format_split(line, fields, 12), 3);
+    assert_string_equal(fields[2], "0");
+}
+
+void
+history_format_chatlog_message(void** state)
+{
+    char line[] = "2020-03-24T11:12:14Z - buddy@server.org: hi - how: are you";
+    gint64 timestamp = 0;
+    char* nick = NULL;
+    char* text = NULL;
+
+    assert_int_equal(history_format_parse_chatlog(line, &timestamp, &nick, &text), HISTORY_CHATLOG_MESSAGE);
+    assert_true(timestamp == 1585048334000000);
+    assert_string_equal(nick, "buddy@server.org");
+    assert_string_equal(text, "hi - how: are you");
+}
+
+void
+history_format_chatlog_action(void** state)
+{
+    char line[] = "2020-03-24T11:12:14.5+01:00 - *me waves: hello";
+    gint64 timestamp = 0;
+    char* nick = NULL;
+    char* text = NULL;
+
+    assert_int_equal(history_format_parse_chatlog(line, &timestamp, &nick, &text), HISTORY_CHATLOG_ACTION);
+    assert_true(timestamp == 1585044734500000);
+    assert_string_equal(nick, "me");
+    assert_string_equal(text, "waves: hello");
+}
+
+void
+history_format_chatlog_continuation(void** state)
+{
+    gint64 timestamp = 0;
+    char* nick = NULL;
+    char* text = NULL;
+
+    char plain[] = "second line of a message";
+    assert_int_equal(history_format_parse_chatlog(plain, &timestamp, &nick, &text), HISTORY_CHATLOG_CONTINUATION);
+    assert_string_equal(plain, "second line of a message");
+
+    // a separator without a timestamp in front is part of the text
+    char dashed[] = "not a date - nick: text";
+    assert_int_equal(history_format_parse_chatlog(dashed, &timestamp, &nick, &text), HISTORY_CHATLOG_CONTINUATION);
+    assert_string_equal(dashed, "not a date - nick: text");
+}
+
+void
+history_format_chatlog_invalid(void** state)
+{
+    gint64 timestamp = 0;
+    char* nick = NULL;
+    char* text = NULL;
+
+    char no_text[] = "2020-03-24T11:12:14Z - buddy@server.org";
+    assert_int_equal(history_format_parse_chatlog(no_text, &timestamp, &nick, &text), HISTORY_CHATLOG_INVALID);
+
+    char no_action[] = "2020-03-24T11:12:14Z - *me";
+    assert_int_equal(history_format_parse_chatlog(no_action, &timestamp, &nick, &text), HISTORY_CHATLOG_INVALID);
+}
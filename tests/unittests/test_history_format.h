@@ -0,0 +1,8 @@
+void history_format_escape_roundtrip(void** state);
+void history_format_unescape_keeps_trailing_backslash(void** state);
+void history_format_split_keeps_tabs_in_last_field(void** state);
+void history_format_split_counts_short_line(void** state);
+void history_format_chatlog_message(void** state);
+void history_format_chatlog_action(void** state);
+void history_format_chatlog_continuation(void** state);
+void history_format_chatlog_invalid(void** state);
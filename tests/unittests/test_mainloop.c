@@ -0,0 +1,51 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <sys/select.h>
+
+#include "tools/mainloop.h"
+
+static gboolean
+_readable(int fd)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval timeout = { 0, 0 };
+
+    return select(fd + 1, &fds, NULL, NULL, &timeout) == 1;
+}
+
+void
+mainloop_wakeup_makes_fd_readable(void** state)
+{
+    mainloop_init();
+    int fd = mainloop_fd();
+    assert_true(fd != -1);
+
+    assert_false(_readable(fd));
+    mainloop_wakeup();
+    assert_true(_readable(fd));
+
+    mainloop_close();
+    assert_int_equal(-1, mainloop_fd());
+}
+
+void
+mainloop_drain_clears_wakeups(void** state)
+{
+    mainloop_init();
+    int fd = mainloop_fd();
+
+    mainloop_wakeup();
+    mainloop_wakeup();
+    mainloop_wakeup();
+    mainloop_drain();
+
+    assert_false(_readable(fd));
+
+    mainloop_close();
+}
@@ -0,0 +1,2 @@
+void mainloop_wakeup_makes_fd_readable(void** state);
+void mainloop_drain_clears_wakeups(void** state);
@@ -84,3 +84,26 @@ test_muc_active(void** state)
 
     assert_true(room_is_active);
 }
+
+void
+test_muc_history_is_logged_at_boundary(void** state)
+{
+    char* room = "room@server.org";
+    GDateTime* since = g_date_time_new_utc(2020, 3, 24, 11, 12, 14.5);
+    GDateTime* before = g_date_time_add(since, -1);
+    GDateTime* after = g_date_time_add(since, 1);
+    muc_set_history_since(room, since);
+
+    // the last logged message itself is replayed by the server
+    assert_true(muc_history_is_logged(room, since));
+    assert_true(muc_history_is_logged(room, before));
+    assert_false(muc_history_is_logged(room, after));
+    assert_false(muc_history_is_logged("other@server.org", since));
+
+    muc_set_history_since(room, NULL);
+    assert_false(muc_history_is_logged(room, since));
+
+    g_date_time_unref(after);
+    g_date_time_unref(before);
+    g_date_time_unref(since);
+}
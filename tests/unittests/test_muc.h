@@ -7,3 +7,4 @@ void test_muc_invites_count_0(void** state);
 void test_muc_invites_count_5(void** state);
 void test_muc_room_is_not_active(void** state);
 void test_muc_active(void** state);
+void test_muc_history_is_logged_at_boundary(void** state);
@@ -132,6 +132,31 @@ parse_cmd_three_args(void** state)
     g_strfreev(args);
 }
 
+void
+parse_cmd_many_args(void** state)
+{
+    char* inp = "/cmd a1 a2 a3 a4 a5 a6 a7 a8 a9 a10 a11 a12 a13 a14 a15 a16 a17 a18 a19 a20";
+    gboolean result = FALSE;
+    gchar** args = parse_args(inp, 1, 20, &result);
+
+    assert_true(result);
+    assert_int_equal(20, g_strv_length(args));
+    assert_string_equal("a1", args[0]);
+    assert_string_equal("a20", args[19]);
+    g_strfreev(args);
+}
+
+void
+parse_cmd_many_args_with_too_many_returns_null(void** state)
+{
+    char* inp = "/cmd a1 a2 a3 a4 a5 a6 a7 a8 a9 a10 a11 a12 a13 a14 a15 a16 a17 a18 a19 a20 a21";
+    gboolean result = TRUE;
+    gchar** args = parse_args(inp, 1, 20, &result);
+
+    assert_false(result);
+    assert_null(args);
+}
+
 void
 parse_cmd_three_args_with_spaces(void** state)
 {
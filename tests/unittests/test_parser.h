@@ -8,6 +8,8 @@ void parse_cmd_with_too_many_returns_null(void** state);
 void parse_cmd_one_arg(void** state);
 void parse_cmd_two_args(void** state);
 void parse_cmd_three_args(void** state);
+void parse_cmd_many_args(void** state);
+void parse_cmd_many_args_with_too_many_returns_null(void** state);
 void parse_cmd_three_args_with_spaces(void** state);
 void parse_cmd_with_freetext(void** state);
 void parse_cmd_one_arg_with_freetext(void** state);
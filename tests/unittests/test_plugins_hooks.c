@@ -0,0 +1,69 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <sys/select.h>
+
+#include "plugins/plugins.h"
+#include "tools/mainloop.h"
+
+static int hook_calls = 0;
+
+static gboolean
+_readable(int fd)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval timeout = { 0, 0 };
+
+    return select(fd + 1, &fds, NULL, NULL, &timeout) == 1;
+}
+
+static void
+_slow_post_chat_message_display(ProfPlugin* plugin, const char* const barejid, const char* const resource,
+                                const char* message)
+{
+    hook_calls++;
+    g_usleep(2000);
+}
+
+void
+plugins_run_hooks_drains_queue_longer_than_slice(void** state)
+{
+    mainloop_init();
+    plugins_init();
+
+    // neither a python nor a C plugin, there is nothing to destroy on shutdown
+    ProfPlugin plugin = { 0 };
+    plugin.name = "slow.so";
+    plugin.lang = (lang_t)-1;
+    plugin.post_chat_message_display = _slow_post_chat_message_display;
+    plugins_add(plugin.name, &plugin);
+
+    hook_calls = 0;
+    for (int i = 0; i < 20; i++) {
+        plugins_post_chat_message_display("buddy@server.org", "laptop", "hello");
+    }
+    assert_int_equal(0, hook_calls);
+
+    // 20 calls of 2ms don't fit in one slice
+    plugins_run_hooks();
+    assert_true(hook_calls < 20);
+    assert_true(_readable(mainloop_fd()));
+
+    int iterations = 1;
+    while (_readable(mainloop_fd()) && iterations < 100) {
+        mainloop_drain();
+        plugins_run_hooks();
+        iterations++;
+    }
+
+    assert_int_equal(20, hook_calls);
+    assert_false(_readable(mainloop_fd()));
+
+    plugins_shutdown();
+    mainloop_close();
+}
@@ -0,0 +1 @@
+void plugins_run_hooks_drains_queue_longer_than_slice(void** state);
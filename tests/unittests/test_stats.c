@@ -0,0 +1,87 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools/stats.h"
+
+static char*
+_find_line(GSList* lines, const char* const probe)
+{
+    for (GSList* curr = lines; curr; curr = g_slist_next(curr)) {
+        char* line = curr->data;
+        if (strstr(line, probe)) {
+            return line;
+        }
+    }
+
+    return NULL;
+}
+
+void
+stats_report_has_no_samples_after_reset(void** state)
+{
+    stats_end(PROF_STATS_UI_UPDATE, stats_start());
+    stats_reset();
+
+    GSList* lines = stats_report();
+    char* line = _find_line(lines, "ui update");
+
+    assert_non_null(line);
+    assert_non_null(strstr(line, "no samples"));
+
+    g_slist_free_full(lines, g_free);
+}
+
+void
+stats_report_counts_samples(void** state)
+{
+    stats_reset();
+    stats_end(PROF_STATS_UI_UPDATE, stats_start());
+    stats_end(PROF_STATS_UI_UPDATE, stats_start());
+    stats_end(PROF_STATS_UI_UPDATE, stats_start());
+
+    GSList* lines = stats_report();
+    char* line = _find_line(lines, "ui update");
+
+    assert_non_null(line);
+    assert_non_null(strstr(line, "count 3,"));
+
+    g_slist_free_full(lines, g_free);
+}
+
+void
+stats_report_counts_probes_separately(void** state)
+{
+    stats_reset();
+    stats_end(PROF_STATS_MESSAGE_HANDLER, stats_start());
+    stats_end(PROF_STATS_MESSAGE_HANDLER, stats_start());
+    stats_end(PROF_STATS_IQ_HANDLER, stats_start());
+
+    GSList* lines = stats_report();
+
+    assert_non_null(strstr(_find_line(lines, "message handler"), "count 2,"));
+    assert_non_null(strstr(_find_line(lines, "iq handler"), "count 1,"));
+    assert_non_null(strstr(_find_line(lines, "presence handler"), "no samples"));
+
+    g_slist_free_full(lines, g_free);
+}
+
+void
+stats_report_shows_counters(void** state)
+{
+    stats_count(PROF_STATS_PRESENCE_DROPPED);
+    stats_reset();
+    stats_count(PROF_STATS_PRESENCE_SENT);
+    stats_count(PROF_STATS_PRESENCE_SENT);
+
+    GSList* lines = stats_report();
+
+    assert_non_null(strstr(_find_line(lines, "presence sent"), ": 2"));
+    assert_non_null(strstr(_find_line(lines, "presence dropped"), ": 0"));
+
+    g_slist_free_full(lines, g_free);
+}
@@ -0,0 +1,4 @@
+void stats_report_has_no_samples_after_reset(void** state);
+void stats_report_counts_samples(void** state);
+void stats_report_counts_probes_separately(void** state);
+void stats_report_shows_counters(void** state);
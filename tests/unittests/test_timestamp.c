@@ -0,0 +1,100 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+
+#include "tools/timestamp.h"
+
+void
+timestamp_parses_utc(void** state)
+{
+    gint64 usec = 0;
+    assert_true(timestamp_parse_iso8601("2020-03-24T11:12:14Z", &usec));
+    assert_true(usec == 1585048334000000);
+}
+
+void
+timestamp_parses_fraction_and_offset(void** state)
+{
+    gint64 usec = 0;
+    assert_true(timestamp_parse_iso8601("2000-02-29T12:34:56.789+02:00", &usec));
+    assert_true(usec == 951820496789000);
+}
+
+void
+timestamp_parses_legacy_delay(void** state)
+{
+    gint64 usec = 0;
+    assert_true(timestamp_parse_iso8601("20020910T23:08:25", &usec));
+    assert_true(usec == 1031699305000000);
+}
+
+void
+timestamp_rejects_invalid(void** state)
+{
+    gint64 usec = 0;
+    assert_false(timestamp_parse_iso8601(NULL, &usec));
+    assert_false(timestamp_parse_iso8601("", &usec));
+    assert_false(timestamp_parse_iso8601("2023-02-29T00:00:00Z", &usec));
+    assert_false(timestamp_parse_iso8601("2023-01-01T00:00:00Zjunk", &usec));
+    assert_false(timestamp_parse_iso8601("2023-01-01", &usec));
+    assert_false(timestamp_parse_iso8601("2023-13-01T00:00:00Z", &usec));
+}
+
+void
+timestamp_local_keeps_instant(void** state)
+{
+    GDateTime* local = timestamp_local_from_iso8601("2020-03-24T11:12:14.5+01:00");
+    assert_non_null(local);
+    assert_true(g_date_time_to_unix(local) == 1585044734);
+    assert_int_equal(g_date_time_get_microsecond(local), 500000);
+
+    g_date_time_unref(local);
+    timestamp_close();
+}
+
+void
+timestamp_format_follows_time(void** state)
+{
+    GDateTime* first = g_date_time_new_from_unix_utc(1585048334);
+    GDateTime* second = g_date_time_add_seconds(first, 1);
+
+    assert_string_equal(timestamp_format(first, "%H:%M:%S"), "11:12:14");
+    assert_string_equal(timestamp_format(first, "%H:%M:%S"), "11:12:14");
+    assert_string_equal(timestamp_format(second, "%H:%M:%S"), "11:12:15");
+    assert_string_equal(timestamp_format(first, "%H:%M"), "11:12");
+
+    g_date_time_unref(second);
+    g_date_time_unref(first);
+    timestamp_close();
+}
+
+void
+timestamp_local_from_usec_keeps_fraction(void** state)
+{
+    GDateTime* local = timestamp_local_from_usec(951820496789000);
+    assert_non_null(local);
+    assert_true(g_date_time_to_unix(local) == 951820496);
+    assert_int_equal(g_date_time_get_microsecond(local), 789000);
+
+    g_date_time_unref(local);
+    timestamp_close();
+}
+
+void
+timestamp_to_iso8601_keeps_usec(void** state)
+{
+    GDateTime* time = timestamp_local_from_usec(1585048334000500);
+    gchar* str = timestamp_to_iso8601_usec(time);
+    assert_string_equal(str, "2020-03-24T11:12:14.000500Z");
+
+    gint64 usec = 0;
+    assert_true(timestamp_parse_iso8601(str, &usec));
+    assert_true(usec == 1585048334000500);
+
+    g_free(str);
+    g_date_time_unref(time);
+    timestamp_close();
+}
@@ -0,0 +1,8 @@
+void timestamp_parses_utc(void** state);
+void timestamp_parses_fraction_and_offset(void** state);
+void timestamp_parses_legacy_delay(void** state);
+void timestamp_rejects_invalid(void** state);
+void timestamp_local_keeps_instant(void** state);
+void timestamp_format_follows_time(void** state);
+void timestamp_local_from_usec_keeps_fraction(void** state);
+void timestamp_to_iso8601_keeps_usec(void** state);
@@ -0,0 +1,79 @@
+#include <glib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools/workqueue.h"
+
+static GString* completed = NULL;
+
+static void
+_work(gpointer data)
+{
+    // let later jobs overtake the first one on another worker
+    if (GPOINTER_TO_INT(data) == 1) {
+        g_usleep(20000);
+    }
+}
+
+static void
+_done(gpointer data)
+{
+    g_string_append_printf(completed, "%d", GPOINTER_TO_INT(data));
+}
+
+void
+workqueue_completes_jobs_in_order(void** state)
+{
+    completed = g_string_new("");
+
+    workqueue_push("a@b.com", _work, _done, GINT_TO_POINTER(1));
+    workqueue_push("a@b.com", _work, _done, GINT_TO_POINTER(2));
+    workqueue_push("a@b.com", _work, _done, GINT_TO_POINTER(3));
+    workqueue_flush();
+
+    assert_string_equal("123", completed->str);
+
+    g_string_free(completed, TRUE);
+    workqueue_close();
+}
+
+void
+workqueue_passthrough_waits_for_earlier_jobs(void** state)
+{
+    completed = g_string_new("");
+
+    workqueue_push("a@b.com", _work, _done, GINT_TO_POINTER(1));
+    workqueue_push("a@b.com", NULL, _done, GINT_TO_POINTER(2));
+    workqueue_process();
+
+    assert_true(workqueue_pending("a@b.com"));
+    assert_false(workqueue_pending("c@d.com"));
+
+    workqueue_flush();
+
+    assert_string_equal("12", completed->str);
+
+    g_string_free(completed, TRUE);
+    workqueue_close();
+}
+
+void
+workqueue_not_pending_after_flush(void** state)
+{
+    completed = g_string_new("");
+
+    workqueue_push("a@b.com", _work, _done, GINT_TO_POINTER(1));
+    workqueue_push("c@d.com", NULL, _done, GINT_TO_POINTER(2));
+    workqueue_flush();
+
+    assert_false(workqueue_pending("a@b.com"));
+    assert_false(workqueue_pending("c@d.com"));
+    assert_int_equal(2, completed->len);
+
+    g_string_free(completed, TRUE);
+    workqueue_close();
+}
@@ -0,0 +1,3 @@
+void workqueue_completes_jobs_in_order(void** state);
+void workqueue_passthrough_waits_for_earlier_jobs(void** state);
+void workqueue_not_pending_after_flush(void** state);
@@ -2,7 +2,6 @@
 #define TOOLS_HTTP_DOWNLOAD_H
 
 #include <curl/curl.h>
-#include <pthread.h>
 
 typedef struct prof_win_t ProfWin;
 
@@ -10,21 +9,17 @@ typedef struct http_download_t
 {
     char* url;
     char* filename;
-    char* directory;
+    char* partname;
+    char* cmd_template;
     FILE* filehandle;
-    curl_off_t bytes_received;
+    curl_off_t resume_from;
+    CURL* curl;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
 } HTTPDownload;
 
-void*
-http_file_get(void* userdata)
+void
+http_file_get(HTTPDownload* download)
 {
-    return NULL;
 }
 
-void http_download_cancel_processes(){};
-void http_download_add_download(){};
-
 #endif
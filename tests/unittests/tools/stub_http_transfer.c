@@ -0,0 +1,22 @@
+#ifndef TOOLS_HTTP_TRANSFER_H
+#define TOOLS_HTTP_TRANSFER_H
+
+// forward -> ui/win_types.h
+typedef struct prof_win_t ProfWin;
+
+void
+http_transfer_cancel(ProfWin* window)
+{
+}
+
+void
+http_transfer_process(void)
+{
+}
+
+void
+http_transfer_close(void)
+{
+}
+
+#endif
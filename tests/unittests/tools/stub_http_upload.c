@@ -2,7 +2,6 @@
 #define TOOLS_HTTP_UPLOAD_H
 
 #include <curl/curl.h>
-#include <pthread.h>
 
 // forward -> ui/win_types.h
 typedef struct prof_win_t ProfWin;
@@ -11,19 +10,15 @@ typedef struct http_upload_t
 {
     char* filename;
     off_t filesize;
-    curl_off_t bytes_sent;
     char* mime_type;
     char* get_url;
     char* put_url;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
 } HTTPUpload;
 
-void*
-http_file_put(void* userdata)
+void
+http_file_put(HTTPUpload* upload)
 {
-    return NULL;
 }
 
 char*
@@ -38,7 +33,4 @@ file_size(const char* const file_name)
     return 0;
 }
 
-void http_upload_cancel_processes(){};
-void http_upload_add_upload(){};
-
 #endif
@@ -244,6 +244,32 @@ xmlwin_show(ProfXMLWin* xmlwin, const char* const msg)
 {
 }
 
+void
+xmlwin_show_pending(ProfXMLWin* xmlwin)
+{
+}
+
+void
+xmlwin_set_filter(ProfXMLWin* xmlwin, const char* const kind, const char* const value)
+{
+}
+
+void
+xmlwin_show_filters(ProfXMLWin* xmlwin, ProfWin* window)
+{
+}
+
+gboolean
+xmlwin_capture_start(ProfXMLWin* xmlwin, const char* const path)
+{
+    return TRUE;
+}
+
+void
+xmlwin_capture_stop(ProfXMLWin* xmlwin)
+{
+}
+
 // ui events
 void
 ui_contact_online(char* barejid, Resource* resource, GDateTime* last_activity)
@@ -492,6 +518,7 @@ void win_update_entry_message(ProfWin* window, const char* const id, const char*
 void win_mark_received(ProfWin* window, const char* const id){};
 void win_print_http_transfer(ProfWin* window, const char* const message, char* url){};
 void win_print_loading_history(ProfWin* window){};
+void win_remove_loading_history(ProfWin* window){};
 
 void
 ui_show_roster(void)
@@ -1209,6 +1236,14 @@ void
 status_bar_set_all_inactive(void)
 {
 }
+void
+status_bar_set_progress(const char* const progress)
+{
+}
+void
+status_bar_clear_progress(void)
+{
+}
 
 // roster window
 void
@@ -1216,6 +1251,16 @@ rosterwin_roster(void)
 {
 }
 
+void
+rosterwin_roster_flush(void)
+{
+}
+
+void
+rosterwin_roster_reset(void)
+{
+}
+
 // occupants window
 void
 occupantswin_occupants(const char* const room)
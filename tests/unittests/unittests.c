@@ -15,6 +15,7 @@
 #include "helpers.h"
 #include "test_autocomplete.h"
 #include "test_chat_session.h"
+#include "test_chat_state.h"
 #include "test_common.h"
 #include "test_contact.h"
 #include "test_cmd_connect.h"
@@ -35,9 +36,16 @@
 #include "test_muc.h"
 #include "test_cmd_roster.h"
 #include "test_cmd_disconnect.h"
+#include "test_cmd_history.h"
 #include "test_form.h"
 #include "test_callbacks.h"
 #include "test_plugins_disco.h"
+#include "test_plugins_hooks.h"
+#include "test_stats.h"
+#include "test_workqueue.h"
+#include "test_mainloop.h"
+#include "test_timestamp.h"
+#include "test_history_format.h"
 
 int
 main(int argc, char* argv[])
@@ -146,6 +154,8 @@ main(int argc, char* argv[])
         unit_test(parse_cmd_one_arg),
         unit_test(parse_cmd_two_args),
         unit_test(parse_cmd_three_args),
+        unit_test(parse_cmd_many_args),
+        unit_test(parse_cmd_many_args_with_too_many_returns_null),
         unit_test(parse_cmd_three_args_with_spaces),
         unit_test(parse_cmd_with_freetext),
         unit_test(parse_cmd_one_arg_with_freetext),
@@ -236,6 +246,25 @@ main(int argc, char* argv[])
                                  init_chat_sessions,
                                  close_chat_sessions),
 
+        unit_test_setup_teardown(chat_state_sent_on_flush,
+                                 init_chat_states,
+                                 close_chat_states),
+        unit_test_setup_teardown(chat_state_waits_for_coalesce_timeout,
+                                 init_chat_states,
+                                 close_chat_states),
+        unit_test_setup_teardown(chat_state_composing_dropped_by_message,
+                                 init_chat_states,
+                                 close_chat_states),
+        unit_test_setup_teardown(chat_state_composing_superseded_by_gone,
+                                 init_chat_states,
+                                 close_chat_states),
+        unit_test_setup_teardown(chat_state_keeps_one_per_contact,
+                                 init_chat_states,
+                                 close_chat_states),
+        unit_test_setup_teardown(chat_state_dropped_when_disconnected,
+                                 init_chat_states,
+                                 close_chat_states),
+
         unit_test_setup_teardown(cmd_connect_shows_message_when_disconnecting,
                                  load_preferences,
                                  close_preferences),
@@ -488,6 +517,7 @@ main(int argc, char* argv[])
         unit_test_setup_teardown(test_muc_invites_count_5, muc_before_test, muc_after_test),
         unit_test_setup_teardown(test_muc_room_is_not_active, muc_before_test, muc_after_test),
         unit_test_setup_teardown(test_muc_active, muc_before_test, muc_after_test),
+        unit_test_setup_teardown(test_muc_history_is_logged_at_boundary, muc_before_test, muc_after_test),
 
         unit_test(cmd_bookmark_shows_message_when_disconnected),
         unit_test(cmd_bookmark_shows_message_when_disconnecting),
@@ -618,6 +648,11 @@ main(int argc, char* argv[])
                                  load_preferences,
                                  close_preferences),
 
+        unit_test(cmd_history_export_shows_usage_when_no_file),
+        unit_test(cmd_history_import_shows_usage_when_no_file),
+        unit_test(cmd_history_export_shows_message_when_disconnected),
+        unit_test(cmd_history_import_shows_message_when_disconnected),
+
         unit_test(prof_partial_occurrences_tests),
         unit_test(prof_whole_occurrences_tests),
 
@@ -631,6 +666,40 @@ main(int argc, char* argv[])
         unit_test(does_not_add_duplicate_feature),
         unit_test(removes_plugin_features),
         unit_test(does_not_remove_feature_when_more_than_one_reference),
+
+        unit_test_setup_teardown(plugins_run_hooks_drains_queue_longer_than_slice,
+                                 load_preferences,
+                                 close_preferences),
+
+        unit_test(stats_report_has_no_samples_after_reset),
+        unit_test(stats_report_counts_samples),
+        unit_test(stats_report_counts_probes_separately),
+        unit_test(stats_report_shows_counters),
+
+        unit_test(workqueue_completes_jobs_in_order),
+        unit_test(workqueue_passthrough_waits_for_earlier_jobs),
+        unit_test(workqueue_not_pending_after_flush),
+
+        unit_test(mainloop_wakeup_makes_fd_readable),
+        unit_test(mainloop_drain_clears_wakeups),
+
+        unit_test(timestamp_parses_utc),
+        unit_test(timestamp_parses_fraction_and_offset),
+        unit_test(timestamp_parses_legacy_delay),
+        unit_test(timestamp_rejects_invalid),
+        unit_test(timestamp_local_keeps_instant),
+        unit_test(timestamp_format_follows_time),
+        unit_test(timestamp_local_from_usec_keeps_fraction),
+        unit_test(timestamp_to_iso8601_keeps_usec),
+
+        unit_test(history_format_escape_roundtrip),
+        unit_test(history_format_unescape_keeps_trailing_backslash),
+        unit_test(history_format_split_keeps_tabs_in_last_field),
+        unit_test(history_format_split_counts_short_line),
+        unit_test(history_format_chatlog_message),
+        unit_test(history_format_chatlog_action),
+        unit_test(history_format_chatlog_continuation),
+        unit_test(history_format_chatlog_invalid),
     };
 
     return run_tests(all_tests);
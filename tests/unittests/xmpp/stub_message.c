@@ -6,6 +6,12 @@ message_init(void)
     return NULL;
 }
 
+ProfMessage*
+message_ref(ProfMessage* message)
+{
+    return message;
+}
+
 void
 message_free(ProfMessage* message)
 {
@@ -277,6 +277,11 @@ presence_join_room(const char* const room, const char* const nick, const char* c
     check_expected(passwd);
 }
 
+void
+presence_join_room_queued(const char* const room, const char* const nick, const char* const passwd, gboolean affiliations)
+{
+}
+
 void
 presence_change_room_nick(const char* const room, const char* const nick)
 {